@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Check that changing the parameters of a function declared in a unit
+# invalidates the cached code of its callers.  The caller is compiled
+# twice with the same cache, once for each declaration of the callee,
+# which is defined in a separate unit compiled by the system compiler.
+#
+# usage: sh cache-signature.sh [scc]
+
+SCC=${1:-../phase6/scc}
+DIR=`mktemp -d` || exit 1
+trap 'rm -rf $DIR' 0
+
+for TYPE in int long; do
+    cat > $DIR/main.c <<END
+int printf(char *s, ...);
+long show($TYPE x);
+
+int main(void)
+{
+    printf("%ld\n", show(-6));
+    return 0;
+}
+END
+    cat > $DIR/show.c <<END
+long show($TYPE x) { return x; }
+END
+    $SCC --cache $DIR/cache < $DIR/main.c > $DIR/main.s &&
+	gcc -no-pie -o $DIR/a.out $DIR/main.s $DIR/show.c 2>/dev/null &&
+	test "`$DIR/a.out`" = -6 || { echo "cache-signature ... failed"; exit 1; }
+done
+
+echo "cache-signature ... ok"
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Check that a file of precompiled declarations that has been truncated
+# or damaged is rejected with a diagnostic, rather than silently missing
+# some of its declarations, and that the intact file is still accepted.
+#
+# usage: sh declarations-truncated.sh [scc]
+
+SCC=${1:-../phase6/scc}
+DIR=`mktemp -d` || exit 1
+trap 'rm -rf $DIR' 0
+
+cat > $DIR/lib.c <<END
+int counter;
+int table[10];
+long scale(long x, int factor) { return x * factor; }
+int printf(char *s, ...);
+END
+cat > $DIR/main.c <<END
+int main(void)
+{
+    counter = 3;
+    printf("%ld\n", scale(counter, 7));
+    return 0;
+}
+END
+
+fail() { echo "declarations-truncated ... failed"; exit 1; }
+
+$SCC --emit-decls $DIR/lib.decls < $DIR/lib.c > $DIR/lib.s || fail
+$SCC --use-decls $DIR/lib.decls < $DIR/main.c > $DIR/main.s || fail
+gcc -no-pie -o $DIR/a.out $DIR/main.s $DIR/lib.s 2>/dev/null || fail
+test "`$DIR/a.out`" = 21 || fail
+
+SIZE=`wc -c < $DIR/lib.decls`
+head -c `expr $SIZE - 8` $DIR/lib.decls > $DIR/short.decls
+$SCC --use-decls $DIR/short.decls < $DIR/main.c > /dev/null 2> $DIR/err && fail
+grep -q truncated $DIR/err || fail
+
+cp $DIR/lib.decls $DIR/bad.decls
+printf 'X' | dd of=$DIR/bad.decls bs=1 seek=`expr $SIZE - 4` conv=notrunc 2>/dev/null
+$SCC --use-decls $DIR/bad.decls < $DIR/main.c > /dev/null 2> $DIR/err && fail
+grep -q checksum $DIR/err || fail
+
+echo "declarations-truncated ... ok"
@@ -0,0 +1,42 @@
+#!/bin/sh
+#
+# Check that every unit of an instrumented program writes its counts,
+# and not just the unit defining main.  Each unit is instrumented as
+# assembly, and then again as object files written directly.
+#
+# usage: sh profile-units.sh [scc]
+
+SCC=${1:-../phase6/scc}
+case $SCC in /*) ;; *) SCC=`pwd`/$SCC ;; esac
+DIR=`mktemp -d` || exit 1
+trap 'rm -rf $DIR' 0
+
+cat > $DIR/main.c <<END
+int printf(char *s, ...);
+int twice(int x);
+
+int main(void)
+{
+    printf("%d\n", twice(21));
+    return 0;
+}
+END
+cat > $DIR/twice.c <<END
+int twice(int x)
+{
+    return x + x;
+}
+END
+
+cd $DIR
+
+for MODE in "" --emit-obj; do
+    rm -f scc.profile *.s *.o
+    $SCC $MODE --profile-generate main.c twice.c &&
+	gcc -no-pie -o a.out main.[so] twice.[so] 2>/dev/null &&
+	test "`./a.out`" = 42 &&
+	grep -q '^main ' scc.profile && grep -q '^twice ' scc.profile ||
+	{ echo "profile-units $MODE ... failed"; exit 1; }
+done
+
+echo "profile-units ... ok"
@@ -0,0 +1,163 @@
+/*
+ * File:	Arena.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		arenas.  An arena keeps every chunk it has ever allocated,
+ *		so once the first few functions have been compiled, the
+ *		arena for function bodies stops asking for memory and
+ *		just reuses its chunks.  Requests too large for a chunk
+ *		get a block of their own, which is freed on release.
+ */
+
+# include <cassert>
+# include <cstdint>
+# include "Arena.h"
+# include "Timer.h"
+
+using namespace std;
+
+# define CHUNK_SIZE 65536
+
+thread_local Arena *Arena::_current = nullptr;
+
+
+/*
+ * Function:	Arena::Arena (constructor)
+ *
+ * Description:	Initialize this arena to be empty.  No chunk is allocated
+ *		until the first request.
+ */
+
+Arena::Arena()
+    : _index(0), _next(nullptr), _limit(nullptr), _size(0)
+{
+}
+
+
+/*
+ * Function:	Arena::~Arena (destructor)
+ *
+ * Description:	Return all chunks to the system.
+ */
+
+Arena::~Arena()
+{
+    release();
+
+    for (auto chunk : _chunks)
+	delete[] chunk;
+
+    if (_current == this)
+	_current = nullptr;
+}
+
+
+/*
+ * Function:	Arena::allocate
+ *
+ * Description:	Allocate the given number of bytes with the given
+ *		alignment, which must be a power of two.  We move to the
+ *		next chunk if the request does not fit in this one.
+ */
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    uintptr_t ptr;
+    char *block;
+
+
+    assert(align > 0 && (align & (align - 1)) == 0);
+
+    if (Timer::enabled)
+	Timer::allocated(size);
+
+    ptr = ((uintptr_t) _next + align - 1) & ~(uintptr_t) (align - 1);
+
+    if (_next == nullptr || ptr + size > (uintptr_t) _limit) {
+	if (size + align > CHUNK_SIZE) {
+	    block = new char[size + align];
+	    _large.push_back(block);
+	    _size += size;
+
+	    ptr = ((uintptr_t) block + align - 1) & ~(uintptr_t) (align - 1);
+	    return (void *) ptr;
+	}
+
+	if (_next != nullptr)
+	    _index ++;
+
+	if (_index == _chunks.size())
+	    _chunks.push_back(new char[CHUNK_SIZE]);
+
+	_next = _chunks[_index];
+	_limit = _next + CHUNK_SIZE;
+	ptr = ((uintptr_t) _next + align - 1) & ~(uintptr_t) (align - 1);
+    }
+
+    _next = (char *) (ptr + size);
+    _size += size;
+    return (void *) ptr;
+}
+
+
+/*
+ * Function:	Arena::release
+ *
+ * Description:	Release everything allocated from this arena.  The regular
+ *		chunks are kept for reuse, so releasing takes constant time
+ *		unless large blocks were allocated.
+ */
+
+void Arena::release()
+{
+    for (auto block : _large)
+	delete[] block;
+
+    _large.clear();
+    _index = 0;
+    _next = _chunks.empty() ? nullptr : _chunks[0];
+    _limit = _chunks.empty() ? nullptr : _chunks[0] + CHUNK_SIZE;
+    _size = 0;
+}
+
+
+/*
+ * Function:	Arena::size (accessor)
+ *
+ * Description:	Return the number of bytes allocated since the arena was
+ *		last released.
+ */
+
+size_t Arena::size() const
+{
+    return _size;
+}
+
+
+/*
+ * Function:	Arena::current (accessor)
+ *
+ * Description:	Return the current arena, which had better exist.
+ */
+
+Arena *Arena::current()
+{
+    assert(_current != nullptr);
+    return _current;
+}
+
+
+/*
+ * Function:	Arena::use
+ *
+ * Description:	Make the given arena the current arena and return the
+ *		previous current arena.
+ */
+
+Arena *Arena::use(Arena *arena)
+{
+    Arena *previous = _current;
+
+    _current = arena;
+    return previous;
+}
@@ -0,0 +1,91 @@
+/*
+ * File:	Arena.h
+ *
+ * Description:	This file contains the class definition for arenas, which
+ *		are used to allocate the abstract syntax trees, symbols,
+ *		scopes, and parameter lists.  Allocation simply bumps a
+ *		pointer within the current chunk.  Nothing is ever freed
+ *		individually; instead, the entire arena is released at
+ *		once, which makes all of its chunks available for reuse.
+ *
+ *		We use one arena for the translation unit, holding
+ *		everything in the global scope, and one for the body of
+ *		each function being compiled, which is released after the
+ *		function has been generated.  The classes allocated from
+ *		arenas always use the current arena, which is selected by
+ *		the parser, or by the worker generating a function.  The
+ *		arenas belong to the context of the translation unit, and
+ *		each thread has its own current arena.
+ *
+ *		Destructors are not run when an arena is released, so the
+ *		container types used in the trees, scopes, and types use
+ *		an arena allocator as well.
+ */
+
+# ifndef ARENA_H
+# define ARENA_H
+# include <cstddef>
+# include <vector>
+
+class Arena {
+    std::vector<char *> _chunks, _large;
+    unsigned _index;
+    char *_next, *_limit;
+    size_t _size;
+
+    static thread_local Arena *_current;
+
+public:
+    Arena();
+    ~Arena();
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+    void release();
+    size_t size() const;
+
+    static Arena *current();
+    static Arena *use(Arena *arena);
+};
+
+
+/* An allocator for standard containers that allocates from the current
+   arena and never deallocates. */
+
+template<class T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    ArenaAllocator() {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+	return (T *) Arena::current()->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T *, size_t) {}
+};
+
+template<class T, class U>
+bool operator ==(const ArenaAllocator<T> &, const ArenaAllocator<U> &)
+{
+    return true;
+}
+
+template<class T, class U>
+bool operator !=(const ArenaAllocator<T> &, const ArenaAllocator<U> &)
+{
+    return false;
+}
+
+
+/* Classes allocated from the current arena inherit from this class. */
+
+struct Allocated {
+    static void *operator new(size_t size) {
+	return Arena::current()->allocate(size);
+    }
+
+    static void operator delete(void *) {}
+};
+
+# endif /* ARENA_H */
@@ -0,0 +1,1439 @@
+/*
+ * File:	Assembler.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the assembler.  The operands are in AT&T order and syntax,
+ *		as written by the code generator, and each instruction is
+ *		encoded much as the system assembler would encode it.
+ *
+ *		The text is kept without its jumps, which are recorded
+ *		separately along with their positions in the text.  A label
+ *		or fixup records its position and the number of jumps before
+ *		it, so its final address is its position plus the sizes of
+ *		those jumps.
+ *
+ *		The object file is written with the sections .text,
+ *		.rela.text, .rodata, .note.GNU-stack, .symtab, .strtab, and
+ *		.shstrtab, in that order.  The globals declared with .comm
+ *		remain common symbols, to be allocated by the linker.
+ */
+
+# include <elf.h>
+# include <cctype>
+# include <cstdlib>
+# include <charconv>
+# include <iostream>
+# include "Assembler.h"
+
+using namespace std;
+
+# define SHORT_JUMP 2
+# define NEAR_JUMP 5
+# define NEAR_BRANCH 6
+# define UNCONDITIONAL -1
+
+# define TEXT_SECTION 1
+# define RELA_SECTION 2
+# define RODATA_SECTION 3
+# define INIT_SECTION 4
+# define SYMTAB_SECTION 7
+# define STRTAB_SECTION 8
+# define SHSTRTAB_SECTION 9
+# define NUM_SECTIONS 10
+
+struct Assembler::Argument {
+    enum Kind {
+	REGISTER, IMMEDIATE, MEMORY,
+    };
+
+    Kind kind;
+    unsigned size;
+    int reg, base, index;
+    unsigned scale;
+    bool rex;
+    long value;
+    string_view symbol;
+};
+
+
+/*
+ * Function:	fail (private)
+ *
+ * Description:	Report that the given line cannot be assembled and exit.
+ *		The assembler only sees the code we generate, so this is
+ *		an internal error.
+ */
+
+static void fail(string_view text)
+{
+    cerr << "scc: cannot assemble \"" << text << "\"" << endl;
+    exit(EXIT_FAILURE);
+}
+
+
+/*
+ * Function:	trim (private)
+ *
+ * Description:	Return the given text without any leading or trailing
+ *		white space.
+ */
+
+static string_view trim(string_view text)
+{
+    while (!text.empty() && isspace((unsigned char) text.front()))
+	text.remove_prefix(1);
+
+    while (!text.empty() && isspace((unsigned char) text.back()))
+	text.remove_suffix(1);
+
+    return text;
+}
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Convert the given text to a decimal number, returning
+ *		whether the whole text is a number.
+ */
+
+static bool number(string_view text, long &value)
+{
+    if (!text.empty() && text[0] == '+')
+	text.remove_prefix(1);
+
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+    return !text.empty() && result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+
+/*
+ * Function:	put (private)
+ *
+ * Description:	Append the given value to the given bytes in the given
+ *		number of bytes, least significant byte first.
+ */
+
+static void put(string &bytes, unsigned long value, unsigned count)
+{
+    for (unsigned i = 0; i < count; i ++)
+	bytes += (char) (value >> (8 * i));
+}
+
+
+/*
+ * Function:	patch (private)
+ *
+ * Description:	Replace the four bytes at the given offset with the given
+ *		value, least significant byte first.
+ */
+
+static void patch(string &bytes, size_t offset, long value)
+{
+    for (unsigned i = 0; i < 4; i ++)
+	bytes[offset + i] = (char) (value >> (8 * i));
+}
+
+
+/*
+ * Function:	pad (private)
+ *
+ * Description:	Append the given number of bytes of padding to the given
+ *		bytes, using the longest no-ops recommended for all x86-64
+ *		processors.
+ */
+
+static void pad(string &bytes, size_t count)
+{
+    static const char *nops[] = {
+	"", "\x90", "\x66\x90", "\x0F\x1F\x00", "\x0F\x1F\x40\x00",
+	"\x0F\x1F\x44\x00\x00", "\x66\x0F\x1F\x44\x00\x00",
+	"\x0F\x1F\x80\x00\x00\x00\x00", "\x0F\x1F\x84\x00\x00\x00\x00\x00",
+	"\x66\x0F\x1F\x84\x00\x00\x00\x00\x00",
+    };
+
+    size_t size;
+
+
+    while (count > 0) {
+	size = min(count, (size_t) 9);
+	bytes.append(nops[size], size);
+	count -= size;
+    }
+}
+
+
+/*
+ * Function:	lookup (private)
+ *
+ * Description:	Find the number and size of the register with the given
+ *		name, returning whether there is such a register.  The low
+ *		bytes of %rsp, %rbp, %rsi, and %rdi can only be named with
+ *		a REX prefix.  A vector register is 16 bytes.
+ */
+
+static bool lookup(string_view name, int &number, unsigned &size, bool &rex)
+{
+    static const char *names[][16] = {
+	{"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+	 "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+	{"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+	 "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+	{"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+	 "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+	{"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+	 "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+	{"xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+	 "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"},
+    };
+
+    static const unsigned sizes[] = {8, 4, 2, 1, 16};
+
+    static const unordered_map<string_view, pair<int, unsigned>> registers = []() {
+	unordered_map<string_view, pair<int, unsigned>> registers;
+
+	for (unsigned i = 0; i < 5; i ++)
+	    for (int j = 0; j < 16; j ++)
+		registers[names[i][j]] = make_pair(j, sizes[i]);
+
+	return registers;
+    }();
+
+
+    auto it = registers.find(name);
+
+    if (it == registers.end())
+	return false;
+
+    number = it->second.first;
+    size = it->second.second;
+    rex = size == 1 && number >= 4 && number < 8;
+    return true;
+}
+
+
+/*
+ * Function:	condition (private)
+ *
+ * Description:	Return the code of the condition with the given name as
+ *		used in a conditional jump or set, or -1 if there is none.
+ */
+
+static int condition(string_view name)
+{
+    static const unordered_map<string_view, int> codes = {
+	{"o", 0}, {"no", 1}, {"b", 2}, {"c", 2}, {"nae", 2}, {"ae", 3},
+	{"nb", 3}, {"nc", 3}, {"e", 4}, {"z", 4}, {"ne", 5}, {"nz", 5},
+	{"be", 6}, {"na", 6}, {"a", 7}, {"nbe", 7}, {"s", 8}, {"ns", 9},
+	{"p", 10}, {"pe", 10}, {"np", 11}, {"po", 11}, {"l", 12},
+	{"nge", 12}, {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14},
+	{"g", 15}, {"nle", 15},
+    };
+
+    auto it = codes.find(name);
+    return it != codes.end() ? it->second : -1;
+}
+
+
+/*
+ * Function:	fits (private)
+ *
+ * Description:	Return whether the given immediate value of an operation
+ *		of the given size can be encoded as a signed byte.  An
+ *		immediate of a smaller operation is only its low bytes.
+ */
+
+static bool fits(long value, unsigned size)
+{
+    if (size == 4)
+	value = (int) value;
+    else if (size == 2)
+	value = (short) value;
+
+    return value == (signed char) value;
+}
+
+
+/*
+ * Function:	Assembler::Assembler (constructor)
+ *
+ * Description:	Initialize this assembler to assemble into the text.
+ */
+
+Assembler::Assembler()
+    : _section(TEXT)
+{
+}
+
+
+/*
+ * Function:	Assembler::argument (private)
+ *
+ * Description:	Parse the given text as an operand, returning whether it
+ *		is valid.  A memory operand has an optional displacement,
+ *		which is a number or a symbol plus or minus a number, and
+ *		then an optional base, index, and scale in parentheses.
+ */
+
+bool Assembler::argument(string_view text, Argument &arg)
+{
+    string_view disp, parts[3];
+    size_t paren, sign, comma;
+    unsigned i, size;
+    long scale;
+    bool rex;
+
+
+    arg = Argument {Argument::MEMORY, 0, -1, -1, -1, 1, false, 0, ""};
+
+    if (text.empty())
+	return false;
+
+    if (text[0] == '$') {
+	arg.kind = Argument::IMMEDIATE;
+	return number(text.substr(1), arg.value);
+    }
+
+    if (text[0] == '%') {
+	arg.kind = Argument::REGISTER;
+	return lookup(text.substr(1), arg.reg, arg.size, arg.rex);
+    }
+
+    paren = text.find('(');
+    disp = text.substr(0, paren);
+
+    if (!disp.empty()) {
+	if (isdigit((unsigned char) disp[0]) || disp[0] == '-') {
+	    if (!number(disp, arg.value))
+		return false;
+
+	} else {
+	    sign = disp.find_first_of("+-");
+	    arg.symbol = disp.substr(0, sign);
+
+	    if (sign != string_view::npos && !number(disp.substr(sign), arg.value))
+		return false;
+	}
+    }
+
+    if (paren == string_view::npos)
+	return true;
+
+    if (text.back() != ')')
+	return false;
+
+    text = text.substr(paren + 1, text.size() - paren - 2);
+
+    for (i = 0; i < 3; i ++) {
+	comma = text.find(',');
+	parts[i] = trim(text.substr(0, comma));
+
+	if (comma == string_view::npos)
+	    break;
+
+	text.remove_prefix(comma + 1);
+    }
+
+    if (i == 3)
+	return false;
+
+    if (!parts[0].empty())
+	if (parts[0][0] != '%' || !lookup(parts[0].substr(1), arg.base, size, rex) || size != 8)
+	    return false;
+
+    if (!parts[1].empty())
+	if (parts[1][0] != '%' || !lookup(parts[1].substr(1), arg.index, size, rex) || size != 8 || arg.index == 4)
+	    return false;
+
+    if (!parts[2].empty()) {
+	if (!number(parts[2], scale) || (scale != 1 && scale != 2 && scale != 4 && scale != 8))
+	    return false;
+
+	arg.scale = scale;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	Assembler::assemble
+ *
+ * Description:	Assemble the given text, which need not end with a
+ *		complete line.  An incomplete line is kept until the rest
+ *		of it is assembled.
+ */
+
+void Assembler::assemble(string_view text)
+{
+    size_t newline;
+
+
+    if (!_partial.empty()) {
+	newline = text.find('\n');
+
+	if (newline == string_view::npos) {
+	    _partial += text;
+	    return;
+	}
+
+	_partial += text.substr(0, newline);
+	line(_partial);
+	_partial.clear();
+	text.remove_prefix(newline + 1);
+    }
+
+    while ((newline = text.find('\n')) != string_view::npos) {
+	line(text.substr(0, newline));
+	text.remove_prefix(newline + 1);
+    }
+
+    _partial = text;
+}
+
+
+/*
+ * Function:	Assembler::line (private)
+ *
+ * Description:	Assemble a single line, which is a label, a directive, or
+ *		an instruction, or a label followed by either.  A label
+ *		starts at the beginning of the line.
+ */
+
+void Assembler::line(string_view text)
+{
+    string_view rest = text, name;
+    vector<Argument> args;
+    size_t colon, space, comma;
+    int depth;
+
+
+    if (!rest.empty() && !isspace((unsigned char) rest[0])) {
+	colon = rest.find(':');
+
+	if (colon == string_view::npos)
+	    fail(text);
+
+	Label &label = _labels[string(rest.substr(0, colon))];
+
+	label.section = _section;
+	label.position = _section == TEXT ? _text.size() : _rodata.size();
+	label.jumps = _jumps.size();
+	rest.remove_prefix(colon + 1);
+    }
+
+    rest = trim(rest);
+
+    if (rest.empty())
+	return;
+
+    space = 0;
+
+    while (space < rest.size() && !isspace((unsigned char) rest[space]))
+	space ++;
+
+    name = rest.substr(0, space);
+    rest = trim(rest.substr(space));
+
+    if (name[0] == '.') {
+	directive(name, rest, text);
+	return;
+    }
+
+    while (!rest.empty()) {
+	for (comma = 0, depth = 0; comma < rest.size(); comma ++)
+	    if (rest[comma] == '(')
+		depth ++;
+	    else if (rest[comma] == ')')
+		depth --;
+	    else if (rest[comma] == ',' && depth == 0)
+		break;
+
+	args.emplace_back();
+
+	if (!argument(trim(rest.substr(0, comma)), args.back()))
+	    fail(text);
+
+	rest.remove_prefix(comma < rest.size() ? comma + 1 : comma);
+	rest = trim(rest);
+    }
+
+    if (args.size() > 2)
+	fail(text);
+
+    instruction(name, args, text);
+}
+
+
+/*
+ * Function:	Assembler::directive (private)
+ *
+ * Description:	Assemble the directive with the given name and operands.
+ *		A string is written with its characters escaped as in C.
+ *		The padding aligning the text is left to be chosen along
+ *		with the sizes of the jumps, whereas the read-only data is
+ *		simply padded with zeroes.  Each entry of the constructors
+ *		is the size of a pointer anyway, and so needs no padding.
+ */
+
+void Assembler::directive(string_view name, string_view rest, string_view text)
+{
+    string &bytes = _section == TEXT ? _text : _rodata;
+    size_t comma, i;
+    long size;
+    char c;
+
+
+    if (name == ".globl")
+	_globals.emplace_back(rest);
+
+    else if (name == ".comm") {
+	comma = rest.find(',');
+
+	if (comma == string_view::npos || !number(trim(rest.substr(comma + 1)), size))
+	    fail(text);
+
+	_common.emplace_back(string(trim(rest.substr(0, comma))), size);
+
+    } else if (name == ".text")
+	_section = TEXT;
+
+    else if (name == ".section" && rest == ".text")
+	_section = TEXT;
+
+    else if (name == ".section" && rest == ".rodata")
+	_section = RODATA;
+
+    else if (name == ".section" && rest.substr(0, rest.find(',')) == ".init_array")
+	_section = INIT;
+
+    else if (name == ".quad" && _section == INIT)
+	_constructors.emplace_back(rest);
+
+    else if (name == ".p2align") {
+	if (!number(rest, size) || size < 0 || size > 12)
+	    fail(text);
+
+	if (_section == TEXT)
+	    _jumps.push_back({_text.size(), UNCONDITIONAL, false, "", 1U << size});
+	else if (_section == RODATA)
+	    while (bytes.size() % (1UL << size) != 0)
+		bytes += '\0';
+
+    } else if (name == ".asciz" || name == ".string") {
+	if (rest.size() < 2 || rest.front() != '"' || rest.back() != '"')
+	    fail(text);
+
+	for (i = 1; i < rest.size() - 1; i ++) {
+	    if (rest[i] != '\\') {
+		bytes += rest[i];
+		continue;
+	    }
+
+	    c = rest[++ i];
+
+	    if (c >= '0' && c <= '7') {
+		for (c = 0; i < rest.size() - 1 && rest[i] >= '0' && rest[i] <= '7'; i ++)
+		    c = c * 8 + rest[i] - '0';
+
+		i --;
+	    } else if (c == 'n')
+		c = '\n';
+	    else if (c == 't')
+		c = '\t';
+
+	    bytes += c;
+	}
+
+	bytes += '\0';
+
+    } else
+	fail(text);
+}
+
+
+/*
+ * Function:	Assembler::immediate (private)
+ *
+ * Description:	Append an immediate value of the given size to the text.
+ */
+
+void Assembler::immediate(long value, unsigned bytes)
+{
+    put(_text, value, bytes);
+}
+
+
+/*
+ * Function:	Assembler::encode (private)
+ *
+ * Description:	Append an instruction of the given size with the given
+ *		opcode, register field, and register or memory operand to
+ *		the text, preceded by any prefixes needed.  A symbolic
+ *		displacement is always four bytes and leaves a fixup.
+ */
+
+void Assembler::encode(initializer_list<unsigned char> opcode, unsigned size,
+	unsigned reg, const Argument &rm, bool rex)
+{
+    unsigned char prefix = 0x40, mod;
+    unsigned scale;
+    long disp;
+
+
+    if (size == 8)
+	prefix |= 8;
+
+    if (reg & 8)
+	prefix |= 4;
+
+    if (rm.kind == Argument::REGISTER) {
+	if (rm.reg & 8)
+	    prefix |= 1;
+
+	rex = rex || rm.rex;
+
+    } else {
+	if (rm.index >= 0 && (rm.index & 8))
+	    prefix |= 2;
+
+	if (rm.base >= 0 && (rm.base & 8))
+	    prefix |= 1;
+    }
+
+    if (size == 2)
+	_text += (char) 0x66;
+
+    if (prefix != 0x40 || rex)
+	_text += (char) prefix;
+
+    for (auto byte : opcode)
+	_text += (char) byte;
+
+    reg &= 7;
+
+    if (rm.kind == Argument::REGISTER) {
+	_text += (char) (0xC0 | reg << 3 | (rm.reg & 7));
+	return;
+    }
+
+    disp = rm.value;
+    scale = rm.scale == 8 ? 3 : (rm.scale == 4 ? 2 : (rm.scale == 2 ? 1 : 0));
+
+    if (rm.base < 0) {
+	_text += (char) (0x04 | reg << 3);
+	_text += (char) (scale << 6 | (rm.index < 0 ? 4 : rm.index & 7) << 3 | 5);
+	mod = 2;
+
+    } else {
+	if (!rm.symbol.empty() || disp != (signed char) disp)
+	    mod = 2;
+	else if (disp != 0 || (rm.base & 7) == 5)
+	    mod = 1;
+	else
+	    mod = 0;
+
+	if (rm.index < 0 && (rm.base & 7) != 4)
+	    _text += (char) (mod << 6 | reg << 3 | (rm.base & 7));
+	else {
+	    _text += (char) (mod << 6 | reg << 3 | 4);
+	    _text += (char) (scale << 6 | (rm.index < 0 ? 4 : rm.index & 7) << 3 | (rm.base & 7));
+	}
+    }
+
+    if (mod == 1)
+	_text += (char) disp;
+
+    else if (mod == 2) {
+	if (!rm.symbol.empty()) {
+	    _fixups.push_back({_text.size(), _jumps.size(), ABSOLUTE, string(rm.symbol), disp});
+	    disp = 0;
+	}
+
+	put(_text, disp, 4);
+    }
+}
+
+
+/*
+ * Function:	Assembler::instruction (private)
+ *
+ * Description:	Assemble the instruction with the given name and operands.
+ *		The size of an instruction is given by the suffix of its
+ *		name, or else by its register operands.
+ */
+
+void Assembler::instruction(string_view name, vector<Argument> &args, string_view text)
+{
+    static const unordered_map<string_view, unsigned> arithmetic = {
+	{"add", 0}, {"or", 1}, {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7},
+    };
+
+    static const unordered_map<string_view, unsigned> unary = {
+	{"not", 2}, {"neg", 3}, {"mul", 4}, {"div", 6}, {"idiv", 7},
+    };
+
+    static const unordered_map<string_view, unsigned> shifts = {
+	{"rol", 0}, {"ror", 1}, {"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7},
+    };
+
+    static const unordered_map<string_view, pair<unsigned char, unsigned char>> packed = {
+	{"movdqa", {0x66, 0x6F}}, {"movdqu", {0xF3, 0x6F}}, {"pxor", {0x66, 0xEF}},
+	{"paddb", {0x66, 0xFC}}, {"paddd", {0x66, 0xFE}}, {"paddq", {0x66, 0xD4}},
+	{"psubb", {0x66, 0xF8}}, {"psubd", {0x66, 0xFA}}, {"psubq", {0x66, 0xFB}},
+	{"pcmpeqb", {0x66, 0x74}}, {"pcmpeqd", {0x66, 0x76}},
+	{"pcmpgtb", {0x66, 0x64}}, {"pcmpgtd", {0x66, 0x66}},
+	{"punpcklbw", {0x66, 0x60}}, {"punpcklwd", {0x66, 0x61}},
+	{"punpckldq", {0x66, 0x62}}, {"punpcklqdq", {0x66, 0x6C}},
+    };
+
+    static const unordered_map<string_view, pair<unsigned char, unsigned>> extensions = {
+	{"movzb", {0xB6, 1}}, {"movzw", {0xB7, 2}},
+	{"movsb", {0xBE, 1}}, {"movsw", {0xBF, 2}}, {"movsl", {0x63, 4}},
+    };
+
+    const Argument *source = args.size() == 2 ? &args[0] : nullptr;
+    const Argument *target = args.empty() ? nullptr : &args.back();
+    string_view base = name;
+    unsigned size = 0, n;
+    long value = 0;
+    int cc = -1;
+
+
+    if (_section != TEXT)
+	fail(text);
+
+
+    /* Instructions without any operands */
+
+    if (args.empty()) {
+	if (name == "ret")
+	    _text += (char) 0xC3;
+	else if (name == "leave")
+	    _text += (char) 0xC9;
+	else if (name == "nop")
+	    _text += (char) 0x90;
+	else if (name == "cltd")
+	    _text += (char) 0x99;
+	else if (name == "cqto")
+	    _text += "\x48\x99";
+	else if (name == "cltq")
+	    _text += "\x48\x98";
+	else
+	    fail(text);
+
+	return;
+    }
+
+
+    /* Calls and jumps, whose target must be a label */
+
+    if (name == "call" || name == "jmp" || (name[0] == 'j' && (cc = condition(name.substr(1))) >= 0)) {
+	if (args.size() != 1 || target->kind != Argument::MEMORY || target->symbol.empty())
+	    fail(text);
+
+	if (target->base >= 0 || target->index >= 0 || target->value != 0)
+	    fail(text);
+
+	if (name == "call") {
+	    _text += (char) 0xE8;
+	    _fixups.push_back({_text.size(), _jumps.size(), RELATIVE, string(target->symbol), 0});
+	    immediate(0, 4);
+	} else
+	    _jumps.push_back({_text.size(), name == "jmp" ? UNCONDITIONAL : cc, false, string(target->symbol), 0});
+
+	return;
+    }
+
+
+    /* Setting a byte on a condition */
+
+    if (name.substr(0, 3) == "set" && (cc = condition(name.substr(3))) >= 0) {
+	if (args.size() != 1 || target->kind == Argument::IMMEDIATE)
+	    fail(text);
+
+	if (target->kind == Argument::REGISTER && target->size != 1)
+	    fail(text);
+
+	encode({0x0F, (unsigned char) (0x90 + cc)}, 1, 0, *target);
+	return;
+    }
+
+
+    /* Moving a 64-bit immediate */
+
+    if (name == "movabsq") {
+	if (source == nullptr || source->kind != Argument::IMMEDIATE)
+	    fail(text);
+
+	if (target->kind != Argument::REGISTER || target->size != 8)
+	    fail(text);
+
+	_text += (char) (target->reg & 8 ? 0x49 : 0x48);
+	_text += (char) (0xB8 + (target->reg & 7));
+	immediate(source->value, 8);
+	return;
+    }
+
+
+    /* Sign and zero extension, with the sizes of both operands */
+
+    if (name.size() == 6 && extensions.count(name.substr(0, 5)) > 0) {
+	auto &extension = extensions.at(name.substr(0, 5));
+
+	size = name[5] == 'w' ? 2 : (name[5] == 'l' ? 4 : (name[5] == 'q' ? 8 : 0));
+
+	if (source == nullptr || size <= extension.second)
+	    fail(text);
+
+	if (target->kind != Argument::REGISTER || target->size != size)
+	    fail(text);
+
+	if (source->kind == Argument::IMMEDIATE)
+	    fail(text);
+
+	if (source->kind == Argument::REGISTER && source->size != extension.second)
+	    fail(text);
+
+	if (extension.first == 0x63)
+	    encode({0x63}, size, target->reg, *source);
+	else
+	    encode({0x0F, extension.first}, size, target->reg, *source);
+
+	return;
+    }
+
+
+    /* Instructions on vector registers, whose mandatory prefix precedes
+       any REX prefix, and which store with the opcode of a load plus
+       sixteen */
+
+    if (packed.count(name) > 0) {
+	auto &opcode = packed.at(name);
+
+	if (source == nullptr || source->kind == Argument::IMMEDIATE)
+	    fail(text);
+
+	if (source->kind == Argument::REGISTER && source->size != 16)
+	    fail(text);
+
+	_text += (char) opcode.first;
+
+	if (target->kind == Argument::REGISTER && target->size == 16)
+	    encode({0x0F, opcode.second}, 4, target->reg, *source);
+	else if (target->kind == Argument::MEMORY && source->kind == Argument::REGISTER && opcode.second == 0x6F)
+	    encode({0x0F, 0x7F}, 4, source->reg, *target);
+	else
+	    fail(text);
+
+	return;
+    }
+
+
+    /* Moving a general register into a vector register */
+
+    if (name == "movd") {
+	if (source == nullptr || source->kind != Argument::REGISTER || source->size < 4)
+	    fail(text);
+
+	if (target->kind != Argument::REGISTER || target->size != 16)
+	    fail(text);
+
+	_text += (char) 0x66;
+	encode({0x0F, 0x6E}, source->size, target->reg, *source);
+	return;
+    }
+
+
+    /* Everything else, whose size is given by its suffix if it has one,
+       and otherwise by its target or source register */
+
+    auto known = [&](string_view op) {
+	return arithmetic.count(op) > 0 || unary.count(op) > 0
+	    || shifts.count(op) > 0 || op == "mov" || op == "lea"
+	    || op == "test" || op == "imul" || op == "push" || op == "pop"
+	    || op == "inc" || op == "dec";
+    };
+
+    if (!known(base) && base.size() > 1) {
+	switch (base.back()) {
+	case 'b': size = 1; break;
+	case 'w': size = 2; break;
+	case 'l': size = 4; break;
+	case 'q': size = 8; break;
+	}
+
+	if (size != 0)
+	    base.remove_suffix(1);
+    }
+
+    if (!known(base))
+	fail(text);
+
+    if (size == 0) {
+	if (target->kind == Argument::REGISTER)
+	    size = target->size;
+	else if (source != nullptr && source->kind == Argument::REGISTER && shifts.count(base) == 0)
+	    size = source->size;
+	else
+	    fail(text);
+    }
+
+    if (target->kind == Argument::REGISTER && target->size != size)
+	fail(text);
+
+    if (source != nullptr && source->kind == Argument::REGISTER && source->size != size)
+	if (shifts.count(base) == 0)
+	    fail(text);
+
+    if (source != nullptr && source->kind == Argument::IMMEDIATE) {
+	value = source->value;
+
+	if (size == 8 && value != (int) value && base != "mov")
+	    fail(text);
+    }
+
+    if (base == "push" || base == "pop") {
+	if (source != nullptr || size != 8)
+	    fail(text);
+
+	if (target->kind == Argument::REGISTER) {
+	    if (target->reg & 8)
+		_text += (char) 0x41;
+
+	    _text += (char) ((base == "push" ? 0x50 : 0x58) + (target->reg & 7));
+
+	} else if (target->kind == Argument::MEMORY)
+	    encode({(unsigned char) (base == "push" ? 0xFF : 0x8F)}, 4, base == "push" ? 6 : 0, *target);
+
+	else if (base == "push" && fits(target->value, 8)) {
+	    _text += (char) 0x6A;
+	    immediate(target->value, 1);
+
+	} else if (base == "push" && target->value == (int) target->value) {
+	    _text += (char) 0x68;
+	    immediate(target->value, 4);
+
+	} else
+	    fail(text);
+
+	return;
+    }
+
+    if (target->kind == Argument::IMMEDIATE)
+	fail(text);
+
+    if (source != nullptr && source->kind == Argument::MEMORY && target->kind == Argument::MEMORY)
+	fail(text);
+
+    if (base == "mov") {
+	if (source == nullptr)
+	    fail(text);
+
+	if (source->kind == Argument::IMMEDIATE) {
+	    if (size == 8 && value != (int) value) {
+		if (target->kind != Argument::REGISTER)
+		    fail(text);
+
+		_text += (char) (target->reg & 8 ? 0x49 : 0x48);
+		_text += (char) (0xB8 + (target->reg & 7));
+		immediate(value, 8);
+
+	    } else if (target->kind == Argument::REGISTER && size != 8) {
+		if (size == 2)
+		    _text += (char) 0x66;
+
+		if ((target->reg & 8) || target->rex)
+		    _text += (char) (target->reg & 8 ? 0x41 : 0x40);
+
+		_text += (char) ((size == 1 ? 0xB0 : 0xB8) + (target->reg & 7));
+		immediate(value, size);
+
+	    } else {
+		encode({(unsigned char) (size == 1 ? 0xC6 : 0xC7)}, size, 0, *target);
+		immediate(value, min(size, 4U));
+	    }
+
+	} else if (source->kind == Argument::REGISTER)
+	    encode({(unsigned char) (size == 1 ? 0x88 : 0x89)}, size, source->reg, *target, source->rex);
+	else
+	    encode({(unsigned char) (size == 1 ? 0x8A : 0x8B)}, size, target->reg, *source, target->rex);
+
+    } else if (base == "lea") {
+	if (source == nullptr || source->kind != Argument::MEMORY)
+	    fail(text);
+
+	if (target->kind != Argument::REGISTER || size == 1)
+	    fail(text);
+
+	encode({0x8D}, size, target->reg, *source);
+
+    } else if (arithmetic.count(base) > 0) {
+	n = arithmetic.at(base);
+
+	if (source == nullptr)
+	    fail(text);
+
+	if (source->kind == Argument::IMMEDIATE) {
+	    if (size == 1) {
+		encode({0x80}, size, n, *target);
+		immediate(value, 1);
+	    } else if (fits(value, size)) {
+		encode({0x83}, size, n, *target);
+		immediate(value, 1);
+	    } else {
+		encode({0x81}, size, n, *target);
+		immediate(value, min(size, 4U));
+	    }
+
+	} else if (source->kind == Argument::REGISTER)
+	    encode({(unsigned char) (n * 8 + (size == 1 ? 0 : 1))}, size, source->reg, *target, source->rex);
+	else
+	    encode({(unsigned char) (n * 8 + (size == 1 ? 2 : 3))}, size, target->reg, *source, target->rex);
+
+    } else if (base == "test") {
+	if (source == nullptr)
+	    fail(text);
+
+	if (source->kind == Argument::IMMEDIATE) {
+	    encode({(unsigned char) (size == 1 ? 0xF6 : 0xF7)}, size, 0, *target);
+	    immediate(value, min(size, 4U));
+	} else if (source->kind == Argument::REGISTER)
+	    encode({(unsigned char) (size == 1 ? 0x84 : 0x85)}, size, source->reg, *target, source->rex);
+	else
+	    encode({(unsigned char) (size == 1 ? 0x84 : 0x85)}, size, target->reg, *source, target->rex);
+
+    } else if (base == "imul") {
+	if (source == nullptr)
+	    encode({(unsigned char) (size == 1 ? 0xF6 : 0xF7)}, size, 5, *target);
+
+	else if (target->kind != Argument::REGISTER || size == 1)
+	    fail(text);
+
+	else if (source->kind == Argument::IMMEDIATE) {
+	    if (fits(value, size)) {
+		encode({0x6B}, size, target->reg, *target);
+		immediate(value, 1);
+	    } else {
+		encode({0x69}, size, target->reg, *target);
+		immediate(value, min(size, 4U));
+	    }
+
+	} else
+	    encode({0x0F, 0xAF}, size, target->reg, *source);
+
+    } else if (unary.count(base) > 0 || base == "inc" || base == "dec") {
+	if (source != nullptr)
+	    fail(text);
+
+	if (base == "inc" || base == "dec")
+	    encode({(unsigned char) (size == 1 ? 0xFE : 0xFF)}, size, base == "dec", *target);
+	else
+	    encode({(unsigned char) (size == 1 ? 0xF6 : 0xF7)}, size, unary.at(base), *target);
+
+    } else {
+	n = shifts.at(base);
+
+	if (source == nullptr || (source->kind == Argument::IMMEDIATE && value == 1))
+	    encode({(unsigned char) (size == 1 ? 0xD0 : 0xD1)}, size, n, *target);
+
+	else if (source->kind == Argument::IMMEDIATE) {
+	    encode({(unsigned char) (size == 1 ? 0xC0 : 0xC1)}, size, n, *target);
+	    immediate(value, 1);
+
+	} else if (source->kind == Argument::REGISTER && source->reg == 1 && source->size == 1)
+	    encode({(unsigned char) (size == 1 ? 0xD2 : 0xD3)}, size, n, *target);
+
+	else
+	    fail(text);
+    }
+}
+
+
+/*
+ * Function:	Assembler::address (private)
+ *
+ * Description:	Return the address of the given label within its section,
+ *		once the sizes of the jumps are known.
+ */
+
+size_t Assembler::address(const Label &label) const
+{
+    if (label.section != TEXT)
+	return label.position;
+
+    return label.position + _extra[label.jumps];
+}
+
+
+/*
+ * Function:	Assembler::link
+ *
+ * Description:	Choose the size of each jump, and then return the final
+ *		text along with the relocations still needed.  A jump to a
+ *		label outside the text is always near, and so is any jump
+ *		whose target is too far away for a short jump.  As the text
+ *		only grows, so do the distances, and so a short jump is
+ *		lengthened at most once.  The padding before a label
+ *		aligned in the text may shrink as the jumps before it grow,
+ *		but the label itself never moves back, and every short jump
+ *		is checked again once the sizes no longer change.  A call
+ *		to a label in the text is resolved here, and any other call
+ *		is through the PLT.
+ */
+
+void Assembler::link(string &text, vector<Relocation> &relocations)
+{
+    size_t i, last, offset;
+    bool changed = true;
+    long from, to;
+
+
+    _extra.assign(_jumps.size() + 1, 0);
+
+    while (changed) {
+	changed = false;
+
+	for (i = 0; i < _jumps.size(); i ++) {
+	    const Jump &jump = _jumps[i];
+
+	    if (jump.alignment > 0)
+		_extra[i + 1] = _extra[i] + (-(jump.position + _extra[i]) & (jump.alignment - 1));
+	    else if (!jump.near)
+		_extra[i + 1] = _extra[i] + SHORT_JUMP;
+	    else
+		_extra[i + 1] = _extra[i] + (jump.condition == UNCONDITIONAL ? NEAR_JUMP : NEAR_BRANCH);
+	}
+
+	for (i = 0; i < _jumps.size(); i ++) {
+	    Jump &jump = _jumps[i];
+	    auto it = _labels.find(jump.target);
+
+	    if (jump.near || jump.alignment > 0)
+		continue;
+
+	    if (it == _labels.end() || it->second.section != TEXT) {
+		jump.near = changed = true;
+		continue;
+	    }
+
+	    from = jump.position + _extra[i] + SHORT_JUMP;
+	    to = address(it->second);
+
+	    if (to - from != (signed char) (to - from))
+		jump.near = changed = true;
+	}
+    }
+
+    text.clear();
+    relocations.clear();
+    last = 0;
+
+    for (i = 0; i < _jumps.size(); i ++) {
+	const Jump &jump = _jumps[i];
+	auto it = _labels.find(jump.target);
+
+	text.append(_text, last, jump.position - last);
+	last = jump.position;
+
+	if (jump.alignment > 0) {
+	    pad(text, _extra[i + 1] - _extra[i]);
+	    continue;
+	}
+
+	if (!jump.near) {
+	    to = address(it->second);
+	    text += (char) (jump.condition == UNCONDITIONAL ? 0xEB : 0x70 + jump.condition);
+	    text += (char) (to - (long) (text.size() + 1));
+	    continue;
+	}
+
+	if (jump.condition == UNCONDITIONAL)
+	    text += (char) 0xE9;
+	else {
+	    text += (char) 0x0F;
+	    text += (char) (0x80 + jump.condition);
+	}
+
+	if (it != _labels.end() && it->second.section == TEXT)
+	    put(text, address(it->second) - (text.size() + 4), 4);
+	else {
+	    relocations.push_back({text.size(), RELATIVE, EXTERNAL, jump.target, -4});
+	    put(text, 0, 4);
+	}
+    }
+
+    text.append(_text, last, string::npos);
+
+    for (auto &fixup : _fixups) {
+	auto it = _labels.find(fixup.symbol);
+
+	offset = fixup.position + _extra[fixup.jumps];
+
+	if (it == _labels.end()) {
+	    relocations.push_back({offset, fixup.type, EXTERNAL, fixup.symbol,
+		fixup.addend - (fixup.type == RELATIVE ? 4 : 0)});
+
+	} else if (fixup.type == RELATIVE && it->second.section == TEXT)
+	    patch(text, offset, address(it->second) + fixup.addend - (offset + 4));
+
+	else {
+	    relocations.push_back({offset, fixup.type, it->second.section, "",
+		(long) address(it->second) + fixup.addend - (fixup.type == RELATIVE ? 4 : 0)});
+	}
+    }
+}
+
+
+/*
+ * Function:	Assembler::rodata (accessor)
+ *
+ * Description:	Return the read-only data.
+ */
+
+const string &Assembler::rodata() const
+{
+    return _rodata;
+}
+
+
+/*
+ * Function:	Assembler::common (accessor)
+ *
+ * Description:	Return the name and size of each common symbol.
+ */
+
+const vector<pair<string, unsigned long>> &Assembler::common() const
+{
+    return _common;
+}
+
+
+/*
+ * Function:	Assembler::functions
+ *
+ * Description:	Return the name and address of each global label defined
+ *		in the text.  The text must already be linked.
+ */
+
+vector<pair<string, size_t>> Assembler::functions() const
+{
+    vector<pair<string, size_t>> functions;
+
+
+    for (auto &name : _globals) {
+	auto it = _labels.find(name);
+
+	if (it != _labels.end() && it->second.section == TEXT)
+	    functions.emplace_back(name, address(it->second));
+    }
+
+    return functions;
+}
+
+
+/*
+ * Function:	Assembler::constructors
+ *
+ * Description:	Return the address in the text of each constructor, in the
+ *		order given.  The text must already be linked.
+ */
+
+vector<size_t> Assembler::constructors() const
+{
+    vector<size_t> constructors;
+
+
+    for (auto &name : _constructors) {
+	auto it = _labels.find(name);
+
+	if (it != _labels.end() && it->second.section == TEXT)
+	    constructors.push_back(address(it->second));
+    }
+
+    return constructors;
+}
+
+
+/*
+ * Function:	Assembler::write
+ *
+ * Description:	Write everything assembled as an ELF64 relocatable object
+ *		file to the given stream.  The local symbols are just those
+ *		of the sections, and the global ones are the functions
+ *		defined, followed by the common symbols and then the
+ *		external symbols referenced.  A common symbol is aligned
+ *		as the system assembler would align it, to the largest
+ *		power of two not exceeding its size, up to sixteen.  Each
+ *		constructor is an entry of the .init_array section, which
+ *		is relocated to its address in the text.
+ */
+
+void Assembler::write(ostream &ostr)
+{
+    string text, rela, init, initrela, symtab, strtab(1, '\0'), shstrtab(1, '\0'), none;
+    unordered_map<string, unsigned> indices;
+    vector<Relocation> relocations;
+    Elf64_Shdr headers[NUM_SECTIONS];
+    Elf64_Ehdr header;
+    Elf64_Off offset;
+    unsigned locals;
+    size_t i;
+
+
+    link(text, relocations);
+
+    auto symbol = [&](const string &name, unsigned binding, unsigned type,
+	    unsigned section, unsigned long value, unsigned long size) {
+	Elf64_Sym sym = {};
+
+	if (!name.empty()) {
+	    sym.st_name = strtab.size();
+	    strtab += name + '\0';
+	}
+
+	sym.st_info = ELF64_ST_INFO(binding, type);
+	sym.st_shndx = section;
+	sym.st_value = value;
+	sym.st_size = size;
+	symtab.append((const char *) &sym, sizeof(sym));
+	return symtab.size() / sizeof(sym) - 1;
+    };
+
+    symbol("", STB_LOCAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+    symbol("", STB_LOCAL, STT_SECTION, TEXT_SECTION, 0, 0);
+    symbol("", STB_LOCAL, STT_SECTION, RODATA_SECTION, 0, 0);
+    locals = symtab.size() / sizeof(Elf64_Sym);
+
+    for (auto &function : functions())
+	if (indices.count(function.first) == 0)
+	    indices[function.first] = symbol(function.first, STB_GLOBAL, STT_FUNC, TEXT_SECTION, function.second, 0);
+
+    for (auto &common : _common)
+	if (indices.count(common.first) == 0) {
+	    unsigned long align;
+
+	    for (align = 1; align < 16 && align * 2 <= common.second; align *= 2)
+		continue;
+
+	    indices[common.first] = symbol(common.first, STB_GLOBAL, STT_OBJECT, SHN_COMMON, align, common.second);
+	}
+
+    for (auto &relocation : relocations)
+	if (relocation.section == EXTERNAL && indices.count(relocation.symbol) == 0)
+	    indices[relocation.symbol] = symbol(relocation.symbol, STB_GLOBAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+
+    for (auto &name : _globals)
+	if (indices.count(name) == 0 && _labels.count(name) == 0)
+	    indices[name] = symbol(name, STB_GLOBAL, STT_NOTYPE, SHN_UNDEF, 0, 0);
+
+    for (auto &relocation : relocations) {
+	Elf64_Rela entry;
+	unsigned index, type;
+
+	if (relocation.section == TEXT)
+	    index = 1;
+	else if (relocation.section == RODATA)
+	    index = 2;
+	else
+	    index = indices[relocation.symbol];
+
+	if (relocation.type == ABSOLUTE)
+	    type = R_X86_64_32S;
+	else
+	    type = relocation.section == EXTERNAL ? R_X86_64_PLT32 : R_X86_64_PC32;
+
+	entry.r_offset = relocation.offset;
+	entry.r_info = ELF64_R_INFO(index, type);
+	entry.r_addend = relocation.addend;
+	rela.append((const char *) &entry, sizeof(entry));
+    }
+
+    for (auto address : constructors()) {
+	Elf64_Rela entry;
+
+	entry.r_offset = init.size();
+	entry.r_info = ELF64_R_INFO(1, R_X86_64_64);
+	entry.r_addend = address;
+	initrela.append((const char *) &entry, sizeof(entry));
+	init.append(sizeof(Elf64_Addr), '\0');
+    }
+
+    struct {
+	const char *name;
+	Elf64_Word type;
+	Elf64_Xword flags;
+	const string *data;
+	Elf64_Word link, info;
+	Elf64_Xword align, entsize;
+    } sections[NUM_SECTIONS] = {
+	{"", SHT_NULL, 0, &none, 0, 0, 0, 0},
+	{".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, &text, 0, 0, 16, 0},
+	{".rela.text", SHT_RELA, SHF_INFO_LINK, &rela, SYMTAB_SECTION, TEXT_SECTION, 8, sizeof(Elf64_Rela)},
+	{".rodata", SHT_PROGBITS, SHF_ALLOC, &_rodata, 0, 0, 1, 0},
+	{".init_array", SHT_INIT_ARRAY, SHF_ALLOC | SHF_WRITE, &init, 0, 0, 8, sizeof(Elf64_Addr)},
+	{".rela.init_array", SHT_RELA, SHF_INFO_LINK, &initrela, SYMTAB_SECTION, INIT_SECTION, 8, sizeof(Elf64_Rela)},
+	{".note.GNU-stack", SHT_PROGBITS, 0, &none, 0, 0, 1, 0},
+	{".symtab", SHT_SYMTAB, 0, &symtab, STRTAB_SECTION, locals, 8, sizeof(Elf64_Sym)},
+	{".strtab", SHT_STRTAB, 0, &strtab, 0, 0, 1, 0},
+	{".shstrtab", SHT_STRTAB, 0, &shstrtab, 0, 0, 1, 0},
+    };
+
+    for (i = 1; i < NUM_SECTIONS; i ++) {
+	headers[i].sh_name = shstrtab.size();
+	shstrtab += string(sections[i].name) + '\0';
+    }
+
+    headers[0] = Elf64_Shdr {};
+    offset = sizeof(Elf64_Ehdr);
+
+    for (i = 1; i < NUM_SECTIONS; i ++) {
+	offset += (sections[i].align - offset % sections[i].align) % sections[i].align;
+	headers[i].sh_type = sections[i].type;
+	headers[i].sh_flags = sections[i].flags;
+	headers[i].sh_addr = 0;
+	headers[i].sh_offset = offset;
+	headers[i].sh_size = sections[i].data->size();
+	headers[i].sh_link = sections[i].link;
+	headers[i].sh_info = sections[i].info;
+	headers[i].sh_addralign = sections[i].align;
+	headers[i].sh_entsize = sections[i].entsize;
+	offset += sections[i].data->size();
+    }
+
+    offset += (8 - offset % 8) % 8;
+
+    header = Elf64_Ehdr {};
+    header.e_ident[EI_MAG0] = ELFMAG0;
+    header.e_ident[EI_MAG1] = ELFMAG1;
+    header.e_ident[EI_MAG2] = ELFMAG2;
+    header.e_ident[EI_MAG3] = ELFMAG3;
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_NONE;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = offset;
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = NUM_SECTIONS;
+    header.e_shstrndx = SHSTRTAB_SECTION;
+
+    ostr.write((const char *) &header, sizeof(header));
+    offset = sizeof(header);
+
+    for (i = 1; i < NUM_SECTIONS; i ++) {
+	for (; offset < headers[i].sh_offset; offset ++)
+	    ostr.put('\0');
+
+	ostr.write(sections[i].data->data(), sections[i].data->size());
+	offset += sections[i].data->size();
+    }
+
+    for (; offset < header.e_shoff; offset ++)
+	ostr.put('\0');
+
+    ostr.write((const char *) headers, sizeof(headers));
+}
@@ -0,0 +1,117 @@
+/*
+ * File:	Assembler.h
+ *
+ * Description:	This file contains the class definition for the assembler,
+ *		which encodes the assembly written by the code generator
+ *		directly as x86-64 machine code, so that an object file can
+ *		be written without running the system assembler.
+ *
+ *		The assembler only understands the assembly we generate:
+ *		the instructions used by the code generator and peephole
+ *		optimizer, labels, and the .globl, .comm, .section, .text,
+ *		.p2align, and .asciz directives, along with .quad naming a
+ *		constructor in the text within the .init_array section.  Each line is encoded as
+ *		soon as it is assembled, except for the jumps, whose size
+ *		depends on the distance to their targets.  Every jump starts
+ *		out short and is lengthened only as needed once all labels
+ *		are known, repeating until no more jumps need to be
+ *		lengthened.  The padding aligning the text depends on the
+ *		sizes of the jumps before it, and so is treated as a jump
+ *		whose size is recomputed each time.
+ *
+ *		A reference to a label not defined in the unit is left as a
+ *		relocation against an external symbol, and so is every
+ *		absolute address, since the sections are not yet placed.
+ */
+
+# ifndef ASSEMBLER_H
+# define ASSEMBLER_H
+# include <string>
+# include <vector>
+# include <ostream>
+# include <string_view>
+# include <unordered_map>
+
+class Assembler {
+    typedef std::string string;
+    typedef std::string_view string_view;
+
+public:
+    enum Section {
+	TEXT, RODATA, INIT, EXTERNAL,
+    };
+
+    enum Type {
+	ABSOLUTE, RELATIVE,
+    };
+
+
+    /* A relocation at an offset into the text, against an address in a
+       section or an external symbol */
+
+    struct Relocation {
+	size_t offset;
+	Type type;
+	Section section;
+	string symbol;
+	long addend;
+    };
+
+private:
+    struct Argument;
+
+    struct Label {
+	Section section;
+	size_t position, jumps;
+    };
+
+    struct Jump {
+	size_t position;
+	int condition;
+	bool near;
+	string target;
+	unsigned alignment;
+    };
+
+    struct Fixup {
+	size_t position, jumps;
+	Type type;
+	string symbol;
+	long addend;
+    };
+
+    Section _section;
+    string _text, _rodata, _partial;
+    std::vector<Jump> _jumps;
+    std::vector<Fixup> _fixups;
+    std::unordered_map<string, Label> _labels;
+    std::vector<std::pair<string, unsigned long>> _common;
+    std::vector<string> _globals;
+    std::vector<string> _constructors;
+    std::vector<size_t> _extra;
+
+    static bool argument(string_view text, Argument &arg);
+    void line(string_view text);
+    void directive(string_view name, string_view rest, string_view text);
+    void instruction(string_view name, std::vector<Argument> &args,
+	string_view text);
+
+    void encode(std::initializer_list<unsigned char> opcode, unsigned size,
+	unsigned reg, const Argument &rm, bool rex = false);
+    void immediate(long value, unsigned bytes);
+    size_t address(const Label &label) const;
+
+public:
+    Assembler();
+    void assemble(string_view text);
+
+    void link(string &text, std::vector<Relocation> &relocations);
+    const string &rodata() const;
+    const std::vector<std::pair<string, unsigned long>> &common() const;
+    std::vector<std::pair<string, size_t>> functions() const;
+    std::vector<size_t> constructors() const;
+
+    void write(std::ostream &ostr);
+};
+
+# endif /* ASSEMBLER_H */
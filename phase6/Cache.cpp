@@ -0,0 +1,302 @@
+/*
+ * File:	Cache.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the cache of the code generated for functions.
+ *
+ *		An entry begins with a line giving the name of the
+ *		function, whether it may be expanded inline, and the number
+ *		of string literals.  Each literal follows as a line giving
+ *		its length and then its value, and then comes the code.  The code
+ *		refers to the Nth literal as .LC@N.
+ */
+
+# include <cctype>
+# include <cstdio>
+# include <fstream>
+# include <sstream>
+# include <thread>
+# include <vector>
+# include <unistd.h>
+# include <sys/stat.h>
+# include "Cache.h"
+# include "Scope.h"
+# include "context.h"
+# include "machine.h"
+# include "tokens.h"
+
+using namespace std;
+
+# define FNV_OFFSET 14695981039346656037UL
+# define FNV_PRIME 1099511628211UL
+
+string Cache::directory;
+
+
+/*
+ * Function:	mix (private)
+ *
+ * Description:	Return the given hash updated with the given text and a
+ *		terminating null, using the FNV-1a hash function.
+ */
+
+static unsigned long mix(unsigned long hash, string_view text)
+{
+    for (unsigned char c : text)
+	hash = (hash ^ c) * FNV_PRIME;
+
+    return hash * FNV_PRIME;
+}
+
+
+/*
+ * Function:	identity (private)
+ *
+ * Description:	Return the hash of the running compiler, computed from the
+ *		device, inode, size, and modification time of its executable
+ *		the first time it is needed, since reading the whole
+ *		executable would cost more than most compiles.  Rebuilding
+ *		the compiler changes at least its modification time.
+ */
+
+static unsigned long identity()
+{
+    static const unsigned long hash = []() {
+	struct stat info;
+	ostringstream stamp;
+
+	if (stat("/proc/self/exe", &info) == 0) {
+	    stamp << info.st_dev << ' ' << info.st_ino << ' ' << info.st_size;
+	    stamp << ' ' << info.st_mtim.tv_sec << '.' << info.st_mtim.tv_nsec;
+	}
+
+	return mix(FNV_OFFSET, stamp.str());
+    }();
+
+    return hash;
+}
+
+
+/*
+ * Function:	describe (private)
+ *
+ * Description:	Write the full structure of a type to the given stream:
+ *		its kind, specifier, and indirection, and the length of an
+ *		array or every parameter type of a function and whether it
+ *		is variadic.  Writing the type as for a diagnostic is not
+ *		enough, since that leaves out the parameters, and calls
+ *		depend upon them.
+ */
+
+static void describe(ostream &ostr, const Type &type)
+{
+    ostr << type.kind() << ' ' << type.specifier() << ' ' << type.indirection();
+
+    if (type.isArray())
+	ostr << '[' << type.length() << ']';
+
+    else if (type.isFunction()) {
+	const Parameters *params = type.parameters();
+
+	ostr << '(';
+
+	if (params == nullptr)
+	    ostr << '?';
+	else {
+	    for (auto &param : params->types) {
+		describe(ostr, param);
+		ostr << ',';
+	    }
+
+	    if (params->variadic)
+		ostr << "...";
+	}
+
+	ostr << ')';
+    }
+}
+
+
+/*
+ * Function:	Cache::Cache (constructor)
+ *
+ * Description:	Initialize the cache entry for the given function, whose
+ *		definition spans the given range of tokens of the current
+ *		translation unit.  The hash of the function is remembered,
+ *		so that the functions calling it may include it in theirs.
+ */
+
+Cache::Cache(const Symbol *function, size_t first, size_t last)
+    : _function(function)
+{
+    CompilerContext *context = CompilerContext::current();
+    unsigned long hash = mix(FNV_OFFSET, to_string(identity()));
+    char buf[20];
+
+
+    for (size_t i = first; i < last; i ++) {
+	const Token &token = context->tokens[i];
+
+	hash = mix(hash, to_string(token.kind));
+
+	if (token.kind != ID) {
+	    hash = mix(hash, token.text);
+	    continue;
+	}
+
+	hash = mix(hash, *token.name);
+	Symbol *symbol = context->global->find(token.name);
+
+	if (symbol != nullptr) {
+	    ostringstream type;
+
+	    describe(type, symbol->type());
+	    hash = mix(hash, type.str());
+
+	    auto it = context->digests.find(symbol);
+
+	    if (it != context->digests.end())
+		hash = mix(hash, to_string(it->second));
+	}
+    }
+
+    context->digests[function] = hash;
+    snprintf(buf, sizeof(buf), "%016lx", hash);
+    _path = directory + "/" + buf + ".s";
+}
+
+
+/*
+ * Function:	Cache::function (accessor)
+ *
+ * Description:	Return the function of this cache entry.
+ */
+
+const Symbol *Cache::function() const
+{
+    return _function;
+}
+
+
+/*
+ * Function:	Cache::find
+ *
+ * Description:	Read the code for our function from the cache into the
+ *		given string along with whether it may be expanded inline,
+ *		and return whether it was found.  The literals it refers
+ *		to were already added to the pool when the function and
+ *		any functions expanded into it were parsed.
+ */
+
+bool Cache::find(string &output, bool &inlinable) const
+{
+    CompilerContext *context = CompilerContext::current();
+    string name, value, prefix = string_prefix + string("@");
+    ostringstream code;
+    vector<unsigned> numbers;
+    size_t count, length, i, j;
+    unsigned number;
+
+
+    ifstream in(_path, ios::binary);
+
+    if (!(in >> name >> inlinable >> count) || name != _function->name())
+	return false;
+
+    for (in.get(), i = 0; i < count; i ++) {
+	if (!(in >> length) || in.get() != '\n')
+	    return false;
+
+	value.resize(length);
+
+	if (!in.read(&value[0], length) || in.get() != '\n')
+	    return false;
+
+	if (!context->strings.find(value, number))
+	    return false;
+
+	numbers.push_back(number);
+    }
+
+    code << in.rdbuf();
+    value = code.str();
+    output.clear();
+
+    for (i = 0; (j = value.find(prefix, i)) != string::npos; i = j) {
+	output.append(value, i, j - i);
+	number = strtoul(value.c_str() + j + prefix.size(), nullptr, 10);
+
+	if (number >= numbers.size())
+	    return false;
+
+	output += string_prefix + to_string(numbers[number]);
+
+	for (j += prefix.size(); j < value.size() && isdigit(value[j]); j ++)
+	    continue;
+    }
+
+    output.append(value, i, string::npos);
+    return true;
+}
+
+
+/*
+ * Function:	Cache::store
+ *
+ * Description:	Write the given code for our function to the cache,
+ *		replacing the labels of its literals by their positions.
+ *		Any failure to write the entry is ignored.
+ */
+
+void Cache::store(const string &output) const
+{
+    CompilerContext *context = CompilerContext::current();
+    string prefix = string_prefix, temp, code;
+    vector<unsigned> numbers;
+    size_t i, j, k, position;
+    unsigned number;
+
+
+    for (i = 0; (j = output.find(prefix, i)) != string::npos; i = k) {
+	k = j + prefix.size();
+	code.append(output, i, k - i);
+
+	if (k == output.size() || !isdigit(output[k]))
+	    continue;
+
+	number = strtoul(output.c_str() + k, nullptr, 10);
+
+	for (position = 0; position < numbers.size(); position ++)
+	    if (numbers[position] == number)
+		break;
+
+	if (position == numbers.size())
+	    numbers.push_back(number);
+
+	code += "@" + to_string(position);
+
+	while (k < output.size() && isdigit(output[k]))
+	    k ++;
+    }
+
+    code.append(output, i, string::npos);
+
+    temp = _path + "." + to_string(getpid()) + "." +
+	to_string(hash<thread::id>()(this_thread::get_id()));
+
+    ofstream out(temp, ios::binary);
+
+    out << _function->name() << ' ' << context->inlines.kept(_function);
+    out << ' ' << numbers.size() << '\n';
+
+    for (auto number : numbers) {
+	string value = context->strings.value(number);
+	out << value.size() << '\n' << value << '\n';
+    }
+
+    out << code;
+    out.close();
+
+    if (!out || rename(temp.c_str(), _path.c_str()) != 0)
+	unlink(temp.c_str());
+}
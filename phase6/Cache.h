@@ -0,0 +1,46 @@
+/*
+ * File:	Cache.h
+ *
+ * Description:	This file contains the class definition for the cache of
+ *		the code generated for functions, which persists across
+ *		runs in a directory given on the command line.  The code
+ *		for a function is kept under a hash of its tokens, of the
+ *		types of the global symbols those tokens may name, and of
+ *		the hashes of the functions already defined that it may
+ *		call, since those may have been expanded inline.  The hash
+ *		of the compiler itself is included too, so that a new
+ *		compiler never uses code generated by an old one.
+ *
+ *		The labels within a function are numbered separately, so
+ *		they need no change, but the labels of the string literals
+ *		are numbered across the translation unit.  The literals are
+ *		therefore kept with the code, which refers to them by their
+ *		position, and are found again in the pool when reused.
+ *
+ *		An entry is written to a temporary file that is then
+ *		renamed, so several compilers may use the same cache at
+ *		once, and an entry that cannot be read is just a miss.
+ */
+
+# ifndef CACHE_H
+# define CACHE_H
+# include <string>
+
+class Symbol;
+
+class Cache {
+    typedef std::string string;
+
+    const Symbol *_function;
+    string _path;
+
+public:
+    static string directory;
+
+    Cache(const Symbol *function, size_t first, size_t last);
+    const Symbol *function() const;
+    bool find(string &output, bool &inlinable) const;
+    void store(const string &output) const;
+};
+
+# endif /* CACHE_H */
@@ -0,0 +1,156 @@
+/*
+ * File:	CallGraph.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the graph of references of a translation unit.
+ */
+
+# include <cassert>
+# include "CallGraph.h"
+
+using namespace std;
+
+
+/*
+ * Function:	CallGraph::CallGraph (constructor)
+ *
+ * Description:	Initialize this graph to have no functions.
+ */
+
+CallGraph::CallGraph()
+    : _current(nullptr)
+{
+}
+
+
+/*
+ * Function:	CallGraph::enter
+ *
+ * Description:	Start adding the references of the given function, whose
+ *		body is about to be parsed.
+ */
+
+void CallGraph::enter(const Symbol *function)
+{
+    assert(_current == nullptr);
+    _current = &_functions[function];
+}
+
+
+/*
+ * Function:	CallGraph::reference
+ *
+ * Description:	Add a reference to the given symbol from the function
+ *		being parsed, if any.  References to local variables are
+ *		added too, but are never followed.
+ */
+
+void CallGraph::reference(const Symbol *symbol)
+{
+    if (_current != nullptr)
+	_current->symbols.push_back(symbol);
+}
+
+
+/*
+ * Function:	CallGraph::reference
+ *
+ * Description:	Add a reference to the string literal with the given
+ *		number from the function being parsed, if any.
+ */
+
+void CallGraph::reference(unsigned string)
+{
+    if (_current != nullptr)
+	_current->strings.push_back(string);
+}
+
+
+/*
+ * Function:	CallGraph::leave
+ *
+ * Description:	Finish adding the references of the function being parsed,
+ *		keeping each symbol only once.
+ */
+
+void CallGraph::leave()
+{
+    vector<const Symbol *> &symbols = _current->symbols;
+    unordered_set<const Symbol *> seen;
+    size_t n = 0;
+
+
+    for (auto symbol : symbols)
+	if (seen.insert(symbol).second)
+	    symbols[n ++] = symbol;
+
+    symbols.resize(n);
+    _current = nullptr;
+}
+
+
+/*
+ * Function:	CallGraph::mark
+ *
+ * Description:	Mark the given symbol and everything reachable from it as
+ *		live.  A symbol that is not a function defined in this unit
+ *		references nothing.
+ */
+
+void CallGraph::mark(const Symbol *root)
+{
+    vector<const Symbol *> stack;
+    const Symbol *symbol;
+
+
+    if (!_live.insert(root).second)
+	return;
+
+    stack.push_back(root);
+
+    while (!stack.empty()) {
+	symbol = stack.back();
+	stack.pop_back();
+
+	auto it = _functions.find(symbol);
+
+	if (it == _functions.end())
+	    continue;
+
+	for (auto string : it->second.strings) {
+	    if (string >= _strings.size())
+		_strings.resize(string + 1);
+
+	    _strings[string] = true;
+	}
+
+	for (auto callee : it->second.symbols)
+	    if (_live.insert(callee).second)
+		stack.push_back(callee);
+    }
+}
+
+
+/*
+ * Function:	CallGraph::live (accessor)
+ *
+ * Description:	Return whether the given symbol has been marked as live.
+ */
+
+bool CallGraph::live(const Symbol *symbol) const
+{
+    return _live.count(symbol) > 0;
+}
+
+
+/*
+ * Function:	CallGraph::live (accessor)
+ *
+ * Description:	Return whether the string literal with the given number
+ *		is used by a live function.
+ */
+
+bool CallGraph::live(unsigned string) const
+{
+    return string < _strings.size() && _strings[string];
+}
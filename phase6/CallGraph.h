@@ -0,0 +1,50 @@
+/*
+ * File:	CallGraph.h
+ *
+ * Description:	This file contains the class definition for the graph of
+ *		references between the functions, globals, and string
+ *		literals of a translation unit.  As the parser reads the
+ *		body of a function, it adds each symbol and literal used in
+ *		the reachable statements of the body, so the graph depends
+ *		only upon the source.
+ *
+ *		Once the unit has been parsed, the symbols reachable from
+ *		the given roots are marked, and only the marked functions,
+ *		globals, and literals need be written.  A function that is
+ *		expanded inline is still referenced by its caller, so what
+ *		it uses is always kept.
+ */
+
+# ifndef CALLGRAPH_H
+# define CALLGRAPH_H
+# include <vector>
+# include <unordered_map>
+# include <unordered_set>
+
+class Symbol;
+
+class CallGraph {
+    struct References {
+	std::vector<const Symbol *> symbols;
+	std::vector<unsigned> strings;
+    };
+
+    std::unordered_map<const Symbol *, References> _functions;
+    References *_current;
+    std::unordered_set<const Symbol *> _live;
+    std::vector<bool> _strings;
+
+public:
+    CallGraph();
+
+    void enter(const Symbol *function);
+    void reference(const Symbol *symbol);
+    void reference(unsigned string);
+    void leave();
+
+    void mark(const Symbol *root);
+    bool live(const Symbol *symbol) const;
+    bool live(unsigned string) const;
+};
+
+# endif /* CALLGRAPH_H */
@@ -0,0 +1,108 @@
+/*
+ * File:	Conventions.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the table of calling conventions of the local functions.
+ */
+
+# include "Conventions.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Conventions::add
+ *
+ * Description:	Add the given function to this table, in the order in
+ *		which the functions are defined, noting whether it is local
+ *		to the translation unit.
+ */
+
+void Conventions::add(const Symbol *function, bool local)
+{
+    lock_guard<mutex> guard(_mutex);
+    unsigned order = _entries.size();
+
+
+    _entries[function] = {order, local, false, false, Convention()};
+}
+
+
+/*
+ * Function:	Conventions::define
+ *
+ * Description:	Record the convention of the given local function, and
+ *		wake anyone waiting for it.
+ */
+
+void Conventions::define(const Symbol *function, const Convention &convention)
+{
+    lock_guard<mutex> guard(_mutex);
+    Entry &entry = _entries.at(function);
+
+
+    entry.convention = convention;
+    entry.defined = entry.known = true;
+    _defined.notify_all();
+}
+
+
+/*
+ * Function:	Conventions::define
+ *
+ * Description:	Record that the given function has been defined without
+ *		a convention of its own, as when its code is reused from
+ *		the cache, so that it is called as usual.
+ */
+
+void Conventions::define(const Symbol *function)
+{
+    lock_guard<mutex> guard(_mutex);
+    Entry &entry = _entries.at(function);
+
+
+    entry.defined = true;
+    _defined.notify_all();
+}
+
+
+/*
+ * Function:	Conventions::local
+ *
+ * Description:	Return whether the given function may only be called from
+ *		within the translation unit.
+ */
+
+bool Conventions::local(const Symbol *function) const
+{
+    lock_guard<mutex> guard(_mutex);
+    auto it = _entries.find(function);
+
+    return it != _entries.end() && it->second.local;
+}
+
+
+/*
+ * Function:	Conventions::find
+ *
+ * Description:	Return the convention of the given callee if it may be
+ *		used by the given caller, or null if the callee must be
+ *		called as usual, waiting for the callee to be allocated its
+ *		registers if necessary.
+ */
+
+const Convention *Conventions::find(const Symbol *callee, const Symbol *caller) const
+{
+    unique_lock<mutex> lock(_mutex);
+    auto it = _entries.find(callee), that = _entries.find(caller);
+
+
+    if (it == _entries.end() || that == _entries.end() || !it->second.local)
+	return nullptr;
+
+    if (it->second.order >= that->second.order)
+	return nullptr;
+
+    _defined.wait(lock, [&]() {return it->second.defined;});
+    return it->second.known ? &it->second.convention : nullptr;
+}
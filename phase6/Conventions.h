@@ -0,0 +1,57 @@
+/*
+ * File:	Conventions.h
+ *
+ * Description:	This file contains the class definition for the table of
+ *		calling conventions of the local functions of a translation
+ *		unit.  When pruning, a function other than the roots can
+ *		only be called from within the unit, and so need not follow
+ *		the usual convention.  Once its registers are allocated, a
+ *		local function records the registers in which it takes its
+ *		arguments at its local entry, and the caller-saved registers
+ *		that it or anything it calls may change.  A call to a local
+ *		function defined before the caller may then pass the
+ *		arguments in those registers, and keep anything else live
+ *		across the call in the other caller-saved registers, so the
+ *		code generated for a function depends only upon the source.
+ *
+ *		The functions of a unit may be generated by several
+ *		threads at once, so finding a callee that is still being
+ *		generated waits for it, just as for the inliner.  The
+ *		conventions are never changed once recorded.
+ */
+
+# ifndef CONVENTIONS_H
+# define CONVENTIONS_H
+# include <mutex>
+# include <vector>
+# include <unordered_map>
+# include <condition_variable>
+
+class Register;
+class Symbol;
+
+struct Convention {
+    std::vector<Register *> arguments;
+    std::vector<Register *> clobbered;
+};
+
+class Conventions {
+    struct Entry {
+	unsigned order;
+	bool local, defined, known;
+	Convention convention;
+    };
+
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _defined;
+    std::unordered_map<const Symbol *, Entry> _entries;
+
+public:
+    void add(const Symbol *function, bool local);
+    void define(const Symbol *function, const Convention &convention);
+    void define(const Symbol *function);
+    bool local(const Symbol *function) const;
+    const Convention *find(const Symbol *callee, const Symbol *caller) const;
+};
+
+# endif /* CONVENTIONS_H */
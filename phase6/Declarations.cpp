@@ -0,0 +1,366 @@
+/*
+ * File:	Declarations.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		precompiled declarations.
+ *
+ *		The file begins with a header giving its version, the
+ *		number of buckets of its hash table, the size of the file,
+ *		and a checksum of everything after the header, followed by
+ *		the offset
+ *		of the first record in each bucket, or zero if the bucket
+ *		is empty.  A record gives the offset of the next record in
+ *		its bucket, the length of the name, and the type, followed
+ *		by the name and then by the specifier and indirection of
+ *		each parameter of a function.  Everything is in the byte
+ *		order of the machine and each record is aligned, so the
+ *		records can be read in place.  The header and every record
+ *		are checked when the file is opened, so that a truncated or
+ *		damaged file is rejected rather than silently missing some
+ *		of its declarations.
+ */
+
+# include <cerrno>
+# include <cstdint>
+# include <cstring>
+# include <fstream>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "Declarations.h"
+# include "Scope.h"
+
+using namespace std;
+
+# define MAGIC "SCCD"
+# define VERSION 2
+
+struct Header {
+    char magic[4];
+    uint32_t version, buckets, checksum;
+    uint64_t size;
+};
+
+struct Record {
+    uint32_t next, length;
+    uint32_t kind, specifier, indirection, variadic;
+    uint64_t count;
+};
+
+struct Parameter {
+    uint32_t specifier, indirection;
+};
+
+
+/*
+ * Function:	digest (private)
+ *
+ * Description:	Return the FNV-1a hash of the given bytes, which, unlike
+ *		the addresses of the interned names, outlives the compiler.
+ */
+
+static uint32_t digest(const char *data, size_t size)
+{
+    uint32_t value = 2166136261U;
+
+
+    for (size_t i = 0; i < size; i ++)
+	value = (value ^ (unsigned char) data[i]) * 16777619U;
+
+    return value;
+}
+
+
+/*
+ * Function:	bucket (private)
+ *
+ * Description:	Return the bucket of the given name.
+ */
+
+static unsigned bucket(const string &name, unsigned buckets)
+{
+    return digest(name.data(), name.size()) % buckets;
+}
+
+
+/*
+ * Function:	padding (private)
+ *
+ * Description:	Return the number of bytes needed after the given offset
+ *		to align a record.
+ */
+
+static size_t padding(size_t offset)
+{
+    return (alignof(Record) - offset % alignof(Record)) % alignof(Record);
+}
+
+
+/*
+ * Function:	Declarations::check (private)
+ *
+ * Description:	Check that every record in each bucket fits in the file,
+ *		follows the records before it, and has a valid type, and
+ *		return a description of the first problem found, or null if
+ *		there is none.
+ */
+
+const char *Declarations::check() const
+{
+    const uint32_t *buckets = (const uint32_t *) (_data + sizeof(Header));
+    size_t first = sizeof(Header) + _buckets * sizeof(uint32_t);
+    const Record *record;
+    size_t offset, end;
+
+
+    for (unsigned i = 0; i < _buckets; i ++)
+	for (offset = buckets[i]; offset != 0; offset = record->next) {
+	    if (offset < first || offset % alignof(Record) != 0)
+		return "record offset out of range";
+
+	    if (offset + sizeof(Record) > _size)
+		return "record offset out of range";
+
+	    record = (const Record *) (_data + offset);
+	    end = offset + sizeof(Record) + record->length;
+
+	    if (end > _size)
+		return "record extends past end of file";
+
+	    if (record->next >= offset && record->next != 0)
+		return "record offset out of range";
+
+	    if (record->kind == FUNCTION) {
+		end += padding(end);
+
+		if (end > _size || record->count > (_size - end) / sizeof(Parameter))
+		    return "record extends past end of file";
+
+	    } else if (record->kind != SCALAR && record->kind != ARRAY)
+		return "record has an invalid type";
+	}
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	Declarations::Declarations (constructor)
+ *
+ * Description:	Initialize these declarations to have no symbols.
+ */
+
+Declarations::Declarations()
+    : _data(nullptr), _size(0), _buckets(0), _error(nullptr)
+{
+}
+
+
+/*
+ * Function:	Declarations::~Declarations (destructor)
+ *
+ * Description:	Unmap the file if one is mapped.
+ */
+
+Declarations::~Declarations()
+{
+    if (_data != nullptr)
+	munmap(_data, _size);
+}
+
+
+/*
+ * Function:	Declarations::open
+ *
+ * Description:	Map the file of declarations with the given path into
+ *		memory, and return whether it is a valid file.  If not, the
+ *		reason is given by error().
+ */
+
+bool Declarations::open(const string &path)
+{
+    Header header;
+    struct stat st;
+    int fd;
+
+
+    if ((fd = ::open(path.c_str(), O_RDONLY)) < 0 || fstat(fd, &st) != 0) {
+	_error = strerror(errno);
+
+	if (fd >= 0)
+	    close(fd);
+
+	return false;
+    }
+
+    if ((size_t) st.st_size < sizeof(Header)) {
+	_error = "file is truncated";
+	close(fd);
+	return false;
+    }
+
+    _size = st.st_size;
+    _data = (char *) mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (_data == MAP_FAILED) {
+	_error = strerror(errno);
+	_data = nullptr;
+	return false;
+    }
+
+    memcpy(&header, _data, sizeof(header));
+
+    if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION)
+	_error = "not a declarations file of this version";
+    else if (header.size > _size)
+	_error = "file is truncated";
+    else if (header.size != _size)
+	_error = "file has the wrong size";
+    else if (digest(_data + sizeof(Header), _size - sizeof(Header)) != header.checksum)
+	_error = "checksum does not match";
+    else if (header.buckets == 0 ||
+	    header.buckets > (_size - sizeof(Header)) / sizeof(uint32_t))
+	_error = "hash table out of range";
+    else {
+	_buckets = header.buckets;
+	_error = check();
+    }
+
+    if (_error != nullptr) {
+	_buckets = 0;
+	return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	Declarations::error (accessor)
+ *
+ * Description:	Return the reason these declarations could not be opened.
+ */
+
+const char *Declarations::error() const
+{
+    return _error;
+}
+
+
+/*
+ * Function:	Declarations::find
+ *
+ * Description:	Return a new symbol for the declaration with the given
+ *		name, or null if there is no such declaration.  The symbol
+ *		and its type are allocated from the current arena.  The
+ *		records were all checked when the file was opened.
+ */
+
+Symbol *Declarations::find(Name name) const
+{
+    const uint32_t *buckets = (const uint32_t *) (_data + sizeof(Header));
+    const Record *record;
+    const Parameter *param;
+    Parameters *params;
+    size_t offset, end;
+
+
+    if (_buckets == 0)
+	return nullptr;
+
+    for (offset = buckets[bucket(*name, _buckets)]; offset != 0; offset = record->next) {
+	record = (const Record *) (_data + offset);
+	end = offset + sizeof(Record) + record->length;
+
+	if (record->length != name->size())
+	    continue;
+
+	if (memcmp(record + 1, name->data(), record->length) != 0)
+	    continue;
+
+	if (record->kind == SCALAR)
+	    return new Symbol(name, Type(record->specifier, record->indirection));
+
+	if (record->kind == ARRAY)
+	    return new Symbol(name, Type(record->specifier, record->indirection,
+		(unsigned long) record->count));
+
+	end += padding(end);
+	param = (const Parameter *) (_data + end);
+	params = new Parameters();
+	params->variadic = record->variadic;
+
+	for (size_t i = 0; i < record->count; i ++)
+	    params->types.push_back(Type(param[i].specifier, param[i].indirection));
+
+	return new Symbol(name, Type(record->specifier, record->indirection, params));
+    }
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	Declarations::write
+ *
+ * Description:	Write the symbols of the given scope to the file with the
+ *		given path, and return whether the file was written.
+ */
+
+bool Declarations::write(const Scope *scope, const string &path)
+{
+    const Symbols &symbols = scope->symbols();
+    vector<uint32_t> buckets(symbols.size() * 2 + 1, 0);
+    Header header = {{'S', 'C', 'C', 'D'}, VERSION, (uint32_t) buckets.size(), 0, 0};
+    string file(sizeof(Header) + buckets.size() * sizeof(uint32_t), '\0');
+
+
+    for (auto symbol : symbols) {
+	const Type &type = symbol->type();
+	const string &name = symbol->name();
+	unsigned n = bucket(name, buckets.size());
+	Record record;
+
+	memset(&record, 0, sizeof(record));
+	record.next = buckets[n];
+	record.length = name.size();
+	record.kind = type.kind();
+	record.specifier = type.specifier();
+	record.indirection = type.indirection();
+
+	if (type.isArray())
+	    record.count = type.length();
+	else if (type.isFunction()) {
+	    record.count = type.parameters()->types.size();
+	    record.variadic = type.parameters()->variadic;
+	}
+
+	file.append(padding(file.size()), '\0');
+	buckets[n] = file.size();
+	file.append((const char *) &record, sizeof(record));
+	file.append(name);
+
+	if (type.isFunction()) {
+	    file.append(padding(file.size()), '\0');
+
+	    for (auto &param : type.parameters()->types) {
+		Parameter p = {(uint32_t) param.specifier(), param.indirection()};
+		file.append((const char *) &p, sizeof(p));
+	    }
+	}
+    }
+
+    memcpy(&file[sizeof(header)], buckets.data(), buckets.size() * sizeof(uint32_t));
+
+    header.size = file.size();
+    header.checksum = digest(&file[sizeof(header)], file.size() - sizeof(header));
+    memcpy(&file[0], &header, sizeof(header));
+
+    ofstream out(path, ios::binary);
+
+    out << file;
+    out.close();
+    return (bool) out;
+}
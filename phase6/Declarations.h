@@ -0,0 +1,46 @@
+/*
+ * File:	Declarations.h
+ *
+ * Description:	This file contains the class definition for precompiled
+ *		declarations.  The global symbols of a translation unit
+ *		may be written to a file, which another unit may then use
+ *		as if it had declared those symbols itself.  The file is
+ *		mapped into memory and checked, and holds a hash table of
+ *		the symbols, so a symbol is created in the global scope
+ *		only when its name is first looked up there.  The file is
+ *		never changed once mapped, so any number of units may use
+ *		it at once.
+ */
+
+# ifndef DECLARATIONS_H
+# define DECLARATIONS_H
+# include <string>
+# include "intern.h"
+
+class Scope;
+class Symbol;
+
+class Declarations {
+    typedef std::string string;
+
+    char *_data;
+    size_t _size;
+    unsigned _buckets;
+    const char *_error;
+
+    Declarations(const Declarations &) = delete;
+    Declarations &operator =(const Declarations &) = delete;
+    const char *check() const;
+
+public:
+    Declarations();
+    ~Declarations();
+
+    bool open(const string &path);
+    const char *error() const;
+    Symbol *find(Name name) const;
+
+    static bool write(const Scope *scope, const string &path);
+};
+
+# endif /* DECLARATIONS_H */
@@ -0,0 +1,376 @@
+/*
+ * File:	Emitter.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the assembly emitter.  The stream buffer of the emitter
+ *		hands out space in the current chunk, and only asks for a
+ *		new chunk when the current one fills up.  Since a chunk is
+ *		never resized, nothing already written is ever copied.
+ *
+ *		Flushing writes every chunk using writev(), retrying as
+ *		needed after a short write or an interrupted system call,
+ *		unless we are assembling, in which case the chunks are
+ *		assembled instead.
+ */
+
+# include <cerrno>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/uio.h>
+# include "Assembler.h"
+# include "Emitter.h"
+
+using namespace std;
+
+# define CHUNK_SIZE 65536
+# define MAX_IOVECS 64
+
+
+/*
+ * Function:	Emitter::Buffer::Buffer (constructor)
+ *
+ * Description:	Initialize this buffer to have a single empty chunk and to
+ *		write to the standard output.
+ */
+
+Emitter::Buffer::Buffer()
+    : _used(0), fd(STDOUT_FILENO)
+{
+    grow();
+}
+
+
+/*
+ * Function:	Emitter::Buffer::~Buffer (destructor)
+ *
+ * Description:	Deallocate all chunks.  Any unwritten output is lost, so
+ *		the emitter flushes before its buffer is destroyed.
+ */
+
+Emitter::Buffer::~Buffer()
+{
+    for (auto chunk : _chunks)
+	delete[] chunk;
+}
+
+
+/*
+ * Function:	Emitter::Buffer::grow (private)
+ *
+ * Description:	Make the next chunk the current chunk, allocating it if we
+ *		have not yet needed this many chunks.
+ */
+
+void Emitter::Buffer::grow()
+{
+    if (pbase() != nullptr)
+	_used ++;
+
+    if (_used == _chunks.size())
+	_chunks.push_back(new char[CHUNK_SIZE]);
+
+    setp(_chunks[_used], _chunks[_used] + CHUNK_SIZE);
+}
+
+
+/*
+ * Function:	Emitter::Buffer::overflow
+ *
+ * Description:	Called by the stream when the current chunk is full.
+ *		Continue in the next chunk.
+ */
+
+Emitter::Buffer::int_type Emitter::Buffer::overflow(int_type c)
+{
+    grow();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+
+/*
+ * Function:	Emitter::Buffer::xsputn
+ *
+ * Description:	Append a sequence of characters, spilling over into as
+ *		many chunks as necessary.
+ */
+
+streamsize Emitter::Buffer::xsputn(const char *s, streamsize n)
+{
+    streamsize left, count;
+
+
+    for (left = n; left > 0; left -= count, s += count) {
+	if (pptr() == epptr())
+	    grow();
+
+	count = min(left, (streamsize) (epptr() - pptr()));
+	memcpy(pptr(), s, count);
+	pbump(count);
+    }
+
+    return n;
+}
+
+
+/*
+ * Function:	Emitter::Buffer::sync
+ *
+ * Description:	Called when the stream is flushed (e.g., by std::endl).
+ *		We deliberately do nothing, as the whole point of the
+ *		emitter is to write only when explicitly asked to.
+ */
+
+int Emitter::Buffer::sync()
+{
+    return 0;
+}
+
+
+/*
+ * Function:	Emitter::Buffer::size
+ *
+ * Description:	Return the number of bytes currently buffered.
+ */
+
+size_t Emitter::Buffer::size() const
+{
+    return (size_t) _used * CHUNK_SIZE + (pptr() - pbase());
+}
+
+
+/*
+ * Function:	Emitter::Buffer::drain
+ *
+ * Description:	Write all buffered chunks to the file descriptor and then
+ *		start over at the first chunk.  Return false if the write
+ *		fails, in which case errno indicates the reason.
+ */
+
+bool Emitter::Buffer::drain()
+{
+    struct iovec iov[MAX_IOVECS];
+    unsigned first, count, i;
+    ssize_t n;
+
+
+    for (first = 0; first <= _used; first += count) {
+	count = min((unsigned) MAX_IOVECS, _used + 1 - first);
+
+	for (i = 0; i < count; i ++) {
+	    iov[i].iov_base = _chunks[first + i];
+	    iov[i].iov_len = first + i < _used ? CHUNK_SIZE : pptr() - pbase();
+	}
+
+	i = 0;
+
+	while (i < count) {
+	    if ((n = writev(fd, iov + i, count - i)) < 0) {
+		if (errno == EINTR)
+		    continue;
+
+		return false;
+	    }
+
+	    while (i < count && (size_t) n >= iov[i].iov_len)
+		n -= iov[i ++].iov_len;
+
+	    if (i < count) {
+		iov[i].iov_base = (char *) iov[i].iov_base + n;
+		iov[i].iov_len -= n;
+	    }
+	}
+    }
+
+    _used = 0;
+    setp(_chunks[0], _chunks[0] + CHUNK_SIZE);
+    return true;
+}
+
+
+/*
+ * Function:	Emitter::Buffer::take
+ *
+ * Description:	Append all buffered chunks to the given text and then
+ *		start over at the first chunk.
+ */
+
+void Emitter::Buffer::take(string &text)
+{
+    for (unsigned i = 0; i < _used; i ++)
+	text.append(_chunks[i], CHUNK_SIZE);
+
+    text.append(pbase(), pptr() - pbase());
+    _used = 0;
+    setp(_chunks[0], _chunks[0] + CHUNK_SIZE);
+}
+
+
+/*
+ * Function:	Emitter::Emitter (constructor)
+ *
+ * Description:	Initialize this emitter to write to the standard output.
+ */
+
+Emitter::Emitter()
+    : std::ostream(&_buffer), _assembler(nullptr)
+{
+}
+
+
+/*
+ * Function:	Emitter::~Emitter (destructor)
+ *
+ * Description:	Write any remaining output and close the output file if
+ *		we opened one.  We may be running as part of exit(), so a
+ *		failure cannot be reported here with another exit().
+ */
+
+Emitter::~Emitter()
+{
+    delete _assembler;
+    _buffer.drain();
+
+    if (_buffer.fd != STDOUT_FILENO)
+	close(_buffer.fd);
+}
+
+
+/*
+ * Function:	Emitter::open
+ *
+ * Description:	Direct all further output to the file with the given path,
+ *		creating or truncating it as necessary.  Any output already
+ *		buffered is flushed to the previous destination first.
+ */
+
+bool Emitter::open(const string &path)
+{
+    int fd;
+
+
+    flush();
+
+    if ((fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+	return false;
+
+    if (_buffer.fd != STDOUT_FILENO)
+	close(_buffer.fd);
+
+    _buffer.fd = fd;
+    _path = path;
+    return true;
+}
+
+
+/*
+ * Function:	Emitter::path (accessor)
+ *
+ * Description:	Return the path of the output file, which is empty if we
+ *		are writing to the standard output.
+ */
+
+const string &Emitter::path() const
+{
+    return _path;
+}
+
+
+/*
+ * Function:	Emitter::size (accessor)
+ *
+ * Description:	Return the number of bytes buffered but not yet written.
+ */
+
+size_t Emitter::size() const
+{
+    return _buffer.size();
+}
+
+
+/*
+ * Function:	Emitter::assemble
+ *
+ * Description:	Assemble all further output rather than writing it.
+ */
+
+void Emitter::assemble()
+{
+    flush();
+    _assembler = new Assembler();
+}
+
+
+/*
+ * Function:	Emitter::detach
+ *
+ * Description:	Stop assembling and return the assembler with everything
+ *		written so far assembled, which the caller then owns.
+ */
+
+Assembler *Emitter::detach()
+{
+    Assembler *assembler = _assembler;
+
+
+    flush();
+    _assembler = nullptr;
+    return assembler;
+}
+
+
+/*
+ * Function:	Emitter::flush
+ *
+ * Description:	Write all buffered output, or assemble it if we are
+ *		assembling.  A failure to write is fatal, since the output
+ *		would be silently truncated otherwise.
+ */
+
+void Emitter::flush()
+{
+    if (_assembler != nullptr) {
+	string text;
+
+	_buffer.take(text);
+	_assembler->assemble(text);
+	return;
+    }
+
+    if (!_buffer.drain()) {
+	cerr << "scc: " << (_path.empty() ? "standard output" : _path);
+	cerr << ": " << strerror(errno) << endl;
+	exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Function:	Emitter::finish
+ *
+ * Description:	Write the object file for everything assembled, if we are
+ *		assembling, and then write all buffered output.
+ */
+
+void Emitter::finish()
+{
+    Assembler *assembler = _assembler;
+
+
+    if (assembler != nullptr) {
+	flush();
+	_assembler = nullptr;
+	assembler->write(*this);
+	delete assembler;
+    }
+
+    flush();
+}
@@ -0,0 +1,72 @@
+/*
+ * File:	Emitter.h
+ *
+ * Description:	This file contains the class definition for the assembly
+ *		emitter.  An emitter is an output stream whose characters
+ *		are appended to a growable buffer made up of fixed-size
+ *		chunks rather than being written immediately.  Nothing is
+ *		ever flushed implicitly, so the code generator can write as
+ *		many lines as it likes at the cost of a memory copy.  All
+ *		buffered chunks are then written out together with a
+ *		single gathering write when the emitter is flushed.
+ *
+ *		Chunks are never returned to the system once allocated.
+ *		After a flush they are simply reused, so the memory used
+ *		by the emitter is bounded by the largest amount of output
+ *		buffered between any two flushes (normally one function).
+ *
+ *		An emitter may instead hand its output to an assembler when
+ *		flushed, in which case the object file is only written once
+ *		the emitter is finished, unless the assembler is instead
+ *		detached to be loaded into memory.
+ */
+
+# ifndef EMITTER_H
+# define EMITTER_H
+# include <string>
+# include <vector>
+# include <ostream>
+# include <streambuf>
+
+class Assembler;
+
+class Emitter : public std::ostream {
+    class Buffer : public std::streambuf {
+	std::vector<char *> _chunks;
+	unsigned _used;
+
+	void grow();
+
+    protected:
+	virtual int_type overflow(int_type c);
+	virtual std::streamsize xsputn(const char *s, std::streamsize n);
+	virtual int sync();
+
+    public:
+	int fd;
+
+	Buffer();
+	~Buffer();
+	size_t size() const;
+	bool drain();
+	void take(std::string &text);
+    };
+
+    Buffer _buffer;
+    std::string _path;
+    Assembler *_assembler;
+
+public:
+    Emitter();
+    ~Emitter();
+
+    bool open(const std::string &path);
+    const std::string &path() const;
+    size_t size() const;
+    void assemble();
+    Assembler *detach();
+    void flush();
+    void finish();
+};
+
+# endif /* EMITTER_H */
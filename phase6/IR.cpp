@@ -0,0 +1,540 @@
+/*
+ * File:	IR.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the intermediate representation of Simple C functions,
+ *		along with functions to write it to a stream, which is
+ *		useful mainly for debugging.
+ */
+
+# include <cassert>
+# include "IR.h"
+
+using namespace std;
+
+static const char *opcodes[] = {
+    "copy", "add", "sub", "mul", "div", "rem", "neg", "extend", "load",
+    "store", "set", "address", "call", "jump", "branch", "return",
+};
+
+static const char *conditions[] = {
+    "eq", "ne", "lt", "gt", "le", "ge",
+};
+
+
+/*
+ * Function:	Operand::Operand (constructor)
+ *
+ * Description:	Initialize an empty operand.
+ */
+
+Operand::Operand()
+    : kind(NONE), size(0), value(0)
+{
+}
+
+
+/*
+ * Function:	Operand::Operand (constructor)
+ *
+ * Description:	Initialize an operand of the given kind and size.  The
+ *		value is the number of the temporary, slot, label, or vector
+ *		register, or the value of a constant.
+ */
+
+Operand::Operand(Kind kind, unsigned size, long value)
+    : kind(kind), size(size), value(value)
+{
+}
+
+
+/*
+ * Function:	Operand::Operand (constructor)
+ *
+ * Description:	Initialize an operand as the address of a global.
+ */
+
+Operand::Operand(const Symbol *symbol)
+    : kind(GLOBAL), size(8), symbol(symbol)
+{
+}
+
+
+/*
+ * Function:	Operand::isTemp
+ *
+ * Description:	Return whether this operand is a temporary.
+ */
+
+bool Operand::isTemp() const
+{
+    return kind == TEMP;
+}
+
+
+/*
+ * Function:	Operand::isConst
+ *
+ * Description:	Return whether this operand is an integer constant.
+ */
+
+bool Operand::isConst() const
+{
+    return kind == CONST;
+}
+
+
+/*
+ * Function:	Operand::isAddress
+ *
+ * Description:	Return whether this operand is a constant address, which
+ *		is known only to the assembler or the storage allocator.
+ */
+
+bool Operand::isAddress() const
+{
+    return kind == SLOT || kind == GLOBAL || kind == STRING;
+}
+
+
+/*
+ * Function:	Operand::isVector
+ *
+ * Description:	Return whether this operand is a vector register.
+ */
+
+bool Operand::isVector() const
+{
+    return kind == VECTOR;
+}
+
+
+/*
+ * Function:	Operand::operator ==
+ *
+ * Description:	Return whether two operands are the same.
+ */
+
+bool Operand::operator ==(const Operand &that) const
+{
+    return kind == that.kind && size == that.size && value == that.value;
+}
+
+
+/*
+ * Function:	Operand::operator !=
+ *
+ * Description:	Return whether two operands differ.
+ */
+
+bool Operand::operator !=(const Operand &that) const
+{
+    return !operator ==(that);
+}
+
+
+/*
+ * Function:	Quad::Quad (constructor)
+ *
+ * Description:	Initialize a quad with the given opcode and operands.
+ */
+
+Quad::Quad(Opcode opcode, const Operand &result, const Operand &left,
+	const Operand &right)
+    : opcode(opcode), condition(NE), result(result), left(left),
+      right(right), callee(nullptr), scale(1), offset(0)
+{
+}
+
+
+/*
+ * Function:	Quad::isTerminator
+ *
+ * Description:	Return whether this quad ends a basic block.
+ */
+
+bool Quad::isTerminator() const
+{
+    return opcode == JUMP || opcode == BRANCH || opcode == RET;
+}
+
+
+/*
+ * Function:	Quad::uses
+ *
+ * Description:	Collect the operands that are read by this quad.  The
+ *		result of a quad is only ever written.
+ */
+
+void Quad::uses(vector<Operand *> &operands)
+{
+    operands.clear();
+
+    if (left.kind != Operand::NONE)
+	operands.push_back(&left);
+
+    if (right.kind != Operand::NONE)
+	operands.push_back(&right);
+
+    if (index.kind != Operand::NONE)
+	operands.push_back(&index);
+
+    for (auto &arg : args)
+	operands.push_back(&arg);
+}
+
+
+/*
+ * Function:	BasicBlock::BasicBlock (constructor)
+ *
+ * Description:	Initialize an empty basic block.
+ */
+
+BasicBlock::BasicBlock(unsigned number)
+    : number(number), count(0), next{nullptr, nullptr}
+{
+}
+
+
+/*
+ * Function:	BasicBlock::terminated
+ *
+ * Description:	Return whether this block already has its last quad.
+ */
+
+bool BasicBlock::terminated() const
+{
+    return !quads.empty() && quads.back().isTerminator();
+}
+
+
+/*
+ * Function:	BasicBlock::successors
+ *
+ * Description:	Return the number of successors of this block.
+ */
+
+unsigned BasicBlock::successors() const
+{
+    return next[0] == nullptr ? 0 : (next[1] == nullptr ? 1 : 2);
+}
+
+
+/*
+ * Function:	Procedure::Procedure (constructor)
+ *
+ * Description:	Initialize a procedure for the given function with an
+ *		empty entry block.
+ */
+
+Procedure::Procedure(const Symbol *function)
+    : function(function), current(nullptr), spilled(0), profiled(false)
+{
+    place(block());
+}
+
+
+/*
+ * Function:	Procedure::~Procedure (destructor)
+ *
+ * Description:	Delete the blocks of this procedure.
+ */
+
+Procedure::~Procedure()
+{
+    for (auto block : blocks)
+	delete block;
+}
+
+
+/*
+ * Function:	Procedure::temp
+ *
+ * Description:	Create a new temporary of the given size.
+ */
+
+Operand Procedure::temp(unsigned size, bool isNamed)
+{
+    temps.push_back(size);
+    named.push_back(isNamed);
+    return Operand(Operand::TEMP, size, temps.size() - 1);
+}
+
+
+/*
+ * Function:	Procedure::slot
+ *
+ * Description:	Create a new stack slot and return its address.  A slot
+ *		with a nonzero offset is at a fixed location, such as a
+ *		parameter passed on the stack.
+ */
+
+Operand Procedure::slot(unsigned size, unsigned alignment, int offset)
+{
+    slots.push_back({size, alignment, offset});
+    return Operand(Operand::SLOT, 8, slots.size() - 1);
+}
+
+
+/*
+ * Function:	Procedure::constant
+ *
+ * Description:	Create a constant of the given size.
+ */
+
+Operand Procedure::constant(long value, unsigned size)
+{
+    return Operand(Operand::CONST, size, value);
+}
+
+
+/*
+ * Function:	Procedure::block
+ *
+ * Description:	Create a new basic block.  A block belongs to the
+ *		procedure only once it is placed, so the blocks are kept in
+ *		the order in which they are placed, rather than the order
+ *		in which they are created.  Every block is eventually
+ *		placed.
+ */
+
+BasicBlock *Procedure::block()
+{
+    return new BasicBlock(0);
+}
+
+
+/*
+ * Function:	Procedure::place
+ *
+ * Description:	Make the given block the current block, falling into it
+ *		from the current block if necessary.
+ */
+
+void Procedure::place(BasicBlock *block)
+{
+    if (current != nullptr && !current->terminated())
+	jump(block);
+
+    block->number = blocks.size();
+    blocks.push_back(block);
+    current = block;
+}
+
+
+/*
+ * Function:	Procedure::emit
+ *
+ * Description:	Append a quad to the current block.  Any quads following a
+ *		terminator are unreachable, and so are placed into a new
+ *		block, which will be discarded.
+ */
+
+void Procedure::emit(const Quad &quad)
+{
+    if (current->terminated())
+	place(block());
+
+    current->quads.push_back(quad);
+}
+
+
+/*
+ * Function:	Procedure::jump
+ *
+ * Description:	End the current block with a jump to the given block.
+ */
+
+void Procedure::jump(BasicBlock *target)
+{
+    emit(Quad(JUMP));
+    current->next[0] = target;
+}
+
+
+/*
+ * Function:	Procedure::branch
+ *
+ * Description:	End the current block with a conditional branch.
+ */
+
+void Procedure::branch(Condition cond, const Operand &left,
+	const Operand &right, BasicBlock *ifTrue, BasicBlock *ifFalse)
+{
+    Quad quad(BRANCH, Operand(), left, right);
+
+
+    quad.condition = cond;
+    emit(quad);
+    current->next[0] = ifTrue;
+    current->next[1] = ifFalse;
+}
+
+
+/*
+ * Function:	Procedure::link
+ *
+ * Description:	Finish the graph by discarding the blocks that cannot be
+ *		reached from the entry block, renumbering the remaining
+ *		blocks in order, and computing their predecessors.
+ */
+
+void Procedure::link()
+{
+    vector<BasicBlock *> work, reachable;
+    vector<bool> seen(blocks.size(), false);
+    unsigned i;
+
+
+    if (!current->terminated())
+	emit(Quad(RET));
+
+    work.push_back(blocks[0]);
+    seen[0] = true;
+
+    while (!work.empty()) {
+	BasicBlock *block = work.back();
+	work.pop_back();
+
+	assert(block->terminated());
+
+	for (i = 0; i < block->successors(); i ++)
+	    if (!seen[block->next[i]->number]) {
+		seen[block->next[i]->number] = true;
+		work.push_back(block->next[i]);
+	    }
+    }
+
+    for (auto block : blocks)
+	if (seen[block->number])
+	    reachable.push_back(block);
+	else
+	    delete block;
+
+    blocks = reachable;
+
+    for (i = 0; i < blocks.size(); i ++) {
+	blocks[i]->number = i;
+	blocks[i]->preds.clear();
+    }
+
+    for (auto block : blocks)
+	for (i = 0; i < block->successors(); i ++)
+	    block->next[i]->preds.push_back(block);
+}
+
+
+/*
+ * Function:	inverse
+ *
+ * Description:	Return the inverse of the given condition.
+ */
+
+Condition inverse(Condition cond)
+{
+    static const Condition inverses[] = {NE, EQ, GE, LE, GT, LT};
+
+    return inverses[cond];
+}
+
+
+/*
+ * Function:	operator << (Operand)
+ *
+ * Description:	Write an operand to the given stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Operand &operand)
+{
+    switch (operand.kind) {
+    case Operand::TEMP:
+	return ostr << "t" << operand.temp << ":" << (unsigned) operand.size;
+
+    case Operand::CONST:
+	return ostr << operand.value;
+
+    case Operand::SLOT:
+	return ostr << "&s" << operand.slot;
+
+    case Operand::GLOBAL:
+	return ostr << "&" << operand.symbol->name();
+
+    case Operand::STRING:
+	return ostr << "&.LC" << operand.label;
+
+    case Operand::VECTOR:
+	return ostr << "v" << operand.reg << ":" << (unsigned) operand.size;
+    }
+
+    return ostr << "-";
+}
+
+
+/*
+ * Function:	operator << (Quad)
+ *
+ * Description:	Write a quad to the given stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Quad &quad)
+{
+    if (quad.result.kind != Operand::NONE)
+	ostr << quad.result << " = ";
+
+    ostr << opcodes[quad.opcode];
+
+    if (quad.opcode == SET || quad.opcode == BRANCH)
+	ostr << "." << conditions[quad.condition];
+
+    if (quad.callee != nullptr)
+	ostr << " " << quad.callee->name();
+
+    if (quad.left.kind != Operand::NONE)
+	ostr << " " << quad.left;
+
+    if (quad.index.kind != Operand::NONE)
+	ostr << " + " << quad.index << " * " << (unsigned) quad.scale;
+
+    if (quad.offset != 0)
+	ostr << " + " << quad.offset;
+
+    if (quad.right.kind != Operand::NONE)
+	ostr << ", " << quad.right;
+
+    for (auto &arg : quad.args)
+	ostr << ", " << arg;
+
+    return ostr;
+}
+
+
+/*
+ * Function:	Procedure::write
+ *
+ * Description:	Write this procedure to the given stream.
+ */
+
+void Procedure::write(ostream &ostr) const
+{
+    ostr << function->name() << ":" << endl;
+
+    for (auto block : blocks) {
+	ostr << "b" << block->number << ":";
+
+	for (auto pred : block->preds)
+	    ostr << " b" << pred->number;
+
+	ostr << endl;
+
+	for (auto &quad : block->quads) {
+	    ostr << "\t" << quad;
+
+	    if (quad.opcode == JUMP)
+		ostr << " b" << block->next[0]->number;
+	    else if (quad.opcode == BRANCH)
+		ostr << " b" << block->next[0]->number << ", b" << block->next[1]->number;
+
+	    ostr << endl;
+	}
+    }
+}
@@ -0,0 +1,214 @@
+/*
+ * File:	IR.h
+ *
+ * Description:	This file contains the class definitions for the
+ *		intermediate representation of Simple C functions.
+ *
+ *		A function is lowered from its abstract syntax tree into a
+ *		procedure, which is a control flow graph of basic blocks.
+ *		Each block is a sequence of three-address instructions
+ *		(quads) ending in exactly one jump, branch, or return.
+ *		Values are held in an unlimited number of temporaries,
+ *		which are later mapped to machine registers or to the
+ *		stack by the register allocator.
+ *
+ *		A temporary is either a named variable, which may be
+ *		assigned any number of times, or an unnamed value computed
+ *		by an expression, which is assigned once but may be
+ *		assigned in several blocks by the logical operators.
+ *
+ *		Memory is only accessed by loads and stores.  An address
+ *		is either a temporary or the address of a stack slot, a
+ *		global, or a string literal, which are constants and so
+ *		can be used directly by the machine instructions.  Just
+ *		before registers are allocated, the addressing modes of the
+ *		machine are selected, after which an address may also have
+ *		a scaled index and an offset, and may be computed by itself.
+ *
+ *		A vectorized loop also computes values in vector registers,
+ *		each holding several elements of the same size in its
+ *		lanes.  There are no temporaries of vector values, so each
+ *		is given its register when created by the vectorizer.
+ *
+ *		Procedures own their blocks and are deleted after code has
+ *		been generated for them.  The member functions are split
+ *		across files in the same way as for the tree:
+ *
+ *		IR.cpp - constructors, accessors, and writing
+ *		layout.cpp - jump threading, profiling, and block layout
+ *		inline.cpp - inline expansion
+ *		tail.cpp - tail call optimization
+ *		values.cpp - value numbering
+ *		vectorize.cpp - loop vectorization
+ *		loops.cpp - loop optimization
+ *		select.cpp - selection of addressing modes
+ *		regalloc.cpp - liveness and register allocation
+ *		allocator.cpp - storage allocation of the stack slots
+ *		generator.cpp - code generation
+ */
+
+# ifndef IR_H
+# define IR_H
+# include <vector>
+# include <ostream>
+# include "Symbol.h"
+# include "Label.h"
+
+enum Opcode {
+    COPY, ADD, SUB, MUL, DIVIDE, REMAINDER, NEG, EXTEND, LOAD, STORE, SET,
+    ADDRESS, CALL, JUMP, BRANCH, RET,
+};
+
+enum Condition {
+    EQ, NE, LT, GT, LE, GE,
+};
+
+
+/* An operand: nothing, a temporary, a constant, a constant address, or
+   a vector register, whose size is that of each of its lanes */
+
+class Operand {
+public:
+    enum Kind {
+	NONE, TEMP, CONST, SLOT, GLOBAL, STRING, VECTOR,
+    };
+
+    unsigned char kind;
+    unsigned char size;
+
+    union {
+	unsigned temp;
+	long value;
+	unsigned slot;
+	const Symbol *symbol;
+	unsigned label;
+	unsigned reg;
+    };
+
+    Operand();
+    Operand(Kind kind, unsigned size, long value);
+    Operand(const Symbol *symbol);
+
+    bool isTemp() const;
+    bool isConst() const;
+    bool isAddress() const;
+    bool isVector() const;
+    bool operator ==(const Operand &that) const;
+    bool operator !=(const Operand &that) const;
+};
+
+
+/* A three-address instruction: result = left op right, where a return
+   with a callee is a tail call of the callee with the arguments, and
+   the address of a load, store, or address quad is left + index * scale
+   + offset */
+
+class Quad {
+public:
+    Opcode opcode;
+    Condition condition;
+    Operand result, left, right;
+    const Symbol *callee;
+    std::vector<Operand> args;
+    Operand index;
+    unsigned char scale;
+    int offset;
+
+    Quad(Opcode opcode, const Operand &result = Operand(),
+	const Operand &left = Operand(), const Operand &right = Operand());
+
+    bool isTerminator() const;
+    void uses(std::vector<Operand *> &operands);
+};
+
+
+/* A basic block, whose successors are determined by its last quad, and
+   which was executed the given number of times if profiled */
+
+class BasicBlock {
+public:
+    unsigned number;
+    unsigned long count;
+    Label label;
+    std::vector<Quad> quads;
+    BasicBlock *next[2];
+    std::vector<BasicBlock *> preds;
+
+    BasicBlock(unsigned number);
+    bool terminated() const;
+    unsigned successors() const;
+};
+
+
+/* A stack slot, with an offset assigned by the storage allocator */
+
+struct Slot {
+    unsigned size, alignment;
+    int offset;
+};
+
+
+/* A procedure: the control flow graph of a function */
+
+class Procedure {
+public:
+    const Symbol *function;
+    std::vector<BasicBlock *> blocks;
+    BasicBlock *current;
+
+    std::vector<unsigned char> temps;
+    std::vector<bool> named;
+    std::vector<Slot> slots;
+    std::vector<Operand> params;
+
+    std::vector<class Register *> registers;
+    std::vector<unsigned> spills;
+    unsigned spilled;
+    bool profiled;
+
+    Procedure(const Symbol *function);
+    ~Procedure();
+
+    Operand temp(unsigned size, bool isNamed = false);
+    Operand slot(unsigned size, unsigned alignment, int offset = 0);
+    Operand constant(long value, unsigned size);
+
+    BasicBlock *block();
+    void place(BasicBlock *block);
+    void emit(const Quad &quad);
+    void jump(BasicBlock *target);
+    void branch(Condition cond, const Operand &left, const Operand &right,
+	BasicBlock *ifTrue, BasicBlock *ifFalse);
+
+    void link();
+    void threadJumps();
+    void write(std::ostream &ostr) const;
+
+    void instrument(class Counters &counters);
+    void annotate(const class Profile &profile);
+    void layout();
+
+    unsigned size() const;
+    Procedure *copy() const;
+    void expand(const class Inlines &inlines);
+
+    void optimizeTailCalls();
+    void numberValues();
+    void vectorizeLoops();
+    void optimizeLoops(unsigned registers);
+    void selectAddresses();
+    void liveness(std::vector<std::vector<unsigned long>> &liveOut) const;
+    std::vector<class Register *>
+	allocateRegisters(const std::vector<class Register *> &callerSaved,
+	    const std::vector<class Register *> &calleeSaved,
+	    const std::vector<class Register *> &parameters,
+	    const class Conventions &conventions);
+    void allocate(int &offset);
+};
+
+std::ostream &operator <<(std::ostream &ostr, const Operand &operand);
+std::ostream &operator <<(std::ostream &ostr, const Quad &quad);
+
+Condition inverse(Condition cond);
+
+# endif /* IR_H */
@@ -0,0 +1,171 @@
+/*
+ * File:	Inlines.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the table of functions that may be expanded inline.
+ */
+
+# include "Inlines.h"
+# include "machine.h"
+# include "context.h"
+# include "Profile.h"
+# include "IR.h"
+
+using namespace std;
+
+# define INLINE_BUDGET 24
+# define HOT_INLINE_BUDGET 96
+
+
+/*
+ * Function:	eligible (private)
+ *
+ * Description:	Return whether a procedure may be expanded inline: it must
+ *		be small, must not call itself, and must have all of its
+ *		parameters in registers, since the parameters passed on the
+ *		stack are at fixed locations in its frame.  A procedure
+ *		entered often enough to be hot may be somewhat larger.
+ */
+
+static bool eligible(const Procedure &proc)
+{
+    const Parameters *params = proc.function->type().parameters();
+    const Profile *profile = CompilerContext::current()->profile;
+    unsigned budget = INLINE_BUDGET;
+
+
+    if (params->variadic || params->types.size() > NUM_PARAM_REGS)
+	return false;
+
+    if (proc.profiled && profile->hot(proc.blocks[0]->count))
+	budget = HOT_INLINE_BUDGET;
+
+    if (proc.size() > budget)
+	return false;
+
+    for (auto block : proc.blocks)
+	for (auto &quad : block->quads)
+	    if (quad.opcode == CALL && quad.callee == proc.function)
+		return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	Inlines::~Inlines (destructor)
+ *
+ * Description:	Delete the procedures kept in this table.
+ */
+
+Inlines::~Inlines()
+{
+    for (auto &entry : _entries)
+	delete entry.second.proc;
+}
+
+
+/*
+ * Function:	Inlines::add
+ *
+ * Description:	Add the given function to this table, in the order in
+ *		which the functions are defined.
+ */
+
+void Inlines::add(const Symbol *function)
+{
+    lock_guard<mutex> guard(_mutex);
+    unsigned order = _entries.size();
+
+
+    _entries[function] = {order, false, nullptr};
+}
+
+
+/*
+ * Function:	Inlines::define
+ *
+ * Description:	Record that the function of the given procedure has been
+ *		lowered, keeping a copy of the procedure if it may be
+ *		expanded inline, and wake anyone waiting for it.  Calls
+ *		within the procedure have already been expanded, so a
+ *		small function calling another small function may be
+ *		expanded in turn.
+ */
+
+void Inlines::define(const Procedure &proc)
+{
+    Procedure *copy = eligible(proc) ? proc.copy() : nullptr;
+    lock_guard<mutex> guard(_mutex);
+    Entry &entry = _entries.at(proc.function);
+
+
+    entry.proc = copy;
+    entry.defined = true;
+    _defined.notify_all();
+}
+
+
+/*
+ * Function:	Inlines::define
+ *
+ * Description:	Record that the given function, which may not be expanded
+ *		inline, has been defined without being lowered.
+ */
+
+void Inlines::define(const Symbol *function)
+{
+    lock_guard<mutex> guard(_mutex);
+    Entry &entry = _entries.at(function);
+
+
+    entry.defined = true;
+    _defined.notify_all();
+}
+
+
+/*
+ * Function:	Inlines::kept
+ *
+ * Description:	Return whether a procedure was kept for the given
+ *		function, which has already been defined.
+ */
+
+bool Inlines::kept(const Symbol *function) const
+{
+    lock_guard<mutex> guard(_mutex);
+
+    return _entries.at(function).proc != nullptr;
+}
+
+
+/*
+ * Function:	Inlines::find
+ *
+ * Description:	Return the procedure for the given callee if it may be
+ *		expanded inline into the given caller, or null otherwise,
+ *		waiting for the callee to be lowered if necessary.  A
+ *		callee kept only because it is hot is only expanded into a
+ *		call that is hot as well.
+ */
+
+const Procedure *Inlines::find(const Symbol *callee, const Symbol *caller,
+	bool hot) const
+{
+    unique_lock<mutex> lock(_mutex);
+    auto it = _entries.find(callee), that = _entries.find(caller);
+
+
+    if (it == _entries.end() || that == _entries.end())
+	return nullptr;
+
+    if (it->second.order >= that->second.order)
+	return nullptr;
+
+    _defined.wait(lock, [&]() {return it->second.defined;});
+
+    if (!hot && it->second.proc != nullptr && it->second.proc->size() > INLINE_BUDGET)
+	return nullptr;
+
+    return it->second.proc;
+}
@@ -0,0 +1,51 @@
+/*
+ * File:	Inlines.h
+ *
+ * Description:	This file contains the class definition for the table of
+ *		functions that may be expanded inline.  The parser adds
+ *		each function to the table as it hands the function to the
+ *		pipeline, and once the function has been lowered, a copy of
+ *		its procedure is kept if it is small enough to be worth
+ *		expanding.  A call is only expanded if the callee was
+ *		defined before the caller, so the code generated for a
+ *		function depends only upon the source.
+ *
+ *		The functions of a unit may be generated by several
+ *		threads at once, so finding a callee that is still being
+ *		lowered waits for it.  The callee was handed to the
+ *		pipeline first, and so is never waiting for the caller.
+ *		The procedures are never changed once kept.
+ */
+
+# ifndef INLINES_H
+# define INLINES_H
+# include <mutex>
+# include <unordered_map>
+# include <condition_variable>
+
+class Procedure;
+class Symbol;
+
+class Inlines {
+    struct Entry {
+	unsigned order;
+	bool defined;
+	const Procedure *proc;
+    };
+
+    mutable std::mutex _mutex;
+    mutable std::condition_variable _defined;
+    std::unordered_map<const Symbol *, Entry> _entries;
+
+public:
+    ~Inlines();
+
+    void add(const Symbol *function);
+    void define(const Procedure &proc);
+    void define(const Symbol *function);
+    bool kept(const Symbol *function) const;
+    const Procedure *find(const Symbol *callee, const Symbol *caller,
+	bool hot) const;
+};
+
+# endif /* INLINES_H */
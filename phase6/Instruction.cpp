@@ -0,0 +1,106 @@
+/*
+ * File:	Instruction.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		assembly instructions.
+ */
+
+# include "Instruction.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Instruction::Instruction (constructor)
+ *
+ * Description:	Initialize this instruction to be a label with the given
+ *		name.
+ */
+
+Instruction::Instruction(const string &label)
+    : size(0), target(label)
+{
+}
+
+
+/*
+ * Function:	Instruction::Instruction (constructor)
+ *
+ * Description:	Initialize this instruction with the given opcode, size,
+ *		and operands.  A single operand is moved to the target.
+ */
+
+Instruction::Instruction(const string &opcode, unsigned size,
+	const string &source, const string &target)
+    : opcode(opcode), size(size), source(source), target(target)
+{
+    if (this->target.empty())
+	this->target.swap(this->source);
+}
+
+
+/*
+ * Function:	Instruction::isLabel (predicate)
+ *
+ * Description:	Return whether this instruction is actually a label.
+ */
+
+bool Instruction::isLabel() const
+{
+    return opcode.empty();
+}
+
+
+/*
+ * Function:	Instruction::write
+ *
+ * Description:	Write this instruction to the specified stream in the
+ *		syntax expected by the assembler.
+ */
+
+void Instruction::write(ostream &ostr) const
+{
+    unsigned power = 0;
+
+
+    if (opcode.empty()) {
+	if (size > 1) {
+	    while (1U << power < size)
+		power ++;
+
+	    ostr << "\t.p2align\t" << power << '\n';
+	}
+
+	ostr << target << ":\n";
+	return;
+    }
+
+    ostr << '\t' << opcode;
+
+    if (size != 0)
+	ostr << (size == 1 ? 'b' : (size == 4 ? 'l' : 'q'));
+
+    if (!target.empty()) {
+	ostr << '\t';
+
+	if (!source.empty())
+	    ostr << source << ", ";
+
+	ostr << target;
+    }
+
+    ostr << '\n';
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write an instruction to a stream.
+ */
+
+ostream &operator <<(ostream &ostr, const Instruction &insn)
+{
+    insn.write(ostr);
+    return ostr;
+}
@@ -0,0 +1,46 @@
+/*
+ * File:	Instruction.h
+ *
+ * Description:	This file contains the class definition for assembly
+ *		instructions.  The code generator appends instructions to
+ *		a list rather than writing them as text, so that the list
+ *		can be optimized before being written.
+ *
+ *		An instruction consists of an opcode, an access size that
+ *		determines the opcode suffix, and at most two operands in
+ *		AT&T order.  An instruction with only one operand always
+ *		stores it as the target.  A size of zero means that the
+ *		opcode has no suffix (or that it is already part of the
+ *		opcode).  A label
+ *		is just an instruction with an empty opcode whose target is
+ *		the name of the label, and whose size is the number of
+ *		bytes to which the label is aligned, if any.
+ */
+
+# ifndef INSTRUCTION_H
+# define INSTRUCTION_H
+# include <string>
+# include <vector>
+# include <ostream>
+
+class Instruction {
+    typedef std::string string;
+
+public:
+    string opcode;
+    unsigned size;
+    string source, target;
+
+    Instruction(const string &label);
+    Instruction(const string &opcode, unsigned size,
+	const string &source = "", const string &target = "");
+
+    bool isLabel() const;
+    void write(std::ostream &ostr) const;
+};
+
+typedef std::vector<Instruction> Instructions;
+
+std::ostream &operator <<(std::ostream &ostr, const Instruction &insn);
+
+# endif /* INSTRUCTION_H */
@@ -1,9 +1,15 @@
 
 #include "Label.h"
 
-unsigned Label::_counter = 0;
+/* Labels are numbered separately within each function, and the name of
+   the function is part of the label, so the labels of a function do not
+   depend upon which thread generates it or upon the other functions. */
+
+thread_local Name Label::_scope = nullptr;
+thread_local unsigned Label::_counter = 0;
 
 Label::Label() {
+	_function = _scope;
 	_number = _counter++;
 }
 
@@ -11,6 +17,15 @@ unsigned Label::number() const {
 	return _number;
 }
 
+Name Label::function() const {
+	return _function;
+}
+
+void Label::enter(Name function) {
+	_scope = function;
+	_counter = 0;
+}
+
 std::ostream &operator <<(std::ostream &ostr, const Label &label) {
-	return ostr << ".L" << label.number();
-}
\ No newline at end of file
+	return ostr << ".L" << *label.function() << "." << label.number();
+}
@@ -1,13 +1,22 @@
+# ifndef LABEL_H
+# define LABEL_H
 
 # include <iostream>
 # include <string>
 #include <ostream>
+# include "intern.h"
 
 class Label {
-	static unsigned _counter;
+	static thread_local Name _scope;
+	static thread_local unsigned _counter;
+	Name _function;
 	unsigned _number;
 	public:
 		Label();
 		unsigned number() const;
+		Name function() const;
+		static void enter(Name function);
 };
-std::ostream &operator <<(std::ostream &ostr, const Label &label);
\ No newline at end of file
+std::ostream &operator <<(std::ostream &ostr, const Label &label);
+
+# endif /* LABEL_H */
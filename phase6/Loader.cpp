@@ -0,0 +1,217 @@
+/*
+ * File:	Loader.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the loader.  The text, the stubs, the read-only data, and
+ *		the common symbols are placed in a single mapping, in that
+ *		order, with each of the last two starting a new page.  The
+ *		relocations are applied while the mapping is still
+ *		writable, after which the text and stubs are made
+ *		executable and the read-only data read-only.
+ *
+ *		A stub is an indirect jump through the address following
+ *		it, as in "jmp *0(%rip)".
+ */
+
+# include <cerrno>
+# include <cstring>
+# include <iostream>
+# include <dlfcn.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include "Loader.h"
+
+using namespace std;
+
+# define STUB_SIZE 16
+
+
+/*
+ * Function:	roundup (private)
+ *
+ * Description:	Return the given size rounded up to a multiple of the given
+ *		alignment.
+ */
+
+static size_t roundup(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+
+/*
+ * Function:	Loader::Loader (constructor)
+ *
+ * Description:	Initialize this loader to have nothing loaded.
+ */
+
+Loader::Loader()
+    : _base(nullptr), _size(0)
+{
+}
+
+
+/*
+ * Function:	Loader::~Loader (destructor)
+ *
+ * Description:	Unmap whatever was loaded.
+ */
+
+Loader::~Loader()
+{
+    if (_base != nullptr)
+	munmap(_base, _size);
+}
+
+
+/*
+ * Function:	Loader::load
+ *
+ * Description:	Link the given translation unit and load it into memory,
+ *		returning whether it could be loaded.  Each function called
+ *		but not defined gets a stub jumping to its address in the
+ *		process.  Any other symbol not defined must already have an
+ *		address within the low two gigabytes.  A common symbol is
+ *		aligned as it would be by the system assembler.  Once the
+ *		unit is loaded, its constructors are run in order, as the
+ *		system loader would.  If the unit cannot be loaded, the
+ *		reason is reported.
+ */
+
+bool Loader::load(Assembler &assembler)
+{
+    size_t page = sysconf(_SC_PAGESIZE), stubs, rodata, data, size, align;
+    vector<Assembler::Relocation> relocations;
+    unordered_map<string, char *> externals;
+    vector<pair<string, size_t>> common;
+    string text;
+    char *target, *place;
+    long value;
+    int word;
+
+
+    assembler.link(text, relocations);
+
+    stubs = roundup(text.size(), STUB_SIZE);
+    size = stubs;
+
+    for (auto &relocation : relocations)
+	if (relocation.section == Assembler::EXTERNAL)
+	    if (relocation.type == Assembler::RELATIVE && externals.count(relocation.symbol) == 0) {
+		externals[relocation.symbol] = nullptr;
+		size += STUB_SIZE;
+	    }
+
+    rodata = roundup(size, page);
+    data = roundup(rodata + assembler.rodata().size(), page);
+    size = data;
+
+    for (auto &symbol : assembler.common()) {
+	for (align = 1; align < 16 && align * 2 <= symbol.second; align *= 2)
+	    continue;
+
+	size = roundup(size, align);
+	common.emplace_back(symbol.first, size);
+	size += symbol.second;
+    }
+
+    _size = roundup(max(size, (size_t) 1), page);
+    _base = (char *) mmap(nullptr, _size, PROT_READ | PROT_WRITE,
+	MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+    if (_base == MAP_FAILED) {
+	_base = nullptr;
+	cerr << "scc: cannot load program: " << strerror(errno) << endl;
+	return false;
+    }
+
+    memcpy(_base, text.data(), text.size());
+    memcpy(_base + rodata, assembler.rodata().data(), assembler.rodata().size());
+
+    for (auto &function : assembler.functions())
+	_functions[function.first] = _base + function.second;
+
+    place = _base + stubs;
+
+    for (auto &external : externals) {
+	void *address = dlsym(RTLD_DEFAULT, external.first.c_str());
+
+	if (address == nullptr) {
+	    cerr << "scc: " << external.first << ": undefined symbol" << endl;
+	    return false;
+	}
+
+	memcpy(place, "\xFF\x25\x00\x00\x00\x00", 6);
+	memcpy(place + 6, &address, sizeof(address));
+	external.second = place;
+	place += STUB_SIZE;
+    }
+
+    for (auto &relocation : relocations) {
+	place = _base + relocation.offset;
+
+	if (relocation.section == Assembler::TEXT)
+	    target = _base;
+	else if (relocation.section == Assembler::RODATA)
+	    target = _base + rodata;
+	else if (relocation.type == Assembler::RELATIVE)
+	    target = externals[relocation.symbol];
+	else {
+	    target = nullptr;
+
+	    for (auto &symbol : common)
+		if (symbol.first == relocation.symbol)
+		    target = _base + symbol.second;
+
+	    if (target == nullptr && _functions.count(relocation.symbol) > 0)
+		target = _functions[relocation.symbol];
+
+	    if (target == nullptr)
+		target = (char *) dlsym(RTLD_DEFAULT, relocation.symbol.c_str());
+
+	    if (target == nullptr) {
+		cerr << "scc: " << relocation.symbol << ": undefined symbol" << endl;
+		return false;
+	    }
+	}
+
+	if (relocation.type == Assembler::ABSOLUTE)
+	    value = (long) (target + relocation.addend);
+	else
+	    value = target + relocation.addend - place;
+
+	if (value != (int) value) {
+	    cerr << "scc: " << relocation.symbol << ": cannot be addressed" << endl;
+	    return false;
+	}
+
+	word = value;
+	memcpy(place, &word, sizeof(word));
+    }
+
+    if (mprotect(_base, rodata, PROT_READ | PROT_EXEC) < 0
+	    || (data > rodata && mprotect(_base + rodata, data - rodata, PROT_READ) < 0)) {
+	cerr << "scc: cannot load program: " << strerror(errno) << endl;
+	return false;
+    }
+
+    for (auto constructor : assembler.constructors())
+	((void (*)()) (_base + constructor))();
+
+    return true;
+}
+
+
+/*
+ * Function:	Loader::find
+ *
+ * Description:	Return the address of the global function with the given
+ *		name, or null if there is no such function.
+ */
+
+void *Loader::find(const string &name) const
+{
+    auto it = _functions.find(name);
+
+    return it != _functions.end() ? it->second : nullptr;
+}
@@ -0,0 +1,40 @@
+/*
+ * File:	Loader.h
+ *
+ * Description:	This file contains the class definition for the loader,
+ *		which places the code and data of an assembled translation
+ *		unit in the memory of the compiler itself, so that the
+ *		program can be run without being written, linked, or
+ *		executed as a separate process.
+ *
+ *		The generated code refers to its strings and globals by
+ *		absolute 32-bit addresses, so everything is mapped within
+ *		the low two gigabytes.  The functions of the C library are
+ *		found with dlsym() and are usually much farther away than a
+ *		call can reach, so each is called through a stub in the
+ *		text that jumps indirectly to its address, much like the
+ *		PLT of a dynamically linked program.
+ */
+
+# ifndef LOADER_H
+# define LOADER_H
+# include <string>
+# include <unordered_map>
+# include "Assembler.h"
+
+class Loader {
+    typedef std::string string;
+
+    char *_base;
+    size_t _size;
+    std::unordered_map<string, char *> _functions;
+
+public:
+    Loader();
+    ~Loader();
+
+    bool load(Assembler &assembler);
+    void *find(const string &name) const;
+};
+
+# endif /* LOADER_H */
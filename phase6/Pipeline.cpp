@@ -0,0 +1,356 @@
+/*
+ * File:	Pipeline.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the code generation pipeline.  All writing to the emitter
+ *		is done by the parser thread, so the emitter itself need
+ *		not be synchronized.  The workers only take functions from
+ *		the queue and mark them as done.
+ */
+
+# include <sstream>
+# include "Cache.h"
+# include "CallGraph.h"
+# include "Pipeline.h"
+# include "context.h"
+# include "IR.h"
+# include "Timer.h"
+# include "Tree.h"
+
+using namespace std;
+
+# define JOBS_PER_WORKER 4
+
+
+/*
+ * Function:	Pipeline::Pipeline (constructor)
+ *
+ * Description:	Initialize this pipeline and start the given number of
+ *		workers for the translation unit with the given context.
+ */
+
+Pipeline::Pipeline(CompilerContext *context, unsigned workers)
+    : _context(context), _arena(nullptr), _closing(false), _holding(false)
+{
+    for (unsigned i = 0; i < workers; i ++)
+	_workers.emplace_back(&Pipeline::work, this);
+}
+
+
+/*
+ * Function:	Pipeline::~Pipeline (destructor)
+ *
+ * Description:	Write any functions remaining in the pipeline, and then
+ *		stop the workers.  The arenas are deallocated along with
+ *		the pipeline, since no function can still be using them.
+ */
+
+Pipeline::~Pipeline()
+{
+    finish();
+
+    {
+	lock_guard<mutex> guard(_mutex);
+	_closing = true;
+    }
+
+    _queued.notify_all();
+
+    for (auto &worker : _workers)
+	worker.join();
+}
+
+
+/*
+ * Function:	Pipeline::work (private)
+ *
+ * Description:	Repeatedly take the next function waiting in the queue
+ *		and generate code for it into its own buffer, until the
+ *		pipeline is closed.  A worker uses the context of the
+ *		translation unit and allocates from the arena of the
+ *		function it is generating.
+ */
+
+void Pipeline::work()
+{
+    unique_lock<mutex> lock(_mutex);
+    Job *job;
+
+
+    CompilerContext::use(_context);
+
+    while (true) {
+	_queued.wait(lock, [this]() {return _closing || !_waiting.empty();});
+
+	if (_waiting.empty())
+	    break;
+
+	job = _waiting.front();
+	_waiting.pop_front();
+	lock.unlock();
+
+	ostringstream ostr;
+
+	Arena::use(job->arena);
+	job->function->generate(ostr);
+	job->output = ostr.str();
+	Arena::use(nullptr);
+
+	if (job->cache != nullptr) {
+	    job->cache->store(job->output);
+	    delete job->cache;
+	}
+
+	lock.lock();
+	job->done = true;
+	_completed.notify_one();
+    }
+
+    CompilerContext::use(nullptr);
+}
+
+
+/*
+ * Function:	Pipeline::emit (private)
+ *
+ * Description:	Write the given code for the given function to the
+ *		emitter, unless the code is being held, in which case it is
+ *		kept until the pipeline is released.
+ */
+
+void Pipeline::emit(const Function *function, string &output)
+{
+    if (_holding) {
+	_held.emplace_back(function->symbol(), std::move(output));
+	return;
+    }
+
+    Timer timer(EMIT);
+
+    _context->emitter << output;
+    _context->emitter.flush();
+}
+
+
+/*
+ * Function:	Pipeline::write (private)
+ *
+ * Description:	Write each completed function at the head of the queue,
+ *		waiting for the head to complete as long as more than the
+ *		given number of functions are still in the pipeline.  The
+ *		lock is not held while writing.
+ */
+
+void Pipeline::write(unique_lock<mutex> &lock, size_t limit)
+{
+    Job *job;
+
+
+    while (!_pending.empty()) {
+	if (!_pending.front()->done) {
+	    if (_pending.size() <= limit)
+		break;
+
+	    _completed.wait(lock);
+	    continue;
+	}
+
+	job = _pending.front();
+	_pending.pop_front();
+	lock.unlock();
+
+	emit(job->function, job->output);
+	job->arena->release();
+
+	lock.lock();
+	_free.push_back(job->arena);
+	delete job;
+    }
+}
+
+
+/*
+ * Function:	Pipeline::arena
+ *
+ * Description:	Return an arena for the body of the next function,
+ *		reusing one whose function has already been written if
+ *		possible.
+ */
+
+Arena *Pipeline::arena()
+{
+    lock_guard<mutex> guard(_mutex);
+
+
+    if (_free.empty()) {
+	_arenas.emplace_back();
+	_free.push_back(&_arenas.back());
+    }
+
+    _arena = _free.back();
+    _free.pop_back();
+    return _arena;
+}
+
+
+/*
+ * Function:	Pipeline::reuse (private)
+ *
+ * Description:	Write the given code for the given function, taken from
+ *		the cache, in place of generating it.  The function is
+ *		still lowered if it may be expanded inline, and is called
+ *		as usual.
+ */
+
+void Pipeline::reuse(Function *function, Cache *cache, string &output,
+	bool inlinable)
+{
+    if (inlinable) {
+	Timer timer(GENERATE);
+	Procedure *proc = function->lower();
+
+	_context->inlines.define(*proc);
+	delete proc;
+    } else
+	_context->inlines.define(cache->function());
+
+    _context->conventions.define(cache->function());
+    delete cache;
+
+    if (_workers.empty()) {
+	emit(function, output);
+	discard();
+	return;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+
+    _pending.push_back(new Job {function, _arena, output, true, nullptr});
+    _arena = nullptr;
+
+    write(lock, _workers.size() * JOBS_PER_WORKER);
+}
+
+
+/*
+ * Function:	Pipeline::generate
+ *
+ * Description:	Generate code for the given function, whose body was
+ *		allocated from the arena last returned, unless its code is
+ *		in the given cache entry.  Without any workers, the code is
+ *		generated and written immediately.  Otherwise, the function
+ *		is queued and any functions already completed are written.
+ *		This pipeline owns the entry from now on.
+ */
+
+void Pipeline::generate(Function *function, Cache *cache)
+{
+    bool inlinable;
+    string output;
+
+
+    if (cache != nullptr && cache->find(output, inlinable)) {
+	reuse(function, cache, output, inlinable);
+	return;
+    }
+
+    if (_workers.empty()) {
+	if (cache == nullptr && !_holding)
+	    function->generate(_context->emitter);
+	else {
+	    ostringstream ostr;
+
+	    function->generate(ostr);
+	    output = ostr.str();
+
+	    if (cache != nullptr) {
+		cache->store(output);
+		delete cache;
+	    }
+	}
+
+	emit(function, output);
+	discard();
+	return;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+
+    _pending.push_back(new Job {function, _arena, "", false, cache});
+    _waiting.push_back(_pending.back());
+    _arena = nullptr;
+    _queued.notify_one();
+
+    write(lock, _workers.size() * JOBS_PER_WORKER);
+}
+
+
+/*
+ * Function:	Pipeline::discard
+ *
+ * Description:	Release the arena last returned without generating code
+ *		for its function.
+ */
+
+void Pipeline::discard()
+{
+    lock_guard<mutex> guard(_mutex);
+
+
+    _arena->release();
+    _free.push_back(_arena);
+    _arena = nullptr;
+}
+
+
+/*
+ * Function:	Pipeline::finish
+ *
+ * Description:	Wait for every function in the pipeline to complete and
+ *		write them all.
+ */
+
+void Pipeline::finish()
+{
+    unique_lock<mutex> lock(_mutex);
+
+    write(lock, 0);
+}
+
+
+/*
+ * Function:	Pipeline::hold
+ *
+ * Description:	Hold the code of every function from now on rather than
+ *		writing it.
+ */
+
+void Pipeline::hold()
+{
+    _holding = true;
+}
+
+
+/*
+ * Function:	Pipeline::release
+ *
+ * Description:	Write the code held for the functions that are live in
+ *		the given graph, in source order, and discard the rest.
+ *		Every function must already have been written.
+ */
+
+void Pipeline::release(const CallGraph &graph)
+{
+    Timer timer(EMIT);
+    Emitter &emitter = _context->emitter;
+
+
+    for (auto &held : _held)
+	if (graph.live(held.first)) {
+	    emitter << held.second;
+	    emitter.flush();
+	}
+
+    _held.clear();
+    _holding = false;
+}
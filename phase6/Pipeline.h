@@ -0,0 +1,88 @@
+/*
+ * File:	Pipeline.h
+ *
+ * Description:	This file contains the class definition for the code
+ *		generation pipeline of a translation unit.  The parser
+ *		hands each function to the pipeline as soon as it has been
+ *		checked, along with the arena holding its body, and goes on
+ *		to parse the next function.
+ *
+ *		Without any workers, code is generated for the function
+ *		immediately and written to the emitter, just as if there
+ *		were no pipeline at all.  Otherwise, the functions are
+ *		queued for a pool of worker threads, each of which
+ *		generates code for one function at a time into a private
+ *		buffer.  The buffers are written to the emitter in source
+ *		order as the functions at the head of the queue complete.
+ *		A function only depends upon its own tree and upon the
+ *		symbols and types of the translation unit, which are never
+ *		changed once checked.
+ *
+ *		A function may be handed over with its entry in the cache,
+ *		in which case its code is taken from the cache if there,
+ *		and is otherwise added to the cache once generated.
+ *
+ *		The number of functions in the pipeline is bounded, so the
+ *		memory used by their arenas is bounded too.  Arenas are
+ *		reused once their functions have been written.
+ *
+ *		The code of each function may instead be held until the
+ *		whole unit has been parsed, and then only the code of the
+ *		functions found to be live is written.
+ */
+
+# ifndef PIPELINE_H
+# define PIPELINE_H
+# include <deque>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <utility>
+# include <vector>
+# include <condition_variable>
+# include "Arena.h"
+
+class Cache;
+class CallGraph;
+class CompilerContext;
+
+class Pipeline {
+    struct Job {
+	class Function *function;
+	Arena *arena;
+	std::string output;
+	bool done;
+	Cache *cache;
+    };
+
+    CompilerContext *_context;
+    std::vector<std::thread> _workers;
+    std::deque<Arena> _arenas;
+    std::vector<Arena *> _free;
+    Arena *_arena;
+
+    std::mutex _mutex;
+    std::condition_variable _queued, _completed;
+    std::deque<Job *> _pending, _waiting;
+    bool _closing, _holding;
+    std::vector<std::pair<const class Symbol *, std::string>> _held;
+
+    void work();
+    void emit(const class Function *function, std::string &output);
+    void write(std::unique_lock<std::mutex> &lock, size_t limit);
+    void reuse(class Function *function, Cache *cache, std::string &output,
+	bool inlinable);
+
+public:
+    Pipeline(CompilerContext *context, unsigned workers);
+    ~Pipeline();
+
+    Arena *arena();
+    void generate(class Function *function, Cache *cache = nullptr);
+    void discard();
+    void finish();
+    void hold();
+    void release(const CallGraph &graph);
+};
+
+# endif /* PIPELINE_H */
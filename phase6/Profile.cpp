@@ -0,0 +1,233 @@
+/*
+ * File:	Profile.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		profiling the generated code.
+ *
+ *		A profile is a text file with a line for each function,
+ *		giving its name and then the count of each of its blocks.
+ *		The counters are appended to the profile each time the
+ *		program exits, so the counts of several runs are simply
+ *		added together when the profile is read.
+ *
+ *		The counters are written by a function generated along with
+ *		the globals of the unit, which a constructor of the unit
+ *		registers with __cxa_atexit(), since atexit() itself is not
+ *		part of the shared C library and so cannot be found when the
+ *		program is run in memory.  Every unit of a program thus
+ *		writes its own counters, whichever unit defines main.  The
+ *		name of each function and then each of its counters are
+ *		written with fprintf().
+ */
+
+# include <fstream>
+# include <sstream>
+# include "Profile.h"
+# include "machine.h"
+# include "string.h"
+# include "Symbol.h"
+# include "tokens.h"
+
+using namespace std;
+
+# define HOT_RATIO 100
+
+
+/*
+ * Function:	Counters::counters
+ *
+ * Description:	Return the symbol for the given number of counters of the
+ *		given function, creating it if necessary.
+ */
+
+const Symbol *Counters::counters(const Symbol *function, unsigned count)
+{
+    lock_guard<mutex> guard(_mutex);
+    auto &entry = _functions[function->name()];
+
+
+    if (entry.first == nullptr) {
+	Arena *previous = Arena::use(&_arena);
+	Name name = intern(function->name() + ".counts");
+
+	entry.first = new Symbol(name, Type(LONG, 0, count));
+	entry.second = count;
+	Arena::use(previous);
+    }
+
+    return entry.first;
+}
+
+
+/*
+ * Function:	Counters::write
+ *
+ * Description:	Write the counters to the given stream, along with the
+ *		function appending them to the profile, which is called
+ *		with the stack aligned and so need only keep it aligned,
+ *		and the constructor registering it to be called at exit.
+ */
+
+void Counters::write(ostream &ostr) const
+{
+    unsigned i = 0;
+
+
+    for (auto &function : _functions) {
+	ostr << "\t.comm\t" << global_prefix << function.second.first->name();
+	ostr << ", " << function.second.second * SIZEOF_LONG << '\n';
+    }
+
+    ostr << "\t.text" << '\n';
+    ostr << "profile.dump:" << '\n';
+    ostr << "\tpushq\t%rbp" << '\n';
+    ostr << "\tpushq\t%rbx" << '\n';
+    ostr << "\tpushq\t%r12" << '\n';
+    ostr << "\tleaq\tprofile.path, %rdi" << '\n';
+    ostr << "\tleaq\tprofile.mode, %rsi" << '\n';
+    ostr << "\tcall\tfopen" << '\n';
+    ostr << "\ttestq\t%rax, %rax" << '\n';
+    ostr << "\tje\tprofile.done" << '\n';
+    ostr << "\tmovq\t%rax, %rbx" << '\n';
+
+    for (auto &function : _functions) {
+	ostr << "\tmovq\t%rbx, %rdi" << '\n';
+	ostr << "\tleaq\tprofile.name" << i << ", %rsi" << '\n';
+	ostr << "\tmovl\t$0, %eax" << '\n';
+	ostr << "\tcall\tfprintf" << '\n';
+	ostr << "\tmovq\t$0, %r12" << '\n';
+	ostr << "profile.loop" << i << ":" << '\n';
+	ostr << "\tmovq\t%rbx, %rdi" << '\n';
+	ostr << "\tleaq\tprofile.count, %rsi" << '\n';
+	ostr << "\tmovq\t" << global_prefix << function.second.first->name();
+	ostr << "(,%r12,8), %rdx" << '\n';
+	ostr << "\tmovl\t$0, %eax" << '\n';
+	ostr << "\tcall\tfprintf" << '\n';
+	ostr << "\tincq\t%r12" << '\n';
+	ostr << "\tcmpq\t$" << function.second.second << ", %r12" << '\n';
+	ostr << "\tjl\tprofile.loop" << i << '\n';
+	ostr << "\tmovl\t$10, %edi" << '\n';
+	ostr << "\tmovq\t%rbx, %rsi" << '\n';
+	ostr << "\tcall\tfputc" << '\n';
+	i ++;
+    }
+
+    ostr << "\tmovq\t%rbx, %rdi" << '\n';
+    ostr << "\tcall\tfclose" << '\n';
+    ostr << "profile.done:" << '\n';
+    ostr << "\tpopq\t%r12" << '\n';
+    ostr << "\tpopq\t%rbx" << '\n';
+    ostr << "\tpopq\t%rbp" << '\n';
+    ostr << "\tret" << '\n' << '\n';
+
+    ostr << "profile.init:" << '\n';
+    ostr << "\tpushq\t%rbp" << '\n';
+    ostr << "\tleaq\tprofile.dump, %rdi" << '\n';
+    ostr << "\tmovq\t$0, %rsi" << '\n';
+    ostr << "\tmovq\t$0, %rdx" << '\n';
+    ostr << "\tcall\t__cxa_atexit" << '\n';
+    ostr << "\tpopq\t%rbp" << '\n';
+    ostr << "\tret" << '\n' << '\n';
+
+    ostr << "\t.section\t.init_array,\"aw\"" << '\n';
+    ostr << "\t.p2align\t3" << '\n';
+    ostr << "\t.quad\tprofile.init" << '\n';
+
+    ostr << "\t.section\t.rodata" << '\n';
+    ostr << "profile.path:\t.asciz\t\"" << PROFILE_OUTPUT << "\"" << '\n';
+    ostr << "profile.mode:\t.asciz\t\"a\"" << '\n';
+    ostr << "profile.count:\t.asciz\t\" %lu\"" << '\n';
+    i = 0;
+
+    for (auto &function : _functions) {
+	ostr << "profile.name" << i ++ << ":\t.asciz\t\"";
+	ostr << escapeString(function.first) << "\"" << '\n';
+    }
+}
+
+
+/*
+ * Function:	Profile::Profile (constructor)
+ *
+ * Description:	Initialize an empty profile.
+ */
+
+Profile::Profile()
+    : _hottest(0)
+{
+}
+
+
+/*
+ * Function:	Profile::read
+ *
+ * Description:	Read the profile in the given file, adding together the
+ *		counts of each function written more than once, and return
+ *		whether the profile could be read.  The counts of a
+ *		function written with a different number of blocks, as by
+ *		an older version of its source, replace the earlier ones.
+ */
+
+bool Profile::read(const string &path)
+{
+    ifstream in(path);
+    string buf, name;
+    vector<unsigned long> counts;
+    unsigned long count;
+
+
+    if (!in)
+	return false;
+
+    while (getline(in, buf)) {
+	istringstream line(buf);
+
+	if (!(line >> name))
+	    continue;
+
+	counts.clear();
+
+	while (line >> count)
+	    counts.push_back(count);
+
+	vector<unsigned long> &total = _counts[name];
+
+	if (total.size() != counts.size())
+	    total.assign(counts.size(), 0);
+
+	for (unsigned i = 0; i < counts.size(); i ++) {
+	    total[i] += counts[i];
+	    _hottest = max(_hottest, total[i]);
+	}
+    }
+
+    return !in.bad();
+}
+
+
+/*
+ * Function:	Profile::find
+ *
+ * Description:	Return the counts of the blocks of the given function, or
+ *		null if the function is not in the profile.
+ */
+
+const vector<unsigned long> *Profile::find(const string &function) const
+{
+    auto it = _counts.find(function);
+
+    return it != _counts.end() ? &it->second : nullptr;
+}
+
+
+/*
+ * Function:	Profile::hot
+ *
+ * Description:	Return whether the given count is hot, which is to say
+ *		within a small factor of the hottest count in the profile.
+ */
+
+bool Profile::hot(unsigned long count) const
+{
+    return count > 0 && count * HOT_RATIO >= _hottest;
+}
@@ -0,0 +1,67 @@
+/*
+ * File:	Profile.h
+ *
+ * Description:	This file contains the class definitions for profiling
+ *		the generated code.  When instrumenting, each function
+ *		counts how often each of its basic blocks is executed, as
+ *		lowered and before any optimization, in an array of
+ *		counters named after the function.  The entry of a
+ *		function, both arms of each branch, and each call all
+ *		begin or lie within such a block.  The counters of each
+ *		translation unit are written when the program exits, by a
+ *		function that a constructor of the unit registers.
+ *
+ *		A profile is then read back when compiling the same
+ *		source again, which lowers each function into the same
+ *		blocks, so the count of each block can simply be given to
+ *		it.  A profile not matching a function is ignored for that
+ *		function.
+ *
+ *		The functions of a unit may be lowered by several threads
+ *		at once, so the counters are created under a lock.  A
+ *		profile is never changed once read, so any number of units
+ *		may use it at once.
+ */
+
+# ifndef PROFILE_H
+# define PROFILE_H
+# include <map>
+# include <mutex>
+# include <string>
+# include <vector>
+# include <ostream>
+# include <unordered_map>
+# include "Arena.h"
+
+class Symbol;
+
+class Counters {
+    typedef std::string string;
+
+    std::mutex _mutex;
+    Arena _arena;
+    std::map<string, std::pair<const Symbol *, unsigned>> _functions;
+
+public:
+    const Symbol *counters(const Symbol *function, unsigned count);
+
+    void write(std::ostream &ostr) const;
+};
+
+class Profile {
+    typedef std::string string;
+
+    std::unordered_map<string, std::vector<unsigned long>> _counts;
+    unsigned long _hottest;
+
+public:
+    Profile();
+
+    bool read(const string &path);
+    const std::vector<unsigned long> *find(const string &function) const;
+    bool hot(unsigned long count) const;
+};
+
+# define PROFILE_OUTPUT "scc.profile"
+
+# endif /* PROFILE_H */
@@ -5,7 +5,6 @@
  *		registers on the Intel 64-bit processor.
  */
 
-# include "Tree.h"
 # include "Register.h"
 
 using namespace std;
@@ -18,7 +17,7 @@ using namespace std;
  */
 
 Register::Register(const string &qword, const string &lword, const string &byte)
-    : _qword(qword), _lword(lword), _byte(byte), node(nullptr)
+    : _qword(qword), _lword(lword), _byte(byte)
 {
 }
 
@@ -51,15 +50,10 @@ const string &Register::byte() const
 /*
  * Function:	operator <<
  *
- * Description:	Write a register to a stream.  The operand name is
- *		determined by the type of the associated expression if
- *		present.  Otherwise, the default name will be used.
+ * Description:	Write a register to a stream using its default name.
  */
 
 ostream &operator <<(ostream &ostr, const Register *reg)
 {
-    if (reg->node != nullptr)
-	return ostr << reg->name(reg->node->type().size());
-
     return ostr << reg->name();
 }
@@ -22,8 +22,6 @@ class Register {
     string _byte;
 
 public:
-    class Expression *node;
-
     Register(const string &qword, const string &lword, const string &byte);
     const string &name(unsigned size = 0) const;
     const string &byte() const;
@@ -11,11 +11,32 @@
  *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- hashing the symbols of large scopes
  */
 
 # include <cassert>
+# include <cstdint>
+# include "Declarations.h"
 # include "Scope.h"
 
+# define MIN_INDEXED 8
+
+
+/*
+ * Function:	slot (private)
+ *
+ * Description:	Return the initial slot for the given name in a table with
+ *		the given capacity, which is a power of two.  Names are
+ *		heap-allocated, so the low-order bits of their addresses are
+ *		always zero and we use Fibonacci hashing to mix the rest.
+ */
+
+static unsigned slot(Name name, unsigned capacity)
+{
+    uint64_t h = (uintptr_t) name * 11400714819323198485UL;
+    return (h >> 32) & (capacity - 1);
+}
+
 
 /*
  * Function:	Scope::Scope (constructor)
@@ -24,43 +45,145 @@
  */
 
 Scope::Scope(Scope *enclosing)
-    : _enclosing(enclosing)
+    : _enclosing(enclosing), _index(nullptr), _capacity(0),
+      _imported(nullptr), _arena(nullptr)
 {
 }
 
 
+/*
+ * Function:	Scope::rehash (private)
+ *
+ * Description:	Allocate a new hash table with the given capacity and put
+ *		all of our symbols into it.  The old table, if any, is left
+ *		in the arena.
+ */
+
+void Scope::rehash(unsigned capacity)
+{
+    unsigned i;
+
+
+    _index = (Symbol **) Arena::current()->allocate(capacity * sizeof(Symbol *));
+    _capacity = capacity;
+
+    for (i = 0; i < capacity; i ++)
+	_index[i] = nullptr;
+
+    for (auto symbol : _symbols) {
+	for (i = slot(&symbol->name(), capacity); _index[i]; i = (i + 1) & (capacity - 1))
+	    continue;
+
+	_index[i] = symbol;
+    }
+}
+
+
 /*
  * Function:	Scope::insert
  *
  * Description:	Insert the given symbol into this scope.  It had better not
- *		already be inserted, or we fail big time.
+ *		already be inserted, or we fail big time.  The hash table is
+ *		kept at most half full.
  */
 
 
 void Scope::insert(Symbol *symbol)
 {
-    assert(find(symbol->name()) == nullptr);
+    unsigned i;
+
+
+    assert(search(&symbol->name()) == nullptr);
     _symbols.push_back(symbol);
+
+    if (_symbols.size() * 2 > _capacity) {
+	if (_symbols.size() >= MIN_INDEXED)
+	    rehash(_capacity > 0 ? _capacity * 2 : MIN_INDEXED * 4);
+
+    } else {
+	i = slot(&symbol->name(), _capacity);
+
+	while (_index[i] != nullptr)
+	    i = (i + 1) & (_capacity - 1);
+
+	_index[i] = symbol;
+    }
 }
 
 
 /*
- * Function:	Scope::find
+ * Function:	Scope::search (private)
  *
  * Description:	Find and return the symbol with the given name in this
  *		scope.  If no such symbol is found, return a null pointer.
+ *		Since names are interned, we need only compare addresses.
  */
 
-Symbol *Scope::find(const string &name) const
+Symbol *Scope::search(Name name) const
 {
-    for (auto symbol : _symbols)
-	if (name == symbol->name())
-	    return symbol;
+    unsigned i;
+
+
+    if (_index == nullptr) {
+	for (auto symbol : _symbols)
+	    if (name == &symbol->name())
+		return symbol;
+
+	return nullptr;
+    }
+
+    for (i = slot(name, _capacity); _index[i]; i = (i + 1) & (_capacity - 1))
+	if (name == &_index[i]->name())
+	    return _index[i];
 
     return nullptr;
 }
 
 
+/*
+ * Function:	Scope::find
+ *
+ * Description:	Find and return the symbol with the given name in this
+ *		scope, adding it from the imported declarations if it is
+ *		declared there.  If no such symbol is found, return a null
+ *		pointer.  The symbol is added in the arena of the scope
+ *		when the declarations were imported, whatever the current
+ *		arena may be.
+ */
+
+Symbol *Scope::find(Name name)
+{
+    Symbol *symbol;
+    Arena *previous;
+
+
+    if ((symbol = search(name)) != nullptr || _imported == nullptr)
+	return symbol;
+
+    previous = Arena::use(_arena);
+
+    if ((symbol = _imported->find(name)) != nullptr)
+	insert(symbol);
+
+    Arena::use(previous);
+    return symbol;
+}
+
+
+/*
+ * Function:	Scope::import
+ *
+ * Description:	Import the given declarations into this scope, which are
+ *		added to it in the current arena.
+ */
+
+void Scope::import(const Declarations *declarations)
+{
+    _imported = declarations;
+    _arena = Arena::current();
+}
+
+
 /*
  * Function:	Scope::lookup
  *
@@ -70,7 +193,7 @@ Symbol *Scope::find(const string &name) const
  *		null pointer.
  */
 
-Symbol *Scope::lookup(const string &name) const
+Symbol *Scope::lookup(Name name)
 {
     Symbol *symbol;
 
@@ -3,35 +3,52 @@
  *
  * Description:	This file contains the class definition for scopes in
  *		Simple C.  A scope consists simply of a list of symbols.
- *		We use a vector rather than a map because we want to keep
- *		the symbols in insertion order, and we expect the number of
- *		symbols inserted to be small.
+ *		We use a vector because we want to keep the symbols in
+ *		insertion order.  Most scopes are small and are searched
+ *		linearly, but once a scope grows large enough, we also
+ *		maintain an open addressing hash table of its symbols,
+ *		indexed by the address of their interned names.
  *
  *		Each scope has a link to its enclosing scope.  By
  *		convention, a null scope is used if there is no enclosing
  *		scope.  The find function searches only the given scope,
  *		whereas the lookup function searches the given scope and
  *		all enclosing scopes.
+ *
+ *		The global scope may also import precompiled declarations,
+ *		which are added to it as they are first found.
+ *
+ *		Scopes and their vectors of symbols are allocated from the
+ *		current arena.
  */
 
 # ifndef SCOPE_H
 # define SCOPE_H
 # include "Symbol.h"
+# include "Arena.h"
 # include <vector>
 
-typedef std::vector<Symbol *> Symbols;
+typedef std::vector<Symbol *, ArenaAllocator<Symbol *>> Symbols;
 
-class Scope {
+class Scope : public Allocated {
     typedef std::string string;
     Scope *_enclosing;
     Symbols _symbols;
+    Symbol **_index;
+    unsigned _capacity;
+    const class Declarations *_imported;
+    Arena *_arena;
+
+    void rehash(unsigned capacity);
+    Symbol *search(Name name) const;
 
 public:
     Scope(Scope *enclosing = nullptr);
 
     void insert(Symbol *symbol);
-    Symbol *find(const string &name) const;
-    Symbol *lookup(const string &name) const;
+    Symbol *find(Name name);
+    Symbol *lookup(Name name);
+    void import(const class Declarations *declarations);
 
     Scope *enclosing() const;
     const Symbols &symbols() const;
@@ -0,0 +1,140 @@
+/*
+ * File:	Source.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the source text of a translation unit.  To map a file with
+ *		the null characters after it, we first map enough anonymous
+ *		memory for both, and then map the file over its beginning.  The rest of the last page of the file and any
+ *		pages after it are then zero.
+ */
+
+# include <cerrno>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "Source.h"
+
+using namespace std;
+
+# define READ_SIZE 65536
+
+
+/*
+ * Function:	Source::Source (constructor)
+ *
+ * Description:	Initialize this source to be empty.
+ */
+
+Source::Source()
+    : _text(nullptr), _size(0), _mapped(0)
+{
+}
+
+
+/*
+ * Function:	Source::~Source (destructor)
+ *
+ * Description:	Unmap the source text if it was mapped.
+ */
+
+Source::~Source()
+{
+    if (_mapped != 0)
+	munmap(_text, _mapped);
+}
+
+
+/*
+ * Function:	Source::open
+ *
+ * Description:	Map or read the file with the given path, or the standard
+ *		input if the path is empty.  Return false on failure, in
+ *		which case errno indicates the reason.
+ */
+
+bool Source::open(const string &path)
+{
+    int fd, error = 0;
+    struct stat st;
+    size_t page;
+    void *base;
+    ssize_t n;
+
+
+    if (path.empty())
+	fd = STDIN_FILENO;
+    else if ((fd = ::open(path.c_str(), O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+	_size = st.st_size;
+	page = sysconf(_SC_PAGESIZE);
+	_mapped = (_size + SOURCE_PADDING + page - 1) / page * page;
+
+	base = mmap(nullptr, _mapped, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (base == MAP_FAILED) {
+	    error = errno;
+	    _mapped = 0;
+
+	} else if (_size > 0 && mmap(base, _size, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+	    error = errno;
+	    munmap(base, _mapped);
+	    _mapped = 0;
+
+	} else
+	    _text = (char *) base;
+
+    } else {
+	while (true) {
+	    _buffer.resize(_size + READ_SIZE);
+
+	    if ((n = read(fd, _buffer.data() + _size, READ_SIZE)) > 0)
+		_size += n;
+	    else if (n == 0 || errno != EINTR)
+		break;
+	}
+
+	if (n < 0)
+	    error = errno;
+
+	_buffer.resize(_size);
+	_buffer.resize(_size + SOURCE_PADDING, '\0');
+	_text = _buffer.data();
+    }
+
+    if (fd != STDIN_FILENO)
+	close(fd);
+
+    errno = error;
+    return error == 0;
+}
+
+
+/*
+ * Function:	Source::text (accessor)
+ *
+ * Description:	Return the source text, which is followed by at least
+ *		SOURCE_PADDING null characters.
+ */
+
+char *Source::text() const
+{
+    return _text;
+}
+
+
+/*
+ * Function:	Source::size (accessor)
+ *
+ * Description:	Return the size of the source text, not including the
+ *		null characters after it.
+ */
+
+size_t Source::size() const
+{
+    return _size;
+}
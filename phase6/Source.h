@@ -0,0 +1,44 @@
+/*
+ * File:	Source.h
+ *
+ * Description:	This file contains the class definition for the source
+ *		text of a translation unit.  A regular file is mapped into
+ *		memory rather than read, and anything else, such as a pipe,
+ *		is read into a buffer.  Either way, the text is followed by
+ *		enough null characters, at least two, so that the lexer can
+ *		scan it in place without copying it into buffers of its own,
+ *		and can always read a vector's worth beyond any position.
+ *
+ *		The text is writable, since the flex scanner temporarily
+ *		writes a null character after each token as it scans, and
+ *		overwrites the comments it skips.  The mapping
+ *		is private, so the file itself is never changed.  The text
+ *		of every token is a span of the source, which therefore
+ *		lives as long as the context of the translation unit.
+ */
+
+# ifndef SOURCE_H
+# define SOURCE_H
+# include <string>
+# include <vector>
+
+# define SOURCE_PADDING 32
+
+class Source {
+    char *_text;
+    size_t _size, _mapped;
+    std::vector<char> _buffer;
+
+    Source(const Source &) = delete;
+    Source &operator =(const Source &) = delete;
+
+public:
+    Source();
+    ~Source();
+
+    bool open(const std::string &path);
+    char *text() const;
+    size_t size() const;
+};
+
+# endif /* SOURCE_H */
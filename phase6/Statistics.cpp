@@ -0,0 +1,187 @@
+/*
+ * File:	Statistics.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the statistics of compiling a translation unit.
+ */
+
+# include <algorithm>
+# include <iomanip>
+# include <sstream>
+# include <sys/resource.h>
+# include "Statistics.h"
+
+using namespace std;
+
+
+/*
+ * Function:	peak (private)
+ *
+ * Description:	Return the peak memory used by the compiler so far in
+ *		kilobytes.
+ */
+
+static long peak()
+{
+    struct rusage usage;
+
+
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+/*
+ * Function:	quote (private)
+ *
+ * Description:	Return the given string as a JSON string.
+ */
+
+static string quote(const string &s)
+{
+    ostringstream ostr;
+
+
+    ostr << '"';
+
+    for (unsigned char c : s)
+	if (c == '"' || c == '\\')
+	    ostr << '\\' << c;
+	else if (c < 0x20)
+	    ostr << "\\u" << hex << setw(4) << setfill('0') << (int) c << dec;
+	else
+	    ostr << c;
+
+    ostr << '"';
+    return ostr.str();
+}
+
+
+/*
+ * Function:	Statistics::Statistics (constructor)
+ *
+ * Description:	Initialize the statistics with nothing counted.
+ */
+
+Statistics::Statistics()
+{
+    for (unsigned i = 0; i < NUM_PHASES; i ++)
+	elapsed[i] = allocations[i] = bytes[i] = heap[i] = heapBytes[i] = 0;
+}
+
+
+/*
+ * Function:	Statistics::add
+ *
+ * Description:	Add the counters of a generated function.
+ */
+
+void Statistics::add(const FunctionStatistics &function)
+{
+    lock_guard<mutex> guard(_mutex);
+
+    _functions.push_back(function);
+}
+
+
+/*
+ * Function:	Statistics::report
+ *
+ * Description:	Return a report of the time spent in each phase of
+ *		compiling the given unit, along with the number of source
+ *		lines per second for each phase and the peak memory used
+ *		so far.  Each line is a name, a value, and a unit, so that
+ *		scripts can easily read the times too.
+ */
+
+string Statistics::report(const string &unit, unsigned lines) const
+{
+    ostringstream ostr;
+    double seconds;
+
+
+    ostr << "unit " << unit << '\n';
+    ostr << fixed << setprecision(6);
+
+    for (unsigned i = 0; i < NUM_PHASES; i ++) {
+	seconds = elapsed[i] / 1e9;
+	ostr << phases[i] << " " << seconds << " s ";
+	ostr << (unsigned long) (seconds > 0 ? lines / seconds : 0) << " lines/s\n";
+    }
+
+    ostr << "lines " << lines << '\n';
+    ostr << "peak " << peak() << " KB\n";
+    return ostr.str();
+}
+
+
+/*
+ * Function:	Statistics::json
+ *
+ * Description:	Return the statistics of compiling the given unit as a
+ *		single line of JSON, given the number of lines, and the
+ *		number of distinct string literals and of literals found
+ *		already in the pool.  The functions are sorted by name, so
+ *		that the output does not depend upon which threads
+ *		generated them.
+ */
+
+string Statistics::json(const string &unit, unsigned lines, unsigned strings,
+	unsigned hits) const
+{
+    vector<FunctionStatistics> functions;
+    unsigned long instructions = 0, spilled = 0, loads = 0, stores = 0;
+    ostringstream ostr;
+    double seconds;
+
+
+    {
+	lock_guard<mutex> guard(_mutex);
+	functions = _functions;
+    }
+
+    sort(functions.begin(), functions.end(),
+	[](const FunctionStatistics &a, const FunctionStatistics &b) {
+	    return a.name < b.name;
+	});
+
+    ostr << "{\"unit\": " << quote(unit) << ", \"lines\": " << lines;
+    ostr << ", \"peak_kb\": " << peak() << ", \"phases\": {";
+
+    for (unsigned i = 0; i < NUM_PHASES; i ++) {
+	seconds = elapsed[i] / 1e9;
+	ostr << (i > 0 ? ", " : "") << quote(phases[i]) << ": {";
+	ostr << "\"seconds\": " << fixed << setprecision(6) << seconds;
+	ostr << ", \"lines_per_second\": ";
+	ostr << (unsigned long) (seconds > 0 ? lines / seconds : 0);
+	ostr << ", \"allocations\": " << allocations[i];
+	ostr << ", \"bytes\": " << bytes[i];
+	ostr << ", \"heap_allocations\": " << heap[i];
+	ostr << ", \"heap_bytes\": " << heapBytes[i] << "}";
+    }
+
+    ostr << "}, \"strings\": {\"literals\": " << strings;
+    ostr << ", \"hits\": " << hits << "}, \"functions\": [";
+
+    for (unsigned i = 0; i < functions.size(); i ++) {
+	const FunctionStatistics &function = functions[i];
+
+	ostr << (i > 0 ? ", " : "") << "{\"name\": " << quote(function.name);
+	ostr << ", \"instructions\": " << function.instructions;
+	ostr << ", \"spilled\": " << function.spilled;
+	ostr << ", \"spill_loads\": " << function.loads;
+	ostr << ", \"spill_stores\": " << function.stores << "}";
+
+	instructions += function.instructions;
+	spilled += function.spilled;
+	loads += function.loads;
+	stores += function.stores;
+    }
+
+    ostr << "], \"totals\": {\"functions\": " << functions.size();
+    ostr << ", \"instructions\": " << instructions;
+    ostr << ", \"spilled\": " << spilled;
+    ostr << ", \"spill_loads\": " << loads;
+    ostr << ", \"spill_stores\": " << stores << "}}\n";
+    return ostr.str();
+}
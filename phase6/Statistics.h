@@ -0,0 +1,46 @@
+/*
+ * File:	Statistics.h
+ *
+ * Description:	This file contains the class definition for the
+ *		statistics of compiling a translation unit: the time and
+ *		allocations of each phase, which are gathered by the
+ *		timers, and the counters of each function generated, which
+ *		are added by whichever thread generated it.  The statistics
+ *		are written either as a short report for people or as a
+ *		single line of JSON for scripts.
+ */
+
+# ifndef STATISTICS_H
+# define STATISTICS_H
+# include <atomic>
+# include <mutex>
+# include <string>
+# include <vector>
+# include "Timer.h"
+
+struct FunctionStatistics {
+    std::string name;
+    unsigned instructions;
+    unsigned spilled, loads, stores;
+};
+
+class Statistics {
+    typedef std::string string;
+
+    mutable std::mutex _mutex;
+    std::vector<FunctionStatistics> _functions;
+
+public:
+    std::atomic<unsigned long> elapsed[NUM_PHASES];
+    std::atomic<unsigned long> allocations[NUM_PHASES], bytes[NUM_PHASES];
+    std::atomic<unsigned long> heap[NUM_PHASES], heapBytes[NUM_PHASES];
+
+    Statistics();
+
+    void add(const FunctionStatistics &function);
+    string report(const string &unit, unsigned lines) const;
+    string json(const string &unit, unsigned lines, unsigned strings,
+	unsigned hits) const;
+};
+
+# endif /* STATISTICS_H */
@@ -0,0 +1,110 @@
+/*
+ * File:	StringPool.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the pool of string literals.  The characters of each literal
+ *		are kept by the pool, since the literals in the body of a
+ *		function are released along with its arena.
+ */
+
+# include "StringPool.h"
+
+using namespace std;
+
+
+/*
+ * Function:	StringPool::StringPool (constructor)
+ *
+ * Description:	Initialize this pool to be empty.
+ */
+
+StringPool::StringPool()
+    : _hits(0)
+{
+}
+
+
+/*
+ * Function:	StringPool::insert
+ *
+ * Description:	Return the number of the given literal, adding it to the
+ *		pool if it has not been seen before.
+ */
+
+unsigned StringPool::insert(string_view value)
+{
+    lock_guard<mutex> guard(_mutex);
+    auto it = _numbers.find(value);
+
+
+    if (it != _numbers.end()) {
+	_hits ++;
+	return it->second;
+    }
+
+    _strings.emplace_back(value);
+    _numbers.emplace(_strings.back(), _strings.size() - 1);
+    return _strings.size() - 1;
+}
+
+
+/*
+ * Function:	StringPool::find
+ *
+ * Description:	Find the number of the given literal without adding it,
+ *		and return whether it is in the pool.
+ */
+
+bool StringPool::find(string_view value, unsigned &number)
+{
+    lock_guard<mutex> guard(_mutex);
+    auto it = _numbers.find(value);
+
+
+    if (it == _numbers.end())
+	return false;
+
+    number = it->second;
+    return true;
+}
+
+
+/*
+ * Function:	StringPool::value
+ *
+ * Description:	Return the literal with the given number, which may be
+ *		asked for while other literals are being added.
+ */
+
+string StringPool::value(unsigned number)
+{
+    lock_guard<mutex> guard(_mutex);
+
+    return _strings.at(number);
+}
+
+
+/*
+ * Function:	StringPool::strings (accessor)
+ *
+ * Description:	Return the literals in the pool in the order of their
+ *		numbers.  No literal may be added while they are used.
+ */
+
+const deque<string> &StringPool::strings() const
+{
+    return _strings;
+}
+
+
+/*
+ * Function:	StringPool::hits (accessor)
+ *
+ * Description:	Return the number of literals added that were already in
+ *		the pool.
+ */
+
+unsigned StringPool::hits() const
+{
+    return _hits;
+}
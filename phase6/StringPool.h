@@ -0,0 +1,40 @@
+/*
+ * File:	StringPool.h
+ *
+ * Description:	This file contains the class definition for the pool of
+ *		string literals of a translation unit.  Each distinct
+ *		literal is numbered in the order it is first added, and is
+ *		written with the globals under a label made from its number.
+ *		Since the parser adds the literals as it reads them, the
+ *		numbers depend only upon the source, no matter which
+ *		threads later generate code using them.
+ *
+ *		The literals are found by hashing, and the pool is locked
+ *		while adding a literal, so any thread may add to it.
+ */
+
+# ifndef STRINGPOOL_H
+# define STRINGPOOL_H
+# include <deque>
+# include <mutex>
+# include <string>
+# include <string_view>
+# include <unordered_map>
+
+class StringPool {
+    std::mutex _mutex;
+    std::deque<std::string> _strings;
+    std::unordered_map<std::string_view, unsigned> _numbers;
+    unsigned _hits;
+
+public:
+    StringPool();
+
+    unsigned insert(std::string_view value);
+    bool find(std::string_view value, unsigned &number);
+    std::string value(unsigned number);
+    const std::deque<std::string> &strings() const;
+    unsigned hits() const;
+};
+
+# endif /* STRINGPOOL_H */
@@ -17,8 +17,8 @@ using std::string;
  * Description:	Initialize a symbol object.
  */
 
-Symbol::Symbol(const string &name, const Type &type)
-    : _name(name), _type(type), offset(0)
+Symbol::Symbol(Name name, const Type &type)
+    : _name(name), _type(type)
 {
 }
 
@@ -31,7 +31,7 @@ Symbol::Symbol(const string &name, const Type &type)
 
 const string &Symbol::name() const
 {
-    return _name;
+    return *_name;
 }
 
 
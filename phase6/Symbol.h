@@ -3,23 +3,27 @@
  *
  * Description:	This file contains the class definition for symbols in
  *		Simple C.  At this point, a symbol merely consists of a
- *		name and a type, neither of which you can change.
+ *		name and a type, neither of which you can change.  The
+ *		storage of a local variable is given when its function is
+ *		lowered, and a global is simply its name.  The name is
+ *		interned, so the address of the name of a symbol can be
+ *		compared directly against an interned name.
  */
 
 # ifndef SYMBOL_H
 # define SYMBOL_H
 # include <string>
+# include "Arena.h"
 # include "Type.h"
+# include "intern.h"
 
-class Symbol {
+class Symbol : public Allocated {
     typedef std::string string;
-    string _name;
+    Name _name;
     Type _type;
 
 public:
-    int offset;
-
-    Symbol(const string &name, const Type &type);
+    Symbol(Name name, const Type &type);
     const string &name() const;
     const Type &type() const;
 };
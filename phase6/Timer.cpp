@@ -0,0 +1,153 @@
+/*
+ * File:	Timer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		timing the phases of the compiler.
+ */
+
+# include <cstdlib>
+# include <new>
+# include "Timer.h"
+# include "context.h"
+
+using namespace std;
+
+const char *phases[NUM_PHASES] = {
+    "lex", "parse", "check", "allocate", "generate", "emit",
+};
+
+bool Timer::enabled = false;
+thread_local Timer *Timer::_current = nullptr;
+
+
+/*
+ * Function:	Timer::start (private)
+ *
+ * Description:	Start timing the phase of this timer, stopping the timer
+ *		of the enclosing phase, if any.
+ */
+
+void Timer::start()
+{
+    _outer = _current;
+    _allocations = _bytes = _heap = _heapBytes = 0;
+    _start = clock::now();
+
+    if (_outer != nullptr)
+	_outer->stop(_start);
+
+    _current = this;
+}
+
+
+/*
+ * Function:	Timer::finish (private)
+ *
+ * Description:	Stop timing this phase and restart the timer of the
+ *		enclosing phase, if any.
+ */
+
+void Timer::finish()
+{
+    clock::time_point now = clock::now();
+
+
+    stop(now);
+    _current = _outer;
+
+    if (_outer != nullptr)
+	_outer->_start = now;
+}
+
+
+/*
+ * Function:	Timer::stop (private)
+ *
+ * Description:	Add the time since this timer was last started, and the
+ *		allocations made since then, to its phase.
+ */
+
+void Timer::stop(clock::time_point now)
+{
+    Statistics &stats = CompilerContext::current()->stats;
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(now - _start);
+
+
+    stats.elapsed[_phase] += elapsed.count();
+    stats.allocations[_phase] += _allocations;
+    stats.bytes[_phase] += _bytes;
+    stats.heap[_phase] += _heap;
+    stats.heapBytes[_phase] += _heapBytes;
+    _allocations = _bytes = _heap = _heapBytes = 0;
+}
+
+
+/*
+ * Function:	Timer::allocated
+ *
+ * Description:	Count an allocation of the given size, either from an
+ *		arena or from the heap, against the phase of the innermost
+ *		timer of this thread, if any.
+ */
+
+void Timer::allocated(size_t size, bool heap)
+{
+    if (_current == nullptr)
+	return;
+
+    if (heap) {
+	_current->_heap ++;
+	_current->_heapBytes += size;
+    } else {
+	_current->_allocations ++;
+	_current->_bytes += size;
+    }
+}
+
+
+/*
+ * Function:	operator new
+ *
+ * Description:	Allocate memory from the heap, counting the allocation if
+ *		timing is enabled.  The standard containers and the chunks
+ *		of the arenas are all allocated this way.  The memory is
+ *		allocated with malloc, so the default operator delete still
+ *		works.
+ */
+
+void *operator new(size_t size)
+{
+    void *ptr;
+
+
+    if (Timer::enabled)
+	Timer::allocated(size, true);
+
+    while ((ptr = malloc(size ? size : 1)) == nullptr) {
+	new_handler handler = get_new_handler();
+
+	if (handler == nullptr)
+	    throw bad_alloc();
+
+	handler();
+    }
+
+    return ptr;
+}
+
+
+/*
+ * Function:	operator delete
+ *
+ * Description:	Free memory allocated from the heap.
+ */
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
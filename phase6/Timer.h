@@ -0,0 +1,63 @@
+/*
+ * File:	Timer.h
+ *
+ * Description:	This file contains the class definition for timing the
+ *		phases of the compiler.  A timer adds the time from its
+ *		creation until its destruction to the given phase of the
+ *		current translation unit, along with the number and size
+ *		of the allocations made meanwhile, both from arenas and
+ *		from the heap.  Timers nest:
+ *		while an inner timer is running, the outer one is stopped,
+ *		so code generated synchronously during parsing is not
+ *		charged to parsing.
+ *
+ *		Each thread has its own innermost timer, so the times of a
+ *		phase done by several threads at once are summed, and may
+ *		add up to more than the elapsed time.
+ *
+ *		Timing is enabled only when statistics are requested, and
+ *		must not be enabled or disabled while compiling.  A disabled
+ *		timer costs only a test, so timers may be used freely.
+ */
+
+# ifndef TIMER_H
+# define TIMER_H
+# include <chrono>
+# include <cstddef>
+
+enum Phase {
+    LEX, PARSE, CHECK, ALLOCATE, GENERATE, EMIT, NUM_PHASES,
+};
+
+class Timer {
+    typedef std::chrono::steady_clock clock;
+    static thread_local Timer *_current;
+
+    Timer *_outer;
+    Phase _phase;
+    clock::time_point _start;
+    unsigned long _allocations, _bytes, _heap, _heapBytes;
+
+    void start();
+    void stop(clock::time_point now);
+    void finish();
+
+public:
+    static bool enabled;
+
+    Timer(Phase phase) : _phase(phase) {
+	if (enabled)
+	    start();
+    }
+
+    ~Timer() {
+	if (enabled)
+	    finish();
+    }
+
+    static void allocated(size_t size, bool heap = false);
+};
+
+extern const char *phases[NUM_PHASES];
+
+# endif /* TIMER_H */
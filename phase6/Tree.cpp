@@ -19,10 +19,12 @@
  *		- everything (it is optional to construct an AST)
  */
 
+# include <cerrno>
 # include <cstdlib>
-# include <sstream>
+# include <cstring>
 # include "tokens.h"
 # include "Tree.h"
+# include "context.h"
 
 using namespace std;
 
@@ -35,7 +37,7 @@ using namespace std;
  */
 
 Expression::Expression(const Type &type)
-    : _type(type), _lvalue(false), offset(0), reg(nullptr)
+    : _type(type), _lvalue(false)
 {
 }
 
@@ -93,12 +95,20 @@ Unary::Unary(Expression *expr, const Type &type)
 /*
  * Function:	String::String (constructor)
  *
- * Description:	Initialize this string literal.
+ * Description:	Initialize this string literal.  The characters are copied
+ *		into the current arena along with the node itself, and the
+ *		literal is added to the string pool of the translation
+ *		unit.
  */
 
 String::String(const string &value)
-    : Expression(Type(CHAR, 0, value.size() + 1)), _value(value)
+    : Expression(Type(CHAR, 0, value.size() + 1))
 {
+    char *chars = (char *) Arena::current()->allocate(value.size(), 1);
+
+    memcpy(chars, value.data(), value.size());
+    _value = std::string_view(chars, value.size());
+    _number = CompilerContext::current()->strings.insert(_value);
 }
 
 
@@ -108,12 +118,24 @@ String::String(const string &value)
  * Description:	Return the value of this string.
  */
 
-const string &String::value() const
+std::string_view String::value() const
 {
     return _value;
 }
 
 
+/*
+ * Function:	String::number (accessor)
+ *
+ * Description:	Return the number of this string in the string pool.
+ */
+
+unsigned String::number() const
+{
+    return _number;
+}
+
+
 /*
  * Function:	Identifier::Identifier (constructor)
  *
@@ -147,12 +169,22 @@ const Symbol *Identifier::symbol() const
  */
 
 Number::Number(unsigned long value)
-    : Expression(Type(LONG))
+    : Expression(Type(LONG)), _value(value)
 {
-    stringstream ss;
+}
+
+
+/*
+ * Function:	Number::Number (constructor)
+ *
+ * Description:	Initialize a number with the given value and type, which is
+ *		the result of folding a constant expression.  A negative
+ *		value is stored sign-extended.
+ */
 
-    ss << value;
-    _value = ss.str();
+Number::Number(unsigned long value, const Type &type)
+    : Expression(type), _value(value)
+{
 }
 
 
@@ -163,22 +195,18 @@ Number::Number(unsigned long value)
  */
 
 Number::Number(const string &value)
-    : Expression(Type(INT)), _value(value)
+    : Expression(Type(INT))
 {
-    unsigned long val;
     char *ptr;
 
 
     errno = 0;
-    val = strtoul(value.c_str(), &ptr, 0);
+    _value = strtoul(value.c_str(), &ptr, 0);
 
     if (errno != 0)
 	_type = Type();
-    else if (*ptr == 'l' || *ptr == 'L' || val != (unsigned) val)
+    else if (*ptr == 'l' || *ptr == 'L' || _value != (unsigned) _value)
 	_type = Type(LONG);
-
-    if (*ptr == 'l' || *ptr == 'L')
-	_value.erase(_value.size() - 1);
 }
 
 
@@ -188,7 +216,7 @@ Number::Number(const string &value)
  * Description:	Return the value of this integer.
  */
 
-const string &Number::value() const
+unsigned long Number::value() const
 {
     return _value;
 }
@@ -542,6 +570,18 @@ Function::Function(const Symbol *id, Block *body)
 }
 
 
+/*
+ * Function:	Function::symbol (accessor)
+ *
+ * Description:	Return the symbol of this function.
+ */
+
+const Symbol *Function::symbol() const
+{
+    return _id;
+}
+
+
 /*
  * Function:	Expression:isNumber (accessor)
  *
@@ -574,7 +614,7 @@ bool Expression::isDereference(Expression *&pointer) const
 
 bool Number::isNumber(unsigned long &value) const
 {
-    value = strtoul(_value.c_str(), NULL, 0);
+    value = _value;
     return true;
 }
 
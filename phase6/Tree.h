@@ -5,8 +5,9 @@
  *		syntax trees in Simple C.
  *
  *		The base class Node cannot not be instantiated (the
- *		constructor is protected).  It provides empty functions for
- *		storage allocation and code generation.
+ *		constructor is protected).  Statements and expressions are
+ *		lowered into the intermediate representation, from which
+ *		code is then generated.
  *
  *		A Node is either a Function, representing a function
  *		definition, a Statement, or an Expression, which also
@@ -20,9 +21,12 @@
  *
  *		Tree.h - class definitions
  *		Tree.cpp - constructors and accessors
- *		allocator.cpp - member functions to do storage allocation
+ *		lower.cpp - member functions to lower the tree into the IR
  *		generator.cpp - member functions to do code generation
  *		writer.cpp - member functions to write the tree to a stream
+ *
+ *		All nodes are allocated from the current arena, and so
+ *		are the vectors of statements and expressions.
  */
 
 # ifndef TREE_H
@@ -30,17 +34,23 @@
 # include <string>
 # include <vector>
 # include <ostream>
+# include <string_view>
+# include "Arena.h"
 # include "Scope.h"
-# include "Register.h"
-# include "Label.h"
 
-typedef std::vector<class Statement *> Statements;
-typedef std::vector<class Expression *> Expressions;
+typedef std::vector<class Statement *, ArenaAllocator<class Statement *>>
+    Statements;
+typedef std::vector<class Expression *, ArenaAllocator<class Expression *>>
+    Expressions;
+
+class Operand;
+class Procedure;
+class BasicBlock;
 
 
 /* The base class */
 
-class Node {
+class Node : public Allocated {
 protected:
     typedef std::string string;
     typedef std::ostream ostream;
@@ -49,8 +59,6 @@ protected:
 public:
     virtual ~Node() {}
     virtual void write(ostream &ostr) const = 0;
-    virtual void allocate(int &offset) const {}
-    virtual void generate() {}
 };
 
 
@@ -59,6 +67,9 @@ public:
 class Statement : public Node {
 protected:
     Statement() {}
+
+public:
+    virtual void lower(Procedure &proc) const = 0;
 };
 
 
@@ -71,16 +82,17 @@ protected:
     Expression(const Type &type);
 
 public:
-    int offset;
-    Register *reg;
-
     const Type &type() const;
     bool lvalue() const;
 
-    virtual void operand(ostream &ostr) const;
     virtual bool isNumber(unsigned long &value) const;
     virtual bool isDereference(Expression *&pointer) const;
-    void test(const Label &label, bool ifTrue);
+
+    virtual Operand lower(Procedure &proc) const;
+    virtual Operand address(Procedure &proc) const;
+    virtual void store(Procedure &proc, const Operand &value) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -105,13 +117,15 @@ protected:
 /* A string literal */
 
 class String : public Expression {
-    string _value;
+    std::string_view _value;
+    unsigned _number;
 
 public:
     String(const string &value);
-    const string &value() const;
+    std::string_view value() const;
+    unsigned number() const;
     virtual void write(ostream &ostr) const;
-    void operand(ostream &ostr) const;
+    virtual Operand address(Procedure &proc) const;
 };
 
 
@@ -124,22 +138,25 @@ public:
     Identifier(const Symbol *symbol);
     const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
-    virtual void operand(ostream &ostr) const;
+    virtual Operand lower(Procedure &proc) const;
+    virtual Operand address(Procedure &proc) const;
+    virtual void store(Procedure &proc, const Operand &value) const;
 };
 
 
 /* A number (i.e., integer literal) */
 
 class Number : public Expression {
-    string _value;
+    unsigned long _value;
 
 public:
     Number(unsigned long value);
+    Number(unsigned long value, const Type &type);
     Number(const string &value);
-    const string &value() const;
+    unsigned long value() const;
     virtual void write(ostream &ostr) const;
     virtual bool isNumber(unsigned long &value) const;
-    virtual void operand(ostream &ostr) const;
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -152,7 +169,7 @@ class Call : public Expression {
 public:
     Call(const Symbol *id, const Expressions &args, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -162,7 +179,9 @@ class Not : public Unary {
 public:
     Not(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -172,7 +191,7 @@ class Negate : public Unary {
 public:
     Negate(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -183,7 +202,8 @@ public:
     Dereference(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
     virtual bool isDereference(Expression *&pointer) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual Operand address(Procedure &proc) const;
 };
 
 
@@ -193,7 +213,7 @@ class Address : public Unary {
 public:
     Address(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -203,7 +223,7 @@ class Cast : public Unary {
 public:
     Cast(Expression *expr, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -213,7 +233,7 @@ class Multiply : public Binary {
 public:
     Multiply(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -223,7 +243,7 @@ class Divide : public Binary {
 public:
     Divide(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -233,7 +253,7 @@ class Remainder : public Binary {
 public:
     Remainder(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -243,7 +263,7 @@ class Add : public Binary {
 public:
     Add(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -253,7 +273,7 @@ class Subtract : public Binary {
 public:
     Subtract(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
 };
 
 
@@ -263,7 +283,9 @@ class LessThan : public Binary {
 public:
     LessThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -273,7 +295,9 @@ class GreaterThan : public Binary {
 public:
     GreaterThan(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -283,7 +307,9 @@ class LessOrEqual : public Binary {
 public:
     LessOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -293,7 +319,9 @@ class GreaterOrEqual : public Binary {
 public:
     GreaterOrEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -303,7 +331,9 @@ class Equal : public Binary {
 public:
     Equal(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -313,7 +343,9 @@ class NotEqual : public Binary {
 public:
     NotEqual(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -323,7 +355,9 @@ class LogicalAnd: public Binary {
 public:
     LogicalAnd(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -333,7 +367,9 @@ class LogicalOr : public Binary {
 public:
     LogicalOr(Expression *left, Expression *right, const Type &type);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual Operand lower(Procedure &proc) const;
+    virtual void test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const;
 };
 
 
@@ -345,7 +381,7 @@ class Assignment : public Statement {
 public:
     Assignment(Expression *left, Expression *right);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -355,7 +391,7 @@ class Break : public Statement {
 public:
     Break();
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -367,7 +403,7 @@ class Return : public Statement {
 public:
     Return(Expression *expr);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -381,8 +417,7 @@ public:
     Block(Scope *decls, const Statements &stmts);
     Scope *declarations() const;
     virtual void write(ostream &ostr) const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -395,8 +430,7 @@ class While : public Statement {
 public:
     While(Expression *expr, Statement *stmt);
     virtual void write(ostream &ostr) const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -411,8 +445,7 @@ class For : public Statement {
 public:
     For(Statement *init, Expression *expr, Statement *incr, Statement *stmt);
     virtual void write(ostream &ostr) const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -425,8 +458,7 @@ class If : public Statement {
 public:
     If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
     virtual void write(ostream &ostr) const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -438,7 +470,7 @@ class Simple : public Statement {
 public:
     Simple(Expression *expr);
     virtual void write(ostream &ostr) const;
-    virtual void generate();
+    virtual void lower(Procedure &proc) const;
 };
 
 
@@ -450,9 +482,10 @@ class Function : public Node {
 
 public:
     Function(const Symbol *id, Block *body);
+    const Symbol *symbol() const;
     virtual void write(ostream &ostr) const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
+    Procedure *lower() const;
+    void generate(ostream &ostr);
 };
 
 # endif /* TREE_H */
@@ -14,14 +14,229 @@
  *		- predicate functions
  *		- stream operator
  *		- error type
+ *		- interning
+ *		- computing size and alignment
+ *
+ *		The entries of the table are kept in chunks that are never
+ *		moved, so they can be read without locking while another
+ *		thread is adding a type.  A thread only reads the entry of
+ *		a handle it was given after the entry was added.
  */
 
+# include <mutex>
+# include <cstddef>
+# include <string>
 # include <cassert>
+# include <unordered_map>
+# include "machine.h"
 # include "tokens.h"
 # include "Type.h"
 
 using namespace std;
 
+# define NUM_SCALARS 16
+# define CHUNK_BITS 12
+# define CHUNK_SIZE (1U << CHUNK_BITS)
+# define NUM_CHUNKS 4096
+
+struct TypeEntry {
+    short kind, specifier;
+    unsigned indirection;
+    unsigned long length;
+    const Parameters *parameters;
+    unsigned long size;
+    unsigned alignment;
+};
+
+class TypeTable {
+    typedef std::string string;
+    std::mutex _mutex;
+    TypeEntry *_chunks[NUM_CHUNKS];
+    unsigned _count;
+    std::unordered_map<string, unsigned> _handles;
+    Arena _arena;
+
+public:
+    TypeTable();
+    ~TypeTable();
+    unsigned insert(const TypeEntry &entry);
+
+    const TypeEntry &operator [](unsigned handle) const {
+	return _chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+    }
+};
+
+
+/*
+ * Function:	scalar (private)
+ *
+ * Description:	Return the handle of the scalar type with the given
+ *		specifier and indirection if it is in the table from the
+ *		start, and zero otherwise.
+ */
+
+static unsigned scalar(int specifier, unsigned indirection)
+{
+    unsigned index = specifier == CHAR ? 0 : (specifier == INT ? 1 : 2);
+
+
+    if (indirection >= NUM_SCALARS)
+	return 0;
+
+    return 1 + index * NUM_SCALARS + indirection;
+}
+
+
+/*
+ * Function:	measure (private)
+ *
+ * Description:	Compute the size and alignment of the type of the given
+ *		entry in bytes, which are zero for a function type or the
+ *		error type.
+ */
+
+static void measure(TypeEntry &entry)
+{
+    unsigned long count = entry.kind == ARRAY ? entry.length : 1;
+
+
+    entry.size = entry.alignment = 0;
+
+    if (entry.kind == FUNCTION || entry.kind == ERROR)
+	return;
+
+    if (entry.indirection > 0) {
+	entry.size = count * SIZEOF_PTR;
+	entry.alignment = ALIGNOF_PTR;
+
+    } else if (entry.specifier == CHAR) {
+	entry.size = count * SIZEOF_CHAR;
+	entry.alignment = ALIGNOF_CHAR;
+
+    } else if (entry.specifier == INT) {
+	entry.size = count * SIZEOF_INT;
+	entry.alignment = ALIGNOF_INT;
+
+    } else if (entry.specifier == LONG) {
+	entry.size = count * SIZEOF_LONG;
+	entry.alignment = ALIGNOF_LONG;
+    }
+}
+
+
+/*
+ * Function:	TypeTable::TypeTable (constructor)
+ *
+ * Description:	Initialize the table with the error type, followed by the
+ *		scalar types of each specifier in the order of their
+ *		handles.
+ */
+
+TypeTable::TypeTable()
+    : _chunks{}, _count(0)
+{
+    TypeEntry entry = {ERROR, 0, 0, 0, nullptr, 0, 0};
+    int specifiers[] = {CHAR, INT, LONG};
+
+
+    insert(entry);
+    entry.kind = SCALAR;
+
+    for (auto specifier : specifiers)
+	for (unsigned indirection = 0; indirection < NUM_SCALARS; indirection ++) {
+	    entry.specifier = specifier;
+	    entry.indirection = indirection;
+	    assert(insert(entry) == scalar(specifier, indirection));
+	}
+}
+
+
+/*
+ * Function:	TypeTable::~TypeTable (destructor)
+ *
+ * Description:	Deallocate the chunks of this table.  The parameter lists
+ *		are deallocated along with its arena.
+ */
+
+TypeTable::~TypeTable()
+{
+    for (auto chunk : _chunks)
+	delete[] chunk;
+}
+
+
+/*
+ * Function:	TypeTable::insert
+ *
+ * Description:	Return the handle of the type of the given entry, adding
+ *		the type to the table if it is not already there.  A
+ *		function type is identified by the handles of its
+ *		parameters, and its parameter list is copied into the arena
+ *		of the table when first added.
+ */
+
+unsigned TypeTable::insert(const TypeEntry &entry)
+{
+    lock_guard<mutex> guard(_mutex);
+    string key((const char *) &entry, offsetof(TypeEntry, length));
+    unsigned handle;
+
+
+    if (entry.kind == ARRAY)
+	key.append((const char *) &entry.length, sizeof(entry.length));
+
+    else if (entry.kind == FUNCTION) {
+	key += entry.parameters->variadic ? 'v' : 'f';
+
+	for (auto &type : entry.parameters->types)
+	    key.append((const char *) &type, sizeof(type));
+    }
+
+    auto it = _handles.find(key);
+
+    if (it != _handles.end())
+	return it->second;
+
+    handle = _count ++;
+    assert(handle < NUM_CHUNKS * CHUNK_SIZE);
+
+    if (_chunks[handle >> CHUNK_BITS] == nullptr)
+	_chunks[handle >> CHUNK_BITS] = new TypeEntry[CHUNK_SIZE];
+
+    TypeEntry &added = _chunks[handle >> CHUNK_BITS][handle & (CHUNK_SIZE - 1)];
+
+    added = entry;
+    measure(added);
+
+    if (entry.kind == FUNCTION) {
+	Arena *previous = Arena::use(&_arena);
+	Parameters *params = new Parameters();
+
+	params->variadic = entry.parameters->variadic;
+	params->types.assign(entry.parameters->types.begin(), entry.parameters->types.end());
+	added.parameters = params;
+	Arena::use(previous);
+    }
+
+    _handles.emplace(key, handle);
+    return handle;
+}
+
+
+/*
+ * Function:	table (private)
+ *
+ * Description:	Return the table of types, which is created when first
+ *		used, since types are made during static initialization.
+ */
+
+static TypeTable &table()
+{
+    static TypeTable table;
+
+    return table;
+}
+
 
 /*
  * Function:	Type::Type (constructor)
@@ -30,7 +245,7 @@ using namespace std;
  */
 
 Type::Type()
-    : _kind(ERROR)
+    : _handle(0)
 {
 }
 
@@ -42,9 +257,12 @@ Type::Type()
  */
 
 Type::Type(int specifier, unsigned indirection)
-    : _kind(SCALAR), _specifier(specifier), _indirection(indirection)
 {
     assert(specifier == CHAR || specifier == INT || specifier == LONG);
+    _handle = scalar(specifier, indirection);
+
+    if (_handle == 0)
+	_handle = table().insert({SCALAR, (short) specifier, indirection, 0, nullptr, 0, 0});
 }
 
 
@@ -55,24 +273,36 @@ Type::Type(int specifier, unsigned indirection)
  */
 
 Type::Type(int specifier, unsigned indirection, unsigned long length)
-    : _kind(ARRAY), _specifier(specifier), _indirection(indirection)
 {
     assert(specifier == CHAR || specifier == INT || specifier == LONG);
-    _length = length;
+    _handle = table().insert({ARRAY, (short) specifier, indirection, length, nullptr, 0, 0});
 }
 
 
 /*
  * Function:	Type::Type (constructor)
  *
- * Description:	Initialize this type object as a function type.
+ * Description:	Initialize this type object as a function type.  The
+ *		parameters are only copied, if the type is new, so the
+ *		caller still owns them.
  */
 
 Type::Type(int specifier, unsigned indirection, Parameters *parameters)
-    : _kind(FUNCTION), _specifier(specifier), _indirection(indirection)
 {
     assert(specifier == CHAR || specifier == INT || specifier == LONG);
-    _parameters = parameters;
+    _handle = table().insert({FUNCTION, (short) specifier, indirection, 0, parameters, 0, 0});
+}
+
+
+/*
+ * Function:	Type::entry (private)
+ *
+ * Description:	Return the entry of this type in the table.
+ */
+
+const TypeEntry &Type::entry() const
+{
+    return table()[_handle];
 }
 
 
@@ -84,7 +314,7 @@ Type::Type(int specifier, unsigned indirection, Parameters *parameters)
 
 int Type::kind() const
 {
-    return _kind;
+    return entry().kind;
 }
 
 
@@ -96,7 +326,7 @@ int Type::kind() const
 
 int Type::specifier() const
 {
-    return _specifier;
+    return entry().specifier;
 }
 
 
@@ -108,7 +338,7 @@ int Type::specifier() const
 
 unsigned Type::indirection() const
 {
-    return _indirection;
+    return entry().indirection;
 }
 
 
@@ -122,8 +352,8 @@ unsigned Type::indirection() const
 
 unsigned long Type::length() const
 {
-    assert(_kind == ARRAY);
-    return _length;
+    assert(entry().kind == ARRAY);
+    return entry().length;
 }
 
 
@@ -134,44 +364,24 @@ unsigned long Type::length() const
  *		function type.
  */
 
-Parameters *Type::parameters() const
+const Parameters *Type::parameters() const
 {
-    assert(_kind == FUNCTION);
-    return _parameters;
+    assert(entry().kind == FUNCTION);
+    return entry().parameters;
 }
 
 
 /*
  * Function:	Type::operator ==
  *
- * Description:	Return whether another type is equal to this type.  The
- *		parameter lists are checked for function types, which C++
- *		makes so easy.  (At least, it makes something easy!)
+ * Description:	Return whether another type is equal to this type.  Each
+ *		distinct type has a single handle, so the parameter lists of
+ *		function types were already compared when interning them.
  */
 
 bool Type::operator ==(const Type &that) const
 {
-    if (_kind != that._kind)
-	return false;
-
-    if (_kind == ERROR)
-	return true;
-
-    if (_specifier != that._specifier || _indirection != that._indirection)
-	return false;
-
-    if (_kind == SCALAR)
-	return true;
-
-    if (_kind == ARRAY)
-	return _length == that._length;
-
-    assert(_kind == FUNCTION && _parameters && that._parameters);
-
-    if (_parameters->variadic != that._parameters->variadic)
-	return false;
-
-    return _parameters->types == that._parameters->types;
+    return _handle == that._handle;
 }
 
 
@@ -197,7 +407,7 @@ bool Type::operator !=(const Type &that) const
 
 bool Type::isScalar() const
 {
-    return _kind == SCALAR;
+    return entry().kind == SCALAR;
 }
 
 
@@ -209,7 +419,7 @@ bool Type::isScalar() const
 
 bool Type::isArray() const
 {
-    return _kind == ARRAY;
+    return entry().kind == ARRAY;
 }
 
 
@@ -221,7 +431,7 @@ bool Type::isArray() const
 
 bool Type::isFunction() const
 {
-    return _kind == FUNCTION;
+    return entry().kind == FUNCTION;
 }
 
 
@@ -234,7 +444,9 @@ bool Type::isFunction() const
 
 bool Type::isNumeric() const
 {
-    return _kind == SCALAR && _indirection == 0;
+    const TypeEntry &type = entry();
+
+    return type.kind == SCALAR && type.indirection == 0;
 }
 
 
@@ -247,7 +459,9 @@ bool Type::isNumeric() const
 
 bool Type::isPointer() const
 {
-    return _kind == SCALAR && _indirection > 0;
+    const TypeEntry &type = entry();
+
+    return type.kind == SCALAR && type.indirection > 0;
 }
 
 
@@ -274,8 +488,10 @@ bool Type::isCompatibleWith(const Type &that) const
 
 Type Type::decay() const
 {
-    if (_kind == ARRAY)
-	return Type(_specifier, _indirection + 1);
+    const TypeEntry &type = entry();
+
+    if (type.kind == ARRAY)
+	return Type(type.specifier, type.indirection + 1);
 
     return *this;
 }
@@ -291,7 +507,9 @@ Type Type::decay() const
 
 Type Type::promote() const
 {
-    if (_kind == SCALAR && _indirection == 0 && _specifier == CHAR)
+    const TypeEntry &type = entry();
+
+    if (type.kind == SCALAR && type.indirection == 0 && type.specifier == CHAR)
 	return Type(INT);
 
     return *this;
@@ -307,8 +525,36 @@ Type Type::promote() const
 
 Type Type::dereference() const
 {
-    assert(_kind == SCALAR && _indirection > 0);
-    return Type(_specifier, _indirection - 1);
+    const TypeEntry &type = entry();
+
+    assert(type.kind == SCALAR && type.indirection > 0);
+    return Type(type.specifier, type.indirection - 1);
+}
+
+
+/*
+ * Function:	Type::size
+ *
+ * Description:	Return the size of a type in bytes.
+ */
+
+unsigned long Type::size() const
+{
+    assert(entry().kind != FUNCTION && entry().kind != ERROR);
+    return entry().size;
+}
+
+
+/*
+ * Function:	Type::alignment
+ *
+ * Description:	Return the alignment of a type in bytes.
+ */
+
+unsigned Type::alignment() const
+{
+    assert(entry().kind != FUNCTION && entry().kind != ERROR);
+    return entry().alignment;
 }
 
 
@@ -20,30 +20,36 @@
  *		As we've designed them, types are essentially immutable,
  *		since we haven't included any mutators.  In practice, we'll
  *		be creating new types rather than changing existing types.
+ *
+ *		Each distinct type is interned in a table shared by all
+ *		translation units, and a type is merely its 32-bit handle
+ *		into the table, so two types are equal exactly when their
+ *		handles are.  The table holds the size and alignment of
+ *		each type, and a single canonical copy of the parameter
+ *		list of each function type, which it owns.  The scalar
+ *		types likely to be used are in the table from the start,
+ *		so making one never needs the table to be searched.
  */
 
 # ifndef TYPE_H
 # define TYPE_H
 # include <vector>
 # include <ostream>
+# include "Arena.h"
 
 enum { ARRAY, FUNCTION, SCALAR };
 
-typedef std::vector<class Type> Types;
+typedef std::vector<class Type, ArenaAllocator<class Type>> Types;
 
-struct Parameters {
+struct Parameters : public Allocated {
     bool variadic;
     Types types;
 };
 
 class Type {
-    short _kind, _specifier;
-    unsigned _indirection;
+    unsigned _handle;
 
-    union {
-	unsigned long _length;
-	Parameters *_parameters;
-    };
+    const struct TypeEntry &entry() const;
 
 public:
     Type();
@@ -56,7 +62,7 @@ public:
     unsigned indirection() const;
 
     unsigned long length() const;
-    Parameters *parameters() const;
+    const Parameters *parameters() const;
 
     bool operator ==(const Type &that) const;
     bool operator !=(const Type &that) const;
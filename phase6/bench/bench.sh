@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# bench.sh - benchmark the speed of the compiler on generated programs
+#
+# Usage: bench.sh [corpus-program [compiler]]
+#
+# Each corpus is generated afresh, compiled with timing enabled, and the
+# time, throughput, and peak memory of each phase are reported.  The
+# generated code is checked by assembling it, so that a benchmark never
+# reports the speed of a compiler that silently makes garbage.
+
+CORPUS=${1:-bench/corpus}
+SCC=${2:-./scc}
+WORKDIR=${TMPDIR:-/tmp}/scc-bench.$$
+
+trap 'rm -rf $WORKDIR' 0 2
+
+mkdir -p $WORKDIR || exit 1
+
+run() {
+    name=$1
+    shift
+
+    $CORPUS "$@" > $WORKDIR/$name.c || exit 1
+    $SCC -T < $WORKDIR/$name.c > $WORKDIR/$name.s 2> $WORKDIR/$name.err ||
+	{ echo "$name: compilation failed" 1>&2; cat $WORKDIR/$name.err 1>&2; exit 1; }
+    gcc -c -o $WORKDIR/$name.o $WORKDIR/$name.s ||
+	{ echo "$name: assembly failed" 1>&2; exit 1; }
+
+    awk -v name=$name '
+	$1 == "lines" { lines = $2 }
+	$1 == "peak" { peak = $2 }
+	$3 == "s" { total += $2; phase[++n] = $1; secs[n] = $2; rate[n] = $4 }
+	END {
+	    printf "%s: %d lines, %.3f s, %d lines/s, %d KB peak\n",
+		name, lines, total, (total > 0 ? lines / total : 0), peak
+	    for (i = 1; i <= n; i ++)
+		printf "    %-10s %10.6f s %12d lines/s\n", phase[i], secs[i], rate[i]
+	}' $WORKDIR/$name.err
+}
+
+run functions -f 20000 -d 4 -g 4 -s 16
+run nesting -f 500 -d 18 -g 4 -s 16
+run tables -f 100 -d 4 -g 2000 -s 4096
+run mixed -f 5000 -d 12 -g 64 -s 4096
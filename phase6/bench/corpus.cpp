@@ -0,0 +1,205 @@
+/*
+ * File:	corpus.cpp
+ *
+ * Description:	This file contains a generator of large Simple C programs
+ *		for benchmarking the compiler.  A program is written to the
+ *		standard output in the style of the examples: thousands of
+ *		small functions calling one another, deeply nested
+ *		expressions, and huge global tables filled and summed by
+ *		loops.  The programs are also valid C, so they can be
+ *		checked against another compiler.
+ *
+ *		Usage:	corpus [-f functions] [-d depth] [-g globals]
+ *			[-s length] [-r seed]
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <string>
+# include <unistd.h>
+
+using namespace std;
+
+static unsigned functions = 5000, depth = 12, globals = 64, length = 4096;
+
+static const char *operators[] = {
+    "+", "-", "*", "&&", "||", "<", ">", "<=", ">=", "==", "!=",
+};
+
+# define NUM_OPERATORS (sizeof(operators) / sizeof(operators[0]))
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Return a random expression nested to the given depth
+ *		using the parameters a and b and the global tables.
+ */
+
+static string expression(unsigned depth)
+{
+    unsigned n = rand() % 8;
+
+
+    if (depth == 0) {
+	if (n < 3)
+	    return n == 2 ? "b" : "a";
+
+	if (n < 6)
+	    return to_string(rand() % 100);
+
+	return "t" + to_string(rand() % globals) + "[" +
+	    to_string(rand() % length) + "]";
+    }
+
+    if (n == 0)
+	return "-(" + expression(depth - 1) + ")";
+
+    if (n == 1)
+	return "!" + expression(depth - 1);
+
+    if (n == 2)
+	return "(" + expression(depth - 1) + ")";
+
+    return "(" + expression(depth - 1) + " " + operators[rand() % NUM_OPERATORS]
+	+ " " + expression(depth - 1 - rand() % depth) + ")";
+}
+
+
+/*
+ * Function:	writeGlobals
+ *
+ * Description:	Write the declarations of the library functions and of
+ *		the global tables.
+ */
+
+static void writeGlobals()
+{
+    printf("int printf(char *s, ...);\n");
+    printf("int *malloc(int size), *null;\n\n");
+
+    for (unsigned i = 0; i < globals; i ++)
+	printf("int t%u[%u];\n", i, length);
+
+    printf("\n");
+}
+
+
+/*
+ * Function:	writeTables
+ *
+ * Description:	Write the functions that fill and sum the global tables.
+ */
+
+static void writeTables()
+{
+    for (unsigned i = 0; i < globals; i ++) {
+	printf("int fill%u(int x)\n{\n    int i;\n\n\n", i);
+	printf("    i = 0;\n\n");
+	printf("    while (i < %u) {\n", length);
+	printf("\tt%u[i] = (i * x + %u) %% 101;\n", i, i);
+	printf("\ti = i + 1;\n    }\n\n");
+	printf("    return t%u[x %% %u];\n}\n\n", i, length);
+    }
+
+    printf("int sum(void)\n{\n    int i, s;\n\n\n    s = 0;\n\n");
+    printf("    for (i = 0; i < %u; i = i + 1)\n\ts = s", length);
+
+    for (unsigned i = 0; i < globals; i ++)
+	printf("%s+ t%u[i]", i % 8 == 7 ? "\n\t    " : " ", i);
+
+    printf(";\n\n    return s;\n}\n\n");
+}
+
+
+/*
+ * Function:	writeFunctions
+ *
+ * Description:	Write the functions that compute the nested expressions.
+ *		Each function calls its predecessor, so none of them is
+ *		dead.
+ */
+
+static void writeFunctions()
+{
+    for (unsigned i = 0; i < functions; i ++) {
+	printf("int f%u(int a, int b)\n{\n    int c;\n\n\n", i);
+	printf("    c = %s;\n\n", expression(depth).c_str());
+	printf("    if (c > %d)\n\tc = c - a;\n", rand() % 100);
+	printf("    else if (c < b)\n\tc = c + b;\n\n");
+
+	if (i > 0)
+	    printf("    return c + f%u(b, a %% 7) %% 13;\n}\n\n", i - 1);
+	else
+	    printf("    return c;\n}\n\n");
+    }
+}
+
+
+/*
+ * Function:	writeMain
+ *
+ * Description:	Write the main function, which fills the tables, calls
+ *		the last function several times, and prints the results.
+ */
+
+static void writeMain()
+{
+    printf("int main(void)\n{\n    int i, s;\n\n\n");
+
+    for (unsigned i = 0; i < globals; i ++)
+	printf("    fill%u(%u);\n", i, i + 1);
+
+    printf("\n    s = sum();\n");
+
+    if (functions > 0) {
+	printf("\n    for (i = 0; i < 10; i = i + 1)\n");
+	printf("\ts = s + f%u(i, s %% 10) %% 1000;\n", functions - 1);
+    }
+
+    printf("\n    printf(\"%%d\\n\", s);\n    return 0;\n}\n");
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Parse the command line and write the program.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned seed = 1;
+    int c;
+
+
+    while ((c = getopt(argc, argv, "d:f:g:r:s:")) != -1)
+	if (c == 'd')
+	    depth = atoi(optarg);
+	else if (c == 'f')
+	    functions = atoi(optarg);
+	else if (c == 'g')
+	    globals = atoi(optarg);
+	else if (c == 'r')
+	    seed = atoi(optarg);
+	else if (c == 's')
+	    length = atoi(optarg);
+	else {
+	    fprintf(stderr, "usage: %s [-f functions] [-d depth] [-g globals]"
+		    " [-s length] [-r seed]\n", argv[0]);
+	    exit(EXIT_FAILURE);
+	}
+
+    if (globals == 0)
+	globals = 1;
+
+    if (length == 0)
+	length = 1;
+
+    srand(seed);
+    writeGlobals();
+    writeTables();
+    writeFunctions();
+    writeMain();
+    exit(EXIT_SUCCESS);
+}
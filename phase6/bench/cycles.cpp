@@ -0,0 +1,160 @@
+/*
+ * File:	cycles.cpp
+ *
+ * Description:	This file contains a program that runs another program
+ *		and reports the cycles and instructions it takes.  The
+ *		hardware counters are read with perf_event_open, so the perf
+ *		tool itself need not be installed.  The counters are enabled
+ *		only once the child has executed the program, so the cost of
+ *		starting it is not counted.
+ *
+ *		Where the hardware counters are unavailable, as on many
+ *		virtual machines, the cycles are instead measured with the
+ *		time stamp counter around the whole run, and the number of
+ *		instructions is reported as n/a.
+ *
+ *		The results are written to the standard error as a single
+ *		line of names and values:
+ *
+ *		    cycles N instructions N|n/a seconds S counter perf|tsc
+ *
+ *		Usage:	cycles program [argument ...]
+ */
+
+# include <cerrno>
+# include <chrono>
+# include <cstdint>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <string>
+# include <unistd.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <sys/wait.h>
+# include <linux/perf_event.h>
+# include <x86intrin.h>
+
+using namespace std;
+
+
+/*
+ * Function:	counter
+ *
+ * Description:	Open a counter of the given hardware event for the given
+ *		process, which starts counting when the process executes a
+ *		new program.  Return the file descriptor of the counter, or
+ *		-1 if it could not be opened.
+ */
+
+static int counter(pid_t pid, unsigned long event)
+{
+    struct perf_event_attr attr;
+
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+
+/*
+ * Function:	value
+ *
+ * Description:	Return the value of the counter with the given file
+ *		descriptor as a string, or n/a if there is no such counter.
+ */
+
+static string value(int fd)
+{
+    uint64_t count;
+
+
+    if (fd == -1 || read(fd, &count, sizeof(count)) != sizeof(count))
+	return "n/a";
+
+    return to_string(count);
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Start the program in a child that waits for the counters
+ *		to be opened before executing it, then wait for the child
+ *		and report the counts.  The exit status is that of the
+ *		program.
+ */
+
+int main(int argc, char *argv[])
+{
+    int fds[2], cycles, instructions, status;
+    uint64_t start, ticks;
+    char c;
+    pid_t pid;
+
+
+    if (argc < 2) {
+	fprintf(stderr, "usage: %s program [argument ...]\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (pipe(fds) == -1 || (pid = fork()) == -1) {
+	perror(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+	close(fds[1]);
+
+	if (read(fds[0], &c, 1) != 1)
+	    _exit(EXIT_FAILURE);
+
+	close(fds[0]);
+	execvp(argv[1], argv + 1);
+	perror(argv[1]);
+	_exit(127);
+    }
+
+    close(fds[0]);
+    cycles = counter(pid, PERF_COUNT_HW_CPU_CYCLES);
+    instructions = counter(pid, PERF_COUNT_HW_INSTRUCTIONS);
+
+    auto begin = chrono::steady_clock::now();
+    start = __rdtsc();
+
+    if (write(fds[1], "", 1) != 1) {
+	perror(argv[0]);
+	exit(EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+
+    while (waitpid(pid, &status, 0) == -1)
+	if (errno != EINTR) {
+	    perror(argv[0]);
+	    exit(EXIT_FAILURE);
+	}
+
+    ticks = __rdtsc() - start;
+    auto end = chrono::steady_clock::now();
+
+    fprintf(stderr, "cycles %s instructions %s seconds %.6f counter %s\n",
+	    cycles != -1 ? value(cycles).c_str() : to_string(ticks).c_str(),
+	    value(instructions).c_str(),
+	    chrono::duration<double>(end - begin).count(),
+	    cycles != -1 ? "perf" : "tsc");
+
+    if (WIFSIGNALED(status))
+	exit(128 + WTERMSIG(status));
+
+    exit(WEXITSTATUS(status));
+}
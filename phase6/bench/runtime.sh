@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# runtime.sh - benchmark the speed of the code generated by the compiler
+#
+# Usage: runtime.sh [cycles-program [compiler]]
+#
+# Each program in bench/runtime is compiled with the compiler and with
+# gcc -O0 and -O1 as baselines, and run on its input the best of three
+# times.  The cycles and instructions of each run, and the number of
+# instructions in the assembly, are reported for each compiler.  The
+# output of each baseline is checked against that of the compiler.
+
+CYCLES=${1:-bench/cycles}
+SCC=${2:-./scc}
+RUNS=3
+WORKDIR=${TMPDIR:-/tmp}/scc-runtime.$$
+
+trap 'rm -rf $WORKDIR' 0 2
+
+mkdir -p $WORKDIR || exit 1
+
+# Count the instructions in an assembly file, ignoring labels and directives.
+
+count() {
+    awk '/^[ \t]+[a-z]/ { n ++ } END { print n + 0 }' $1
+}
+
+# Run a program several times and print its best cycles and instructions.
+
+measure() {
+    for run in `seq $RUNS`; do
+	$CYCLES $1 < $2 2>&1 > $1.out | tail -1 ||
+	    { echo "$1: failed" 1>&2; exit 1; }
+    done | sort -n -k 2 | head -1
+}
+
+echo "revision `git rev-parse --short HEAD 2>/dev/null || echo unknown`"
+printf "%-8s %-6s %14s %14s %10s %8s\n" \
+    program build cycles instructions seconds static
+
+for file in bench/runtime/*.c; do
+    name=`basename $file .c`
+    input=bench/runtime/$name.in
+
+    $SCC < $file > $WORKDIR/$name.scc.s &&
+	gcc -no-pie -o $WORKDIR/$name.scc $WORKDIR/$name.scc.s 2>/dev/null ||
+	{ echo "$name: compilation failed" 1>&2; exit 1; }
+
+    for level in O0 O1; do
+	gcc -w -$level -S -o $WORKDIR/$name.$level.s $file &&
+	    gcc -o $WORKDIR/$name.$level $WORKDIR/$name.$level.s ||
+	    { echo "$name: gcc -$level failed" 1>&2; exit 1; }
+    done
+
+    for build in scc O0 O1; do
+	set -- `measure $WORKDIR/$name.$build $input`
+	printf "%-8s %-6s %14s %14s %10s %8s\n" $name $build $2 $4 $6 \
+	    `count $WORKDIR/$name.$build.s`
+
+	if [ $build != scc ]; then
+	    cmp -s $WORKDIR/$name.scc.out $WORKDIR/$name.$build.out ||
+		echo "$name: output differs from gcc -$build" 1>&2
+	fi
+    done
+done
@@ -0,0 +1,107 @@
+/* matrix.c, scaled up to multiply two large matrices */
+
+int *malloc(int n), free(int *p);
+int printf(char *s, ...), scanf(char *s, ...);
+
+int **allocate(int n)
+{
+    int i;
+    int **a;
+
+    i = 0;
+    a = (int **) malloc(n * sizeof(int *));
+
+    while (i < n) {
+	a[i] = malloc(n * sizeof(int));
+	i = i + 1;
+    }
+
+    return a;
+}
+
+int initialize(int **a, int n, int k)
+{
+    int i, j;
+
+
+    i = 0;
+
+    while (i < n) {
+	j = 0;
+
+	while (j < n) {
+	    a[i][j] = (i * k + j) % 17 - 8;
+	    j = j + 1;
+	}
+
+	i = i + 1;
+    }
+
+    return 0;
+}
+
+int multiply(int **c, int **a, int **b, int n)
+{
+    int i, j, k, s;
+
+
+    for (i = 0; i < n; i = i + 1)
+	for (j = 0; j < n; j = j + 1) {
+	    s = 0;
+
+	    for (k = 0; k < n; k = k + 1)
+		s = s + a[i][k] * b[k][j];
+
+	    c[i][j] = s;
+	}
+
+    return 0;
+}
+
+int checksum(int **a, int n)
+{
+    int i, j, s;
+
+
+    s = 0;
+
+    for (i = 0; i < n; i = i + 1)
+	for (j = 0; j < n; j = j + 1)
+	    s = (s * 31 + a[i][j]) % 1000003;
+
+    return s;
+}
+
+int deallocate(int **a, int n)
+{
+    int i;
+
+    i = 0;
+
+    while (i < n) {
+	free(a[i]);
+	i = i + 1;
+    }
+
+    free((int *) a);
+    return 0;
+}
+
+int main(void)
+{
+    int **a, **b, **c;
+    int n;
+
+    scanf("%d", &n);
+    a = allocate(n);
+    b = allocate(n);
+    c = allocate(n);
+    initialize(a, n, 3);
+    initialize(b, n, 5);
+    multiply(c, a, b, n);
+    printf("%d\n", checksum(c, n));
+    deallocate(a, n);
+    deallocate(b, n);
+    deallocate(c, n);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/* qsort.c, scaled up to sort a large array read from the input size */
+
+int *malloc(int n), rand(void), printf(char *s, ...), scanf(char *s, ...);
+
+int exchange(int *a, int *b)
+{
+    int t;
+
+    t = *a;
+    *a = *b;
+    *b = t;
+
+    return 0;
+}
+
+
+int partition(int *a, int lo, int hi)
+{
+    int i, j, x, temp;
+
+
+    x = a[lo];
+    i = lo - 1;
+    j = hi + 1;
+
+    while (i < j) {
+	j = j - 1;
+
+	while (a[j] > x)
+	    j = j - 1;
+
+	i = i + 1;
+
+	while (a[i] < x)
+	    i = i + 1;
+
+	if (i < j)
+	    exchange(&a[i], &a[j]);
+    }
+
+    return j;
+}
+
+
+int quickSort(int *a, int lo, int hi)
+{
+    int i;
+
+
+    if (hi > lo) {
+	i = partition(a, lo, hi);
+	quickSort(a, lo, i);
+	quickSort(a, i + 1, hi);
+    }
+
+    return 0;
+}
+
+
+int main(void)
+{
+    int *a, i, n, s;
+
+
+    scanf("%d", &n);
+    a = malloc(n * sizeof(int));
+
+    for (i = 0; i < n; i = i + 1)
+	a[i] = rand() % 1000000;
+
+    quickSort(a, 0, n - 1);
+    s = 0;
+
+    for (i = 0; i < n; i = i + 1) {
+	if (i > 0 && a[i - 1] > a[i])
+	    printf("unsorted at %d\n", i);
+
+	s = (s * 31 + a[i]) % 1000003;
+    }
+
+    printf("%d\n", s);
+    return 0;
+}
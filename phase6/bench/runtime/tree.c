@@ -0,0 +1,72 @@
+/* tree.c, scaled up to insert and search many random elements */
+
+int *malloc(int size), *null;
+int rand(void), printf(char *s, ...), scanf(char *s, ...);
+
+int **insert(int **root, int *data)
+{
+    if (!root) {
+	root = (int **) malloc(sizeof(int *) * 3);
+	root[0] = data;
+	root[1] = null;
+	root[2] = null;
+    } else if (data < root[0])
+	root[1] = (int *) insert((int **) root[1], data);
+    else if (data > root[0])
+	root[2] = (int *) insert((int **) root[2], data);
+
+    return root;
+}
+
+int search(int **root, int *data)
+{
+    if (!root)
+	return 0;
+
+    if (data < root[0])
+	return search((int **) root[1], data);
+
+    if (data > root[0])
+	return search((int **) root[2], data);
+
+    return 1;
+}
+
+int inorder(int **root, int depth)
+{
+    int left, right;
+
+
+    if (!root)
+	return depth;
+
+    left = inorder((int **) root[1], depth + 1);
+    right = inorder((int **) root[2], depth + 1);
+
+    if (left > right)
+	return left;
+
+    return right;
+}
+
+int main(void)
+{
+    int **root;
+    int *a, i, n, found;
+
+
+    scanf("%d", &n);
+    a = malloc(n * sizeof(int));
+    root = (int **) null;
+
+    for (i = 0; i < n; i = i + 1)
+	root = insert(root, &a[rand() % n]);
+
+    found = 0;
+
+    for (i = 0; i < n; i = i + 1)
+	found = found + search(root, &a[i]);
+
+    printf("%d found, depth %d\n", found, inorder(root, 0));
+    return 0;
+}
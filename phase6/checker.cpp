@@ -12,6 +12,8 @@
  *		- optionally deleting the symbols when closing a scope
  *		- scaling the operands and results of pointer arithmetic
  *		- explicit type conversions
+ *		- folding constant expressions and simplifying identities
+ *		- eliminating statements with constant tests
  */
 
 # include <set>
@@ -19,13 +21,13 @@
 # include "lexer.h"
 # include "tokens.h"
 # include "checker.h"
+# include "context.h"
+# include "Timer.h"
 
 
 using std::set;
 using std::string;
 
-static set<string> defined;
-static Scope *current, *global;
 static const Type error, character(CHAR), integer(INT), longint(LONG);
 
 static string redefined = "redefinition of '%s'";
@@ -52,7 +54,8 @@ static string invalid_arguments = "invalid arguments to called function";
  *		inserting a cast expression if necessary.  No checking is
  *		done to determine the validity of the cast.  As an
  *		optimization, an integer literal can always be converted to
- *		a long integer literal without an explicit cast.
+ *		a long integer literal without an explicit cast, and vice
+ *		versa by truncating its value.
  */
 
 static Expression *&cast(Expression *&expr, const Type &type)
@@ -64,6 +67,9 @@ static Expression *&cast(Expression *&expr, const Type &type)
 	if (expr->type() == integer && type == longint) {
 	    delete expr;
 	    expr = new Number(value);
+	} else if (expr->type() == longint && type == integer) {
+	    delete expr;
+	    expr = new Number((int) value, integer);
 	}
     }
 
@@ -125,6 +131,72 @@ static Expression *&extend(Expression *&expr, const Type &type)
 }
 
 
+/*
+ * Function:	constant (private)
+ *
+ * Description:	Return whether the given expression is an integer literal
+ *		of type int or long, and if so, its value.  The value of an
+ *		int is interpreted using 32 bits, as in the generated code.
+ */
+
+static bool constant(Expression *expr, long &value)
+{
+    unsigned long n;
+
+
+    if (!expr->isNumber(n))
+	return false;
+
+    if (expr->type() == integer)
+	value = (int) n;
+    else if (expr->type() == longint)
+	value = n;
+    else
+	return false;
+
+    return true;
+}
+
+
+/*
+ * Function:	fold (private)
+ *
+ * Description:	Return an integer literal with the given value and type,
+ *		which is the result of folding a constant expression.  An
+ *		int wraps around as it would at run time.  A long is only
+ *		folded if it fits in 32 bits, since only such values can be
+ *		used as immediate operands, so we return null otherwise.
+ */
+
+static Expression *fold(long value, const Type &type)
+{
+    if (type == integer)
+	return new Number((int) value, integer);
+
+    if (type == longint && value == (int) value)
+	return new Number(value, longint);
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	identity (private)
+ *
+ * Description:	Return whether the given operand of a binary expression
+ *		can replace the expression, since the other operand is the
+ *		identity for the operator.  An lvalue cannot replace the
+ *		expression, as the expression itself is not an lvalue.
+ */
+
+static bool identity(Expression *operand, Expression *other, long value)
+{
+    long n;
+
+    return !operand->lvalue() && constant(other, n) && n == value;
+}
+
+
 /*
  * Function:	scale (private)
  *
@@ -157,12 +229,16 @@ static Expression *scale(Expression *expr, unsigned size)
 
 Scope *openScope()
 {
-    current = new Scope(current);
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
+
 
-    if (global == nullptr)
-	global = current;
+    context->scope = new Scope(context->scope);
 
-    return current;
+    if (context->global == nullptr)
+	context->global = context->scope;
+
+    return context->scope;
 }
 
 
@@ -175,18 +251,18 @@ Scope *openScope()
 
 Scope *closeScope(bool cleanup)
 {
-    Scope *old = current;
-    current = current->enclosing();
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
+    Scope *old = context->scope;
+
+
+    context->scope = context->scope->enclosing();
 
     if (!cleanup)
 	return old;
 
-    for (auto symbol : old->symbols()) {
-	if (symbol->type().isFunction())
-	    delete symbol->type().parameters();
-
+    for (auto symbol : old->symbols())
 	delete symbol;
-    }
 
     delete old;
     return nullptr;
@@ -202,12 +278,16 @@ Scope *closeScope(bool cleanup)
  *		work.
  */
 
-Symbol *defineFunction(const string &name, const Type &type)
+Symbol *defineFunction(Name name, const Type &type)
 {
-    if (defined.count(name) > 0)
-	report(redefined, name);
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
+
+
+    if (context->defined.count(name) > 0)
+	report(redefined, *name);
 
-    defined.insert(name);
+    context->defined.insert(name);
     return declareFunction(name, type);
 }
 
@@ -220,22 +300,22 @@ Symbol *defineFunction(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareFunction(const string &name, const Type &type)
+Symbol *declareFunction(Name name, const Type &type)
 {
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
     Symbol *symbol;
 
 
-    symbol = global->find(name);
+    symbol = context->global->find(name);
 
     if (symbol == nullptr) {
 	symbol = new Symbol(name, type);
-	global->insert(symbol);
+	context->global->insert(symbol);
 
     } else {
 	if (symbol->type() != type)
-	    report(conflicting, name);
-
-	delete type.parameters();
+	    report(conflicting, *name);
     }
 
     return symbol;
@@ -249,23 +329,25 @@ Symbol *declareFunction(const string &name, const Type &type)
  *		redeclaration is discarded.
  */
 
-Symbol *declareVariable(const string &name, const Type &type)
+Symbol *declareVariable(Name name, const Type &type)
 {
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
     Symbol *symbol;
 
 
-    symbol = current->find(name);
+    symbol = context->scope->find(name);
 
     if (symbol == nullptr) {
 	symbol = new Symbol(name, type);
-	current->insert(symbol);
+	context->scope->insert(symbol);
 
     } else {
-	if (current != global)
-	    report(redeclared, name);
+	if (context->scope != context->global)
+	    report(redeclared, *name);
 
 	else if (symbol->type() != type)
-	    report(conflicting, name);
+	    report(conflicting, *name);
     }
 
     return symbol;
@@ -280,17 +362,19 @@ Symbol *declareVariable(const string &name, const Type &type)
  *		future error messages.
  */
 
-Symbol *checkIdentifier(const string &name)
+Symbol *checkIdentifier(Name name)
 {
+    Timer timer(CHECK);
+    CompilerContext *context = CompilerContext::current();
     Symbol *symbol;
 
 
-    symbol = current->lookup(name);
+    symbol = context->scope->lookup(name);
 
     if (symbol == nullptr) {
-	report(undeclared, name);
+	report(undeclared, *name);
 	symbol = new Symbol(name, error);
-	current->insert(symbol);
+	context->scope->insert(symbol);
     }
 
     return symbol;
@@ -310,9 +394,10 @@ Symbol *checkIdentifier(const string &name)
 
 Expression *checkCall(Symbol *id, Expressions &args)
 {
+    Timer timer(CHECK);
     const Type &t = id->type();
     Type result = error;
-    Parameters *params;
+    const Parameters *params;
     unsigned i;
 
 
@@ -363,14 +448,17 @@ Expression *checkCall(Symbol *id, Expressions &args)
  * Description:	Check an array expression: LEFT [RIGHT].  Both operands
  *		undergo the usual conversions, and then the left operand
  *		must have type "pointer to T" and the right operand must
- *		have a numeric type, and the result has type T.
+ *		have a numeric type, and the result has type T.  Indexing
+ *		with zero is simply a dereference.
  */
 
 Expression *checkArray(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     const Type &t1 = decay(promote(left));
     const Type &t2 = decay(extend(right, longint));
     Type result = error;
+    long value;
 
 
     if (t1 != error && t2 != error) {
@@ -381,7 +469,10 @@ Expression *checkArray(Expression *left, Expression *right)
 	    report(invalid_operands, "[]");
     }
 
-    return new Dereference(new Add(left, right, t1), result);;
+    if (constant(right, value) && value == 0)
+	return new Dereference(left, result);
+
+    return new Dereference(new Add(left, right, t1), result);
 }
 
 
@@ -395,8 +486,10 @@ Expression *checkArray(Expression *left, Expression *right)
 
 Expression *checkNot(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = decay(promote(expr));
     Type result = error;
+    long value;
 
 
     if (t != error) {
@@ -406,6 +499,9 @@ Expression *checkNot(Expression *expr)
 	    report(invalid_operand, "!");
     }
 
+    if (result != error && constant(expr, value))
+	return fold(!value, result);
+
     return new Not(expr, result);
 }
 
@@ -420,8 +516,11 @@ Expression *checkNot(Expression *expr)
 
 Expression *checkNegate(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = decay(promote(expr));
     Type result = error;
+    Expression *folded;
+    long value;
 
 
     if (t != error) {
@@ -431,6 +530,11 @@ Expression *checkNegate(Expression *expr)
 	    report(invalid_operand, "-");
 
     }
+
+    if (constant(expr, value))
+	if ((folded = fold(-(unsigned long) value, result)) != nullptr)
+	    return folded;
+
     return new Negate(expr, result);
 }
 
@@ -445,6 +549,7 @@ Expression *checkNegate(Expression *expr)
 
 Expression *checkDereference(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = decay(expr);
     Type result = error;
 
@@ -470,6 +575,7 @@ Expression *checkDereference(Expression *expr)
 
 Expression *checkAddress(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = expr->type();
     Type result = error;
 
@@ -494,6 +600,7 @@ Expression *checkAddress(Expression *expr)
 
 Expression *checkSizeof(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = expr->type();
     unsigned size = 0;
 
@@ -519,6 +626,7 @@ Expression *checkSizeof(Expression *expr)
 
 Expression *checkCast(const Type &type, Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = decay(expr);
     Type result = error;
 
@@ -571,12 +679,30 @@ checkMultiplicative(Expression *&left, Expression *&right, const string &op)
 /*
  * Function:	checkMultiply
  *
- * Description:	Check a multiplication expression: LEFT * RIGHT.
+ * Description:	Check a multiplication expression: LEFT * RIGHT.  Any
+ *		constant operand is placed on the right, which is where the
+ *		code generator looks for powers of two.
  */
 
 Expression *checkMultiply(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkMultiplicative(left, right, "*");
+    Expression *folded;
+    long a, b;
+
+
+    if (constant(left, a)) {
+	if (constant(right, b))
+	    if ((folded = fold((unsigned long) a * b, t)) != nullptr)
+		return folded;
+
+	std::swap(left, right);
+    }
+
+    if (identity(left, right, 1))
+	return left;
+
     return new Multiply(left, right, t);
 }
 
@@ -584,12 +710,26 @@ Expression *checkMultiply(Expression *left, Expression *right)
 /*
  * Function:	checkDivide
  *
- * Description:	Check a division expression: LEFT / RIGHT.
+ * Description:	Check a division expression: LEFT / RIGHT.  Division by
+ *		zero or by minus one is left until run time, since it may
+ *		trap.
  */
 
 Expression *checkDivide(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkMultiplicative(left, right, "/");
+    Expression *folded;
+    long a, b;
+
+
+    if (constant(left, a) && constant(right, b) && b != 0 && b != -1)
+	if ((folded = fold(a / b, t)) != nullptr)
+	    return folded;
+
+    if (identity(left, right, 1))
+	return left;
+
     return new Divide(left, right, t);
 }
 
@@ -602,7 +742,16 @@ Expression *checkDivide(Expression *left, Expression *right)
 
 Expression *checkRemainder(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkMultiplicative(left, right, "%");
+    Expression *folded;
+    long a, b;
+
+
+    if (constant(left, a) && constant(right, b) && b != 0 && b != -1)
+	if ((folded = fold(a % b, t)) != nullptr)
+	    return folded;
+
     return new Remainder(left, right, t);
 }
 
@@ -615,21 +764,33 @@ Expression *checkRemainder(Expression *left, Expression *right)
  *		numeric types, then the result has type long if either
  *		operand has type long and has type int otherwise.  If one
  *		operand has a pointer type and the other has a numeric
- *		type, then the result has that pointer type.
+ *		type, then the result has that pointer type.  A constant
+ *		numeric operand is placed on the right.
  */
 
 Expression *checkAdd(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     const Type &t1 = decay(extend(left, right->type()));
     const Type &t2 = decay(extend(right, left->type()));
     Type result = error;
+    Expression *folded;
+    long a, b;
 
 
     if (t1 != error && t2 != error) {
-	if (t1.isNumeric() && t2.isNumeric())
+	if (t1.isNumeric() && t2.isNumeric()) {
 	    result = t1;
 
-	else if (t1.isPointer() && t2.isNumeric()) {
+	    if (constant(left, a)) {
+		if (constant(right, b))
+		    if ((folded = fold((unsigned long) a + b, result)) != nullptr)
+			return folded;
+
+		std::swap(left, right);
+	    }
+
+	} else if (t1.isPointer() && t2.isNumeric()) {
 	    right = scale(right, t1.dereference().size());
 	    result = t1;
 
@@ -641,6 +802,12 @@ Expression *checkAdd(Expression *left, Expression *right)
 	    report(invalid_operands, "+");
     }
 
+    if (identity(left, right, 0))
+	return left;
+
+    if (identity(right, left, 0))
+	return right;
+
     return new Add(left, right, result);
 }
 
@@ -660,17 +827,23 @@ Expression *checkAdd(Expression *left, Expression *right)
 
 Expression *checkSubtract(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     const Type &t1 = decay(extend(left, right->type()));
     const Type &t2 = decay(extend(right, left->type()));
     Type result = error;
     Expression *expr;
+    long a, b;
 
 
     if (t1 != error && t2 != error) {
-	if (t1.isNumeric() && t2.isNumeric())
+	if (t1.isNumeric() && t2.isNumeric()) {
 	    result = t1;
 
-	else if (t1.isPointer() && t1 == t2)
+	    if (constant(left, a) && constant(right, b))
+		if ((expr = fold((unsigned long) a - b, result)) != nullptr)
+		    return expr;
+
+	} else if (t1.isPointer() && t1 == t2)
 	    result = longint;
 
 	else if (t1.isPointer() && t2.isNumeric()) {
@@ -681,6 +854,9 @@ Expression *checkSubtract(Expression *left, Expression *right)
 	    report(invalid_operands, "-");
     }
 
+    if (identity(left, right, 0))
+	return left;
+
     expr = new Subtract(left, right, result);
 
     if (t1.isPointer() && t1 == t2)
@@ -696,7 +872,8 @@ Expression *checkSubtract(Expression *left, Expression *right)
  * Description:	Check an equality or relational expression.  Both operands
  *		undergo the usual conversions and have their types made
  *		common, and then the two types must be compatible, and the
- *		result has type int.
+ *		result has type int.  Comparing two constants is folded by
+ *		the individual functions.
  */
 
 static Type
@@ -726,7 +903,14 @@ checkComparative(Expression *&left, Expression *&right, const string &op)
 
 Expression *checkLessThan(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, "<");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a < b, t);
+
     return new LessThan(left, right, t);
 }
 
@@ -739,7 +923,14 @@ Expression *checkLessThan(Expression *left, Expression *right)
 
 Expression *checkGreaterThan(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, ">");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a > b, t);
+
     return new GreaterThan(left, right, t);
 }
 
@@ -752,7 +943,14 @@ Expression *checkGreaterThan(Expression *left, Expression *right)
 
 Expression *checkLessOrEqual(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, "<=");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a <= b, t);
+
     return new LessOrEqual(left, right, t);
 }
 
@@ -765,7 +963,14 @@ Expression *checkLessOrEqual(Expression *left, Expression *right)
 
 Expression *checkGreaterOrEqual(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, ">=");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a >= b, t);
+
     return new GreaterOrEqual(left, right, t);
 }
 
@@ -778,7 +983,14 @@ Expression *checkGreaterOrEqual(Expression *left, Expression *right)
 
 Expression *checkEqual(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, "==");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a == b, t);
+
     return new Equal(left, right, t);
 }
 
@@ -791,7 +1003,14 @@ Expression *checkEqual(Expression *left, Expression *right)
 
 Expression *checkNotEqual(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkComparative(left, right, "!=");
+    long a, b;
+
+
+    if (t != error && constant(left, a) && constant(right, b))
+	return fold(a != b, t);
+
     return new NotEqual(left, right, t);
 }
 
@@ -826,12 +1045,26 @@ checkLogical(Expression *&left, Expression *&right, const string &op)
 /*
  * Function:	checkLogicalAnd
  *
- * Description:	Check a logical-and expression: LEFT && RIGHT.
+ * Description:	Check a logical-and expression: LEFT && RIGHT.  If the
+ *		left operand is the constant zero, the right operand is
+ *		never evaluated, and so the expression is simply zero.
  */
 
 Expression *checkLogicalAnd(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkLogical(left, right, "&&");
+    long a, b;
+
+
+    if (t != error && constant(left, a)) {
+	if (a == 0)
+	    return fold(0, t);
+
+	if (constant(right, b))
+	    return fold(b != 0, t);
+    }
+
     return new LogicalAnd(left, right, t);
 }
 
@@ -839,12 +1072,26 @@ Expression *checkLogicalAnd(Expression *left, Expression *right)
 /*
  * Function:	checkLogicalOr
  *
- * Description:	Check a logical-or expression: LEFT || RIGHT.
+ * Description:	Check a logical-or expression: LEFT || RIGHT.  If the
+ *		left operand is a nonzero constant, the right operand is
+ *		never evaluated, and so the expression is simply one.
  */
 
 Expression *checkLogicalOr(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     Type t = checkLogical(left, right, "||");
+    long a, b;
+
+
+    if (t != error && constant(left, a)) {
+	if (a != 0)
+	    return fold(1, t);
+
+	if (constant(right, b))
+	    return fold(b != 0, t);
+    }
+
     return new LogicalOr(left, right, t);
 }
 
@@ -860,6 +1107,7 @@ Expression *checkLogicalOr(Expression *left, Expression *right)
 
 Expression *checkTest(Expression *expr)
 {
+    Timer timer(CHECK);
     const Type &t = decay(promote(expr));
 
     if (t != error && !t.isScalar())
@@ -869,6 +1117,87 @@ Expression *checkTest(Expression *expr)
 }
 
 
+/*
+ * Function:	empty (private)
+ *
+ * Description:	Return an empty statement, which replaces a statement that
+ *		can never be executed.
+ */
+
+static Statement *empty()
+{
+    return new Block(new Scope(), Statements());
+}
+
+
+/*
+ * Function:	checkWhile
+ *
+ * Description:	Check a while statement: while ( EXPR ) STMT.  The test has
+ *		already been checked.  A loop whose test is the constant
+ *		zero never executes its statement.
+ */
+
+Statement *checkWhile(Expression *expr, Statement *stmt)
+{
+    Timer timer(CHECK);
+    long value;
+
+
+    if (constant(expr, value) && value == 0)
+	return empty();
+
+    return new While(expr, stmt);
+}
+
+
+/*
+ * Function:	checkFor
+ *
+ * Description:	Check a for statement: for ( INIT ; EXPR ; INCR ) STMT.
+ *		The test has already been checked.  A loop whose test is
+ *		the constant zero only executes its initialization.
+ */
+
+Statement *checkFor(Statement *init, Expression *expr, Statement *incr,
+	Statement *stmt)
+{
+    long value;
+
+
+    if (constant(expr, value) && value == 0)
+	return init;
+
+    return new For(init, expr, incr, stmt);
+}
+
+
+/*
+ * Function:	checkIf
+ *
+ * Description:	Check an if-then or if-then-else statement: if ( EXPR )
+ *		THEN else ELSE.  The test has already been checked.  If the
+ *		test is a constant, only one of the statements can ever be
+ *		executed, and the other is discarded.
+ */
+
+Statement *checkIf(Expression *expr, Statement *thenStmt, Statement *elseStmt)
+{
+    Timer timer(CHECK);
+    long value;
+
+
+    if (constant(expr, value)) {
+	if (value != 0)
+	    return thenStmt;
+
+	return elseStmt != nullptr ? elseStmt : empty();
+    }
+
+    return new If(expr, thenStmt, elseStmt);
+}
+
+
 /*
  * Function:	checkAssignment
  *
@@ -879,6 +1208,7 @@ Expression *checkTest(Expression *expr)
 
 Statement *checkAssignment(Expression *left, Expression *right)
 {
+    Timer timer(CHECK);
     const Type &t1 = left->type();
     const Type &t2 = decay(right);
 
@@ -906,6 +1236,7 @@ Statement *checkAssignment(Expression *left, Expression *right)
 
 Statement *checkReturn(Expression *expr, const Type &type)
 {
+    Timer timer(CHECK);
     const Type &t = decay(expr);
 
 
@@ -928,6 +1259,9 @@ Statement *checkReturn(Expression *expr, const Type &type)
 
 Statement *checkBreak(unsigned depth)
 {
+    Timer timer(CHECK);
+
+
     if (depth == 0)
 	report(invalid_break);
 
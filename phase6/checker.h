@@ -12,10 +12,10 @@
 Scope *openScope();
 Scope *closeScope(bool cleanup = false);
 
-Symbol *defineFunction(const std::string &name, const Type &type);
-Symbol *declareFunction(const std::string &name, const Type &type);
-Symbol *declareVariable(const std::string &name, const Type &type);
-Symbol *checkIdentifier(const std::string &name);
+Symbol *defineFunction(Name name, const Type &type);
+Symbol *declareFunction(Name name, const Type &type);
+Symbol *declareVariable(Name name, const Type &type);
+Symbol *checkIdentifier(Name name);
 
 Expression *checkCall(Symbol *id, Expressions &args);
 Expression *checkArray(Expression *left, Expression *right);
@@ -40,6 +40,10 @@ Expression *checkLogicalAnd(Expression *left, Expression *right);
 Expression *checkLogicalOr(Expression *left, Expression *right);
 Expression *checkTest(Expression *expr);
 
+Statement *checkWhile(Expression *expr, Statement *stmt);
+Statement *checkFor(Statement *init, Expression *expr, Statement *incr,
+	Statement *stmt);
+Statement *checkIf(Expression *expr, Statement *thenStmt, Statement *elseStmt);
 Statement *checkAssignment(Expression *left, Expression *right);
 Statement *checkReturn(Expression *expr, const Type &type);
 Statement *checkBreak(unsigned depth);
@@ -0,0 +1,87 @@
+/*
+ * File:	context.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the context of compiling a translation unit.
+ */
+
+# include <cassert>
+# include <cstdio>
+# include <iostream>
+# include "context.h"
+# include "lexer.h"
+
+using namespace std;
+
+thread_local CompilerContext *CompilerContext::_current = nullptr;
+
+
+/*
+ * Function:	CompilerContext::CompilerContext (constructor)
+ *
+ * Description:	Initialize the context for compiling the translation unit
+ *		read from the given path, which is empty for the standard
+ *		input, with the given number of code generation workers.
+ */
+
+CompilerContext::CompilerContext(const string &path, unsigned workers)
+    : path(path), next(0), lineno(1), numerrors(0), scope(nullptr),
+      global(nullptr), counters(nullptr), profile(nullptr),
+      pipeline(this, workers)
+{
+}
+
+
+/*
+ * Function:	CompilerContext::current (accessor)
+ *
+ * Description:	Return the current context of this thread, which had
+ *		better exist.
+ */
+
+CompilerContext *CompilerContext::current()
+{
+    assert(_current != nullptr);
+    return _current;
+}
+
+
+/*
+ * Function:	CompilerContext::use
+ *
+ * Description:	Make the given context the current context of this thread
+ *		and return the previous current context.
+ */
+
+CompilerContext *CompilerContext::use(CompilerContext *context)
+{
+    CompilerContext *previous = _current;
+
+    _current = context;
+    return previous;
+}
+
+
+/*
+ * Function:	report
+ *
+ * Description:	Report an error to the standard error prefixed with the
+ *		line number, and the file name when compiling a file.  We'll
+ *		be using this a lot later with an optional string argument,
+ *		but C++'s stupid streams don't do positional arguments, so
+ *		we actually resort to snprintf.  You just can't beat C for
+ *		doing things down and dirty.  The message is written all at
+ *		once, since other threads may be reporting errors too.
+ */
+
+void report(const string &str, const string &arg)
+{
+    CompilerContext *context = CompilerContext::current();
+    string prefix = context->path.empty() ? "" : context->path + ": ";
+    char buf[1000];
+
+
+    snprintf(buf, sizeof(buf), str.c_str(), arg.c_str());
+    cerr << prefix + "line " + to_string(context->lineno) + ": " + buf + "\n";
+    context->numerrors ++;
+}
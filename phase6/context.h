@@ -0,0 +1,87 @@
+/*
+ * File:	context.h
+ *
+ * Description:	This file contains the class definition for the context
+ *		of compiling a translation unit.  Everything belonging to a
+ *		translation unit that is shared by the phases of the
+ *		compiler is kept in its context rather than in globals, so
+ *		that several translation units can be compiled at once by
+ *		different threads.  Each thread has its own current context,
+ *		just as it has its own current arena.
+ *
+ *		State used only while compiling a single function, such as
+ *		the work lists of the peephole optimizer, is instead kept in
+ *		each thread, since it is reused for every function.  The
+ *		functions of a translation unit may themselves be generated
+ *		by several threads, so the labels of each function are
+ *		numbered separately and the string literals are numbered as
+ *		they are parsed.
+ */
+
+# ifndef CONTEXT_H
+# define CONTEXT_H
+# include <set>
+# include <string>
+# include <vector>
+# include <string_view>
+# include <unordered_map>
+# include "Arena.h"
+# include "CallGraph.h"
+# include "Conventions.h"
+# include "Emitter.h"
+# include "Inlines.h"
+# include "Pipeline.h"
+# include "Source.h"
+# include "Statistics.h"
+# include "StringPool.h"
+# include "intern.h"
+
+class Counters;
+class Profile;
+class Scope;
+class Symbol;
+
+struct Token {
+    int kind;
+    unsigned line;
+    Name name;
+    std::string_view text;
+};
+
+class CompilerContext {
+    typedef std::string string;
+    static thread_local CompilerContext *_current;
+
+public:
+    string path;
+    Emitter emitter;
+    Arena unit;
+
+    Source source;
+    std::vector<Token> tokens;
+    size_t next;
+    unsigned lineno;
+    unsigned numerrors;
+
+    Scope *scope, *global;
+    std::set<Name> defined;
+
+    StringPool strings;
+    Inlines inlines;
+    Conventions conventions;
+    CallGraph graph;
+    std::unordered_map<const Symbol *, unsigned long> digests;
+
+    Counters *counters;
+    const Profile *profile;
+
+    Pipeline pipeline;
+    Statistics stats;
+
+    CompilerContext(const string &path = "", unsigned workers = 0);
+
+    static CompilerContext *current();
+    static CompilerContext *use(CompilerContext *context);
+};
+
+# endif /* CONTEXT_H */
@@ -4,28 +4,57 @@
  * Description:	This file contains the public and member function
  *		definitions for the code generator for Simple C.
  *
+ *		Each function is first lowered into its intermediate
+ *		representation, whose temporaries are then allocated
+ *		registers, and each quad is then translated into a few
+ *		instructions.  The registers %rax, %rdx, and %r11 are never
+ *		allocated, and so are available as scratch registers within
+ *		the instructions for a quad.  Division needs %rax and %rdx
+ *		anyway.  The vectorizer never uses the last vector register,
+ *		which is then the scratch vector register.
+ *
  *		Extra functionality:
  *		- putting all the global declarations at the end
  *		- prefix and suffix for globals (required on some systems)
+ *		- buffering the output and writing it once per function
+ *		- keeping temporaries in registers
+ *		- shifting instead of multiplying or dividing by powers of two
+ *		- branching directly on comparisons
+ *		- computing several elements at once in vector registers
+ *		- falling through to the next block instead of jumping
+ *		- collecting instructions for the peephole optimizer
  */
 
 # include <vector>
+# include <algorithm>
 # include <cassert>
+# include <climits>
+# include <cstdlib>
+# include <sstream>
 # include <iostream>
 # include "generator.h"
 # include "machine.h"
+# include "peephole.h"
+# include "Register.h"
 # include "Tree.h"
+# include "IR.h"
 # include "string.h"
+# include "context.h"
+# include "Profile.h"
+# include "Timer.h"
 #include <map>
 
 
 using namespace std;
 
-static int offset;
-static string funcname, tab = "\t";
-static string suffix(Expression *expr);
-static ostream &operator <<(ostream &ostr, Expression *expr);
-static vector<Label> exits_labels;
+static thread_local Procedure *proc;
+static thread_local BasicBlock *following;
+static thread_local string funcname;
+static thread_local Instructions code;
+static thread_local unsigned loads, stores;
+static thread_local vector<Register *> saved;
+static thread_local int saved_offset;
+static thread_local Conventions *conventions;
 
 static Register *rax = new Register("%rax", "%eax", "%al");
 static Register *rbx = new Register("%rbx", "%ebx", "%bl");
@@ -43,106 +72,148 @@ static Register *r14 = new Register("%r14", "%r14d", "%r14b");
 static Register *r15 = new Register("%r15", "%r15d", "%r15b");
 
 static vector<Register *> parameters = {rdi, rsi, rdx, rcx, r8, r9};
-static vector<Register *> registers = {rax, rdi, rsi, rdx, rcx, r8, r9, r10, r11};
-static map<string, Label> strings;
+static vector<Register *> caller_saved = {r10, rcx, rsi, rdi, r8, r9};
+static vector<Register *> callee_saved = {rbx, r12, r13, r14, r15};
 
+static const char *conditions[] = {"e", "ne", "l", "g", "le", "ge"};
 
-/* These will be replaced with functions in the next phase.  They are here
-   as placeholders so that Call::generate() is finished. */
+typedef vector<pair<Register *, Register *>> Moves;
 
-static void assign(Expression *expr, Register *reg){
-    if(expr != nullptr){
-        if(expr->reg != nullptr){
-            expr->reg->node = nullptr;
-        }
-        expr->reg = reg;
-    }
-    if(reg != nullptr){
-        if(reg->node !=nullptr){
-            reg->node->reg = nullptr;
-        }
-        reg->node = expr;
-    }
-}
 
+/*
+ * Function:	text (private)
+ *
+ * Description:	Return the text of an operand, as written by its stream
+ *		operator.
+ */
+
+template<class T>
+static string text(const T &value)
+{
+    ostringstream ostr;
 
-static void load(Expression *expr, Register *reg){
-    if (reg->node != expr) {
-		if (reg->node != nullptr) { //replaces assert
-			offset -= reg->node->type().size();
-			reg->node->offset = offset;
-			cout << "\tmov" << suffix(reg->node) << reg;
-			cout << ", " << offset << "(%rbp)" << endl;
-		}
-		if (expr != nullptr) { //if expression is not allocated to reg, load it
-			unsigned size = expr->type().size();
-			cout << "\tmov" << suffix(expr) << expr;
-			cout << ", " << reg->name(size) << endl;
-		}
-		
-		assign(expr, reg);
-		
-	}
+    ostr << value;
+    return ostr.str();
 }
 
-static Register *getreg(){
-    for (auto reg : registers){
-		if (reg->node == nullptr)
-			return reg;
-    }
-	//spill first register so its available. replaces abort()
-	load(nullptr, registers[0]);
-	return registers[0];
+
+/*
+ * Function:	frame (private)
+ *
+ * Description:	Return the operand for the given offset in the stack frame.
+ */
+
+static string frame(int offset)
+{
+    return to_string(offset) + "(%rbp)";
 }
 
 
 /*
- * Function:	sign_extend_byte_arg (private)
+ * Function:	emit (private)
  *
- * Description:	Sign extend a byte argument to 32 bits.  The Microsoft
- *		calling conventions explicitly state that parameters less
- *		than 64 bits long are not zero extended.  The System V
- *		conventions used for Unix-like systems do not specify what
- *		happens, but gcc and clang do sign extend, and clang
- *		apparently relies on it, but icc does not sign extend.
+ * Description:	Append an instruction to the code for the current function.
+ *		A single operand is given as the source.
+ */
+
+static void emit(const string &opcode, unsigned size = 0,
+	const string &source = "", const string &target = "")
+{
+    code.emplace_back(opcode, size, source, target);
+}
+
+
+/*
+ * Function:	emit (private)
  *
- *		Writing to the 32 bit register will zero the upper 32-bits
- *		of the 64-bit register.  So in effect, an 8-bit value
- *		written to %al is sign extended into %eax but then zero
- *		extended into %rax.
+ * Description:	Append a label to the code for the current function,
+ *		aligned to the given number of bytes if necessary.
  */
 
-void sign_extend_byte_arg(Expression *arg)
+static void emit(const Label &label, unsigned alignment = 0)
 {
-    if (arg->type().size() == 1) {
-	cout << tab << "movsbl" << tab << arg << ", ";
-	cout << arg->reg->name(4) << endl;
-    }
+    code.emplace_back(text(label));
+    code.back().size = alignment;
 }
 
 
 /*
- * Function:	suffix (private)
+ * Function:	power (private)
  *
- * Description:	Return the suffix for an opcode based on the given size.
+ * Description:	Return the base two logarithm of the given operand if it
+ *		is a constant that is a positive power of two small enough
+ *		to use as a shift count and as an immediate operand, and
+ *		return zero otherwise.
  */
 
-static string suffix(unsigned long size)
+static unsigned power(const Operand &operand)
 {
-    return size == 1 ? "b\t" : (size == 4 ? "l\t" : "q\t");
+    unsigned long value;
+
+
+    if (!operand.isConst())
+	return 0;
+
+    value = operand.size == 4 ? (int) operand.value : operand.value;
+
+    if (value < 2 || value >= 1UL << 31 || (value & (value - 1)) != 0)
+	return 0;
+
+    return __builtin_ctzl(value);
 }
 
 
 /*
- * Function:	suffix (private)
+ * Function:	magic (private)
  *
- * Description:	Return the suffix for an opcode based on the size of the
- *		given expression.
+ * Description:	Compute the multiplier and shift with which a signed
+ *		division of the given number of bits by the given divisor
+ *		can be done by multiplying and keeping the high half, as
+ *		in chapter 10 of Hacker's Delight, and return whether the
+ *		divisor is in the range handled.  The arithmetic is that of
+ *		unsigned integers of the given number of bits.
  */
 
-static string suffix(Expression *expr)
+static bool magic(unsigned long divisor, unsigned bits, long &multiplier, unsigned &shift)
 {
-    return suffix(expr->type().size());
+    unsigned long mask = bits == 64 ? ~0UL : (1UL << bits) - 1;
+    unsigned long two = 1UL << (bits - 1), anc, q1, r1, q2, r2, delta;
+    unsigned p = bits - 1;
+
+
+    if (divisor < 2 || divisor >= two)
+	return false;
+
+    anc = two - 1 - two % divisor;
+    q1 = two / anc;
+    r1 = two - q1 * anc;
+    q2 = two / divisor;
+    r2 = two - q2 * divisor;
+
+    do {
+	p ++;
+	q1 = (q1 * 2) & mask;
+	r1 = r1 * 2;
+
+	if (r1 >= anc) {
+	    q1 ++;
+	    r1 -= anc;
+	}
+
+	q2 = (q2 * 2) & mask;
+	r2 = r2 * 2;
+
+	if (r2 >= divisor) {
+	    q2 ++;
+	    r2 -= divisor;
+	}
+
+	delta = divisor - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    multiplier = bits == 64 ? (long) (q2 + 1) : (int) ((q2 + 1) & mask);
+    shift = p - bits;
+    return true;
 }
 
 
@@ -163,687 +234,1155 @@ static int align(int offset)
 
 
 /*
- * Function:	operator << (private)
+ * Function:	location (private)
  *
- * Description:	Convenience function for writing the operand of an
- *		expression using the output stream operator.
+ * Description:	Return the register of an operand, or null if the operand
+ *		is not a temporary kept in a register.
  */
 
-static ostream &operator <<(ostream &ostr, Expression *expr)
+static Register *location(const Operand &operand)
 {
-    if (expr->reg != nullptr)
-	return ostr << expr->reg;
-
-    expr->operand(ostr);
-    return ostr;
+    return operand.isTemp() ? proc->registers[operand.temp] : nullptr;
 }
 
 
 /*
- * Function:	Expression::operand
+ * Function:	isMemory (private)
  *
- * Description:	Write an expression as an operand to the specified stream.
+ * Description:	Return whether an operand is a spilled temporary, and so
+ *		can be used directly only as a memory operand.
  */
 
-void Expression::operand(ostream &ostr) const
+static bool isMemory(const Operand &operand)
 {
-    assert(offset != 0);
-    ostr << offset << "(%rbp)";
+    return operand.isTemp() && location(operand) == nullptr;
 }
 
 
 /*
- * Function:	Identifier::operand
+ * Function:	isImmediate (private)
  *
- * Description:	Write an identifier as an operand to the specified stream.
+ * Description:	Return whether an operand is a constant that can be used
+ *		directly as an immediate operand of the given size.
  */
 
-void Identifier::operand(ostream &ostr) const
+static bool isImmediate(const Operand &operand, unsigned size)
 {
-    if (_symbol->offset == 0)
-	ostr << global_prefix << _symbol->name() << global_suffix;
-    else
-	ostr << _symbol->offset << "(%rbp)";
+    return operand.isConst() && (size < 8 || operand.value == (int) operand.value);
 }
 
 
 /*
- * Function:	Number::operand
+ * Function:	immediate (private)
  *
- * Description:	Write a number as an operand to the specified stream.
+ * Description:	Return the text of a constant as an immediate operand of
+ *		the given size.
  */
 
-void Number::operand(ostream &ostr) const
+static string immediate(const Operand &operand, unsigned size)
 {
-    ostr << "$" << _value;
+    long value = operand.value;
+
+
+    if (size == 1)
+	value = (signed char) value;
+    else if (size == 4)
+	value = (int) value;
+
+    return "$" + to_string(value);
 }
 
 
 /*
- * Function:	Call::generate
+ * Function:	spilled (private)
  *
- * Description:	Generate code for a function call expression.
- *
- *		On a 64-bit platform, the stack needs to be aligned on a
- *		16-byte boundary.  So, if the stack will not be aligned
- *		after pushing any arguments, we first adjust the stack
- *		pointer.
- *
- *		Since all arguments are 8-bytes wide, we could simply do:
- *
- *		    if (args.size() > 6 && args.size() % 2 != 0)
- *			subq $8, %rsp
+ * Description:	Return the text of the stack slot of a spilled temporary.
  */
 
-void Call::generate()
+static string spilled(const Operand &temp)
 {
-    unsigned numBytes;
-
+    return frame(proc->slots[proc->spills[temp.temp]].offset);
+}
 
-    /* Generate code for the arguments first. */ 
 
-    numBytes = 0;
+/*
+ * Function:	memory (private)
+ *
+ * Description:	Return the text of the memory operand at the given address.
+ *		A spilled pointer is first loaded into the scratch
+ *		register.
+ */
 
-    for (int i = _args.size() - 1; i >= 0; i --)
-	_args[i]->generate();
+static string memory(const Operand &address, Register *scratch)
+{
+    switch (address.kind) {
+    case Operand::TEMP:
+	if (location(address) == nullptr) {
+	    loads ++;
+	    emit("movq", 0, spilled(address), scratch->name());
+	    return "(" + scratch->name() + ")";
+	}
 
+	return "(" + location(address)->name() + ")";
 
-    /* Adjust the stack if necessary */
+    case Operand::SLOT:
+	return frame(proc->slots[address.slot].offset);
 
-    if (_args.size() > NUM_PARAM_REGS) {
-	numBytes = align((_args.size() - NUM_PARAM_REGS) * PARAM_ALIGNMENT);
+    case Operand::GLOBAL:
+	return global_prefix + address.symbol->name() + global_suffix;
 
-	if (numBytes > 0)
-	    cout << tab << "subq" << tab << "$" << numBytes << ", %rsp" << endl;
+    case Operand::STRING:
+	return string_prefix + to_string(address.label);
     }
 
+    return to_string(address.value);
+}
 
-    /* Move the arguments into the correct registers or memory locations. */
 
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	if (i >= NUM_PARAM_REGS) {
-	    numBytes += PARAM_ALIGNMENT;
-	    load(_args[i], rax);
-	    sign_extend_byte_arg(_args[i]);
-	    cout << tab << "pushq" << tab << "%rax" << endl;
+/*
+ * Function:	memory (private)
+ *
+ * Description:	Return the text of the memory operand at the address of a
+ *		load, store, or address quad, which may have a scaled index
+ *		and an offset.  A spilled base is first loaded into %r11.
+ *		A spilled index is also loaded into %r11, in which case any
+ *		base held in a temporary is then added to it.
+ */
 
+static string memory(const Quad &quad)
+{
+    const Operand &base = quad.left, &index = quad.index;
+    string disp, first, second, scale = to_string(quad.scale);
+    long offset = quad.offset;
+
+
+    if (index.kind == Operand::NONE && offset == 0)
+	return memory(base, r11);
+
+    if (isMemory(index)) {
+	loads ++;
+	emit("movq", 0, spilled(index), r11->name());
+	second = r11->name();
+    } else if (index.kind != Operand::NONE)
+	second = location(index)->name();
+
+    if (base.kind == Operand::TEMP) {
+	if (location(base) != nullptr)
+	    first = location(base)->name();
+	else if (second != r11->name()) {
+	    loads ++;
+	    emit("movq", 0, spilled(base), r11->name());
+	    first = r11->name();
 	} else {
-	    load(_args[i], parameters[i]);
-	    sign_extend_byte_arg(_args[i]);
+	    if (quad.scale > 1)
+		emit("imulq", 0, "$" + scale, r11->name());
+
+	    loads ++;
+	    emit("addq", 0, spilled(base), r11->name());
+	    first = r11->name();
+	    second.clear();
 	}
 
-	assign(_args[i], nullptr);
-    }
+    } else if (base.kind == Operand::SLOT) {
+	first = "%rbp";
+	offset += proc->slots[base.slot].offset;
 
+    } else if (base.kind == Operand::GLOBAL)
+	disp = global_prefix + base.symbol->name() + global_suffix;
 
-    /* Call the function and then reclaim the stack space.  We only need to
-       assign the number of floating point arguments passed in vector
-       registers to %eax if the function being called takes a variable
-       number of arguments. */
+    else if (base.kind == Operand::STRING)
+	disp = string_prefix + to_string(base.label);
 
-    for (auto reg : registers)
-	load(nullptr, reg);
+    if (disp.empty())
+	disp = offset != 0 ? to_string(offset) : "";
+    else if (offset != 0)
+	disp += (offset > 0 ? "+" : "") + to_string(offset);
 
-    if (_id->type().parameters()->variadic)
-	cout << tab << "movl" << tab << "$0, %eax" << endl;
+    if (first.empty() && second.empty())
+	return disp;
 
-    cout << tab << "call" << tab << global_prefix << _id->name() << endl;
+    if (second.empty())
+	return disp + "(" + first + ")";
 
-    if (numBytes > 0)
-	cout << tab << "addq" << tab << "$" << numBytes << ", %rsp" << endl;
+    if (quad.scale == 1)
+	return disp + "(" + first + "," + second + ")";
 
-    assign(this, rax);
+    return disp + "(" + first + "," + second + "," + scale + ")";
 }
 
 
 /*
- * Function:	Block::generate
+ * Function:	operand (private)
  *
- * Description:	Generate code for this block, which simply means we
- *		generate code for each statement within the block.
+ * Description:	Return the text of an operand of the given size for use as
+ *		the source of an instruction.  If the operand cannot be
+ *		used directly, it is first loaded into the scratch register.
  */
 
-void Block::generate()
+static string operand(const Operand &operand, unsigned size, Register *scratch)
 {
-    for (auto stmt : _stmts) {
-	stmt->generate();
+    if (operand.isTemp()) {
+	if (location(operand) != nullptr)
+	    return location(operand)->name(size);
 
-	for (auto reg : registers)
-	    assert(reg->node == nullptr);
+	loads ++;
+	return spilled(operand);
     }
+
+    if (isImmediate(operand, size))
+	return immediate(operand, size);
+
+    if (operand.isConst())
+	emit("movabsq", 0, "$" + to_string(operand.value), scratch->name());
+    else
+	emit("leaq", 0, memory(operand, scratch), scratch->name());
+
+    return scratch->name(size);
 }
 
 
 /*
- * Function:	Simple::generate
+ * Function:	load (private)
  *
- * Description:	Generate code for a simple (expression) statement, which
- *		means simply generating code for the expression.
+ * Description:	Load an operand of the given size into a register.
  */
 
-void Simple::generate()
+static void load(const Operand &value, Register *reg, unsigned size)
 {
-    _expr->generate();
-    assign(_expr, nullptr);
+    if (location(value) == reg)
+	return;
+
+    if (value.isAddress())
+	emit("leaq", 0, memory(value, reg), reg->name());
+    else if (value.isConst() && !isImmediate(value, size))
+	emit("movabsq", 0, "$" + to_string(value.value), reg->name());
+    else
+	emit("mov", size, operand(value, size, reg), reg->name(size));
 }
 
 
 /*
- * Function:	Function::generate
+ * Function:	store (private)
  *
- * Description:	Generate code for this function, which entails allocating
- *		space for local variables, then emitting our prologue, the
- *		body of the function, and the epilogue.
+ * Description:	Store a register into the location of a temporary.
  */
 
-void Function::generate()
+static void store(Register *reg, const Operand &result)
 {
-    int param_offset;
-    unsigned size;
-    Symbols symbols;
-    Types types;
+    if (!result.isTemp() || location(result) == reg)
+	return;
+
+    if (location(result) != nullptr)
+	emit("mov", result.size, reg->name(result.size), location(result)->name(result.size));
+    else {
+	stores ++;
+	emit("mov", result.size, reg->name(result.size), spilled(result));
+    }
+}
 
 
-    /* Assign offsets to the parameters and local variables. */
+/*
+ * Function:	shuffle (private)
+ *
+ * Description:	Perform a set of moves between registers in parallel.  A
+ *		move is done once its target is not the source of another,
+ *		and a cycle of moves is broken by moving one source into
+ *		the scratch register.
+ */
 
-    param_offset = 2 * SIZEOF_REG;
-    offset = param_offset;
-    allocate(offset);
+static void shuffle(Moves moves)
+{
+    unsigned i, j;
 
 
-    /* Generate our prologue. */
+    for (i = 0; i < moves.size(); )
+	if (moves[i].first == moves[i].second)
+	    moves.erase(moves.begin() + i);
+	else
+	    i ++;
 
-    funcname = _id->name();
-    cout << global_prefix << funcname << ":" << endl;
-    cout << tab << "pushq" << tab << "%rbp" << endl;
-    cout << tab << "movq" << tab << "%rsp, %rbp" << endl;
-    cout << tab << "movl" << tab << "$" << funcname << ".size, %eax" << endl;
-    cout << tab << "subq" << tab << "%rax, %rsp" << endl;
+    while (!moves.empty()) {
+	for (i = 0; i < moves.size(); i ++) {
+	    for (j = 0; j < moves.size(); j ++)
+		if (moves[j].second == moves[i].first)
+		    break;
 
+	    if (j == moves.size())
+		break;
+	}
 
-    /* Spill any parameters. */
+	if (i < moves.size()) {
+	    emit("movq", 0, moves[i].second->name(), moves[i].first->name());
+	    moves.erase(moves.begin() + i);
 
-    types = _id->type().parameters()->types;
-    symbols = _body->declarations()->symbols();
+	} else {
+	    Register *source = moves[0].second;
+
+	    emit("movq", 0, source->name(), r11->name());
+
+	    for (auto &move : moves)
+		if (move.second == source)
+		    move.second = r11;
+	}
+    }
+}
 
-    for (unsigned i = 0; i < NUM_PARAM_REGS; i ++)
-	if (i < types.size()) {
-	    size = symbols[i]->type().size();
-	    cout << tab << "mov" << suffix(size) << parameters[i]->name(size);
-	    cout << ", " << symbols[i]->offset << "(%rbp)" << endl;
-	} else
-	    break;
 
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Compare two operands and return the condition to test.  A
+ *		constant left operand is swapped with the right, reversing
+ *		the condition, since the target cannot be an immediate.
+ */
 
-    /* Generate the body of this function. */
+static Condition compare(Condition cond, Operand left, Operand right)
+{
+    static const Condition reversed[] = {EQ, NE, GT, LT, GE, LE};
+    unsigned size = left.size;
+    string target, source;
 
-    _body->generate();
 
+    if (!left.isTemp() && right.isTemp()) {
+	swap(left, right);
+	cond = reversed[cond];
+    }
 
-    /* Generate our epilogue. */
+    if (left.isTemp())
+	target = operand(left, size, nullptr);
+    else {
+	load(left, r11, size);
+	target = r11->name(size);
+    }
 
-    cout << endl << global_prefix << funcname << ".exit:" << endl;
-    cout << tab << "movq" << tab << "%rbp, %rsp" << endl;
-    cout << tab << "popq" << tab << "%rbp" << endl;
-    cout << tab << "ret" << endl << endl;
+    if (isMemory(left) && isMemory(right)) {
+	load(right, rax, size);
+	source = rax->name(size);
+    } else
+	source = operand(right, size, rax);
 
-    offset -= align(offset - param_offset);
-    cout << tab << ".set" << tab << funcname << ".size, " << -offset << endl;
-    cout << tab << ".globl" << tab << global_prefix << funcname << endl << endl;
+    emit("cmp", size, source, target);
+    return cond;
 }
 
 
 /*
- * Function:	generateGlobals
+ * Function:	arithmetic (private)
  *
- * Description:	Generate code for any global variable declarations.
+ * Description:	Generate code for an addition, subtraction, or
+ *		multiplication, which are two-address instructions on the
+ *		Intel 64-bit processor.  The result is computed in its own
+ *		register if possible, unless that register also holds the
+ *		right operand, which must not be overwritten first.
  */
 
-void generateGlobals(Scope *scope)
+static void arithmetic(const string &opcode, const Quad &quad, bool commutative)
 {
-    const Symbols &symbols = scope->symbols();
+    Operand left = quad.left, right = quad.right;
+    unsigned size = quad.result.size, shift;
+    Register *reg = location(quad.result);
 
-    for (auto symbol : symbols)
-	if (!symbol->type().isFunction()) {
-	    cout << tab << ".comm" << tab << global_prefix << symbol->name();
-	    cout << ", " << symbol->type().size() << endl;
-	}
-    cout << tab <<".data" <<endl;
 
-    for(auto pair: strings){
-        cout << pair.second << ":" << tab << ".asciz" << tab << "\""<< escapeString(pair.first) << "\"" << endl;
-    }
+    if (commutative && left != right)
+	if ((reg != nullptr && location(right) == reg) || left.isConst())
+	    swap(left, right);
+
+    if (reg == nullptr || (left != right && right.isTemp() && location(right) == reg))
+	reg = r11;
+
+    load(left, reg, size);
+
+    if (opcode == "imul" && (shift = power(right)) > 0)
+	emit("sal", size, "$" + to_string(shift), reg->name(size));
+    else
+	emit(opcode, size, operand(right, size, rax), reg->name(size));
 
+    store(reg, quad.result);
 }
 
 
 /*
- * Function:	Assignment::generate
+ * Function:	divide (private)
  *
- * Description:	Generate code for an assignment statement.
- *
- *		NOT FINISHED: Only works if the right-hand side is an
- *		integer literal and the left-hand side is an integer
- *		scalar.
+ * Description:	Generate code for a division or remainder, which leave
+ *		their results in %rax and %rdx, respectively.  A division
+ *		by a power of two is done by shifting after first adding
+ *		one less than the divisor to a negative dividend, so that
+ *		the quotient is rounded toward zero, and the remainder is
+ *		then what is masked off less what was added.  A division by
+ *		any other constant is done by multiplying by its magic
+ *		reciprocal, adding one to a negative quotient, and negating
+ *		the quotient for a negative divisor.  The remainder is then
+ *		the dividend less the quotient times the divisor.
  */
 
-void Assignment::generate()
+static void divide(const Quad &quad)
 {
-    Expression *pointer;
+    unsigned size = quad.result.size, bits = size * 8, shift;
+    long value = quad.right.value, multiplier;
+    string divisor, dividend;
+
+
+    if ((shift = power(quad.right)) > 0) {
+	load(quad.left, rax, size);
+	emit("mov", size, rax->name(size), r11->name(size));
+	emit("sar", size, "$" + to_string(bits - 1), r11->name(size));
+	emit("shr", size, "$" + to_string(bits - shift), r11->name(size));
+	emit("add", size, r11->name(size), rax->name(size));
+
+	if (quad.opcode == DIVIDE)
+	    emit("sar", size, "$" + to_string(shift), rax->name(size));
+	else {
+	    emit("and", size, "$" + to_string((1L << shift) - 1), rax->name(size));
+	    emit("sub", size, r11->name(size), rax->name(size));
+	}
+
+	store(rax, quad.result);
+	return;
+    }
+
+    if (size == 4)
+	value = (int) value;
 
-    _right->generate();
+    if (quad.right.isConst() && value != LONG_MIN &&
+	    magic(labs(value), bits, multiplier, shift)) {
+	if (quad.left.isTemp())
+	    dividend = operand(quad.left, size, nullptr);
+	else {
+	    load(quad.left, r11, size);
+	    dividend = r11->name(size);
+	}
+
+	load(Operand(Operand::CONST, size, multiplier), rax, size);
+	emit("imul", size, dividend);
 
-    if(_left->isDereference(pointer)){ //linked left to pointer
-        pointer->generate();
+	if (multiplier < 0)
+	    emit("add", size, dividend, rdx->name(size));
 
-        if(pointer->reg == nullptr)
-            load(pointer, getreg());
-        if(_right->reg == nullptr)
-            load(_right, getreg());
+	if (shift > 0)
+	    emit("sar", size, "$" + to_string(shift), rdx->name(size));
 
-        cout << "\tmov" << suffix(_right) << _right << ", " << "(" << pointer << ")" <<endl;
+	emit("mov", size, rdx->name(size), rax->name(size));
+	emit("shr", size, "$" + to_string(bits - 1), rax->name(size));
+	emit("add", size, rax->name(size), rdx->name(size));
 
-        assign(_right, nullptr);
-        assign(pointer, nullptr);
+	if (quad.opcode == DIVIDE) {
+	    if (value < 0)
+		emit("neg", size, rdx->name(size));
 
+	    store(rdx, quad.result);
+	    return;
+	}
+
+	if (labs(value) == (int) labs(value))
+	    emit("imul", size, "$" + to_string(labs(value)), rdx->name(size));
+	else {
+	    load(Operand(Operand::CONST, size, labs(value)), rax, size);
+	    emit("imul", size, rax->name(size), rdx->name(size));
+	}
+
+	emit("mov", size, dividend, rax->name(size));
+	emit("sub", size, rdx->name(size), rax->name(size));
+	store(rax, quad.result);
+	return;
     }
-    else{
-        if(_right->reg == nullptr)
-            load(_right, getreg());
 
-        cout << tab << "mov" << suffix(_right) << _right << ", " << _left << endl; //move right into left
+    load(quad.left, rax, size);
+    emit(size == 8 ? "cqto" : "cltd");
 
-        assign(_right, nullptr);
-        assign(_left, nullptr);
+    if (quad.right.isTemp())
+	divisor = operand(quad.right, size, nullptr);
+    else {
+	load(quad.right, r11, size);
+	divisor = r11->name(size);
     }
+
+    emit("idiv", size, divisor);
+    store(quad.opcode == DIVIDE ? rax : rdx, quad.result);
 }
 
-void Add::generate(){
-    _left->generate();
-    _right->generate();
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
+/*
+ * Function:	arguments (private)
+ *
+ * Description:	Move the arguments of a call passed in registers into
+ *		the given registers, sign extending any byte arguments if
+ *		requested.
+ */
+
+static void arguments(const Quad &quad, const vector<Register *> &registers,
+	bool extend)
+{
+    unsigned i;
+    Moves moves;
+
+
+    for (i = 0; i < quad.args.size() && i < NUM_PARAM_REGS; i ++)
+	if (location(quad.args[i]) != nullptr)
+	    moves.emplace_back(registers[i], location(quad.args[i]));
+
+    shuffle(moves);
+
+    for (i = 0; i < quad.args.size() && i < NUM_PARAM_REGS; i ++) {
+	if (location(quad.args[i]) == nullptr)
+	    load(quad.args[i], registers[i], quad.args[i].size);
+
+	if (extend && quad.args[i].size == 1)
+	    emit("movsbl", 0, registers[i]->byte(), registers[i]->name(4));
     }
+}
+
+
+/*
+ * Function:	isLeaf (private)
+ *
+ * Description:	Check if the current procedure calls nothing, not even in
+ *		tail position.
+ */
 
-    cout << tab<< "add" << suffix(_left);
-    cout << _right << ", " << _left << endl;
+static bool isLeaf()
+{
+    for (auto block : proc->blocks)
+	for (auto &quad : block->quads)
+	    if (quad.callee != nullptr)
+		return false;
 
-    assign(_right, nullptr);
-    assign(this, _left->reg); //result of add goes in left register
+    return true;
 }
 
-void Subtract::generate(){
-    _left->generate();
-    _right->generate();
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
+/*
+ * Function:	epilogue (private)
+ *
+ * Description:	Restore the callee-saved registers we use and pop our
+ *		frame, leaving the return address on top of the stack.
+ */
 
-    cout << tab<< "sub" << suffix(_left);
-    cout << _right << ", " << _left << endl;
+static void epilogue()
+{
+    for (unsigned i = 0; i < saved.size(); i ++)
+	emit("movq", 0, frame(saved_offset - (i + 1) * SIZEOF_REG), text(saved[i]));
 
-    assign(_right, nullptr);
-    assign(this, _left->reg);
+    emit("movq", 0, "%rbp", "%rsp");
+    emit("popq", 0, "%rbp");
 }
 
 
+/*
+ * Function:	call (private)
+ *
+ * Description:	Generate code for a function call.
+ *
+ *		On a 64-bit platform, the stack needs to be aligned on a
+ *		16-byte boundary.  So, if the stack will not be aligned
+ *		after pushing any arguments, we first adjust the stack
+ *		pointer.
+ *
+ *		The arguments in registers must be moved in parallel, since
+ *		an argument may be in the parameter register of another.
+ *		Byte arguments are then sign extended to 32 bits, as gcc and
+ *		clang do, and as clang apparently relies on.  A local callee
+ *		defined earlier is instead entered at its local entry, with
+ *		its arguments in the registers in which it takes them, and
+ *		without extending them.
+ */
+
+static void call(const Quad &quad)
+{
+    const Convention *convention = conventions->find(quad.callee, proc->function);
+    unsigned numBytes = 0, i;
+
+
+    /* Push the arguments passed on the stack. */
 
-void Multiply::generate(){
-    _left->generate();
-    _right->generate();
+    if (quad.args.size() > NUM_PARAM_REGS) {
+	numBytes = align((quad.args.size() - NUM_PARAM_REGS) * PARAM_ALIGNMENT);
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
+	if (numBytes > 0)
+	    emit("subq", 0, "$" + to_string(numBytes), "%rsp");
     }
 
-    cout << tab<< "imul" << suffix(_left);
-    cout << _right << ", " << _left << endl;
+    for (i = quad.args.size(); i -- > NUM_PARAM_REGS; ) {
+	const Operand &arg = quad.args[i];
 
-    assign(_right, nullptr);
-    assign(this, _left->reg);
-}
+	numBytes += PARAM_ALIGNMENT;
 
-void Divide::generate(){
-    _left->generate();
-    _right->generate();
+	if (arg.size != 1 && location(arg) != nullptr)
+	    emit("pushq", 0, location(arg)->name());
+	else if (isImmediate(arg, SIZEOF_REG))
+	    emit("pushq", 0, immediate(arg, arg.size));
+	else {
+	    load(arg, rax, arg.size);
 
-    load(_left, rax);
-    
-    load(nullptr, rdx);
-    load(_right, rcx);
+	    if (arg.size == 1)
+		emit("movsbl", 0, rax->byte(), rax->name(4));
 
-    if(_left->type().size() == 8){
-        cout << tab<< "cqto" << endl;
-    }
-    else{
-        cout << tab << "cltd" << endl;
+	    emit("pushq", 0, rax->name());
+	}
     }
 
-    cout << tab<< "idiv" << suffix(_right) << _right->reg <<endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, rax);
 
-}
+    /* Move the arguments into their registers. */
 
-void Remainder::generate(){
-    _left->generate();
-    _right->generate();
+    if (convention != nullptr)
+	arguments(quad, convention->arguments, false);
+    else
+	arguments(quad, parameters, true);
 
-    load(_left, rax);
-    
-    load(nullptr, rdx);
-    load(_right, rcx);
 
-    if(_left->type().size() == 8){
-        cout << tab<< "cqto" << endl;
-    }
-    else{
-        cout << tab << "cltd" << endl;
-    }
+    /* Call the function and then reclaim the stack space.  We only need to
+       assign the number of floating point arguments passed in vector
+       registers to %eax if the function being called takes a variable
+       number of arguments. */
+
+    if (quad.callee->type().parameters()->variadic)
+	emit("movl", 0, "$0", "%eax");
+
+    if (convention != nullptr)
+	emit("call", 0, global_prefix + quad.callee->name() + local_suffix);
+    else
+	emit("call", 0, global_prefix + quad.callee->name());
+
+    if (numBytes > 0)
+	emit("addq", 0, "$" + to_string(numBytes), "%rsp");
 
-    cout << tab<< "idiv" << suffix(_right) << _right->reg <<endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, rdx);
+    store(rax, quad.result);
 }
 
-void LessThan::generate(){
-    _left->generate();
-    _right->generate();
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
+/*
+ * Function:	convention (private)
+ *
+ * Description:	Return the convention of the current procedure, which is
+ *		local.  It takes each argument passed in a register in the
+ *		caller-saved register allocated to its parameter, if any,
+ *		and otherwise in the usual register, unless two arguments
+ *		would then share a register.  It may change the caller-saved
+ *		registers it allocates or takes arguments in, and those any
+ *		of its callees may change.
+ */
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+static Convention convention()
+{
+    Convention result;
+    unsigned i;
 
-    cout << tab << "setl" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
-    
-}
 
-void GreaterThan::generate(){
-    _left->generate();
-    _right->generate();
+    auto clobber = [&](Register *reg) {
+	if (find(caller_saved.begin(), caller_saved.end(), reg) != caller_saved.end())
+	    if (find(result.clobbered.begin(), result.clobbered.end(), reg) == result.clobbered.end())
+		result.clobbered.push_back(reg);
+    };
+
+    for (i = 0; i < proc->params.size(); i ++) {
+	Register *reg = location(proc->params[i]);
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
+	if (find(caller_saved.begin(), caller_saved.end(), reg) == caller_saved.end())
+	    reg = parameters[i];
+
+	result.arguments.push_back(reg);
     }
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+    for (auto reg : result.arguments)
+	if (count(result.arguments.begin(), result.arguments.end(), reg) > 1) {
+	    result.arguments.assign(parameters.begin(), parameters.begin() + proc->params.size());
+	    break;
+	}
 
-    cout << tab << "setg" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
-}
+    for (auto reg : result.arguments)
+	clobber(reg);
 
-void LessOrEqual::generate(){
-    _left->generate();
-    _right->generate();
+    for (auto reg : proc->registers)
+	clobber(reg);
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
+    for (auto block : proc->blocks)
+	for (auto &quad : block->quads)
+	    if (quad.callee != nullptr) {
+		const Convention *callee = conventions->find(quad.callee, proc->function);
+		const vector<Register *> &changed = callee != nullptr ? callee->clobbered : caller_saved;
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+		for (auto reg : changed)
+		    clobber(reg);
+	    }
 
-    cout << tab << "setle" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
+    return result;
 }
 
-void GreaterOrEqual::generate(){
-    _left->generate();
-    _right->generate();
-
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+/*
+ * Function:	xmm (private)
+ *
+ * Description:	Return the text of a vector register.
+ */
 
-    cout << tab << "setge" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
+static string xmm(unsigned reg)
+{
+    return "%xmm" + to_string(reg);
 }
 
-void Equal::generate(){
-    _left->generate();
-    _right->generate();
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
+/*
+ * Function:	packed (private)
+ *
+ * Description:	Generate code for a quad on vector registers, each of whose
+ *		lanes is the size of the vector operand.  The result of an
+ *		arithmetic quad is never in the register of an operand.  A
+ *		copy broadcasts a value to each lane by repeatedly doubling
+ *		it, and a comparison of elements yields a mask of all ones
+ *		or zeros in each lane, which is then negated to get one or
+ *		zero, or incremented if the condition was inverted.
+ */
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+static void packed(const Quad &quad)
+{
+    static const string unpack[] = {"", "bw", "wd", "", "dq", "", "", "", "qdq"};
+    const Operand &result = quad.result, &left = quad.left, &right = quad.right;
+    unsigned size = result.isVector() ? result.size : right.size, n;
+    string lanes = size == 1 ? "b" : (size == 4 ? "d" : "q");
+    string target = xmm(result.reg), scratch = xmm(NUM_VECTOR_REGS - 1);
+    Condition cond = quad.condition;
+    bool inverted;
+
+
+    switch (quad.opcode) {
+    case LOAD:
+	emit("movdqu", 0, memory(quad), target);
+	break;
+
+    case STORE:
+	emit("movdqu", 0, xmm(right.reg), memory(quad));
+	break;
+
+    case COPY:
+	if (location(left) != nullptr)
+	    emit("movd", 0, location(left)->name(left.size == 8 ? 8 : 4), target);
+	else {
+	    load(left, r11, left.size);
+	    emit("movd", 0, r11->name(left.size == 8 ? 8 : 4), target);
+	}
 
-    cout << tab << "sete" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
-}
+	for (n = size; n < VECTOR_SIZE; n *= 2)
+	    emit("punpckl" + unpack[n], 0, target, target);
 
-void NotEqual::generate(){
-    _left->generate();
-    _right->generate();
+	break;
 
-    if(_left->reg == nullptr){ //if left child not in register, allocate and load
-        load(_left, getreg());
-    }
+    case ADD:
+    case SUB:
+	emit("movdqa", 0, xmm(left.reg), target);
+	emit((quad.opcode == ADD ? "padd" : "psub") + lanes, 0, xmm(right.reg), target);
+	break;
 
-    cout << tab << "cmp" << suffix(_left) << tab << _right << ", " << _left->reg << endl;
-    assign(_right, nullptr);
-    assign(_left, nullptr);
-    assign(this, getreg());
+    case NEG:
+	emit("pxor", 0, target, target);
+	emit("psub" + lanes, 0, xmm(left.reg), target);
+	break;
 
-    cout << tab << "setne" << tab << this->reg->byte() << endl;
-    cout << tab << "movzb" << suffix(this) <<tab << this->reg->byte() << ", " << this->reg << endl;
+    case SET:
+	inverted = cond == NE || cond == LE || cond == GE;
+	cond = inverted ? inverse(cond) : cond;
 
-    
-}
+	if (cond == LT) {
+	    emit("movdqa", 0, xmm(right.reg), target);
+	    emit("pcmpgt" + lanes, 0, xmm(left.reg), target);
+	} else {
+	    emit("movdqa", 0, xmm(left.reg), target);
+	    emit((cond == EQ ? "pcmpeq" : "pcmpgt") + lanes, 0, xmm(right.reg), target);
+	}
 
-void Not::generate(){
-    _expr->generate();
+	if (inverted) {
+	    emit("pcmpeqd", 0, scratch, scratch);
+	    emit("psub" + lanes, 0, scratch, target);
+	} else {
+	    emit("pxor", 0, scratch, scratch);
+	    emit("psub" + lanes, 0, target, scratch);
+	    emit("movdqa", 0, scratch, target);
+	}
+
+	break;
 
-    if(_expr->reg == nullptr){ 
-        load(_expr, getreg());
+    default:
+	assert(false);
     }
+}
 
-    cout << tab << "cmp" << suffix(_expr) << tab << "$0" << ", " << _expr->reg << endl;
-    assign(this, getreg());
 
-    cout << tab << "sete" << tab << this->reg->byte() << endl;
-    cout << tab << "movzbl" <<tab << this->reg->byte() << ", " << this->reg << endl;
-    assign(_expr, nullptr);
+/*
+ * Function:	translate (private)
+ *
+ * Description:	Generate code for a quad, which ends the given block if it
+ *		is a terminator.
+ */
+
+static void translate(const Quad &quad, const BasicBlock *block)
+{
+    const Operand &result = quad.result, &left = quad.left, &right = quad.right;
+    Register *reg = location(result);
+    unsigned size = result.size;
+    string opcode, source;
+    Condition cond;
 
-}
 
-void Negate::generate(){
-    _expr->generate();
-    if(_expr->reg == nullptr){ 
-        load(_expr, getreg());
+    if (result.isVector() || right.isVector()) {
+	packed(quad);
+	return;
     }
 
-    cout << tab << "neg" << suffix(_expr) << tab << _expr->reg << endl;
+    switch (quad.opcode) {
+    case COPY:
+	if (reg != nullptr)
+	    load(left, reg, size);
+	else if (location(left) != nullptr || isImmediate(left, size)) {
+	    stores ++;
+	    emit("mov", size, operand(left, size, nullptr), spilled(result));
+	} else {
+	    load(left, r11, size);
+	    store(r11, result);
+	}
 
-    assign(this, _expr->reg);
-    assign(_expr, nullptr);
+	break;
 
-}
+    case ADD:
+	arithmetic("add", quad, true);
+	break;
 
-void Expression::test(const Label &label, bool ifTrue) //label u wanna jump to and jump if true or false
-{
-	generate();
-	
-	if (reg == nullptr)
-		load(this, getreg()); //if not in reg, load in reg
-		
-	cout << "\tcmp" << suffix(this) << "$0, " << this << endl; 
-	cout << (ifTrue ? "\tjne\t" : "\tje\t") << label << endl; //true jumps are = 0, false jumps are neq 0
-	
-	assign(this, nullptr);
-}
+    case SUB:
+	arithmetic("sub", quad, false);
+	break;
 
-void Address::generate(){
-    Expression *pointer;
-    if(_expr->isDereference(pointer)){
-        pointer->generate();
+    case MUL:
+	arithmetic("imul", quad, true);
+	break;
 
-        if(pointer->reg == nullptr){
-            load(pointer, getreg());
-        }
+    case DIVIDE:
+    case REMAINDER:
+	divide(quad);
+	break;
 
-        assign(this, pointer->reg);
-    }
-    else{
-        assign(this, getreg());
-        cout << "\tleaq\t" << _expr << ", " << this <<endl;
-    }
+    case NEG:
+	reg = reg != nullptr ? reg : r11;
+	load(left, reg, size);
+	emit("neg", size, reg->name(size));
+	store(reg, result);
+	break;
 
-}
+    case EXTEND:
+	reg = reg != nullptr ? reg : r11;
 
-void Dereference::generate(){
-    _expr->generate();
-    if(_expr->reg == nullptr){ 
-        load(_expr, getreg());
-    }
-    cout << "\tmov" << suffix(_expr) <<tab<< "(" << _expr << ")" << ", "<< _expr <<endl;
+	if (left.isConst())
+	    load(Operand(Operand::CONST, size, left.value), reg, size);
+	else {
+	    opcode = left.size == 1 ? (size == 4 ? "movsbl" : "movsbq") : "movslq";
+	    emit(opcode, 0, operand(left, left.size, nullptr), reg->name(size));
+	}
+
+	store(reg, result);
+	break;
+
+    case LOAD:
+	reg = reg != nullptr ? reg : rax;
+	emit("mov", size, memory(quad), reg->name(size));
+	store(reg, result);
+	break;
+
+    case STORE:
+	size = right.size;
+
+	if (location(right) != nullptr || isImmediate(right, size))
+	    source = operand(right, size, nullptr);
+	else {
+	    load(right, rax, size);
+	    source = rax->name(size);
+	}
+
+	emit("mov", size, source, memory(quad));
+	break;
+
+    case ADDRESS:
+	reg = reg != nullptr ? reg : rax;
+	emit("leaq", 0, memory(quad), reg->name());
+	store(reg, result);
+	break;
+
+    case SET:
+	cond = compare(quad.condition, left, right);
+	reg = reg != nullptr ? reg : rax;
+	emit(string("set") + conditions[cond], 0, reg->byte());
+	emit("movzbl", 0, reg->byte(), reg->name(4));
+	store(reg, result);
+	break;
+
+    case CALL:
+	call(quad);
+	break;
+
+    case JUMP:
+	if (block->next[0] != following)
+	    emit("jmp", 0, text(block->next[0]->label));
+
+	break;
+
+    case BRANCH:
+	cond = compare(quad.condition, left, right);
+
+	if (block->next[1] == following)
+	    emit(string("j") + conditions[cond], 0, text(block->next[0]->label));
+	else if (block->next[0] == following)
+	    emit(string("j") + conditions[inverse(cond)], 0, text(block->next[1]->label));
+	else {
+	    emit(string("j") + conditions[cond], 0, text(block->next[0]->label));
+	    emit("jmp", 0, text(block->next[1]->label));
+	}
+
+	break;
+
+    case RET:
+	if (quad.callee != nullptr) {
+	    const Convention *convention = conventions->find(quad.callee, proc->function);
 
-    assign(this, _expr->reg);
+	    if (convention != nullptr)
+		arguments(quad, convention->arguments, false);
+	    else
+		arguments(quad, parameters, true);
 
+	    epilogue();
+
+	    if (quad.callee->type().parameters()->variadic)
+		emit("movl", 0, "$0", "%eax");
+
+	    if (convention != nullptr)
+		emit("jmp", 0, global_prefix + quad.callee->name() + local_suffix);
+	    else
+		emit("jmp", 0, global_prefix + quad.callee->name());
+
+	    break;
+	}
+
+	if (left.kind != Operand::NONE)
+	    load(left, rax, left.size);
+
+	if (following != nullptr)
+	    emit("jmp", 0, global_prefix + funcname + ".exit");
+
+	break;
+    }
 }
 
-void String::operand(ostream &ostr) const {
-    if(strings.count(_value) == 0){
-        Label l;
-        strings.insert(make_pair(_value, l));
+
+/*
+ * Function:	Function::generate
+ *
+ * Description:	Generate code for this function into the given stream,
+ *		which entails lowering it, allocating registers and space
+ *		for its temporaries and variables, then emitting our
+ *		prologue, the code for each block, and the epilogue.  The
+ *		callee-saved registers we use are saved below the local
+ *		variables.  A function that calls nothing leaves the stack
+ *		pointer alone if its frame fits in the red zone below it.
+ *		Once lowered, the function may be expanded
+ *		inline into those following it.  A local function also has
+ *		a local entry just after moving its arguments from their
+ *		usual registers into those given by its convention, which
+ *		it records once its registers are allocated, and is not
+ *		global.  The blocks are laid out
+ *		by their counts if profiled.  The counters of the
+ *		function are added to the statistics of the unit if
+ *		requested.
+ */
+
+void Function::generate(ostream &ostr)
+{
+    Timer timer(GENERATE);
+    unsigned i;
+    int offset;
+    Moves moves;
+    vector<bool> tops;
+    vector<Register *> entry;
+    bool local;
+
+
+    /* Lower the function, then assign registers and then offsets to the
+       temporaries and variables. */
+
+    proc = lower();
+    CompilerContext::current()->inlines.define(*proc);
+    proc->optimizeTailCalls();
+    proc->numberValues();
+    proc->vectorizeLoops();
+    proc->optimizeLoops(caller_saved.size() + callee_saved.size());
+    proc->selectAddresses();
+    proc->layout();
+    loads = stores = 0;
+
+    {
+	Timer timer(ALLOCATE);
+
+	conventions = &CompilerContext::current()->conventions;
+	saved = proc->allocateRegisters(caller_saved, callee_saved, parameters, *conventions);
+	offset = 0;
+	proc->allocate(offset);
     }
-    else{
-        //nothing
+
+    local = conventions->local(_id);
+    entry.assign(parameters.begin(), parameters.begin() + proc->params.size());
+
+    if (local && _id->type().parameters()->variadic)
+	conventions->define(_id);
+    else if (local) {
+	Convention convention = ::convention();
+
+	entry = convention.arguments;
+	conventions->define(_id, convention);
     }
-    ostr << strings[_value];
-}
 
-void Return::generate(){
-    _expr->generate();
-    load(_expr, rax);
-    cout <<tab << "jmp"<< tab << funcname<< ".exit" << endl;
-    assign(_expr, nullptr);
-}
+    while (offset % SIZEOF_REG != 0)
+	offset --;
 
-void Break::generate(){
-    cout <<tab << "jmp"<< tab << exits_labels.back() << endl;
-}
+    saved_offset = offset;
+    offset -= saved.size() * SIZEOF_REG;
+    offset -= align(offset);
 
-void Cast::generate(){
-    unsigned long source, target;
-    source = _expr->type().size();
-    target = _type.size();
 
-    _expr->generate();
-    if(_expr->reg == nullptr){
-        load(_expr, getreg());
+    /* Generate our prologue. */
+
+    funcname = _id->name();
+    code.emplace_back(global_prefix + funcname);
+
+    if (local) {
+	for (i = 0; i < entry.size(); i ++)
+	    moves.emplace_back(entry[i], parameters[i]);
+
+	shuffle(moves);
+	moves.clear();
+	code.emplace_back(global_prefix + funcname + local_suffix);
     }
 
-    if(source < target){
-        if(source == 1 && target == 4){
-            cout << tab << "movsbl" << tab << _expr << ", " << _expr->reg->name(target) << endl;
-        }
-        if(source == 1 && target == 8){
-            cout << tab << "movsbq" << tab << _expr << ", " << _expr->reg->name(target) << endl;
-        }
-        if(source == 4 && target == 4){
-            cout << tab << "movslq" << tab << _expr << ", " << _expr->reg->name(target) << endl;
-        }
+    emit("pushq", 0, "%rbp");
+    emit("movq", 0, "%rsp", "%rbp");
+
+    if (offset < -RED_ZONE || (offset < 0 && !isLeaf()))
+	emit("subq", 0, "$" + to_string(-offset), "%rsp");
+
+    for (i = 0; i < saved.size(); i ++)
+	emit("movq", 0, text(saved[i]), frame(saved_offset - (i + 1) * SIZEOF_REG));
+
+
+    /* Spill any register parameters, and then move the rest into their
+       registers once none of them is needed any more. */
+
+    for (i = 0; i < proc->params.size(); i ++) {
+	const Operand &param = proc->params[i];
+
+	if (location(param) != nullptr)
+	    moves.emplace_back(location(param), entry[i]);
+	else if (param.isTemp())
+	    store(entry[i], param);
+	else {
+	    unsigned size = proc->slots[param.slot].size;
+	    emit("mov", size, entry[i]->name(size), memory(param, nullptr));
+	}
     }
 
-    assign(this, _expr->reg);
-}
+    shuffle(moves);
+
+
+    /* Generate the body of this function, aligning the top of each loop,
+       which is the target of a jump or branch backward. */
+
+    tops.assign(proc->blocks.size(), false);
 
-void LogicalOr::generate(){
-    Label L1, L2;
-    _left->test(L1, true);
-    _right->test(L1, true);
+    for (auto block : proc->blocks)
+	for (i = 0; i < block->successors(); i ++)
+	    if (block->next[i]->number <= block->number)
+		tops[block->next[i]->number] = true;
 
-    if(this->reg == nullptr){
-        assign(this, getreg());
+    for (i = 0; i < proc->blocks.size(); i ++) {
+	BasicBlock *block = proc->blocks[i];
+
+	following = i + 1 < proc->blocks.size() ? proc->blocks[i + 1] : nullptr;
+	emit(block->label, tops[i] ? LOOP_ALIGNMENT : 0);
+
+	for (auto &quad : block->quads)
+	    translate(quad, block);
     }
 
-    cout << tab << "movl" << tab << "$0" << ", " << this << endl;
-    cout << "\tjmp\t" << L2 << endl;
 
+    /* Generate our epilogue. */
 
-    cout << L1 << ":" << endl;
-    cout << tab << "movl" << tab << "$1" <<", " << this << endl;
+    code.emplace_back(global_prefix + funcname + ".exit");
+    epilogue();
+    emit("ret");
 
-    cout << L2 << ":" << endl;
 
-}
+    /* Optimize and write the code for this function. */
+
+    optimize(code);
 
-void LogicalAnd::generate(){
-    Label L1, L2;
-    _left->test(L1, false);
-    _right->test(L1, false);
+    if (Timer::enabled) {
+	FunctionStatistics stats {funcname, 0, proc->spilled, loads, stores};
 
-    if(this->reg == nullptr){
-        assign(this, getreg());
+	for (auto &insn : code)
+	    if (!insn.isLabel())
+		stats.instructions ++;
+
+	CompilerContext::current()->stats.add(stats);
     }
 
-    cout << tab << "movl"<< tab << "$1" << ", " << this << endl;
-    cout << "\tjmp\t" << L2 << endl;
+    delete proc;
 
+    Timer emitting(EMIT);
 
-    cout << L1 << ":" << endl;
-    cout << tab << "movl"<< tab  << "$0" <<", " << this << endl;
+    for (auto &insn : code)
+	ostr << insn;
 
-    cout << L2 << ":" << endl;
-}
+    code.clear();
 
-void While::generate(){
-	Label loop, exit;
-    exits_labels.push_back(exit);
-	cout << loop << ":" << endl;
-	_expr->test(exit, false); //jump to exit label if false
-	_stmt->generate();
-	cout << "\tjmp\t" << loop << endl;
-	cout << exit << ":" << endl;
-    exits_labels.pop_back();
+    if (local)
+	ostr << '\n';
+    else
+	ostr << '\n' << "\t.globl\t" << global_prefix << funcname << '\n' << '\n';
 }
 
-void For::generate(){
-    Label loop, exit;
-    exits_labels.push_back(exit);
-    _init->generate();
-    cout << loop << ":" << endl;
-    _expr->test(exit, false); 
-    _stmt->generate();
-    _incr->generate();
-    cout << "\tjmp\t" << loop << endl;
-	cout << exit << ":" << endl;
-    exits_labels.pop_back();
-}
 
-void If::generate(){
-    Label skip, exit;
-    _expr->test(skip, false); 
-    _thenStmt->generate();
-    cout << "\tjmp\t" << exit << endl;
-    cout << skip << ":" << endl;
-    if(_elseStmt != nullptr){
-        _elseStmt->generate();
+/*
+ * Function:	generateGlobals
+ *
+ * Description:	Generate code for any global variable declarations, and
+ *		the counters of the unit if instrumenting, and then for the
+ *		string literals in the order of their labels.
+ *		Only the literals used by live functions are needed, and
+ *		when pruning, only the live globals too.
+ */
+
+void generateGlobals(Scope *scope, bool prune)
+{
+    Timer timer(EMIT);
+    CompilerContext *context = CompilerContext::current();
+    const Symbols &symbols = scope->symbols();
+    Emitter &emitter = context->emitter;
+    unsigned i = 0;
+
+
+    for (auto symbol : symbols)
+	if (!symbol->type().isFunction())
+	    if (!prune || context->graph.live(symbol)) {
+		emitter << "\t.comm\t" << global_prefix << symbol->name();
+		emitter << ", " << symbol->type().size() << '\n';
+	    }
+
+    if (context->counters != nullptr)
+	context->counters->write(emitter);
+
+    emitter << "\t.section\t.rodata" << '\n';
+
+    for (auto &value : context->strings.strings()) {
+	if (context->graph.live(i)) {
+	    emitter << string_prefix << i << ":\t.asciz\t\"";
+	    emitter << escapeString(value) << "\"" << '\n';
+	}
+
+	i ++;
     }
-    cout << exit << ":" << endl;
-}
\ No newline at end of file
+
+    emitter.flush();
+
+}
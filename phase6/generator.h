@@ -10,6 +10,6 @@
 # define GENERATOR_H
 # include "Scope.h"
 
-void generateGlobals(Scope *scope);
+void generateGlobals(Scope *scope, bool prune);
 
 # endif /* GENERATOR_H */
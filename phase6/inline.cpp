@@ -0,0 +1,260 @@
+/*
+ * File:	inline.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		inline expansion.  The actual classes are declared
+ *		elsewhere, mainly in IR.h.
+ *
+ *		A call to a small function defined earlier is replaced by a
+ *		copy of the procedure of the callee, with its temporaries
+ *		and stack slots renumbered into those of the caller.  The
+ *		block containing the call is split after the call, the
+ *		arguments are copied into the parameters, and each return
+ *		becomes a copy into the result of the call and a jump to
+ *		the rest of the block.  The procedures of the callees have
+ *		already had their own calls expanded, so the copies are
+ *		not expanded again, and a procedure can only grow by a
+ *		bounded amount.
+ *
+ *		If the caller was profiled, a call never executed is not
+ *		expanded, and a hot call may expand a larger callee.  Each
+ *		copied block is given the count of the original, scaled by
+ *		how often this call was executed out of all the calls of
+ *		the callee.
+ */
+
+# include "IR.h"
+# include "Inlines.h"
+# include "Profile.h"
+# include "context.h"
+
+using namespace std;
+
+# define GROWTH_BUDGET 256
+
+
+/*
+ * Function:	splice (private)
+ *
+ * Description:	Expand the given call to the given callee at the end of
+ *		the given block, continuing afterward with the given block.
+ *		The copied blocks are appended to the list of blocks.
+ */
+
+static void splice(Procedure &proc, const Quad &call, const Procedure &callee,
+	BasicBlock *block, BasicBlock *after, vector<BasicBlock *> &blocks)
+{
+    vector<Operand> temps, slots;
+    vector<BasicBlock *> copies;
+    unsigned long entry = callee.blocks[0]->count;
+    unsigned i;
+
+
+    for (i = 0; i < callee.temps.size(); i ++)
+	temps.push_back(proc.temp(callee.temps[i], callee.named[i]));
+
+    for (auto &slot : callee.slots)
+	slots.push_back(proc.slot(slot.size, slot.alignment));
+
+    for (i = 0; i < callee.blocks.size(); i ++)
+	copies.push_back(proc.block());
+
+    auto rename = [&](Operand &operand) {
+	if (operand.kind == Operand::TEMP)
+	    operand = temps[operand.temp];
+	else if (operand.kind == Operand::SLOT)
+	    operand = slots[operand.slot];
+    };
+
+
+    /* Copy the arguments into the parameters, which are either
+       temporaries or stack slots if their addresses are taken. */
+
+    for (i = 0; i < callee.params.size(); i ++) {
+	Operand param = callee.params[i];
+
+	rename(param);
+
+	if (param.isTemp())
+	    block->quads.push_back(Quad(COPY, param, call.args[i]));
+	else
+	    block->quads.push_back(Quad(STORE, Operand(), param, call.args[i]));
+    }
+
+    block->quads.push_back(Quad(JUMP));
+    block->next[0] = copies[0];
+    block->next[1] = nullptr;
+
+
+    /* Copy the blocks of the callee, replacing each return. */
+
+    for (auto original : callee.blocks) {
+	BasicBlock *copy = copies[original->number];
+
+	if (callee.profiled && entry > 0)
+	    copy->count = (double) original->count * block->count / entry;
+	else
+	    copy->count = block->count;
+
+	for (auto quad : original->quads) {
+	    if (quad.opcode == RET) {
+		if (call.result.kind != Operand::NONE) {
+		    if (quad.left.kind != Operand::NONE)
+			rename(quad.left);
+		    else
+			quad.left = proc.constant(0, call.result.size);
+
+		    copy->quads.push_back(Quad(COPY, call.result, quad.left));
+		}
+
+		copy->quads.push_back(Quad(JUMP));
+		copy->next[0] = after;
+		continue;
+	    }
+
+	    rename(quad.result);
+	    rename(quad.left);
+	    rename(quad.right);
+
+	    for (auto &arg : quad.args)
+		rename(arg);
+
+	    copy->quads.push_back(quad);
+	}
+
+	for (i = 0; i < original->successors(); i ++)
+	    copy->next[i] = copies[original->next[i]->number];
+
+	blocks.push_back(copy);
+    }
+}
+
+
+/*
+ * Function:	Procedure::size
+ *
+ * Description:	Return the number of quads in this procedure.
+ */
+
+unsigned Procedure::size() const
+{
+    unsigned count = 0;
+
+
+    for (auto block : blocks)
+	count += block->quads.size();
+
+    return count;
+}
+
+
+/*
+ * Function:	Procedure::copy
+ *
+ * Description:	Return a copy of this procedure, with its own blocks.
+ */
+
+Procedure *Procedure::copy() const
+{
+    Procedure *proc = new Procedure(function);
+    unsigned i;
+
+
+    for (auto block : proc->blocks)
+	delete block;
+
+    proc->blocks.clear();
+    proc->temps = temps;
+    proc->named = named;
+    proc->slots = slots;
+    proc->params = params;
+    proc->profiled = profiled;
+
+    for (auto block : blocks) {
+	proc->blocks.push_back(proc->block());
+	proc->blocks.back()->number = block->number;
+	proc->blocks.back()->count = block->count;
+	proc->blocks.back()->quads = block->quads;
+    }
+
+    for (auto block : blocks) {
+	BasicBlock *copy = proc->blocks[block->number];
+
+	for (i = 0; i < block->successors(); i ++)
+	    copy->next[i] = proc->blocks[block->next[i]->number];
+
+	for (auto pred : block->preds)
+	    copy->preds.push_back(proc->blocks[pred->number]);
+    }
+
+    proc->current = proc->blocks.back();
+    return proc;
+}
+
+
+/*
+ * Function:	Procedure::expand
+ *
+ * Description:	Expand inline the calls to the functions in the given
+ *		table, until the procedure has grown by our budget.  The
+ *		graph is linked again if anything was expanded.
+ */
+
+void Procedure::expand(const Inlines &inlines)
+{
+    const Profile *profile = CompilerContext::current()->profile;
+    vector<BasicBlock *> expanded;
+    unsigned i, growth = 0;
+    const Procedure *callee;
+    bool changed = false, hot;
+
+
+    for (auto block : blocks) {
+	expanded.push_back(block);
+
+	for (i = 0; i < block->quads.size(); ) {
+	    const Quad &quad = block->quads[i];
+
+	    if (quad.opcode != CALL || growth >= GROWTH_BUDGET ||
+		    (profiled && block->count == 0)) {
+		i ++;
+		continue;
+	    }
+
+	    hot = profiled && profile->hot(block->count);
+	    callee = inlines.find(quad.callee, function, hot);
+
+	    if (callee == nullptr || growth + callee->size() > GROWTH_BUDGET) {
+		i ++;
+		continue;
+	    }
+
+	    BasicBlock *after = this->block();
+	    Quad call = quad;
+
+	    after->count = block->count;
+	    after->quads.assign(block->quads.begin() + i + 1, block->quads.end());
+	    after->next[0] = block->next[0];
+	    after->next[1] = block->next[1];
+	    block->quads.erase(block->quads.begin() + i, block->quads.end());
+
+	    splice(*this, call, *callee, block, after, expanded);
+	    expanded.push_back(after);
+	    growth += callee->size();
+	    changed = true;
+
+	    block = after;
+	    i = 0;
+	}
+    }
+
+    if (changed) {
+	blocks = expanded;
+
+	for (i = 0; i < blocks.size(); i ++)
+	    blocks[i]->number = i;
+
+	current = blocks.back();
+	link();
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * File:	intern.cpp
+ *
+ * Description:	This file contains the function definitions for interning
+ *		names.  The interned names are kept in an open addressing
+ *		hash table using linear probing.  We store the full hash
+ *		value with each entry so that we rarely need to compare the
+ *		characters of two names, and so that growing the table
+ *		doesn't require rehashing any names.
+ *
+ *		Each thread has its own table, so that threads compiling
+ *		different translation units need not synchronize.  A name
+ *		is only ever compared against names from the same unit.
+ */
+
+# include <vector>
+# include <cstring>
+# include "intern.h"
+
+using namespace std;
+
+struct Entry {
+    size_t hash;
+    Name name;
+};
+
+static thread_local vector<Entry> table(1024);
+static thread_local size_t numNames;
+
+
+/*
+ * Function:	fnv1a (private)
+ *
+ * Description:	Return the FNV-1a hash of the given characters.
+ */
+
+static size_t fnv1a(const char *s, size_t length)
+{
+    size_t h = 14695981039346656037UL;
+
+    while (length -- > 0) {
+	h ^= (unsigned char) *s ++;
+	h *= 1099511628211UL;
+    }
+
+    return h;
+}
+
+
+/*
+ * Function:	grow (private)
+ *
+ * Description:	Double the size of the table and reinsert all entries.
+ */
+
+static void grow()
+{
+    vector<Entry> old(table.size() * 2);
+    size_t mask = old.size() - 1, i;
+
+
+    table.swap(old);		/* the old entries are now in old */
+
+    for (auto &entry : old)
+	if (entry.name != nullptr) {
+	    for (i = entry.hash & mask; table[i].name != nullptr; i = (i + 1) & mask)
+		continue;
+
+	    table[i] = entry;
+	}
+}
+
+
+/*
+ * Function:	intern
+ *
+ * Description:	Return the interned name with the given characters,
+ *		creating it if this is the first time we have seen it.
+ */
+
+Name intern(const char *s, size_t length)
+{
+    size_t h = fnv1a(s, length), mask = table.size() - 1, i;
+
+
+    for (i = h & mask; table[i].name != nullptr; i = (i + 1) & mask)
+	if (table[i].hash == h && table[i].name->size() == length)
+	    if (memcmp(table[i].name->data(), s, length) == 0)
+		return table[i].name;
+
+    table[i].hash = h;
+    table[i].name = new string(s, length);
+
+    if (++ numNames * 2 > table.size()) {
+	Name name = table[i].name;
+	grow();
+	return name;
+    }
+
+    return table[i].name;
+}
+
+
+/*
+ * Function:	intern
+ *
+ * Description:	Return the interned name for the given string.
+ */
+
+Name intern(const string &s)
+{
+    return intern(s.data(), s.size());
+}
@@ -0,0 +1,21 @@
+/*
+ * File:	intern.h
+ *
+ * Description:	This file contains the type and function declarations for
+ *		interning names.  Each distinct name is stored exactly once
+ *		and is never deallocated, so a name can be referred to by a
+ *		pointer to its single copy.  Two interned names are then
+ *		equal if and only if they are the same pointer, which makes
+ *		comparing and hashing names trivial.
+ */
+
+# ifndef INTERN_H
+# define INTERN_H
+# include <string>
+
+typedef const std::string *Name;
+
+Name intern(const char *s, size_t length);
+Name intern(const std::string &s);
+
+# endif /* INTERN_H */
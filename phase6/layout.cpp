@@ -0,0 +1,227 @@
+/*
+ * File:	layout.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		jump threading, profiling, and laying out the blocks of a
+ *		procedure.  The actual classes are declared elsewhere,
+ *		mainly in IR.h.
+ *
+ *		Lowering leaves behind many blocks that just jump to
+ *		another block, such as the join of an if statement at the
+ *		end of another, or the exit of a loop at the end of a loop.
+ *		Each jump or branch to such a block is retargeted to the end
+ *		of the chain of jumps, so that the blocks are discarded.
+ *
+ *		A procedure is instrumented and given its counts just after
+ *		it is lowered, so its blocks are the same in both cases, and
+ *		so that a copy expanded inline counts the blocks of the
+ *		callee.  The optimizations then keep an estimate of the
+ *		count of each block they create.
+ *
+ *		Given the counts, the blocks are laid out greedily, with
+ *		each block followed by the successor not yet placed along
+ *		its hottest edge, so that the hot paths fall through.  When
+ *		there is no such successor, the earliest block executed but
+ *		not yet placed follows, so the blocks never executed are
+ *		moved to the end.
+ *
+ *		The count of an edge is that of its target if the target
+ *		has no other predecessor, which is so for both arms of most
+ *		branches as lowered, and otherwise what remains of the
+ *		count of its source once the other edge is taken away.
+ */
+
+# include "machine.h"
+# include "Profile.h"
+# include "IR.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Procedure::threadJumps
+ *
+ * Description:	Retarget each jump or branch to a block that just jumps
+ *		elsewhere, linking the graph again if anything changed.  A
+ *		branch whose targets become the same is just a jump.  A
+ *		chain of jumps that loops forever is left alone.
+ */
+
+void Procedure::threadJumps()
+{
+    unsigned i, n;
+    bool changed = false;
+
+
+    /* Return whether the given block just jumps to another block. */
+
+    auto empty = [](const BasicBlock *block) {
+	return block->quads.size() == 1 && block->quads[0].opcode == JUMP;
+    };
+
+    for (auto block : blocks) {
+	for (i = 0; i < block->successors(); i ++) {
+	    BasicBlock *target = block->next[i];
+
+	    for (n = 0; n < blocks.size() && empty(target); n ++)
+		target = target->next[0];
+
+	    if (n < blocks.size() && target != block->next[i]) {
+		block->next[i] = target;
+		changed = true;
+	    }
+	}
+
+	if (block->successors() == 2 && block->next[0] == block->next[1]) {
+	    block->quads.back() = Quad(JUMP);
+	    block->next[1] = nullptr;
+	    changed = true;
+	}
+    }
+
+    if (changed)
+	link();
+}
+
+
+/*
+ * Function:	Procedure::instrument
+ *
+ * Description:	Instrument this procedure to increment the counter of each
+ *		block on entry to the block, using the given counters.
+ */
+
+void Procedure::instrument(Counters &counters)
+{
+    Operand base(counters.counters(function, blocks.size()));
+    Operand offset, first, second, value, sum;
+
+
+    for (auto block : blocks) {
+	offset = constant(block->number * SIZEOF_LONG, SIZEOF_PTR);
+	first = temp(SIZEOF_PTR);
+	second = temp(SIZEOF_PTR);
+	value = temp(SIZEOF_LONG);
+	sum = temp(SIZEOF_LONG);
+
+	block->quads.insert(block->quads.begin(), {
+	    Quad(ADD, first, base, offset),
+	    Quad(LOAD, value, first),
+	    Quad(ADD, sum, value, constant(1, SIZEOF_LONG)),
+	    Quad(ADD, second, base, offset),
+	    Quad(STORE, Operand(), second, sum),
+	});
+    }
+}
+
+
+/*
+ * Function:	Procedure::annotate
+ *
+ * Description:	Give each block of this procedure its count in the given
+ *		profile, if the profile has the counts of this procedure.
+ */
+
+void Procedure::annotate(const Profile &profile)
+{
+    const vector<unsigned long> *counts = profile.find(function->name());
+
+
+    if (counts == nullptr || counts->size() != blocks.size())
+	return;
+
+    for (auto block : blocks)
+	block->count = (*counts)[block->number];
+
+    profiled = true;
+}
+
+
+/*
+ * Function:	Procedure::layout
+ *
+ * Description:	Lay out the blocks of this procedure using their counts,
+ *		if it was profiled.  An edge never taken is only followed
+ *		if its source was never executed either.  Of two edges
+ *		taken equally often, the one to the block placed first
+ *		originally is followed.
+ */
+
+void Procedure::layout()
+{
+    vector<BasicBlock *> order;
+    vector<bool> placed(blocks.size(), false);
+    BasicBlock *block = blocks[0], *best;
+    unsigned long count, most;
+    unsigned i, warm = 0, cold = 0;
+
+
+    /* Return the count of the given edge from the given block. */
+
+    auto edge = [](const BasicBlock *block, unsigned i) {
+	const BasicBlock *target = block->next[i], *other;
+
+
+	if (target->preds.size() == 1 || block->successors() == 1)
+	    return min(target->count, block->count);
+
+	other = block->next[1 - i];
+
+	if (other->preds.size() == 1 && other != target)
+	    return block->count - min(other->count, block->count);
+
+	return min(target->count, block->count);
+    };
+
+
+    if (!profiled)
+	return;
+
+    for (i = 0; i < blocks.size(); i ++)
+	blocks[i]->number = i;
+
+    while (block != nullptr) {
+	placed[block->number] = true;
+	order.push_back(block);
+	best = nullptr;
+	most = 0;
+
+	for (i = 0; i < block->successors(); i ++) {
+	    BasicBlock *next = block->next[i];
+
+	    if (placed[next->number])
+		continue;
+
+	    count = edge(block, i);
+
+	    if (best == nullptr || count > most ||
+		    (count == most && next->number < best->number)) {
+		best = next;
+		most = count;
+	    }
+	}
+
+	if (best != nullptr && (most > 0 || block->count == 0)) {
+	    block = best;
+	    continue;
+	}
+
+	while (warm < blocks.size() && (placed[warm] || blocks[warm]->count == 0))
+	    warm ++;
+
+	while (cold < blocks.size() && placed[cold])
+	    cold ++;
+
+	if (warm < blocks.size())
+	    block = blocks[warm];
+	else if (cold < blocks.size())
+	    block = blocks[cold];
+	else
+	    block = nullptr;
+    }
+
+    blocks = order;
+
+    for (i = 0; i < blocks.size(); i ++)
+	blocks[i]->number = i;
+}
@@ -591,11 +591,17 @@ char *yytext;
  *		Extra functionality:
  *		- checking for out of range integer and real literals
  *		- checking for invalid string and character literals
+ *		- interning identifiers
+ *		- reading all the tokens of a translation unit at once
+ *		- scanning the source text in place
  */
 
 # include <cerrno>
 # include <cstdlib>
 # include <iostream>
+# include <mutex>
+# include "context.h"
+# include "Source.h"
 # include "tokens.h"
 # include "string.h"
 # include "lexer.h"
@@ -610,11 +616,12 @@ char *yytext;
 
 using namespace std;
 
-int numerrors = 0;
+Name yyname;
 static void checkInt(), checkString(), checkChar();
-static void ignoreComment();
-#line 616 "<stdout>"
-#line 617 "<stdout>"
+static void ignoreComment(), complain(const string &str);
+static bool atEnd();
+#line 623 "<stdout>"
+#line 624 "<stdout>"
 
 #define INITIAL 0
 
@@ -829,10 +836,10 @@ YY_DECL
 		}
 
 	{
-#line 36 "lexer.l"
+#line 43 "lexer.l"
 
 
-#line 835 "<stdout>"
+#line 842 "<stdout>"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -901,261 +908,261 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 38 "lexer.l"
+#line 45 "lexer.l"
 {ignoreComment();}
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 40 "lexer.l"
+#line 47 "lexer.l"
 {return AUTO;}
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 41 "lexer.l"
+#line 48 "lexer.l"
 {return BREAK;}
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 42 "lexer.l"
+#line 49 "lexer.l"
 {return CASE;}
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 43 "lexer.l"
+#line 50 "lexer.l"
 {return CHAR;}
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 44 "lexer.l"
+#line 51 "lexer.l"
 {return CONST;}
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 45 "lexer.l"
+#line 52 "lexer.l"
 {return CONTINUE;}
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 46 "lexer.l"
+#line 53 "lexer.l"
 {return DEFAULT;}
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 47 "lexer.l"
+#line 54 "lexer.l"
 {return DO;}
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 48 "lexer.l"
+#line 55 "lexer.l"
 {return DOUBLE;}
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 49 "lexer.l"
+#line 56 "lexer.l"
 {return ELSE;}
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 50 "lexer.l"
+#line 57 "lexer.l"
 {return ENUM;}
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 51 "lexer.l"
+#line 58 "lexer.l"
 {return EXTERN;}
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 52 "lexer.l"
+#line 59 "lexer.l"
 {return FLOAT;}
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 53 "lexer.l"
+#line 60 "lexer.l"
 {return FOR;}
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 54 "lexer.l"
+#line 61 "lexer.l"
 {return GOTO;}
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 55 "lexer.l"
+#line 62 "lexer.l"
 {return IF;}
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 56 "lexer.l"
+#line 63 "lexer.l"
 {return INT;}
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 57 "lexer.l"
+#line 64 "lexer.l"
 {return LONG;}
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 58 "lexer.l"
+#line 65 "lexer.l"
 {return REGISTER;}
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 59 "lexer.l"
+#line 66 "lexer.l"
 {return RETURN;}
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 60 "lexer.l"
+#line 67 "lexer.l"
 {return SHORT;}
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 61 "lexer.l"
+#line 68 "lexer.l"
 {return SIGNED;}
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 62 "lexer.l"
+#line 69 "lexer.l"
 {return SIZEOF;}
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
-#line 63 "lexer.l"
+#line 70 "lexer.l"
 {return STATIC;}
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 64 "lexer.l"
+#line 71 "lexer.l"
 {return STRUCT;}
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 65 "lexer.l"
+#line 72 "lexer.l"
 {return SWITCH;}
 	YY_BREAK
 case 28:
 YY_RULE_SETUP
-#line 66 "lexer.l"
+#line 73 "lexer.l"
 {return TYPEDEF;}
 	YY_BREAK
 case 29:
 YY_RULE_SETUP
-#line 67 "lexer.l"
+#line 74 "lexer.l"
 {return UNION;}
 	YY_BREAK
 case 30:
 YY_RULE_SETUP
-#line 68 "lexer.l"
+#line 75 "lexer.l"
 {return UNSIGNED;}
 	YY_BREAK
 case 31:
 YY_RULE_SETUP
-#line 69 "lexer.l"
+#line 76 "lexer.l"
 {return VOID;}
 	YY_BREAK
 case 32:
 YY_RULE_SETUP
-#line 70 "lexer.l"
+#line 77 "lexer.l"
 {return VOLATILE;}
 	YY_BREAK
 case 33:
 YY_RULE_SETUP
-#line 71 "lexer.l"
+#line 78 "lexer.l"
 {return WHILE;}
 	YY_BREAK
 case 34:
 YY_RULE_SETUP
-#line 73 "lexer.l"
+#line 80 "lexer.l"
 {return OR;}
 	YY_BREAK
 case 35:
 YY_RULE_SETUP
-#line 74 "lexer.l"
+#line 81 "lexer.l"
 {return AND;}
 	YY_BREAK
 case 36:
 YY_RULE_SETUP
-#line 75 "lexer.l"
+#line 82 "lexer.l"
 {return EQL;}
 	YY_BREAK
 case 37:
 YY_RULE_SETUP
-#line 76 "lexer.l"
+#line 83 "lexer.l"
 {return NEQ;}
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 77 "lexer.l"
+#line 84 "lexer.l"
 {return LEQ;}
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 78 "lexer.l"
+#line 85 "lexer.l"
 {return GEQ;}
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 79 "lexer.l"
+#line 86 "lexer.l"
 {return INC;}
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 80 "lexer.l"
+#line 87 "lexer.l"
 {return DEC;}
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
-#line 81 "lexer.l"
+#line 88 "lexer.l"
 {return ARROW;}
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 82 "lexer.l"
+#line 89 "lexer.l"
 {return ELLIPSIS;}
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 83 "lexer.l"
+#line 90 "lexer.l"
 {return yytext[0];}
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 85 "lexer.l"
-{return ID;}
+#line 92 "lexer.l"
+{yyname = intern(yytext, yyleng); return ID;}
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 87 "lexer.l"
+#line 94 "lexer.l"
 {checkInt(); return NUM;}
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 88 "lexer.l"
+#line 95 "lexer.l"
 {checkString(); return STRING;}
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 89 "lexer.l"
+#line 96 "lexer.l"
 {checkChar(); return CHARACTER;}
 	YY_BREAK
 case 49:
 /* rule 49 can match eol */
 YY_RULE_SETUP
-#line 91 "lexer.l"
+#line 98 "lexer.l"
 {/* ignored */}
 	YY_BREAK
 case 50:
 YY_RULE_SETUP
-#line 92 "lexer.l"
+#line 99 "lexer.l"
 {/* ignored */}
 	YY_BREAK
 case 51:
 YY_RULE_SETUP
-#line 94 "lexer.l"
+#line 101 "lexer.l"
 ECHO;
 	YY_BREAK
-#line 1158 "<stdout>"
+#line 1165 "<stdout>"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -2131,7 +2138,7 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 94 "lexer.l"
+#line 101 "lexer.l"
 
 
 /*
@@ -2145,17 +2152,31 @@ static void ignoreComment()
     int c1, c2;
 
 
-    while ((c1 = yyinput()) != 0) {
+    while (!atEnd() && (c1 = yyinput()) != 0) {
 	while (c1 == '*') {
-	    if ((c2 = yyinput()) == '/' || c2 == 0)
+	    if (atEnd() || (c2 = yyinput()) == '/' || c2 == 0)
 		return;
 
 	    c1 = c2;
 	}
     }
 
-    if (c1 == 0)
-	report("unterminated comment");
+    complain("unterminated comment");
+}
+
+
+/*
+ * Function:	atEnd
+ *
+ * Description:	Return whether the scanner has reached the end of the
+ *		source.  Reading past the end of a buffer being scanned in
+ *		place would make flex try to refill it from the input file,
+ *		which we never open.
+ */
+
+static bool atEnd()
+{
+    return (yy_c_buf_p) >= &YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars)];
 }
 
 
@@ -2171,7 +2192,7 @@ static void checkInt()
     strtol(yytext, NULL, 0);
 
     if (errno != 0)
-	report("integer constant too large");
+	complain("integer constant too large");
 }
 
 
@@ -2184,15 +2205,14 @@ static void checkInt()
 static void checkString()
 {
     bool invalid, overflow;
-    string s(yytext + 1, yyleng - 2);
 
 
-    s = parseString(s, invalid, overflow);
+    parseString(string_view(yytext + 1, yyleng - 2), invalid, overflow);
 
     if (invalid)
-	report("unknown escape sequence in string constant");
+	complain("unknown escape sequence in string constant");
     else if (overflow)
-	report("escape sequence out of range in string constant");
+	complain("escape sequence out of range in string constant");
 }
 
 
@@ -2205,37 +2225,66 @@ static void checkString()
 static void checkChar()
 {
     bool invalid, overflow;
-    string s(yytext + 1, yyleng - 2);
+    string s;
 
 
-    s = parseString(s, invalid, overflow);
+    s = parseString(string_view(yytext + 1, yyleng - 2), invalid, overflow);
 
     if (invalid)
-	report("unknown escape sequence in character constant");
+	complain("unknown escape sequence in character constant");
     else if (overflow)
-	report("escape sequence out of range in character constant");
+	complain("escape sequence out of range in character constant");
     else if (s.size() > 1)
-	report("multi-character character constant");
+	complain("multi-character character constant");
 }
 
 
 /*
- * Function:	report
+ * Function:	complain
  *
- * Description:	Report an error to the standard error prefixed with the
- *		line number.  We'll be using this a lot later with an
- *		optional string argument, but C++'s stupid streams don't do
- *		positional arguments, so we actually resort to snprintf.
- *		You just can't beat C for doing things down and dirty.
+ * Description:	Report an invalid token at the current line of the input.
  */
 
-void report(const string &str, const string &arg)
+static void complain(const string &str)
 {
-    char buf[1000];
+    CompilerContext::current()->lineno = yylineno;
+    report(str);
+}
 
 
-    snprintf(buf, sizeof(buf), str.c_str(), arg.c_str());
-    cerr << "line " << yylineno << ": " << buf << endl;
-    numerrors ++;
-}
+/*
+ * Function:	tokenize
+ *
+ * Description:	Read all the tokens of the current translation unit from
+ *		the given source.  The source is scanned in place, and the
+ *		text of each token is a span of the source rather than a
+ *		copy.  The scanner generated by flex is not reentrant, so
+ *		only one translation unit at a time can be read, while
+ *		other threads compile the units already read.
+ */
+
+void tokenize(Source &source)
+{
+    static mutex scanner;
+    lock_guard<mutex> guard(scanner);
+    CompilerContext *context = CompilerContext::current();
+    YY_BUFFER_STATE buffer;
+    int token;
 
+
+    buffer = yy_scan_buffer(source.text(), source.size() + 2);
+    yylineno = 1;
+
+    do {
+	token = yylex();
+
+	if (token == ID)
+	    context->tokens.push_back({token, (unsigned) yylineno, yyname, {}});
+	else if (token == DONE)
+	    context->tokens.push_back({token, (unsigned) yylineno, nullptr, {}});
+	else
+	    context->tokens.push_back({token, (unsigned) yylineno, nullptr, {yytext, (size_t) yyleng}});
+    } while (token != DONE);
+
+    yy_delete_buffer(buffer);
+}
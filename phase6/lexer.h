@@ -1,18 +1,20 @@
 /*
  * File:	lexer.h
  *
- * Description:	This file contains the public function and variable
- *		declarations for the lexical analyzer for Simple C.
+ * Description:	This file contains the public function declarations for
+ *		the lexical analyzer for Simple C.  The analyzer is either
+ *		the flex scanner in lexer.l or the hand-written scanner in
+ *		scanner.cpp, selected when building.  Errors are reported
+ *		with the context of the translation unit, by both.
  */
 
 # ifndef LEXER_H
 # define LEXER_H
 # include <string>
 
-extern char *yytext;
-extern int yylineno, numerrors;
+class Source;
 
-extern int yylex();
+extern void tokenize(Source &source);
 extern void report(const std::string &str, const std::string &arg = "");
 
 # endif /* LEXER_H */
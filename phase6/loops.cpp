@@ -0,0 +1,681 @@
+/*
+ * File:	loops.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		optimizing the loops of a procedure.  The actual classes
+ *		are declared elsewhere, mainly in IR.h.
+ *
+ *		Since Simple C has no goto statement, every flow graph is
+ *		reducible, and so every edge to a block on the stack of a
+ *		depth-first search is the back edge of a natural loop.
+ *		Each loop is first given a preheader, a block through which
+ *		it is always entered, and the loops are then optimized from
+ *		the innermost outwards, so that code hoisted out of an inner
+ *		loop can then be hoisted out of its enclosing loop.
+ *
+ *		Loop-invariant code motion moves a quad into the preheader
+ *		if none of its operands is computed in the loop and its
+ *		result is an unnamed temporary, which is computed only
+ *		once.  Such a quad has no effect other than computing its
+ *		result, except for a load, which is only moved if the loop
+ *		has no stores or calls and the address is that of a stack
+ *		slot or a global, which is always valid.
+ *
+ *		Strength reduction finds the named temporaries incremented
+ *		by a constant exactly once in the loop, which are the basic
+ *		induction variables, and the temporaries computed from them
+ *		by extension, multiplication by a constant, and addition of
+ *		an invariant.  Each such computation that needs an extension
+ *		or multiplication is replaced by a new named temporary,
+ *		which is computed in the preheader and then incremented
+ *		along with its basic induction variable.  Indexing an array
+ *		thus becomes a pointer incremented by the element size.
+ */
+
+# include <algorithm>
+# include <unordered_map>
+# include "IR.h"
+
+using namespace std;
+
+struct Loop {
+    BasicBlock *header;
+    vector<BasicBlock *> blocks;
+    vector<bool> contains;
+};
+
+struct Induction {
+    unsigned basic;
+    long factor;
+    Operand addend;
+    bool reduce;
+};
+
+struct Reduction {
+    Induction induction;
+    Operand temp;
+};
+
+
+/*
+ * Function:	findLoops (private)
+ *
+ * Description:	Find the natural loops of a procedure, ordered so that an
+ *		inner loop precedes the loops enclosing it.  The blocks of
+ *		each loop are kept in the order in which they are laid out.
+ */
+
+static void findLoops(const Procedure &proc, vector<Loop> &loops)
+{
+    unsigned n = proc.blocks.size(), i;
+    vector<unsigned char> state(n, 0);
+    vector<pair<BasicBlock *, unsigned>> stack;
+    vector<vector<BasicBlock *>> latches(n);
+
+
+    /* Search the graph depth first, where a state of one means that a
+       block is on the stack and two means that it is finished. */
+
+    stack.emplace_back(proc.blocks[0], 0);
+    state[0] = 1;
+
+    while (!stack.empty()) {
+	BasicBlock *block = stack.back().first;
+
+	if (stack.back().second == block->successors()) {
+	    state[block->number] = 2;
+	    stack.pop_back();
+	    continue;
+	}
+
+	BasicBlock *next = block->next[stack.back().second ++];
+
+	if (state[next->number] == 1)
+	    latches[next->number].push_back(block);
+	else if (state[next->number] == 0) {
+	    state[next->number] = 1;
+	    stack.emplace_back(next, 0);
+	}
+    }
+
+
+    /* The body of a loop is every block that reaches one of its back
+       edges without passing through its header. */
+
+    loops.clear();
+
+    for (i = 0; i < n; i ++)
+	if (!latches[i].empty()) {
+	    vector<BasicBlock *> work = latches[i];
+	    Loop loop;
+
+	    loop.header = proc.blocks[i];
+	    loop.contains.assign(n, false);
+	    loop.contains[i] = true;
+
+	    while (!work.empty()) {
+		BasicBlock *block = work.back();
+		work.pop_back();
+
+		if (!loop.contains[block->number]) {
+		    loop.contains[block->number] = true;
+		    work.insert(work.end(), block->preds.begin(), block->preds.end());
+		}
+	    }
+
+	    for (auto block : proc.blocks)
+		if (loop.contains[block->number])
+		    loop.blocks.push_back(block);
+
+	    loops.push_back(loop);
+	}
+
+    stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+	return a.blocks.size() < b.blocks.size();
+    });
+}
+
+
+/*
+ * Function:	preheader (private)
+ *
+ * Description:	Return the preheader of a loop, which is its only
+ *		predecessor outside the loop if that block has no other
+ *		successor, and null otherwise.
+ */
+
+static BasicBlock *preheader(const Loop &loop)
+{
+    BasicBlock *result = nullptr;
+
+
+    for (auto pred : loop.header->preds)
+	if (!loop.contains[pred->number]) {
+	    if (result != nullptr)
+		return nullptr;
+
+	    result = pred;
+	}
+
+    return result != nullptr && result->successors() == 1 ? result : nullptr;
+}
+
+
+/*
+ * Function:	addPreheaders (private)
+ *
+ * Description:	Give every loop without one a preheader, placed just before
+ *		its header, and return whether any were added.  The
+ *		preheader is entered as often as the header is entered from
+ *		outside the loop, which is at most how often the blocks
+ *		jumping there were executed.
+ */
+
+static bool addPreheaders(Procedure &proc, const vector<Loop> &loops)
+{
+    vector<BasicBlock *> blocks, added(proc.blocks.size(), nullptr);
+    bool changed = false;
+    unsigned i;
+
+
+    for (auto &loop : loops) {
+	if (preheader(loop) != nullptr)
+	    continue;
+
+	BasicBlock *block = proc.block();
+
+	block->quads.emplace_back(JUMP);
+	block->next[0] = loop.header;
+
+	for (auto pred : loop.header->preds)
+	    if (!loop.contains[pred->number])
+		for (i = 0; i < pred->successors(); i ++)
+		    if (pred->next[i] == loop.header) {
+			pred->next[i] = block;
+			block->count += pred->count;
+		    }
+
+	block->count = min(block->count, loop.header->count);
+
+	added[loop.header->number] = block;
+	changed = true;
+    }
+
+    if (!changed)
+	return false;
+
+    for (auto block : proc.blocks) {
+	if (added[block->number] != nullptr)
+	    blocks.push_back(added[block->number]);
+
+	blocks.push_back(block);
+    }
+
+    proc.blocks = blocks;
+
+    for (i = 0; i < proc.blocks.size(); i ++)
+	proc.blocks[i]->number = i;
+
+    proc.link();
+    return true;
+}
+
+
+/*
+ * Function:	count (private)
+ *
+ * Description:	Count the definitions and uses of each temporary in the
+ *		given blocks.
+ */
+
+static void count(const vector<BasicBlock *> &blocks, vector<unsigned> &defs,
+	vector<unsigned> &uses)
+{
+    vector<Operand *> operands;
+
+
+    for (auto block : blocks)
+	for (auto &quad : block->quads) {
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp())
+		    uses[operand->temp] ++;
+
+	    if (quad.result.isTemp())
+		defs[quad.result.temp] ++;
+	}
+}
+
+
+/*
+ * Function:	isInvariant (private)
+ *
+ * Description:	Return whether an operand is not computed in the loop.
+ */
+
+static bool isInvariant(const Operand &operand, const vector<unsigned> &inside)
+{
+    return !operand.isTemp() || inside[operand.temp] == 0;
+}
+
+
+/*
+ * Function:	isPure (private)
+ *
+ * Description:	Return whether a quad has no effect other than computing
+ *		its result, and cannot fail.  A load can fail, but only if
+ *		the address is invalid.
+ */
+
+static bool isPure(const Quad &quad)
+{
+    switch (quad.opcode) {
+    case COPY:
+    case ADD:
+    case SUB:
+    case MUL:
+    case NEG:
+    case EXTEND:
+    case SET:
+	return true;
+
+    case LOAD:
+	return quad.left.kind == Operand::SLOT || quad.left.kind == Operand::GLOBAL;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	hoist (private)
+ *
+ * Description:	Move the invariant quads of a loop into its preheader.
+ *		Moving a quad may make others invariant, so we repeat until
+ *		nothing moves.
+ */
+
+static void hoist(const Procedure &proc, const Loop &loop, BasicBlock *pre,
+	const vector<unsigned> &defs, vector<unsigned> &inside)
+{
+    vector<Operand *> operands;
+    bool memory = false, changed, invariant;
+    unsigned i, j;
+
+
+    for (auto block : loop.blocks)
+	for (auto &quad : block->quads)
+	    memory |= quad.opcode == STORE || quad.opcode == CALL;
+
+    do {
+	changed = false;
+
+	for (auto block : loop.blocks) {
+	    for (i = j = 0; i < block->quads.size(); i ++) {
+		Quad &quad = block->quads[i];
+		const Operand &result = quad.result;
+
+		invariant = isPure(quad) && (quad.opcode != LOAD || !memory);
+		invariant = invariant && result.isTemp() && !proc.named[result.temp];
+		invariant = invariant && defs[result.temp] == 1;
+
+		quad.uses(operands);
+
+		for (auto operand : operands)
+		    invariant = invariant && isInvariant(*operand, inside);
+
+		if (invariant) {
+		    inside[result.temp] --;
+		    pre->quads.insert(pre->quads.end() - 1, quad);
+		    changed = true;
+		} else if (j ++ != i)
+		    block->quads[j - 1] = quad;
+	    }
+
+	    block->quads.erase(block->quads.begin() + j, block->quads.end());
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	define (private)
+ *
+ * Description:	Return the block defining a temporary in the loop, and the
+ *		position of its last definition in that block.
+ */
+
+static BasicBlock *define(const Loop &loop, unsigned temp, unsigned &position)
+{
+    unsigned i;
+
+
+    for (auto block : loop.blocks)
+	for (i = block->quads.size(); i -- > 0; )
+	    if (block->quads[i].result.isTemp() && block->quads[i].result.temp == temp) {
+		position = i;
+		return block;
+	    }
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	reduce (private)
+ *
+ * Description:	Perform strength reduction on the induction variables of a
+ *		loop.  A derived induction variable is reduced if it needs a
+ *		multiplication or extension and is used other than to
+ *		compute another induction variable.  A use is then replaced
+ *		by its reduced temporary if it follows the definition in
+ *		the same block without the basic induction variable being
+ *		incremented in between, and otherwise the definition is
+ *		replaced by a copy.  Each reduced temporary is live
+ *		throughout the loop, so no more are created than there are
+ *		registers to hold them.
+ */
+
+static void reduce(Procedure &proc, const Loop &loop, BasicBlock *pre,
+	const vector<unsigned> &defs, vector<unsigned> &uses,
+	const vector<unsigned> &inside, unsigned registers)
+{
+    unordered_map<unsigned, long> steps;
+    unordered_map<unsigned, Induction> inductions;
+    unordered_map<unsigned, unsigned> derived;
+    vector<pair<unsigned, unsigned>> chosen;
+    vector<Reduction> reductions;
+    vector<Operand *> operands;
+    unsigned i, position;
+
+
+    /* Find the basic induction variables. */
+
+    for (auto block : loop.blocks)
+	for (auto &quad : block->quads) {
+	    const Operand &result = quad.result;
+
+	    if (!result.isTemp() || !proc.named[result.temp] || inside[result.temp] != 1)
+		continue;
+
+	    if (quad.opcode == ADD && quad.left == result && quad.right.isConst())
+		steps[result.temp] = quad.right.value;
+	    else if (quad.opcode == ADD && quad.right == result && quad.left.isConst())
+		steps[result.temp] = quad.left.value;
+	    else if (quad.opcode == SUB && quad.left == result && quad.right.isConst())
+		steps[result.temp] = -quad.right.value;
+	}
+
+    if (steps.empty())
+	return;
+
+
+    /* Find the derived induction variables, in order. */
+
+    auto lookup = [&](const Operand &operand, Induction &induction) {
+	if (!operand.isTemp())
+	    return false;
+
+	if (steps.count(operand.temp) > 0) {
+	    induction = {operand.temp, 1, Operand(), false};
+	    return true;
+	}
+
+	auto it = inductions.find(operand.temp);
+
+	if (it == inductions.end())
+	    return false;
+
+	induction = it->second;
+	return true;
+    };
+
+    for (auto block : loop.blocks)
+	for (auto &quad : block->quads) {
+	    const Operand &result = quad.result, *source = &quad.left;
+	    Induction induction;
+	    bool found = false;
+
+	    if (!result.isTemp() || proc.named[result.temp] || defs[result.temp] != 1)
+		continue;
+
+	    if (quad.opcode == EXTEND) {
+		if (quad.left.isTemp() && steps.count(quad.left.temp) > 0) {
+		    induction = {quad.left.temp, 1, Operand(), true};
+		    found = true;
+		}
+
+	    } else if (quad.opcode == MUL) {
+		if (lookup(quad.left, induction) && quad.right.isConst())
+		    found = induction.addend.kind == Operand::NONE;
+		else if (lookup(quad.right, induction) && quad.left.isConst()) {
+		    found = induction.addend.kind == Operand::NONE;
+		    source = &quad.right;
+		}
+
+		if (found) {
+		    induction.factor *= (source == &quad.left ? quad.right : quad.left).value;
+		    induction.reduce = true;
+		}
+
+	    } else if (quad.opcode == ADD) {
+		if (lookup(quad.left, induction) && isInvariant(quad.right, inside)) {
+		    found = induction.addend.kind == Operand::NONE;
+		    induction.addend = quad.right;
+		} else if (lookup(quad.right, induction) && isInvariant(quad.left, inside)) {
+		    found = induction.addend.kind == Operand::NONE;
+		    induction.addend = quad.left;
+		    source = &quad.right;
+		}
+	    }
+
+	    if (found) {
+		inductions[result.temp] = induction;
+		derived[source->temp] ++;
+	    }
+	}
+
+
+    /* Choose the induction variables to reduce, sharing a reduced
+       temporary between those that are the same. */
+
+    for (auto block : loop.blocks)
+	for (auto &quad : block->quads) {
+	    unsigned temp = quad.result.temp;
+
+	    if (!quad.result.isTemp() || inductions.count(temp) == 0)
+		continue;
+
+	    Induction &induction = inductions[temp];
+
+	    if (!induction.reduce || uses[temp] <= derived[temp])
+		continue;
+
+	    for (i = 0; i < reductions.size(); i ++) {
+		Induction &other = reductions[i].induction;
+
+		if (other.basic == induction.basic && other.factor == induction.factor)
+		    if (other.addend == induction.addend && reductions[i].temp.size == quad.result.size)
+			break;
+	    }
+
+	    if (i == reductions.size()) {
+		if (reductions.size() == registers)
+		    continue;
+
+		reductions.push_back({induction, proc.temp(quad.result.size, true)});
+	    }
+
+	    chosen.emplace_back(temp, i);
+	}
+
+    if (chosen.empty())
+	return;
+
+    uses.resize(proc.temps.size(), 0);
+
+
+    /* Compute each reduced temporary in the preheader, and increment it
+       along with its basic induction variable. */
+
+    for (auto &reduction : reductions) {
+	const Induction &induction = reduction.induction;
+	Operand basic(Operand::TEMP, proc.temps[induction.basic], induction.basic);
+	Operand temp = reduction.temp;
+	auto end = pre->quads.end() - 1;
+
+	if (basic.size != temp.size)
+	    end = pre->quads.insert(end, Quad(EXTEND, temp, basic)) + 1;
+	else
+	    end = pre->quads.insert(end, Quad(COPY, temp, basic)) + 1;
+
+	if (induction.factor != 1)
+	    end = pre->quads.insert(end, Quad(MUL, temp, temp, proc.constant(induction.factor, temp.size))) + 1;
+
+	if (induction.addend.kind != Operand::NONE) {
+	    pre->quads.insert(end, Quad(ADD, temp, temp, induction.addend));
+
+	    if (induction.addend.isTemp())
+		uses[induction.addend.temp] ++;
+	}
+
+	BasicBlock *block = define(loop, induction.basic, position);
+	long step = steps[induction.basic] * induction.factor;
+
+	block->quads.insert(block->quads.begin() + position + 1,
+	    Quad(ADD, temp, temp, proc.constant(step, temp.size)));
+    }
+
+
+    /* Replace the reduced induction variables. */
+
+    for (auto &pair : chosen) {
+	unsigned temp = pair.first, replaced = 0;
+	unsigned basic = reductions[pair.second].induction.basic;
+	Operand reduced = reductions[pair.second].temp;
+	BasicBlock *block = define(loop, temp, position);
+	Quad &quad = block->quads[position];
+
+	for (i = position + 1; i < block->quads.size(); i ++) {
+	    Quad &use = block->quads[i];
+
+	    use.uses(operands);
+
+	    for (auto operand : operands)
+		if (*operand == quad.result) {
+		    *operand = reduced;
+		    replaced ++;
+		}
+
+	    if (use.result.isTemp() && use.result.temp == basic)
+		break;
+	}
+
+	uses[temp] -= replaced;
+
+	if (uses[temp] > 0) {
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp())
+		    uses[operand->temp] --;
+
+	    quad = Quad(COPY, quad.result, reduced);
+	}
+    }
+}
+
+
+/*
+ * Function:	sweep (private)
+ *
+ * Description:	Delete the quads in a loop computing unnamed temporaries
+ *		that are no longer used, such as those computing the
+ *		reduced induction variables.
+ */
+
+static void sweep(const Procedure &proc, const Loop &loop, vector<unsigned> &uses)
+{
+    vector<Operand *> operands;
+    vector<bool> dead;
+    bool changed;
+    unsigned i;
+
+
+    do {
+	changed = false;
+
+	for (auto block : loop.blocks) {
+	    dead.assign(block->quads.size(), false);
+
+	    for (i = block->quads.size(); i -- > 0; ) {
+		Quad &quad = block->quads[i];
+
+		if (!quad.result.isTemp() || proc.named[quad.result.temp])
+		    continue;
+
+		if (uses[quad.result.temp] != 0 || (!isPure(quad) && quad.opcode != LOAD))
+		    continue;
+
+		quad.uses(operands);
+
+		for (auto operand : operands)
+		    if (operand->isTemp())
+			uses[operand->temp] --;
+
+		dead[i] = changed = true;
+	    }
+
+	    auto first = block->quads.data();
+
+	    block->quads.erase(remove_if(block->quads.begin(), block->quads.end(),
+		[&](const Quad &quad) {return dead[&quad - first];}), block->quads.end());
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	Procedure::optimizeLoops
+ *
+ * Description:	Perform loop-invariant code motion and strength reduction
+ *		on each loop of this procedure, given the number of
+ *		registers available for allocation.
+ */
+
+void Procedure::optimizeLoops(unsigned registers)
+{
+    vector<unsigned> defs, uses, inside, unused;
+    vector<Loop> loops;
+
+
+    findLoops(*this, loops);
+
+    if (loops.empty())
+	return;
+
+    if (addPreheaders(*this, loops))
+	findLoops(*this, loops);
+
+    for (auto &loop : loops) {
+	BasicBlock *pre = preheader(loop);
+
+	defs.assign(temps.size(), 0);
+	uses.assign(temps.size(), 0);
+	inside.assign(temps.size(), 0);
+	unused.assign(temps.size(), 0);
+
+	for (auto &param : params)
+	    if (param.isTemp())
+		defs[param.temp] ++;
+
+	count(blocks, defs, uses);
+	count(loop.blocks, inside, unused);
+
+	hoist(*this, loop, pre, defs, inside);
+	reduce(*this, loop, pre, defs, uses, inside, registers);
+	sweep(*this, loop, uses);
+    }
+}
@@ -0,0 +1,962 @@
+/*
+ * File:	lower.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		lowering abstract syntax trees into the intermediate
+ *		representation.  The actual classes are declared
+ *		elsewhere, mainly in Tree.h and IR.h.
+ *
+ *		Every local scalar variable whose address is never taken
+ *		is kept in a named temporary, and every other variable is
+ *		given a stack slot.  Since an expression in Simple C cannot
+ *		modify a variable, an expression can simply use the
+ *		temporary of a variable, rather than a copy of it.
+ *
+ *		We do not know whether the address of a variable is taken
+ *		until we see it, so if we find that a variable we placed
+ *		in a temporary has its address taken, we give it a slot and
+ *		lower the function again.
+ *
+ *		Conditions are lowered into branches, so the comparison and
+ *		logical operators only compute a value when one is needed.
+ */
+
+# include <cassert>
+# include <unordered_map>
+# include <unordered_set>
+# include "generator.h"
+# include "machine.h"
+# include "Tree.h"
+# include "IR.h"
+# include "context.h"
+# include "Profile.h"
+
+using namespace std;
+
+static thread_local unordered_map<const Symbol *, Operand> storage;
+static thread_local unordered_set<const Symbol *> escaped;
+static thread_local vector<BasicBlock *> exits;
+static thread_local bool restart;
+
+
+/*
+ * Function:	declare (private)
+ *
+ * Description:	Give storage to a local variable: a named temporary if it
+ *		is a scalar whose address is not taken, and a stack slot
+ *		otherwise.  A parameter passed on the stack already has a
+ *		fixed slot, given by its offset.
+ */
+
+static Operand declare(Procedure &proc, const Symbol *symbol, int offset = 0)
+{
+    const Type &type = symbol->type();
+    Operand operand;
+
+
+    if (type.isScalar() && escaped.count(symbol) == 0)
+	operand = proc.temp(type.size(), true);
+    else
+	operand = proc.slot(type.size(), type.alignment(), offset);
+
+    storage[symbol] = operand;
+    return operand;
+}
+
+
+/*
+ * Function:	binary (private)
+ *
+ * Description:	Lower a binary arithmetic operator.
+ */
+
+static Operand binary(Procedure &proc, Opcode opcode, const Expression *expr,
+	Expression *left, Expression *right)
+{
+    Operand l = left->lower(proc);
+    Operand r = right->lower(proc);
+    Operand result = proc.temp(expr->type().size());
+
+
+    proc.emit(Quad(opcode, result, l, r));
+    return result;
+}
+
+
+/*
+ * Function:	compare (private)
+ *
+ * Description:	Lower a comparison that computes a value.
+ */
+
+static Operand compare(Procedure &proc, Condition cond, Expression *left,
+	Expression *right)
+{
+    Operand l = left->lower(proc);
+    Operand r = right->lower(proc);
+    Operand result = proc.temp(SIZEOF_INT);
+    Quad quad(SET, result, l, r);
+
+
+    quad.condition = cond;
+    proc.emit(quad);
+    return result;
+}
+
+
+/*
+ * Function:	branch (private)
+ *
+ * Description:	Lower a comparison used as a condition.
+ */
+
+static void branch(Procedure &proc, Condition cond, Expression *left,
+	Expression *right, BasicBlock *ifTrue, BasicBlock *ifFalse)
+{
+    Operand l = left->lower(proc);
+    Operand r = right->lower(proc);
+
+
+    proc.branch(cond, l, r, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	logical (private)
+ *
+ * Description:	Lower a logical operator that computes a value by testing
+ *		it and assigning either one or zero.
+ */
+
+static Operand logical(Procedure &proc, const Expression *expr)
+{
+    Operand result = proc.temp(SIZEOF_INT);
+    BasicBlock *ifTrue = proc.block(), *ifFalse = proc.block();
+    BasicBlock *join = proc.block();
+
+
+    expr->test(proc, ifTrue, ifFalse);
+
+    proc.place(ifTrue);
+    proc.emit(Quad(COPY, result, proc.constant(1, SIZEOF_INT)));
+    proc.jump(join);
+
+    proc.place(ifFalse);
+    proc.emit(Quad(COPY, result, proc.constant(0, SIZEOF_INT)));
+    proc.place(join);
+    return result;
+}
+
+
+/*
+ * Function:	Expression::lower
+ *
+ * Description:	Lower an expression and return the operand holding its
+ *		value.  Only the subclasses can be lowered.
+ */
+
+Operand Expression::lower(Procedure &proc) const
+{
+    assert(0);
+    return Operand();
+}
+
+
+/*
+ * Function:	Expression::address
+ *
+ * Description:	Lower an lvalue and return the operand holding its
+ *		address.
+ */
+
+Operand Expression::address(Procedure &proc) const
+{
+    assert(0);
+    return Operand();
+}
+
+
+/*
+ * Function:	Expression::store
+ *
+ * Description:	Lower the assignment of a value to an lvalue.
+ */
+
+void Expression::store(Procedure &proc, const Operand &value) const
+{
+    proc.emit(Quad(STORE, Operand(), address(proc), value));
+}
+
+
+/*
+ * Function:	Expression::test
+ *
+ * Description:	Lower an expression used as a condition by comparing its
+ *		value against zero.  A constant condition needs no test.
+ */
+
+void Expression::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    Operand value = lower(proc);
+
+
+    if (value.isConst())
+	proc.jump(value.value != 0 ? ifTrue : ifFalse);
+    else
+	proc.branch(NE, value, proc.constant(0, value.size), ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	Number::lower
+ *
+ * Description:	Lower an integer literal into a constant.
+ */
+
+Operand Number::lower(Procedure &proc) const
+{
+    return proc.constant(_value, _type.size());
+}
+
+
+/*
+ * Function:	String::address
+ *
+ * Description:	Return the address of a string literal, which was placed
+ *		in the string pool when it was parsed.
+ */
+
+Operand String::address(Procedure &proc) const
+{
+    return Operand(Operand::STRING, SIZEOF_PTR, _number);
+}
+
+
+/*
+ * Function:	Identifier::lower
+ *
+ * Description:	Lower an identifier, which is either its temporary or a
+ *		load from its address.
+ */
+
+Operand Identifier::lower(Procedure &proc) const
+{
+    auto it = storage.find(_symbol);
+    Operand result;
+
+
+    if (it != storage.end() && it->second.isTemp())
+	return it->second;
+
+    result = proc.temp(_type.size());
+    proc.emit(Quad(LOAD, result, address(proc)));
+    return result;
+}
+
+
+/*
+ * Function:	Identifier::address
+ *
+ * Description:	Return the address of an identifier, which is its slot or
+ *		its global name.  Taking the address of a variable kept in
+ *		a temporary means the function must be lowered again.
+ */
+
+Operand Identifier::address(Procedure &proc) const
+{
+    auto it = storage.find(_symbol);
+
+
+    if (it == storage.end())
+	return Operand(_symbol);
+
+    if (it->second.isTemp()) {
+	escaped.insert(_symbol);
+	restart = true;
+	return proc.slot(_type.size(), _type.alignment());
+    }
+
+    return it->second;
+}
+
+
+/*
+ * Function:	Identifier::store
+ *
+ * Description:	Lower an assignment to an identifier.  If the value was
+ *		just computed by the last quad, that quad can compute it
+ *		directly into the temporary of the variable.
+ */
+
+void Identifier::store(Procedure &proc, const Operand &value) const
+{
+    auto it = storage.find(_symbol);
+    BasicBlock *block = proc.current;
+
+
+    if (it == storage.end() || !it->second.isTemp()) {
+	Expression::store(proc, value);
+	return;
+    }
+
+    if (value.isTemp() && !proc.named[value.temp] && !block->quads.empty()) {
+	Quad &last = block->quads.back();
+
+	if (last.result == value) {
+	    last.result = it->second;
+	    return;
+	}
+    }
+
+    proc.emit(Quad(COPY, it->second, value));
+}
+
+
+/*
+ * Function:	Call::lower
+ *
+ * Description:	Lower a function call.  The arguments are evaluated from
+ *		right to left.
+ */
+
+Operand Call::lower(Procedure &proc) const
+{
+    Quad quad(CALL, proc.temp(_type.size()));
+
+
+    quad.callee = _id;
+    quad.args.resize(_args.size());
+
+    for (int i = _args.size() - 1; i >= 0; i --)
+	quad.args[i] = _args[i]->lower(proc);
+
+    proc.emit(quad);
+    return quad.result;
+}
+
+
+/*
+ * Function:	Not::lower
+ *
+ * Description:	Lower a logical negation by comparing against zero.
+ */
+
+Operand Not::lower(Procedure &proc) const
+{
+    Operand value = _expr->lower(proc);
+    Operand result = proc.temp(SIZEOF_INT);
+    Quad quad(SET, result, value, proc.constant(0, value.size));
+
+
+    quad.condition = EQ;
+    proc.emit(quad);
+    return result;
+}
+
+
+/*
+ * Function:	Not::test
+ *
+ * Description:	Lower a logical negation used as a condition, which is
+ *		just the operand with the targets exchanged.
+ */
+
+void Not::test(Procedure &proc, BasicBlock *ifTrue, BasicBlock *ifFalse) const
+{
+    _expr->test(proc, ifFalse, ifTrue);
+}
+
+
+/*
+ * Function:	Negate::lower
+ *
+ * Description:	Lower an arithmetic negation.
+ */
+
+Operand Negate::lower(Procedure &proc) const
+{
+    Operand value = _expr->lower(proc);
+    Operand result = proc.temp(_type.size());
+
+
+    proc.emit(Quad(NEG, result, value));
+    return result;
+}
+
+
+/*
+ * Function:	Dereference::lower
+ *
+ * Description:	Lower a dereference into a load.
+ */
+
+Operand Dereference::lower(Procedure &proc) const
+{
+    Operand pointer = _expr->lower(proc);
+    Operand result = proc.temp(_type.size());
+
+
+    proc.emit(Quad(LOAD, result, pointer));
+    return result;
+}
+
+
+/*
+ * Function:	Dereference::address
+ *
+ * Description:	Return the address of a dereference, which is simply the
+ *		value of its operand.
+ */
+
+Operand Dereference::address(Procedure &proc) const
+{
+    return _expr->lower(proc);
+}
+
+
+/*
+ * Function:	Address::lower
+ *
+ * Description:	Lower an address expression.
+ */
+
+Operand Address::lower(Procedure &proc) const
+{
+    return _expr->address(proc);
+}
+
+
+/*
+ * Function:	Cast::lower
+ *
+ * Description:	Lower a cast, which sign extends to a larger type and
+ *		truncates to a smaller type.  Casts between types of the
+ *		same size need no code at all.
+ */
+
+Operand Cast::lower(Procedure &proc) const
+{
+    unsigned source = _expr->type().size(), target = _type.size();
+    Operand value = _expr->lower(proc), result;
+
+
+    if (source == target)
+	return value;
+
+    if (value.isConst()) {
+	if (target == 1)
+	    return proc.constant((signed char) value.value, target);
+
+	if (target == 4)
+	    return proc.constant((int) value.value, target);
+
+	return proc.constant(value.value, target);
+    }
+
+    result = proc.temp(target);
+    proc.emit(Quad(source < target ? EXTEND : COPY, result, value));
+    return result;
+}
+
+
+/*
+ * Function:	Multiply::lower
+ *
+ * Description:	Lower a multiplication.
+ */
+
+Operand Multiply::lower(Procedure &proc) const
+{
+    return binary(proc, MUL, this, _left, _right);
+}
+
+
+/*
+ * Function:	Divide::lower
+ *
+ * Description:	Lower a division.
+ */
+
+Operand Divide::lower(Procedure &proc) const
+{
+    return binary(proc, DIVIDE, this, _left, _right);
+}
+
+
+/*
+ * Function:	Remainder::lower
+ *
+ * Description:	Lower a remainder.
+ */
+
+Operand Remainder::lower(Procedure &proc) const
+{
+    return binary(proc, REMAINDER, this, _left, _right);
+}
+
+
+/*
+ * Function:	Add::lower
+ *
+ * Description:	Lower an addition.
+ */
+
+Operand Add::lower(Procedure &proc) const
+{
+    return binary(proc, ADD, this, _left, _right);
+}
+
+
+/*
+ * Function:	Subtract::lower
+ *
+ * Description:	Lower a subtraction.
+ */
+
+Operand Subtract::lower(Procedure &proc) const
+{
+    return binary(proc, SUB, this, _left, _right);
+}
+
+
+/*
+ * Function:	LessThan::lower
+ *
+ * Description:	Lower a less-than comparison.
+ */
+
+Operand LessThan::lower(Procedure &proc) const
+{
+    return compare(proc, LT, _left, _right);
+}
+
+
+/*
+ * Function:	LessThan::test
+ *
+ * Description:	Lower a less-than comparison used as a condition.
+ */
+
+void LessThan::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    branch(proc, LT, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	GreaterThan::lower
+ *
+ * Description:	Lower a greater-than comparison.
+ */
+
+Operand GreaterThan::lower(Procedure &proc) const
+{
+    return compare(proc, GT, _left, _right);
+}
+
+
+/*
+ * Function:	GreaterThan::test
+ *
+ * Description:	Lower a greater-than comparison used as a condition.
+ */
+
+void GreaterThan::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    branch(proc, GT, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	LessOrEqual::lower
+ *
+ * Description:	Lower a less-than-or-equal comparison.
+ */
+
+Operand LessOrEqual::lower(Procedure &proc) const
+{
+    return compare(proc, LE, _left, _right);
+}
+
+
+/*
+ * Function:	LessOrEqual::test
+ *
+ * Description:	Lower a less-than-or-equal comparison used as a
+ *		condition.
+ */
+
+void LessOrEqual::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    branch(proc, LE, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	GreaterOrEqual::lower
+ *
+ * Description:	Lower a greater-than-or-equal comparison.
+ */
+
+Operand GreaterOrEqual::lower(Procedure &proc) const
+{
+    return compare(proc, GE, _left, _right);
+}
+
+
+/*
+ * Function:	GreaterOrEqual::test
+ *
+ * Description:	Lower a greater-than-or-equal comparison used as a
+ *		condition.
+ */
+
+void GreaterOrEqual::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    branch(proc, GE, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	Equal::lower
+ *
+ * Description:	Lower an equality comparison.
+ */
+
+Operand Equal::lower(Procedure &proc) const
+{
+    return compare(proc, EQ, _left, _right);
+}
+
+
+/*
+ * Function:	Equal::test
+ *
+ * Description:	Lower an equality comparison used as a condition.
+ */
+
+void Equal::test(Procedure &proc, BasicBlock *ifTrue, BasicBlock *ifFalse) const
+{
+    branch(proc, EQ, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	NotEqual::lower
+ *
+ * Description:	Lower an inequality comparison.
+ */
+
+Operand NotEqual::lower(Procedure &proc) const
+{
+    return compare(proc, NE, _left, _right);
+}
+
+
+/*
+ * Function:	NotEqual::test
+ *
+ * Description:	Lower an inequality comparison used as a condition.
+ */
+
+void NotEqual::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    branch(proc, NE, _left, _right, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	LogicalAnd::lower
+ *
+ * Description:	Lower a logical-and expression that computes a value.
+ */
+
+Operand LogicalAnd::lower(Procedure &proc) const
+{
+    return logical(proc, this);
+}
+
+
+/*
+ * Function:	LogicalAnd::test
+ *
+ * Description:	Lower a logical-and expression used as a condition, which
+ *		only tests the right operand if the left one is true.
+ */
+
+void LogicalAnd::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    BasicBlock *right = proc.block();
+
+
+    _left->test(proc, right, ifFalse);
+    proc.place(right);
+    _right->test(proc, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	LogicalOr::lower
+ *
+ * Description:	Lower a logical-or expression that computes a value.
+ */
+
+Operand LogicalOr::lower(Procedure &proc) const
+{
+    return logical(proc, this);
+}
+
+
+/*
+ * Function:	LogicalOr::test
+ *
+ * Description:	Lower a logical-or expression used as a condition, which
+ *		only tests the right operand if the left one is false.
+ */
+
+void LogicalOr::test(Procedure &proc, BasicBlock *ifTrue,
+	BasicBlock *ifFalse) const
+{
+    BasicBlock *right = proc.block();
+
+
+    _left->test(proc, ifTrue, right);
+    proc.place(right);
+    _right->test(proc, ifTrue, ifFalse);
+}
+
+
+/*
+ * Function:	Assignment::lower
+ *
+ * Description:	Lower an assignment statement.  The right-hand side is
+ *		evaluated before the address of the left-hand side.
+ */
+
+void Assignment::lower(Procedure &proc) const
+{
+    Operand value = _right->lower(proc);
+
+
+    _left->store(proc, value);
+}
+
+
+/*
+ * Function:	Break::lower
+ *
+ * Description:	Lower a break statement into a jump out of the innermost
+ *		loop.
+ */
+
+void Break::lower(Procedure &proc) const
+{
+    proc.jump(exits.back());
+}
+
+
+/*
+ * Function:	Return::lower
+ *
+ * Description:	Lower a return statement.
+ */
+
+void Return::lower(Procedure &proc) const
+{
+    Operand value = _expr->lower(proc);
+
+
+    proc.emit(Quad(RET, Operand(), value));
+}
+
+
+/*
+ * Function:	Block::lower
+ *
+ * Description:	Lower a block after giving storage to the variables
+ *		declared within it.  The parameters have already been
+ *		given storage.
+ */
+
+void Block::lower(Procedure &proc) const
+{
+    for (auto symbol : _decls->symbols())
+	if (!symbol->type().isFunction() && storage.count(symbol) == 0)
+	    declare(proc, symbol);
+
+    for (auto stmt : _stmts)
+	stmt->lower(proc);
+}
+
+
+/*
+ * Function:	Simple::lower
+ *
+ * Description:	Lower an expression statement, discarding its value.  A
+ *		call whose value is discarded need not have a result.
+ */
+
+void Simple::lower(Procedure &proc) const
+{
+    Operand value = _expr->lower(proc);
+    BasicBlock *block = proc.current;
+
+
+    if (!block->quads.empty() && block->quads.back().opcode == CALL)
+	if (block->quads.back().result == value)
+	    block->quads.back().result = Operand();
+}
+
+
+/*
+ * Function:	While::lower
+ *
+ * Description:	Lower a while statement.  The loop is rotated so that the
+ *		test is at the bottom, guarded by a copy of the test on
+ *		entry, and so each iteration takes only a single branch
+ *		back to the top.
+ */
+
+void While::lower(Procedure &proc) const
+{
+    BasicBlock *body = proc.block(), *exit = proc.block();
+
+
+    _expr->test(proc, body, exit);
+
+    proc.place(body);
+    exits.push_back(exit);
+    _stmt->lower(proc);
+    exits.pop_back();
+    _expr->test(proc, body, exit);
+
+    proc.place(exit);
+}
+
+
+/*
+ * Function:	For::lower
+ *
+ * Description:	Lower a for statement, which is rotated just like a while
+ *		statement.
+ */
+
+void For::lower(Procedure &proc) const
+{
+    BasicBlock *body = proc.block(), *exit = proc.block();
+
+
+    _init->lower(proc);
+    _expr->test(proc, body, exit);
+
+    proc.place(body);
+    exits.push_back(exit);
+    _stmt->lower(proc);
+    exits.pop_back();
+    _incr->lower(proc);
+    _expr->test(proc, body, exit);
+
+    proc.place(exit);
+}
+
+
+/*
+ * Function:	If::lower
+ *
+ * Description:	Lower an if-then or if-then-else statement.
+ */
+
+void If::lower(Procedure &proc) const
+{
+    BasicBlock *then = proc.block(), *join = proc.block();
+    BasicBlock *otherwise = join;
+
+
+    if (_elseStmt != nullptr)
+	otherwise = proc.block();
+
+    _expr->test(proc, then, otherwise);
+    proc.place(then);
+    _thenStmt->lower(proc);
+
+    if (_elseStmt != nullptr) {
+	if (!proc.current->terminated())
+	    proc.jump(join);
+
+	proc.place(otherwise);
+	_elseStmt->lower(proc);
+    }
+
+    proc.place(join);
+}
+
+
+/*
+ * Function:	Function::lower
+ *
+ * Description:	Lower this function into a new procedure.  The parameters
+ *		are given storage first, and those passed on the stack are
+ *		loaded from their fixed slots if they are kept in
+ *		temporaries.  The register parameters are moved into their
+ *		storage by the code generator.  Once its jumps are
+ *		threaded, the procedure is instrumented or given its counts
+ *		if profiling, and calls to small functions defined earlier
+ *		are expanded inline.
+ */
+
+Procedure *Function::lower() const
+{
+    const Symbols &symbols = _body->declarations()->symbols();
+    unsigned i, numParams = _id->type().parameters()->types.size();
+    int offset = 2 * SIZEOF_REG;
+    Procedure *proc;
+    Operand operand;
+
+
+    escaped.clear();
+    Label::enter(&_id->name());
+
+    do {
+	proc = new Procedure(_id);
+	storage.clear();
+	restart = false;
+
+	for (i = 0; i < numParams; i ++)
+	    if (i < NUM_PARAM_REGS)
+		proc->params.push_back(declare(*proc, symbols[i]));
+	    else {
+		int fixed = offset + (i - NUM_PARAM_REGS) * PARAM_ALIGNMENT;
+
+		if (escaped.count(symbols[i]) > 0)
+		    declare(*proc, symbols[i], fixed);
+		else {
+		    operand = proc->slot(SIZEOF_REG, PARAM_ALIGNMENT, fixed);
+		    proc->emit(Quad(LOAD, declare(*proc, symbols[i]), operand));
+		}
+	    }
+
+	_body->lower(*proc);
+
+	if (restart)
+	    delete proc;
+
+    } while (restart);
+
+    proc->link();
+    proc->threadJumps();
+
+    if (CompilerContext::current()->counters != nullptr)
+	proc->instrument(*CompilerContext::current()->counters);
+    else if (CompilerContext::current()->profile != nullptr)
+	proc->annotate(*CompilerContext::current()->profile);
+
+    proc->expand(CompilerContext::current()->inlines);
+    return proc;
+}
@@ -19,7 +19,12 @@
 # define NUM_PARAM_REGS 6
 # define PARAM_ALIGNMENT 8
 # define STACK_ALIGNMENT 16
+# define LOOP_ALIGNMENT 16
+# define RED_ZONE 128
+# define VECTOR_SIZE 16
+# define NUM_VECTOR_REGS 16
 
 # define global_prefix ""
 # define global_suffix ""
-# define label_prefix ".L"
+# define local_suffix ".local"
+# define string_prefix ".LC"
@@ -4,32 +4,68 @@
  * Description:	This file contains the public and private function and
  *		variable definitions for the recursive-descent parser for
  *		Simple C.
+ *
+ *		The binary operators are parsed by precedence climbing,
+ *		using a table of their precedences, so that a leaf of an
+ *		expression is reached through a single function rather than
+ *		one for each level of precedence.  The original function
+ *		for each level is still used if DESCENT_PARSER is defined,
+ *		as by "make CPPFLAGS=-DDESCENT_PARSER", so that the two may
+ *		be compared.  Both call the same checking functions in the
+ *		same order, and so build the same trees.
  */
 
+# include <atomic>
+# include <algorithm>
+# include <cerrno>
 # include <cstdlib>
+# include <cstring>
 # include <iostream>
+# include <thread>
+# include <getopt.h>
+# include <unistd.h>
+# include <sys/stat.h>
 # include "generator.h"
 # include "checker.h"
 # include "string.h"
 # include "tokens.h"
 # include "lexer.h"
+# include "context.h"
+# include "Cache.h"
+# include "Declarations.h"
+# include "Loader.h"
+# include "Profile.h"
+# include "server.h"
 
 using namespace std;
 
-static int lookahead, nexttoken;
-static string lexbuf, nextbuf;
+static thread_local int lookahead, nexttoken;
+static thread_local string_view lexbuf, nextbuf;
+static thread_local Name lexname, nextname;
 
 static Expression *expression();
 static Statement *statement();
 
-static Type returnType;
-static unsigned loopDepth;
+static thread_local Type returnType;
+static thread_local unsigned loopDepth;
+static thread_local bool reachable;
+
+static bool timing, statistics, prune, objects, running, instrumenting;
+static Assembler *assembled;
+static Profile *profile;
+static Declarations *imported;
+static string exported;
+static vector<string> roots = {"main"};
+
+struct SyntaxError {};
 
 
 /*
  * Function:	error
  *
- * Description:	Report a syntax error to standard error.
+ * Description:	Report a syntax error to standard error and abandon the
+ *		translation unit, since our parser does not do error
+ *		recovery.
  */
 
 static void error()
@@ -37,9 +73,37 @@ static void error()
     if (lookahead == DONE)
 	report("syntax error at end of file", "");
     else
-	report("syntax error at '%s'", lexbuf);
+	report("syntax error at '%s'", lookahead == ID ? *lexname : string(lexbuf));
 
-    exit(EXIT_FAILURE);
+    throw SyntaxError();
+}
+
+
+/*
+ * Function:	scan
+ *
+ * Description:	Return the next token of the translation unit along with
+ *		its text, which is a span of the source text.  The lexer
+ *		has already interned the text of an identifier for us.
+ *		Once the end of file is reached, it is returned from then
+ *		on.
+ */
+
+static int scan(string_view &buf, Name &name)
+{
+    CompilerContext *context = CompilerContext::current();
+    const Token &token = context->tokens[min(context->next, context->tokens.size() - 1)];
+
+
+    context->next ++;
+    context->lineno = token.line;
+
+    if (token.kind == ID)
+	name = token.name;
+    else
+	buf = token.text;
+
+    return token.kind;
 }
 
 
@@ -47,8 +111,9 @@ static void error()
  * Function:	match
  *
  * Description:	Match the next token against the specified token.  A
- *		failure indicates a syntax error and will terminate the
- *		program since our parser does not do error recovery.
+ *		failure indicates a syntax error and will abandon the
+ *		translation unit since our parser does not do error
+ *		recovery.
  */
 
 static void match(int t)
@@ -59,11 +124,10 @@ static void match(int t)
     if (nexttoken != 0) {
 	lookahead = nexttoken;
 	lexbuf = nextbuf;
+	lexname = nextname;
 	nexttoken = 0;
-    } else {
-	lookahead = yylex();
-	lexbuf = yytext;
-    }
+    } else
+	lookahead = scan(lexbuf, lexname);
 }
 
 
@@ -76,10 +140,8 @@ static void match(int t)
 
 static int peek()
 {
-    if (!nexttoken) {
-	nexttoken = yylex();
-	nextbuf = yytext;
-    }
+    if (!nexttoken)
+	nexttoken = scan(nextbuf, nextname);
 
     return nexttoken;
 }
@@ -121,14 +183,14 @@ static unsigned long number()
  * Description:	Match the next token as an identifier and return its name.
  */
 
-static string identifier()
+static Name identifier()
 {
-    string buf;
+    Name name;
 
 
-    buf = lexbuf;
+    name = lexname;
     match(ID);
-    return buf;
+    return name;
 }
 
 
@@ -192,7 +254,7 @@ static unsigned pointers()
 
 static void declarator(int typespec)
 {
-    string name;
+    Name name;
     unsigned indirection;
 
 
@@ -289,7 +351,12 @@ static Expression *primaryExpression()
 
     } else if (lookahead == STRING) {
 	lexbuf = lexbuf.substr(1, lexbuf.size() - 2);
-	expr = new String(parseString(lexbuf));
+	String *literal = new String(parseString(lexbuf));
+
+	if (reachable)
+	    CompilerContext::current()->graph.reference(literal->number());
+
+	expr = literal;
 	match(STRING);
 
     } else if (lookahead == CHARACTER) {
@@ -298,7 +365,7 @@ static Expression *primaryExpression()
 	match(CHARACTER);
 
     } else if (lookahead == NUM) {
-	expr = new Number(lexbuf);
+	expr = new Number(string(lexbuf));
 	match(NUM);
 
     } else if (lookahead == ID) {
@@ -308,6 +375,9 @@ static Expression *primaryExpression()
 
 	symbol = checkIdentifier(identifier());
 
+	if (reachable)
+	    CompilerContext::current()->graph.reference(symbol);
+
 	if (lookahead == '(') {
 	    match('(');
 
@@ -442,6 +512,8 @@ static Expression *prefixExpression()
 }
 
 
+# ifdef DESCENT_PARSER
+
 /*
  * Function:	multiplicativeExpression
  *
@@ -666,6 +738,119 @@ static Expression *expression()
     return left;
 }
 
+# else
+
+struct Operator {
+    unsigned precedence;
+    Expression *(*check)(Expression *left, Expression *right);
+};
+
+
+/*
+ * Function:	binary
+ *
+ * Description:	Return the precedence of the binary operator with the
+ *		given token and the function checking it, or a precedence
+ *		of zero if the token is not a binary operator.  Note that
+ *		Simple C has neither shift nor bitwise operators.
+ */
+
+static Operator binary(int token)
+{
+    switch (token) {
+    case OR:
+	return {1, checkLogicalOr};
+
+    case AND:
+	return {2, checkLogicalAnd};
+
+    case EQL:
+	return {3, checkEqual};
+
+    case NEQ:
+	return {3, checkNotEqual};
+
+    case '<':
+	return {4, checkLessThan};
+
+    case '>':
+	return {4, checkGreaterThan};
+
+    case LEQ:
+	return {4, checkLessOrEqual};
+
+    case GEQ:
+	return {4, checkGreaterOrEqual};
+
+    case '+':
+	return {5, checkAdd};
+
+    case '-':
+	return {5, checkSubtract};
+
+    case '*':
+	return {6, checkMultiply};
+
+    case '/':
+	return {6, checkDivide};
+
+    case '%':
+	return {6, checkRemainder};
+    }
+
+    return {0, nullptr};
+}
+
+
+/*
+ * Function:	binaryExpression
+ *
+ * Description:	Parse an expression whose binary operators all have at
+ *		least the given precedence.  All of the binary operators
+ *		are left associative, so the right operand of each may only
+ *		have operators of a higher precedence.
+ *
+ *		binary-expression:
+ *		  prefix-expression
+ *		  binary-expression binary-operator prefix-expression
+ */
+
+static Expression *binaryExpression(unsigned minimum)
+{
+    Expression *left, *right;
+    Operator op;
+
+
+    left = prefixExpression();
+
+    while ((op = binary(lookahead)).precedence >= minimum) {
+	match(lookahead);
+	right = binaryExpression(op.precedence + 1);
+	left = op.check(left, right);
+    }
+
+    return left;
+}
+
+
+/*
+ * Function:	expression
+ *
+ * Description:	Parse an expression, or more specifically, a logical-or
+ *		expression, since Simple C does not allow comma or
+ *		assignment as an expression operator.
+ *
+ *		expression:
+ *		  binary-expression
+ */
+
+static Expression *expression()
+{
+    return binaryExpression(1);
+}
+
+# endif /* DESCENT_PARSER */
+
 
 /*
  * Function:	statements
@@ -673,7 +858,9 @@ static Expression *expression()
  * Description:	Parse a possibly empty sequence of statements.  Rather than
  *		checking if the next token starts a statement, we check if
  *		the next token ends the sequence, since a sequence of
- *		statements is always terminated by a closing brace.
+ *		statements is always terminated by a closing brace.  A
+ *		statement that cannot be reached is still parsed and
+ *		checked, but is then dropped.
  *
  *		statements:
  *		  empty
@@ -683,10 +870,17 @@ static Expression *expression()
 static Statements statements()
 {
     Statements stmts;
+    Statement *stmt;
+    bool live;
 
 
-    while (lookahead != '}')
-	stmts.push_back(statement());
+    while (lookahead != '}') {
+	live = reachable;
+	stmt = statement();
+
+	if (live)
+	    stmts.push_back(stmt);
+    }
 
     return stmts;
 }
@@ -723,6 +917,10 @@ static Statement *assignment()
  *
  * Description:	Parse a statement.  Note that Simple C has so few
  *		statements that we handle them all in this one function.
+ *		We also keep track of whether the statement following is
+ *		reachable: not after a break or return, and not after an
+ *		if statement neither of whose branches completes.  A loop
+ *		may always complete, since its test may be false.
  *
  *		statement:
  *		  { declarations statements }
@@ -739,8 +937,9 @@ static Statement *statement()
 {
     Scope *scope;
     Expression *expr;
-    Statement *stmt, *init, *incr;
+    Statement *stmt, *init, *incr, *other;
     Statements stmts;
+    bool live;
 
 
     if (lookahead == '{') {
@@ -756,6 +955,7 @@ static Statement *statement()
 	match(BREAK);
 	stmt = checkBreak(loopDepth);
 	match(';');
+	reachable = false;
 	return stmt;
 
     } else if (lookahead == RETURN) {
@@ -763,6 +963,7 @@ static Statement *statement()
 	expr = expression();
 	stmt = checkReturn(expr, returnType);
 	match(';');
+	reachable = false;
 	return stmt;
 
     } else if (lookahead == WHILE) {
@@ -771,10 +972,12 @@ static Statement *statement()
 	expr = expression();
 	expr = checkTest(expr);
 	match(')');
+	live = reachable;
 	loopDepth ++;
 	stmt = statement();
 	loopDepth --;
-	return new While(expr, stmt);
+	reachable = live;
+	return checkWhile(expr, stmt);
 
     } else if (lookahead == FOR) {
 	match(FOR);
@@ -786,10 +989,12 @@ static Statement *statement()
 	match(';');
 	incr = assignment();
 	match(')');
+	live = reachable;
 	loopDepth ++;
 	stmt = statement();
 	loopDepth --;
-	return new For(init, expr, incr, stmt);
+	reachable = live;
+	return checkFor(init, expr, incr, stmt);
 
     } else if (lookahead == IF) {
 	match(IF);
@@ -797,13 +1002,19 @@ static Statement *statement()
 	expr = expression();
 	expr = checkTest(expr);
 	match(')');
+	live = reachable;
 	stmt = statement();
 
-	if (lookahead != ELSE)
-	    return new If(expr, stmt, nullptr);
+	if (lookahead != ELSE) {
+	    reachable = live;
+	    return checkIf(expr, stmt, nullptr);
+	}
 
 	match(ELSE);
-	return new If(expr, stmt, statement());
+	swap(live, reachable);
+	other = statement();
+	reachable = reachable || live;
+	return checkIf(expr, stmt, other);
 
     } else {
 	stmt = assignment();
@@ -825,7 +1036,7 @@ static Statement *statement()
 
 static Type parameter()
 {
-    string name;
+    Name name;
     int typespec;
     unsigned indirection;
 
@@ -897,7 +1108,7 @@ static Parameters *parameters()
 
 static void globalDeclarator(int typespec)
 {
-    string name;
+    Name name;
     unsigned indirection;
 
 
@@ -924,7 +1135,16 @@ static void globalDeclarator(int typespec)
 /*
  * Function:	functionOrGlobal
  *
- * Description:	Parse a function definition or global declaration.
+ * Description:	Parse a function definition or global declaration.  The
+ *		body of a function definition is allocated from its own
+ *		arena, which is released as soon as the pipeline has
+ *		generated code for the function.  Everything else,
+ *		including the function and its parameters, belongs to the
+ *		translation unit.  A function is added to the table of
+ *		functions that may be expanded inline as it is handed to
+ *		the pipeline, along with its entry in the cache if there
+ *		is a cache.  When pruning, a function other than the roots
+ *		is also local to the translation unit.
  *
  * 		function-or-global:
  * 		  specifier function-declarator { declarations statements }
@@ -938,7 +1158,7 @@ static void globalDeclarator(int typespec)
 
 static void functionOrGlobal()
 {
-    string name;
+    Name name;
     int typespec;
     unsigned indirection;
     Parameters *params;
@@ -946,6 +1166,9 @@ static void functionOrGlobal()
     Function *function;
     Symbol *symbol;
     Scope *decls;
+    Cache *cache;
+    CompilerContext *context = CompilerContext::current();
+    size_t first = context->next - 1;
 
 
     typespec = specifier();
@@ -961,16 +1184,31 @@ static void functionOrGlobal()
 	if (lookahead == '{') {
 	    returnType = Type(typespec, indirection);
 	    symbol = defineFunction(name, Type(typespec, indirection, params));
+	    Arena::use(context->pipeline.arena());
+	    context->graph.enter(symbol);
+	    reachable = true;
 	    match('{');
 	    declarations();
 	    stmts = statements();
 	    decls = closeScope();
 	    function = new Function(symbol, new Block(decls, stmts));
+	    context->graph.leave();
 	    match('}');
 
-	    if (numerrors == 0)
-		function->generate();
+	    if (context->numerrors == 0) {
+		context->inlines.add(symbol);
+		context->conventions.add(symbol, prune &&
+			find(roots.begin(), roots.end(), *name) == roots.end());
+		cache = nullptr;
 
+		if (!Cache::directory.empty())
+		    cache = new Cache(symbol, first, context->next - 1);
+
+		context->pipeline.generate(function, cache);
+	    } else
+		context->pipeline.discard();
+
+	    Arena::use(&context->unit);
 	    return;
 	}
 
@@ -995,24 +1233,410 @@ static void functionOrGlobal()
 
 
 /*
- * Function:	main
+ * Function:	mark
+ *
+ * Description:	Mark what is live in the translation unit with the given
+ *		global scope.  When pruning, only the roots and what they
+ *		reference are live.  Otherwise, every function defined is
+ *		live, since it may be called from another unit, but the
+ *		string literals used only by unreachable statements are
+ *		not.
+ */
+
+static void mark(Scope *global)
+{
+    CompilerContext *context = CompilerContext::current();
+    Symbol *symbol;
+
+
+    if (!prune) {
+	for (auto name : context->defined)
+	    if ((symbol = global->find(name)) != nullptr)
+		context->graph.mark(symbol);
+
+	return;
+    }
+
+    for (auto &root : roots)
+	if ((symbol = global->find(intern(root))) != nullptr)
+	    context->graph.mark(symbol);
+}
+
+
+/*
+ * Function:	compile
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Compile the translation unit read from the given input
+ *		file, or the standard input if none is given, writing the
+ *		generated code to the given output file, or the standard
+ *		output if none is given, using the given number of code
+ *		generation workers.  Return whether the translation
+ *		unit was compiled without any errors, removing the output
+ *		file if it was not.  When pruning, the code of the
+ *		functions is held until the unit has been parsed, so that
+ *		only the live functions are written.  When writing object
+ *		files, the code is assembled as it is written, and the
+ *		object file is written once the unit is complete, or when
+ *		running, the assembled unit is kept to be loaded.  When
+ *		instrumenting, the unit has its own counters, and each
+ *		function is lowered with the profile if there is one.  The
+ *		statistics of the unit are written afterward if requested.
  *
  *		translation-unit:
  *		  empty
  *		  function-or-global translation-unit
  */
 
-int main()
+static bool compile(const string &input, const string &output, unsigned workers)
 {
-    openScope();
-    lookahead = yylex();
-    lexbuf = yytext;
+    Counters counters;
+    CompilerContext context(input, workers);
+    bool failed = false;
+
+
+    if (!context.source.open(input)) {
+	cerr << "scc: " << (input.empty() ? "standard input" : input);
+	cerr << ": " << strerror(errno) << endl;
+	return false;
+    }
+
+    if (!output.empty() && !context.emitter.open(output)) {
+	cerr << "scc: " << output << ": " << strerror(errno) << endl;
+	return false;
+    }
+
+    if (objects || running)
+	context.emitter.assemble();
+
+    if (instrumenting)
+	context.counters = &counters;
+
+    context.profile = profile;
+    CompilerContext::use(&context);
+
+    {
+	Timer timer(LEX);
+	tokenize(context.source);
+    }
+
+    Arena::use(&context.unit);
+    nexttoken = 0;
+    loopDepth = 0;
+
+    if (prune)
+	context.pipeline.hold();
+
+    try {
+	Timer timer(PARSE);
+
+	openScope();
+
+	if (imported != nullptr)
+	    context.global->import(imported);
+
+	lookahead = scan(lexbuf, lexname);
+
+	while (lookahead != DONE)
+	    functionOrGlobal();
+
+    } catch (SyntaxError &) {
+	failed = true;
+    }
+
+    context.pipeline.finish();
+
+    if (!failed) {
+	Scope *global = closeScope();
+
+	if (!exported.empty() && context.numerrors == 0)
+	    if (!Declarations::write(global, exported)) {
+		cerr << "scc: " << exported << ": " << strerror(errno) << endl;
+		failed = true;
+	    }
+
+	mark(global);
+
+	if (prune)
+	    context.pipeline.release(context.graph);
+
+	generateGlobals(global, prune);
+
+	if (running)
+	    assembled = context.emitter.detach();
+	else
+	    context.emitter.finish();
+    }
+
+    if (timing || statistics) {
+	string unit = input.empty() ? "-" : input;
+	unsigned lines = context.tokens.empty() ? 0 : context.tokens.back().line;
+
+	if (timing)
+	    cerr << context.stats.report(unit, lines);
+
+	if (statistics) {
+	    unsigned strings = context.strings.strings().size();
+	    cerr << context.stats.json(unit, lines, strings, context.strings.hits());
+	}
+    }
+
+    failed = failed || context.numerrors > 0;
+
+    if (failed && !output.empty())
+	unlink(output.c_str());
+
+    Arena::use(nullptr);
+    CompilerContext::use(nullptr);
+    return !failed;
+}
+
+
+/*
+ * Function:	execute
+ *
+ * Description:	Load the assembled translation unit into memory and call
+ *		its main function with the given program name, returning
+ *		the exit status of the program.  The loader is static, so
+ *		that the program stays loaded until after the functions it
+ *		registered to be called at exit have been called.
+ */
+
+static int execute(const string &program)
+{
+    char *args[] = {(char *) program.c_str(), nullptr};
+    static Loader loader;
+    void *entry;
+
+
+    if (!loader.load(*assembled))
+	return EXIT_FAILURE;
+
+    delete assembled;
+    assembled = nullptr;
+
+    if ((entry = loader.find("main")) == nullptr) {
+	cerr << "scc: main: undefined symbol" << endl;
+	return EXIT_FAILURE;
+    }
+
+    return ((int (*)(int, char **)) entry)(1, args);
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Compile each file given on the command line, writing the
+ *		generated code for "file.c" to "file.s", or compile the
+ *		standard input if no files are given.  With the -o option,
+ *		the code for a single translation unit is written to the
+ *		given output file rather than the standard output or the
+ *		default output file.
+ *
+ *		With the -j option, up to the given number of translation
+ *		units are compiled at once, each by its own thread.  Each
+ *		thread takes the next file not yet taken until none are
+ *		left.  With the -t option, the functions of each unit are
+ *		generated by the given number of additional threads while
+ *		the unit is still being parsed.  With the -T option, the
+ *		time spent in each phase of each unit is written to the
+ *		standard error.  With the --stats option, the times,
+ *		allocations, and code generation counters of each unit are
+ *		written to the standard error as a line of JSON.  With the
+ *		--cache option, the code generated for each function is
+ *		kept in the given directory, which is created if needed, and
+ *		reused when the function and what it depends upon are
+ *		unchanged.  With the --emit-decls option, the global symbols
+ *		of the unit are also written to the given file, which the
+ *		--use-decls option then imports into every unit compiled.
+ *		With the --prune option, only the functions and globals
+ *		reachable from main, and from each function or global
+ *		given with the --export option, are written, and only
+ *		these roots may be called from other units, so the other
+ *		functions are called using conventions of their own.  With
+ *		the --emit-obj option, an object file is written in place of
+ *		the assembly, to "file.o" by default.  With the --run
+ *		option, the single translation unit is instead loaded into
+ *		memory and run, and the exit status is that of the program.
+ *		With the --profile-generate option, the generated code
+ *		counts how often each block is executed and appends the
+ *		counts to "scc.profile" at exit, and with the --profile-use
+ *		option, the counts in the given profile guide the inliner,
+ *		the register allocator, and the layout of the blocks.  The
+ *		cache is not used when profiling or pruning, since the code
+ *		then depends upon more than the function itself.
+ *		Return the exit status, which indicates whether
+ *		all translation units were compiled without error.
+ */
+
+static int run(int argc, char *argv[])
+{
+    string output, usage = " [-T] [--stats] [--cache dir] [--emit-decls file] [--use-decls file] [--prune] [--export name] [--emit-obj] [--run] [--profile-generate] [--profile-use file] [-j jobs] [-t threads] [-o output] [file ...]";
+    static const struct option options[] = {
+	{"stats", no_argument, nullptr, 'S'},
+	{"cache", required_argument, nullptr, 'C'},
+	{"emit-decls", required_argument, nullptr, 'E'},
+	{"use-decls", required_argument, nullptr, 'U'},
+	{"prune", no_argument, nullptr, 'P'},
+	{"export", required_argument, nullptr, 'X'},
+	{"emit-obj", no_argument, nullptr, 'O'},
+	{"run", no_argument, nullptr, 'R'},
+	{"profile-generate", no_argument, nullptr, 'G'},
+	{"profile-use", required_argument, nullptr, 'F'},
+	{nullptr, 0, nullptr, 0},
+    };
+    vector<string> inputs, outputs;
+    vector<thread> pool;
+    atomic<size_t> next(0);
+    atomic<bool> failed(false);
+    unsigned jobs = 1, workers = 0;
+    int c;
+
+
+    while ((c = getopt_long(argc, argv, "Tj:o:t:", options, nullptr)) != -1)
+	if (c == 'T')
+	    timing = true;
+	else if (c == 'S')
+	    statistics = true;
+	else if (c == 'C')
+	    Cache::directory = optarg;
+	else if (c == 'E')
+	    exported = optarg;
+	else if (c == 'U') {
+	    imported = new Declarations();
+
+	    if (!imported->open(optarg)) {
+		cerr << "scc: " << optarg << ": cannot use declarations: ";
+		cerr << imported->error() << endl;
+		return EXIT_FAILURE;
+	    }
+	}
+	else if (c == 'P')
+	    prune = true;
+	else if (c == 'X')
+	    roots.push_back(optarg);
+	else if (c == 'O')
+	    objects = true;
+	else if (c == 'R')
+	    running = true;
+	else if (c == 'G')
+	    instrumenting = true;
+	else if (c == 'F') {
+	    profile = new Profile();
+
+	    if (!profile->read(optarg)) {
+		cerr << "scc: " << optarg << ": cannot use profile" << endl;
+		return EXIT_FAILURE;
+	    }
+	}
+	else if (c == 'o')
+	    output = optarg;
+	else if (c == 'j' && atoi(optarg) > 0)
+	    jobs = atoi(optarg);
+	else if (c == 't' && atoi(optarg) >= 0)
+	    workers = atoi(optarg);
+	else {
+	    cerr << "usage: " << argv[0] << usage << endl;
+	    return EXIT_FAILURE;
+	}
+
+    Timer::enabled = timing || statistics;
+
+    if (instrumenting || profile != nullptr || prune)
+	Cache::directory.clear();
+
+    if (!Cache::directory.empty())
+	mkdir(Cache::directory.c_str(), 0777);
+
+    for (int i = optind; i < argc; i ++) {
+	string input = argv[i];
+	size_t length = input.size();
+
+	inputs.push_back(input);
+
+	if (length > 2 && input.compare(length - 2, 2, ".c") == 0)
+	    outputs.push_back(input.substr(0, length - 2) + (objects ? ".o" : ".s"));
+	else
+	    outputs.push_back(input + (objects ? ".o" : ".s"));
+    }
+
+    if (inputs.empty()) {
+	inputs.push_back("");
+	outputs.push_back(output);
+
+    } else if (!output.empty()) {
+	if (inputs.size() > 1) {
+	    cerr << "scc: cannot use -o with multiple files" << endl;
+	    return EXIT_FAILURE;
+	}
+
+	outputs[0] = output;
+    }
+
+    if (!exported.empty() && inputs.size() > 1) {
+	cerr << "scc: cannot use --emit-decls with multiple files" << endl;
+	return EXIT_FAILURE;
+    }
+
+    if (running) {
+	if (inputs.size() > 1) {
+	    cerr << "scc: cannot use --run with multiple files" << endl;
+	    return EXIT_FAILURE;
+	}
+
+	outputs[0].clear();
+    }
+
+    auto work = [&]() {
+	size_t i;
+
+	while ((i = next ++) < inputs.size())
+	    if (!compile(inputs[i], outputs[i], workers))
+		failed = true;
+    };
+
+    jobs = min((size_t) jobs, inputs.size());
+
+    for (unsigned i = 1; i < jobs; i ++)
+	pool.emplace_back(work);
+
+    work();
+
+    for (auto &thread : pool)
+	thread.join();
+
+    if (running && !failed)
+	return execute(inputs[0].empty() ? argv[0] : inputs[0]);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Run the compiler.  With the --server option, the compiler
+ *		instead listens on the given socket and runs the commands
+ *		sent to it.  If the SCC_SERVER environment variable names
+ *		the socket of a server, the command is sent to the server to
+ *		be run, and is only run here if no server is listening.
+ */
+
+int main(int argc, char *argv[])
+{
+    const char *server = getenv("SCC_SERVER");
+    int status;
+
+
+    if (argc == 3 && strcmp(argv[1], "--server") == 0) {
+	if (!serve(argv[2], run))
+	    cerr << "scc: " << argv[2] << ": " << strerror(errno) << endl;
+
+	exit(EXIT_FAILURE);
+    }
 
-    while (lookahead != DONE)
-	functionOrGlobal();
+    if (server == nullptr || *server == '\0' || !forward(server, argc, argv, status))
+	status = run(argc, argv);
 
-    generateGlobals(closeScope());
-    exit(EXIT_SUCCESS);
+    exit(status);
 }
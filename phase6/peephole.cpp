@@ -0,0 +1,992 @@
+/*
+ * File:	peephole.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for the peephole optimizer for Simple C.
+ *
+ *		The optimizer works on the list of instructions generated
+ *		for a function.  A rule looks at a small window of adjacent
+ *		instructions, starting at a given position, and rewrites it
+ *		if it matches.  We repeatedly apply all rules at all
+ *		positions until nothing changes, or until we give up.
+ *
+ *		Many rules are only valid if a register is not used after
+ *		the window, so each pass begins by computing the registers
+ *		live after each instruction, using the usual backwards
+ *		dataflow analysis over the jumps and labels of the list.
+ *		The liveness is not updated as rules are applied, which is
+ *		safe since no rule makes a dead register live at a point
+ *		after its window.  A window never spans a label, except as
+ *		explicitly checked by the rules for jumps.
+ *
+ *		Instructions are deleted by turning them into labels with
+ *		no name, which are squeezed out before the next pass.
+ *		To keep the passes cheap, each instruction is only offered
+ *		to the rules that can match its opcode.
+ */
+
+# include <map>
+# include <cctype>
+# include <cstdlib>
+# include <cstring>
+# include <unordered_map>
+# include <unordered_set>
+# include "peephole.h"
+# include "machine.h"
+
+using namespace std;
+
+# define MAX_PASSES 8
+
+# define RAX (1 << 0)
+# define RCX (1 << 1)
+# define RDX (1 << 2)
+# define RBX (1 << 3)
+# define RSP (1 << 4)
+# define RBP (1 << 5)
+# define RSI (1 << 6)
+# define RDI (1 << 7)
+# define R8  (1 << 8)
+# define R9  (1 << 9)
+# define R10 (1 << 10)
+# define R11 (1 << 11)
+# define ALL 0xffff
+
+# define ARGUMENTS (RDI | RSI | RDX | RCX | R8 | R9)
+# define CALLER_SAVED (RAX | RCX | RDX | RSI | RDI | R8 | R9 | R10 | R11)
+# define CALLEE_SAVED (RBX | RSP | RBP | 0xf000)
+# define SCRATCH (RAX | RDX | R11)
+
+typedef bool (*Rule)(Instructions &, size_t);
+
+static thread_local vector<unsigned> live;
+static thread_local unordered_map<string, size_t> labels;
+
+static const map<string, string> inverses = {
+    {"e", "ne"}, {"ne", "e"}, {"l", "ge"}, {"ge", "l"}, {"g", "le"},
+    {"le", "g"}, {"b", "ae"}, {"ae", "b"}, {"a", "be"}, {"be", "a"},
+};
+
+
+/*
+ * Function:	number (private)
+ *
+ * Description:	Return the number of the register with the given name,
+ *		using any of its access sizes, or -1 if there is no such
+ *		register.  The number is the one used in the encoding of
+ *		the register.
+ */
+
+static int number(const char *name, size_t length)
+{
+    static const char cores[][3] = {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di"};
+    static const char bytes[][3] = {"al", "cl", "dl", "bl"};
+
+
+    if (length >= 2 && name[0] == 'r' && isdigit(name[1]))
+	return atoi(name + 1);
+
+    if (length == 3 && (name[0] == 'r' || name[0] == 'e'))
+	name ++;
+    else if (length == 3 && name[2] != 'l')
+	return -1;
+    else if (length != 2 && length != 3)
+	return -1;
+
+    for (unsigned r = 0; r < 8; r ++)
+	if (name[0] == cores[r][0] && name[1] == cores[r][1])
+	    return r;
+
+    for (unsigned r = 0; r < 4; r ++)
+	if (name[0] == bytes[r][0] && name[1] == bytes[r][1])
+	    return r;
+
+    return -1;
+}
+
+
+/*
+ * Function:	registers (private)
+ *
+ * Description:	Return the set of registers mentioned in an operand.  An
+ *		unknown register is assumed to be any register.
+ */
+
+static unsigned registers(const string &operand)
+{
+    const char *s = operand.c_str(), *t;
+    unsigned result = 0;
+    int r;
+
+
+    for (s = strchr(s, '%'); s != nullptr; s = strchr(t, '%')) {
+	for (t = ++ s; isalnum(*t); t ++)
+	    continue;
+
+	r = number(s, t - s);
+	result |= r >= 0 ? 1 << r : ALL;
+    }
+
+    return result;
+}
+
+
+/*
+ * Function:	isRegister (private)
+ *
+ * Description:	Return whether an operand is a register.
+ */
+
+static bool isRegister(const string &operand)
+{
+    return !operand.empty() && operand[0] == '%';
+}
+
+
+/*
+ * Function:	isImmediate (private)
+ *
+ * Description:	Return whether an operand is an immediate value.
+ */
+
+static bool isImmediate(const string &operand)
+{
+    return !operand.empty() && operand[0] == '$';
+}
+
+
+/*
+ * Function:	isMemory (private)
+ *
+ * Description:	Return whether an operand is in memory, which includes
+ *		globals named only by their symbol.
+ */
+
+static bool isMemory(const string &operand)
+{
+    return !operand.empty() && !isRegister(operand) && !isImmediate(operand);
+}
+
+
+/*
+ * Function:	isLocal (private)
+ *
+ * Description:	Return whether an operand is the local entry of a function.
+ */
+
+static bool isLocal(const string &operand)
+{
+    size_t length = strlen(local_suffix);
+
+    return operand.size() > length &&
+	operand.compare(operand.size() - length, length, local_suffix) == 0;
+}
+
+
+/*
+ * Function:	fitsImmediate (private)
+ *
+ * Description:	Return whether an operand can be used as an immediate of
+ *		an instruction of the given size.  A 64-bit instruction
+ *		only takes a sign-extended 32-bit immediate, except for a
+ *		move into a register, which we never create.
+ */
+
+static bool fitsImmediate(const string &operand, unsigned size)
+{
+    char *end;
+    long value;
+
+
+    if (size != 8)
+	return true;
+
+    value = strtol(operand.c_str() + 1, &end, 10);
+    return *end == '\0' && value == (int) value;
+}
+
+
+/*
+ * Function:	isDeleted (private)
+ *
+ * Description:	Return whether an instruction has been deleted.
+ */
+
+static bool isDeleted(const Instruction &insn)
+{
+    return insn.opcode.empty() && insn.target.empty();
+}
+
+
+/*
+ * Function:	remove (private)
+ *
+ * Description:	Delete an instruction.
+ */
+
+static void remove(Instruction &insn)
+{
+    insn.opcode.clear();
+    insn.source.clear();
+    insn.target.clear();
+}
+
+
+/*
+ * Function:	isJump (private)
+ *
+ * Description:	Return whether an instruction is a jump, either
+ *		conditional or unconditional.
+ */
+
+static bool isJump(const Instruction &insn)
+{
+    return !insn.opcode.empty() && insn.opcode[0] == 'j';
+}
+
+
+/*
+ * Function:	isBranch (private)
+ *
+ * Description:	Return whether an instruction is a conditional jump whose
+ *		condition we know how to invert.
+ */
+
+static bool isBranch(const Instruction &insn)
+{
+    return isJump(insn) && inverses.count(insn.opcode.substr(1)) > 0;
+}
+
+
+/*
+ * Function:	next (private)
+ *
+ * Description:	Return the position of the next instruction that has not
+ *		been deleted.
+ */
+
+static size_t next(const Instructions &code, size_t i)
+{
+    for (i ++; i < code.size() && isDeleted(code[i]); i ++)
+	continue;
+
+    return i;
+}
+
+
+/*
+ * Function:	following (private)
+ *
+ * Description:	Return the position of the next instruction within the
+ *		same window, or the end if the window would span a label.
+ */
+
+static size_t following(const Instructions &code, size_t i)
+{
+    i = next(code, i);
+    return i < code.size() && !code[i].isLabel() ? i : code.size();
+}
+
+
+/*
+ * Function:	precedes (private)
+ *
+ * Description:	Return whether the instruction at the given position is
+ *		immediately followed by the given label, possibly among
+ *		other labels.
+ */
+
+static bool precedes(const Instructions &code, size_t i, const string &label)
+{
+    for (i = next(code, i); i < code.size() && code[i].isLabel(); i = next(code, i))
+	if (code[i].target == label)
+	    return true;
+
+    return false;
+}
+
+
+/*
+ * Function:	normalize (private)
+ *
+ * Description:	Move the size suffix of common opcodes written with their
+ *		suffix into the size, so that the rules need only examine
+ *		one spelling of each opcode.
+ */
+
+static void normalize(Instructions &code)
+{
+    static const string opcodes[] = {
+	"mov", "add", "sub", "cmp", "lea", "push", "pop", "movzb"
+    };
+
+    for (auto &insn : code)
+	if (insn.size == 0 && insn.opcode.size() > 1) {
+	    char suffix = insn.opcode.back();
+	    unsigned size = suffix == 'b' ? 1 : (suffix == 'l' ? 4 : (suffix == 'q' ? 8 : 0));
+
+	    if (size == 0)
+		continue;
+
+	    for (auto &opcode : opcodes)
+		if (insn.opcode.size() == opcode.size() + 1 &&
+			insn.opcode.compare(0, opcode.size(), opcode) == 0) {
+		    insn.opcode = opcode;
+		    insn.size = size;
+		    break;
+		}
+	}
+}
+
+
+/*
+ * Function:	effects (private)
+ *
+ * Description:	Determine the registers used and defined by an instruction.
+ *		A register is only defined if the instruction overwrites
+ *		it entirely, which excludes writing a byte register.  A
+ *		call of a local entry may take its arguments in any
+ *		registers and change only some of the caller-saved ones, and
+ *		so is assumed to use every register and to change only the
+ *		scratch registers, which are never live across a call.
+ */
+
+static void effects(const Instruction &insn, unsigned &uses, unsigned &defs)
+{
+    const string &op = insn.opcode;
+    unsigned source, target;
+
+
+    uses = defs = 0;
+
+    if (insn.isLabel() || isJump(insn))
+	return;
+
+    source = registers(insn.source);
+    target = registers(insn.target);
+
+    /* Only a few opcodes have implicit operands, and they can be
+       recognized by their first letter before comparing. */
+
+    if (strchr("cdipr", op[0]) != nullptr) {
+	if (op == "call" && isLocal(insn.target)) {
+	    uses = ALL;
+	    defs = SCRATCH;
+	    return;
+	}
+
+	if (op == "call") {
+	    uses = ARGUMENTS | RAX | RSP;
+	    defs = CALLER_SAVED;
+	    return;
+	}
+
+	if (op == "ret") {
+	    uses = RAX | CALLEE_SAVED;
+	    return;
+	}
+
+	if (op == "cltd" || op == "cqto") {
+	    uses = RAX;
+	    defs = RDX;
+	    return;
+	}
+
+	if (op == "imul" && insn.source.empty()) {
+	    uses = target | RAX;
+	    defs = RAX | RDX;
+	    return;
+	}
+
+	if (op == "idiv" || op == "div") {
+	    uses = target | RAX | RDX;
+	    defs = RAX | RDX;
+	    return;
+	}
+
+	if (op == "push") {
+	    uses = target | RSP;
+	    defs = RSP;
+	    return;
+	}
+
+	if (op == "pop") {
+	    uses = RSP | (isRegister(insn.target) ? 0 : target);
+	    defs = RSP | (isRegister(insn.target) ? target : 0);
+	    return;
+	}
+    }
+
+    if (!isRegister(insn.target) || op == "cmp" || op == "test")
+	uses = source | target;
+
+    else if ((op == "mov" && insn.size != 1) || op == "lea" ||
+	    op == "movzb" || op.compare(0, 4, "movs") == 0) {
+	uses = source;
+	defs = target;
+
+    } else {
+	uses = source | target;
+	defs = target;
+    }
+}
+
+
+/*
+ * Function:	analyze (private)
+ *
+ * Description:	Compute the registers live after each instruction, and
+ *		record the position of each label.  The successors of each
+ *		instruction are found first, so that iterating to a fixed
+ *		point need not look at the instructions again.
+ */
+
+static void analyze(const Instructions &code)
+{
+    static const size_t none = -1, exit = -2, unknown = -3;
+    static thread_local vector<unsigned> in, uses, defs;
+    static thread_local vector<size_t> targets;
+    static thread_local vector<bool> falls;
+
+    bool changed;
+    unsigned out;
+    size_t i, n = code.size();
+
+
+    labels.clear();
+    live.assign(n, 0);
+    in.assign(n + 1, 0);
+    uses.resize(n);
+    defs.resize(n);
+    targets.assign(n, none);
+    falls.assign(n, true);
+
+    for (i = 0; i < n; i ++)
+	if (code[i].isLabel())
+	    labels[code[i].target] = i;
+
+    for (i = 0; i < n; i ++) {
+	const Instruction &insn = code[i];
+
+	effects(insn, uses[i], defs[i]);
+
+	if (insn.opcode == "ret") {
+	    targets[i] = exit;
+	    falls[i] = false;
+	} else if (isJump(insn)) {
+	    auto it = labels.find(insn.target);
+	    targets[i] = it != labels.end() ? it->second : unknown;
+	    falls[i] = insn.opcode != "jmp";
+	}
+    }
+
+    do {
+	changed = false;
+
+	for (i = n; i -- > 0; ) {
+	    out = falls[i] ? in[i + 1] : 0;
+
+	    if (targets[i] == unknown)
+		out = ALL;
+	    else if (targets[i] != none && targets[i] != exit)
+		out |= in[targets[i]];
+
+	    live[i] = out;
+	    out = uses[i] | (out & ~defs[i]);
+
+	    if (out != in[i]) {
+		in[i] = out;
+		changed = true;
+	    }
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	removeLabels (private)
+ *
+ * Description:	Delete the local labels that are no longer the target of
+ *		any jump.  The labels of string literals are not part of
+ *		the code, so a local label can only be used by a jump.
+ */
+
+static bool removeLabels(Instructions &code)
+{
+    unordered_set<string> references;
+    bool changed = false;
+
+
+    for (auto &insn : code)
+	if (isJump(insn))
+	    references.insert(insn.target);
+
+    for (auto &insn : code)
+	if (insn.isLabel() && insn.target.compare(0, 2, ".L") == 0)
+	    if (references.count(insn.target) == 0) {
+		remove(insn);
+		changed = true;
+	    }
+
+    return changed;
+}
+
+
+/*
+ * Function:	unreachable (private)
+ *
+ * Description:	Delete the instructions following an unconditional jump or
+ *		a return up to the next label, since they can never be
+ *		executed.
+ */
+
+static bool unreachable(Instructions &code, size_t i)
+{
+    bool changed = false;
+
+
+    if (code[i].opcode != "jmp" && code[i].opcode != "ret")
+	return false;
+
+    for (i = following(code, i); i < code.size(); i = following(code, i)) {
+	remove(code[i]);
+	changed = true;
+    }
+
+    return changed;
+}
+
+
+/*
+ * Function:	jumpToNext (private)
+ *
+ *		jmp L		=>
+ *	    L:			    L:
+ *
+ * Description:	Delete a jump to the label that follows it.
+ */
+
+static bool jumpToNext(Instructions &code, size_t i)
+{
+    if (code[i].opcode != "jmp" || !precedes(code, i, code[i].target))
+	return false;
+
+    remove(code[i]);
+    return true;
+}
+
+
+/*
+ * Function:	branchOverJump (private)
+ *
+ *		jcc L1		=>	jncc L2
+ *		jmp L2
+ *	    L1:			    L1:
+ *
+ * Description:	Invert a conditional jump over an unconditional jump.
+ */
+
+static bool branchOverJump(Instructions &code, size_t i)
+{
+    size_t j = following(code, i);
+
+
+    if (!isBranch(code[i]) || j == code.size() || code[j].opcode != "jmp")
+	return false;
+
+    if (!precedes(code, j, code[i].target))
+	return false;
+
+    code[i].opcode = "j" + inverses.at(code[i].opcode.substr(1));
+    code[i].target = code[j].target;
+    remove(code[j]);
+    return true;
+}
+
+
+/*
+ * Function:	threadJump (private)
+ *
+ *		jcc L1		=>	jcc L2
+ *		...			...
+ *	    L1:			    L1:
+ *		jmp L2			jmp L2
+ *
+ * Description:	Retarget a jump to an unconditional jump.
+ */
+
+static bool threadJump(Instructions &code, size_t i)
+{
+    size_t j;
+
+
+    if (!isJump(code[i]))
+	return false;
+
+    auto it = labels.find(code[i].target);
+
+    if (it == labels.end())
+	return false;
+
+    for (j = it->second; j < code.size() && code[j].isLabel(); j = next(code, j))
+	continue;
+
+    if (j == code.size() || code[j].opcode != "jmp")
+	return false;
+
+    if (code[j].target == code[i].target)
+	return false;
+
+    code[i].target = code[j].target;
+    return true;
+}
+
+
+/*
+ * Function:	storeReload (private)
+ *
+ *		mov S, M	=>	mov S, M
+ *		mov M, D		mov S, D
+ *
+ * Description:	Replace loading a value just stored with the value itself,
+ *		removing the load entirely if the value is already there.
+ */
+
+static bool storeReload(Instructions &code, size_t i)
+{
+    size_t j = following(code, i);
+    Instruction &a = code[i];
+
+
+    if (a.opcode != "mov" || j == code.size() || !isMemory(a.target))
+	return false;
+
+    if (isMemory(a.source))
+	return false;
+
+    Instruction &b = code[j];
+
+    if (b.opcode != "mov" || b.size != a.size || b.source != a.target)
+	return false;
+
+    if (!isRegister(b.target))
+	return false;
+
+    if (b.target == a.source)
+	remove(b);
+    else
+	b.source = a.source;
+
+    return true;
+}
+
+
+/*
+ * Function:	selfMove (private)
+ *
+ *		mov R, R	=>
+ *
+ * Description:	Delete a move of a register to itself.  A 32-bit move is
+ *		not deleted, since it clears the upper half of the
+ *		register.
+ */
+
+static bool selfMove(Instructions &code, size_t i)
+{
+    Instruction &a = code[i];
+
+
+    if (a.opcode != "mov" || a.size == 4 || a.source != a.target)
+	return false;
+
+    remove(a);
+    return true;
+}
+
+
+/*
+ * Function:	compareBranch (private)
+ *
+ *		setcc B		=>	jcc L
+ *		movzb B, R
+ *		cmp $0, R
+ *		jne L
+ *
+ * Description:	Jump directly on the condition of a comparison rather
+ *		than materializing and then testing its result, provided
+ *		that the result is not used afterwards.
+ */
+
+static bool compareBranch(Instructions &code, size_t i)
+{
+    size_t j, k, l;
+    string cc;
+
+
+    if (code[i].opcode.compare(0, 3, "set") != 0)
+	return false;
+
+    cc = code[i].opcode.substr(3);
+
+    if (inverses.count(cc) == 0)
+	return false;
+
+    if ((j = following(code, i)) == code.size() || (k = following(code, j)) == code.size())
+	return false;
+
+    if ((l = following(code, k)) == code.size())
+	return false;
+
+    Instruction &b = code[j], &c = code[k], &d = code[l];
+    unsigned reg = registers(b.target);
+
+    if (b.opcode != "movzb" || b.source != code[i].target || !isRegister(b.target))
+	return false;
+
+    if (c.opcode != "cmp" || c.size != b.size || c.source != "$0" || c.target != b.target)
+	return false;
+
+    if ((d.opcode != "je" && d.opcode != "jne") || (live[l] & reg) != 0)
+	return false;
+
+    if ((registers(b.source) & reg) == 0)
+	return false;
+
+    code[i].opcode = "j" + (d.opcode == "jne" ? cc : inverses.at(cc));
+    code[i].source.clear();
+    code[i].target = d.target;
+    remove(b);
+    remove(c);
+    remove(d);
+    return true;
+}
+
+
+/*
+ * Function:	inPlace (private)
+ *
+ *		mov L, R	=>	op S, L
+ *		op S, R
+ *		mov R, L
+ *
+ * Description:	Operate directly on a location rather than on a copy of it
+ *		in a register that is not used afterwards.
+ */
+
+static bool inPlace(Instructions &code, size_t i)
+{
+    static const string opcodes[] = {
+	"add", "sub", "imul", "and", "or", "xor", "sal", "sar", "shr", "neg"
+    };
+
+    size_t j, k;
+    Instruction &a = code[i];
+    unsigned reg;
+    bool found = false;
+
+
+    if (a.opcode != "mov" || a.size == 1 || !isRegister(a.target))
+	return false;
+
+    if (isImmediate(a.source) || a.source == a.target)
+	return false;
+
+    if ((j = following(code, i)) == code.size() || (k = following(code, j)) == code.size())
+	return false;
+
+    Instruction &b = code[j], &c = code[k];
+    reg = registers(a.target);
+
+    if (b.size != a.size || b.target != a.target)
+	return false;
+
+    for (auto &opcode : opcodes)
+	found |= b.opcode == opcode;
+
+    if (!found)
+	return false;
+
+    if (c.opcode != "mov" || c.size != a.size || c.source != a.target || c.target != a.source)
+	return false;
+
+    if ((registers(b.source) & reg) != 0 || (live[k] & reg) != 0)
+	return false;
+
+    if (isMemory(a.source) && (isMemory(b.source) || b.opcode == "imul"))
+	return false;
+
+    b.target = a.source;
+    remove(a);
+    remove(c);
+    return true;
+}
+
+
+/*
+ * Function:	forward (private)
+ *
+ *		mov X, R	=>	op X, Y
+ *		op R, Y
+ *
+ * Description:	Use a value directly rather than through a register that
+ *		is not used afterwards.  The register must appear only once
+ *		in the second instruction, and the result must still be a
+ *		legal instruction.
+ */
+
+static bool forward(Instructions &code, size_t i)
+{
+    static const string opcodes[] = {
+	"mov", "add", "sub", "imul", "and", "or", "xor", "cmp", "test"
+    };
+
+    size_t j;
+    Instruction &a = code[i];
+    unsigned reg;
+    bool found = false;
+
+
+    if (a.opcode != "mov" || a.size == 1 || !isRegister(a.target))
+	return false;
+
+    if (a.source == a.target || (j = following(code, i)) == code.size())
+	return false;
+
+    Instruction &b = code[j];
+    reg = registers(a.target);
+
+    if (b.size != a.size || (live[j] & reg) != 0)
+	return false;
+
+    for (auto &opcode : opcodes)
+	found |= b.opcode == opcode;
+
+    if (!found)
+	return false;
+
+    if (b.source == a.target && (registers(b.target) & reg) == 0) {
+	if (isMemory(a.source) && isMemory(b.target))
+	    return false;
+
+	if (isImmediate(a.source) && !fitsImmediate(a.source, b.size))
+	    return false;
+
+	if (b.opcode == "imul" && !isRegister(b.target))
+	    return false;
+
+	b.source = a.source;
+
+    } else if (b.target == a.target && (registers(b.source) & reg) == 0) {
+	if (b.opcode != "cmp" && b.opcode != "test")
+	    return false;
+
+	if (isImmediate(a.source) || (isMemory(a.source) && isMemory(b.source)))
+	    return false;
+
+	b.target = a.source;
+
+    } else
+	return false;
+
+    remove(a);
+    return true;
+}
+
+
+/*
+ * Function:	compact (private)
+ *
+ * Description:	Squeeze the deleted instructions out of the code.
+ */
+
+static void compact(Instructions &code)
+{
+    size_t i, j;
+
+
+    for (i = j = 0; i < code.size(); i ++)
+	if (!isDeleted(code[i])) {
+	    if (i != j)
+		code[j] = move(code[i]);
+
+	    j ++;
+	}
+
+    code.erase(code.begin() + j, code.end());
+}
+
+
+/*
+ * Function:	candidates (private)
+ *
+ * Description:	Return the rules that can apply to an instruction, which
+ *		are selected by its opcode so that most instructions need
+ *		not be examined by every rule.
+ */
+
+static const Rule *candidates(const Instruction &insn)
+{
+    static const Rule jumps[] = {
+	unreachable, jumpToNext, branchOverJump, threadJump, nullptr
+    };
+
+    static const Rule moves[] = {
+	storeReload, selfMove, inPlace, forward, nullptr
+    };
+
+    static const Rule sets[] = {compareBranch, nullptr};
+    static const Rule returns[] = {unreachable, nullptr};
+
+
+    if (isJump(insn))
+	return jumps;
+
+    if (insn.opcode == "mov")
+	return moves;
+
+    if (insn.opcode.compare(0, 3, "set") == 0)
+	return sets;
+
+    if (insn.opcode == "ret")
+	return returns;
+
+    return nullptr;
+}
+
+
+/*
+ * Function:	optimize
+ *
+ * Description:	Optimize the code for a function by repeatedly applying
+ *		the rules until no more changes are made.
+ */
+
+void optimize(Instructions &code)
+{
+    const Rule *rules;
+    bool changed;
+    unsigned pass;
+    size_t i;
+
+
+    normalize(code);
+
+    for (pass = 0; pass < MAX_PASSES; pass ++) {
+	changed = removeLabels(code);
+	compact(code);
+	analyze(code);
+
+	for (i = 0; i < code.size(); i ++)
+	    if ((rules = candidates(code[i])) != nullptr)
+		for (; *rules != nullptr; rules ++)
+		    if ((*rules)(code, i)) {
+			changed = true;
+			break;
+		    }
+
+	if (!changed)
+	    break;
+    }
+
+    compact(code);
+}
@@ -0,0 +1,14 @@
+/*
+ * File:	peephole.h
+ *
+ * Description:	This file contains the public function declarations for the
+ *		peephole optimizer for Simple C.
+ */
+
+# ifndef PEEPHOLE_H
+# define PEEPHOLE_H
+# include "Instruction.h"
+
+void optimize(Instructions &code);
+
+# endif /* PEEPHOLE_H */
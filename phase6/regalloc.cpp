@@ -0,0 +1,365 @@
+/*
+ * File:	regalloc.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		register allocation.  The actual classes are declared
+ *		elsewhere, mainly in IR.h.
+ *
+ *		We first compute the temporaries live on entry to and exit
+ *		from each basic block using the usual backwards dataflow
+ *		analysis, and then number the quads in the order in which
+ *		the blocks are laid out.  The live range of a temporary is
+ *		then simply the interval from its first definition or use
+ *		to its last, extended to cover the blocks it is live across.
+ *		Uses are numbered before definitions, so a temporary that
+ *		dies in a quad can share a register with the result.
+ *
+ *		The intervals are then allocated using linear scan.  A
+ *		temporary live across a call must be in a callee-saved
+ *		register, which survives the call without being saved, or
+ *		in a caller-saved register that a local callee is known not
+ *		to change, and any other temporary may be in either kind of
+ *		register.  When
+ *		we run out of registers, the interval with the smallest
+ *		spill cost stays in memory, where the cost of an interval
+ *		is its number of definitions and uses, weighted by the loop
+ *		depth of each, or by the count of its block if profiled.
+ *		Temporaries spilled with disjoint intervals share a stack
+ *		slot, just as they would share a register.
+ *
+ *		Temporaries passed as arguments, and the parameters, prefer
+ *		the registers in which they are passed, to avoid moves.  An
+ *		argument of a local callee prefers the register in which the
+ *		callee takes it.
+ */
+
+# include <map>
+# include <queue>
+# include <climits>
+# include <algorithm>
+# include "IR.h"
+# include "Register.h"
+# include "Conventions.h"
+
+using namespace std;
+
+# define LOOP_WEIGHT 10
+# define MAX_WEIGHT 1000000
+
+typedef vector<unsigned long> Bits;
+typedef pair<unsigned, unsigned> Occupant;
+typedef priority_queue<Occupant, vector<Occupant>, greater<Occupant>> Slots;
+
+struct Interval {
+    unsigned temp;
+    unsigned start, end;
+    unsigned long cost;
+    unsigned clobbered;
+    Register *hint;
+};
+
+
+/*
+ * Function:	bit (private)
+ *
+ * Description:	Return whether the given temporary is in the set.
+ */
+
+static bool bit(const Bits &bits, unsigned temp)
+{
+    return bits[temp / 64] >> (temp % 64) & 1;
+}
+
+
+/*
+ * Function:	set (private)
+ *
+ * Description:	Add the given temporary to the set.
+ */
+
+static void set(Bits &bits, unsigned temp)
+{
+    bits[temp / 64] |= 1UL << (temp % 64);
+}
+
+
+/*
+ * Function:	Procedure::liveness
+ *
+ * Description:	Compute the temporaries live on exit from each block.  The
+ *		blocks are visited in reverse order, which for the mostly
+ *		structured graphs we create converges in a few passes.
+ */
+
+void Procedure::liveness(vector<Bits> &liveOut) const
+{
+    unsigned words = (temps.size() + 63) / 64, i, j, k;
+    vector<Bits> uses(blocks.size(), Bits(words)), defs(uses), liveIn(uses);
+    vector<Operand *> operands;
+    bool changed;
+
+
+    for (i = 0; i < blocks.size(); i ++)
+	for (auto &quad : blocks[i]->quads) {
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp() && !bit(defs[i], operand->temp))
+		    set(uses[i], operand->temp);
+
+	    if (quad.result.isTemp())
+		set(defs[i], quad.result.temp);
+	}
+
+    liveOut.assign(blocks.size(), Bits(words));
+
+    do {
+	changed = false;
+
+	for (i = blocks.size(); i -- > 0; ) {
+	    BasicBlock *block = blocks[i];
+
+	    for (j = 0; j < block->successors(); j ++) {
+		const Bits &in = liveIn[block->next[j]->number];
+
+		for (k = 0; k < words; k ++)
+		    liveOut[i][k] |= in[k];
+	    }
+
+	    for (k = 0; k < words; k ++) {
+		unsigned long in = uses[i][k] | (liveOut[i][k] & ~defs[i][k]);
+
+		if (in != liveIn[i][k]) {
+		    liveIn[i][k] = in;
+		    changed = true;
+		}
+	    }
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	Procedure::allocateRegisters
+ *
+ * Description:	Allocate registers to the temporaries of this procedure
+ *		using linear scan, and return the callee-saved registers
+ *		used, which the function must save and restore.  Any
+ *		temporary not given a register is given a stack slot.  The
+ *		parameters are live on entry, so their intervals start at
+ *		zero.  The given conventions are those of the local callees.
+ */
+
+vector<Register *>
+Procedure::allocateRegisters(const vector<Register *> &callerSaved,
+	const vector<Register *> &calleeSaved,
+	const vector<Register *> &parameters, const Conventions &conventions)
+{
+    vector<Interval> intervals(temps.size(), {0, UINT_MAX, 0, 0, 0, nullptr});
+    vector<Interval *> sorted, active;
+    map<unsigned, Slots> slots;
+    vector<Register *> used, order, allowed;
+    vector<Bits> liveOut;
+    vector<pair<unsigned, unsigned>> calls;
+    vector<unsigned> depth(blocks.size(), 0);
+    vector<Operand *> operands;
+    unsigned i, j, position, start, all = (1 << callerSaved.size()) - 1;
+    unsigned long weight;
+
+
+    /* Compute the loop depth of each block.  Since the blocks are laid
+       out in order, a branch backwards closes a loop containing all the
+       blocks in between. */
+
+    for (auto block : blocks)
+	for (i = 0; i < block->successors(); i ++)
+	    if (block->next[i]->number <= block->number)
+		for (j = block->next[i]->number; j <= block->number; j ++)
+		    depth[j] ++;
+
+
+    /* Compute the interval of each temporary. */
+
+    liveness(liveOut);
+
+    for (i = 0; i < temps.size(); i ++)
+	intervals[i].temp = i;
+
+    for (i = 0; i < params.size(); i ++)
+	if (params[i].isTemp()) {
+	    intervals[params[i].temp].start = 0;
+	    intervals[params[i].temp].end = 0;
+	    intervals[params[i].temp].hint = parameters[i];
+	}
+
+    position = 2;
+
+    for (auto block : blocks) {
+	start = position;
+	weight = 1;
+
+	if (profiled)
+	    weight += block->count;
+	else
+	    for (i = 0; i < depth[block->number] && weight < MAX_WEIGHT; i ++)
+		weight *= LOOP_WEIGHT;
+
+	for (auto &quad : block->quads) {
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp()) {
+		    Interval &interval = intervals[operand->temp];
+
+		    interval.start = min(interval.start, position);
+		    interval.end = max(interval.end, position);
+		    interval.cost += weight;
+		}
+
+	    if (quad.callee != nullptr) {
+		const Convention *convention = conventions.find(quad.callee, function);
+		const vector<Register *> *hints = &parameters;
+
+		if (convention != nullptr)
+		    hints = &convention->arguments;
+
+		if (quad.opcode == CALL && convention == nullptr)
+		    calls.emplace_back(position, all);
+		else if (quad.opcode == CALL) {
+		    calls.emplace_back(position, 0);
+
+		    for (i = 0; i < callerSaved.size(); i ++)
+			if (find(convention->clobbered.begin(), convention->clobbered.end(),
+				callerSaved[i]) != convention->clobbered.end())
+			    calls.back().second |= 1 << i;
+		}
+
+		for (i = 0; i < quad.args.size() && i < hints->size(); i ++)
+		    if (quad.args[i].isTemp())
+			intervals[quad.args[i].temp].hint = (*hints)[i];
+	    }
+
+	    if (quad.result.isTemp()) {
+		Interval &interval = intervals[quad.result.temp];
+
+		interval.start = min(interval.start, position + 1);
+		interval.end = max(interval.end, position + 1);
+		interval.cost += weight;
+	    }
+
+	    position += 2;
+	}
+
+	for (i = 0; i < temps.size(); i ++)
+	    if (bit(liveOut[block->number], i)) {
+		intervals[i].start = min(intervals[i].start, start);
+		intervals[i].end = max(intervals[i].end, position);
+	    }
+    }
+
+    for (auto &interval : intervals)
+	if (interval.start != UINT_MAX) {
+	    auto it = upper_bound(calls.begin(), calls.end(),
+		    make_pair(interval.start, UINT_MAX));
+
+	    for (; it != calls.end() && it->first < interval.end; it ++)
+		interval.clobbered |= it->second;
+
+	    sorted.push_back(&interval);
+	}
+
+    sort(sorted.begin(), sorted.end(), [](Interval *a, Interval *b) {
+	return a->start < b->start;
+    });
+
+
+    /* Allocate the registers.  A temporary prefers a caller-saved
+       register that no call it is live across may change, so that the
+       callee-saved registers remain for those needing them. */
+
+    registers.assign(temps.size(), nullptr);
+    spills.assign(temps.size(), 0);
+    spilled = 0;
+    order = callerSaved;
+    order.insert(order.end(), calleeSaved.begin(), calleeSaved.end());
+
+    /* The slots of each size are ordered by the end of the last
+       interval spilled to each.  Every interval spilled so far starts
+       no later than the one now being spilled, so the first slot is
+       free if its last interval has ended. */
+
+    auto spill = [&](Interval *interval) {
+	unsigned size = temps[interval->temp];
+	Slots &free = slots[size];
+
+	if (!free.empty() && free.top().first < interval->start) {
+	    spills[interval->temp] = free.top().second;
+	    free.pop();
+	} else
+	    spills[interval->temp] = slot(size, size).slot;
+
+	free.emplace(interval->end, spills[interval->temp]);
+	spilled ++;
+    };
+
+    for (auto interval : sorted) {
+	Register *chosen = nullptr;
+
+	allowed.clear();
+
+	for (i = 0; i < order.size(); i ++)
+	    if (i >= callerSaved.size() || (interval->clobbered >> i & 1) == 0)
+		allowed.push_back(order[i]);
+
+	for (i = 0; i < active.size(); )
+	    if (active[i]->end < interval->start)
+		active.erase(active.begin() + i);
+	    else
+		i ++;
+
+	auto isFree = [&](Register *reg) {
+	    for (auto other : active)
+		if (registers[other->temp] == reg)
+		    return false;
+
+	    return true;
+	};
+
+	if (interval->hint != nullptr && isFree(interval->hint))
+	    if (find(allowed.begin(), allowed.end(), interval->hint) != allowed.end())
+		chosen = interval->hint;
+
+	for (i = 0; chosen == nullptr && i < allowed.size(); i ++)
+	    if (isFree(allowed[i]))
+		chosen = allowed[i];
+
+	if (chosen == nullptr) {
+	    Interval *victim = interval;
+
+	    for (auto other : active)
+		if (find(allowed.begin(), allowed.end(), registers[other->temp]) != allowed.end())
+		    if (other->cost < victim->cost ||
+			(other->cost == victim->cost && other->end > victim->end))
+			victim = other;
+
+	    if (victim == interval) {
+		spill(interval);
+		continue;
+	    }
+
+	    chosen = registers[victim->temp];
+	    registers[victim->temp] = nullptr;
+	    spill(victim);
+	    active.erase(find(active.begin(), active.end(), victim));
+	}
+
+	registers[interval->temp] = chosen;
+	active.push_back(interval);
+    }
+
+    for (auto reg : calleeSaved)
+	if (find(registers.begin(), registers.end(), reg) != registers.end())
+	    used.push_back(reg);
+
+    return used;
+}
@@ -0,0 +1,515 @@
+/*
+ * File:	scanner.cpp
+ *
+ * Description:	This file contains the hand-written lexical analyzer for
+ *		Simple C, which may be built instead of the flex scanner
+ *		using "make SCANNER=scanner.o".  It recognizes exactly the
+ *		same tokens and reports exactly the same errors as the flex
+ *		description in lexer.l, which remains the specification.
+ *
+ *		The source is scanned in place.  Runs of whitespace, the
+ *		bodies of comments, and the extents of identifiers and
+ *		numbers are found sixteen characters at a time using SSE2,
+ *		which every x86-64 processor has, and a character at a time
+ *		elsewhere.  The source is padded with null characters, so
+ *		we can always read sixteen characters beyond any position
+ *		within it, and since a null character ends every run, only
+ *		comments need to check for the end of the source.
+ *
+ *		Keywords are recognized using a perfect hash of the length
+ *		and the first and last characters of an identifier.
+ *
+ *		Unlike the flex scanner, this scanner keeps all of its
+ *		state in local variables, and so several translation units
+ *		may be read at once.
+ */
+
+# include <string>
+# include <cerrno>
+# include <cstdlib>
+# include <cctype>
+# include <cstring>
+# include "context.h"
+# include "Source.h"
+# include "tokens.h"
+# include "string.h"
+# include "lexer.h"
+
+# ifdef __SSE2__
+# include <emmintrin.h>
+# endif
+
+using namespace std;
+
+struct Keyword {
+    const char *name;
+    int token;
+};
+
+static const Keyword keywords[64] = {
+    {"return", RETURN}, {}, {"unsigned", UNSIGNED}, {},
+    {}, {}, {"if", IF}, {"const", CONST},
+    {}, {}, {"extern", EXTERN}, {"continue", CONTINUE},
+    {"break", BREAK}, {"auto", AUTO}, {}, {"double", DOUBLE},
+    {}, {"int", INT}, {}, {"else", ELSE},
+    {"while", WHILE}, {"volatile", VOLATILE}, {}, {"static", STATIC},
+    {}, {}, {}, {},
+    {"signed", SIGNED}, {"for", FOR}, {"register", REGISTER}, {"default", DEFAULT},
+    {}, {"goto", GOTO}, {}, {},
+    {}, {"union", UNION}, {"sizeof", SIZEOF}, {"short", SHORT},
+    {}, {}, {}, {},
+    {"struct", STRUCT}, {"do", DO}, {}, {},
+    {"switch", SWITCH}, {"float", FLOAT}, {}, {},
+    {}, {}, {}, {"case", CASE},
+    {"char", CHAR}, {"typedef", TYPEDEF}, {}, {"enum", ENUM},
+    {"void", VOID}, {}, {}, {"long", LONG},
+};
+
+
+/*
+ * Function:	complain (private)
+ *
+ * Description:	Report an invalid token at the given line of the input.
+ */
+
+static void complain(unsigned line, const string &str)
+{
+    CompilerContext::current()->lineno = line;
+    report(str);
+}
+
+
+/*
+ * Function:	keyword (private)
+ *
+ * Description:	Return the token for the given identifier if it is a
+ *		keyword, and zero otherwise.
+ */
+
+static int keyword(const char *s, size_t length)
+{
+    const Keyword *kw;
+
+
+    if (length < 2 || length > 8)
+	return 0;
+
+    kw = &keywords[(14 * (unsigned char) s[0] + 5 * (unsigned char) s[length - 1] + 5 * length) & 63];
+
+    if (kw->name != nullptr && strncmp(kw->name, s, length) == 0 && kw->name[length] == '\0')
+	return kw->token;
+
+    return 0;
+}
+
+
+# ifdef __SSE2__
+
+/*
+ * Function:	within (private)
+ *
+ * Description:	Return a mask of the characters in the given vector that
+ *		are within the given number of the given character, treating
+ *		the characters as unsigned.
+ */
+
+static inline __m128i within(__m128i x, char low, char range)
+{
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(low));
+
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(range)), t);
+}
+
+
+/*
+ * Function:	skipSpace (private)
+ *
+ * Description:	Return the first character at or after the given one that
+ *		is not whitespace, counting the newlines skipped.
+ */
+
+static const char *skipSpace(const char *p, unsigned &line)
+{
+    unsigned others, newlines;
+    __m128i x;
+
+
+    while (true) {
+	x = _mm_loadu_si128((const __m128i *) p);
+	others = ~_mm_movemask_epi8(_mm_or_si128(within(x, '\t', '\r' - '\t'),
+		_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')))) & 0xffff;
+	newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+
+	if (others != 0) {
+	    line += __builtin_popcount(newlines & ((others & -others) - 1));
+	    return p + __builtin_ctz(others);
+	}
+
+	line += __builtin_popcount(newlines);
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	skipWord (private)
+ *
+ * Description:	Return the first character at or after the given one that
+ *		cannot be part of an identifier, or of a number if only
+ *		digits are allowed.
+ */
+
+static const char *skipWord(const char *p, bool digits)
+{
+    unsigned others;
+    __m128i x, in;
+
+
+    while (true) {
+	x = _mm_loadu_si128((const __m128i *) p);
+	in = within(x, '0', 9);
+
+	if (!digits) {
+	    in = _mm_or_si128(in, within(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 25));
+	    in = _mm_or_si128(in, _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+	}
+
+	others = ~_mm_movemask_epi8(in) & 0xffff;
+
+	if (others != 0)
+	    return p + __builtin_ctz(others);
+
+	p += 16;
+    }
+}
+
+
+/*
+ * Function:	findStar (private)
+ *
+ * Description:	Return the first asterisk or null character at or after
+ *		the given character and before the given end, or the end if
+ *		there is none, counting the newlines before it.
+ */
+
+static const char *findStar(const char *p, const char *end, unsigned &line)
+{
+    unsigned stars, newlines, valid;
+    __m128i x;
+
+
+    while (p < end) {
+	x = _mm_loadu_si128((const __m128i *) p);
+	stars = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('*')),
+		_mm_cmpeq_epi8(x, _mm_setzero_si128())));
+	newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+	valid = end - p < 16 ? (1 << (end - p)) - 1 : 0xffff;
+	stars &= valid;
+
+	if (stars != 0) {
+	    line += __builtin_popcount(newlines & ((stars & -stars) - 1));
+	    return p + __builtin_ctz(stars);
+	}
+
+	line += __builtin_popcount(newlines & valid);
+	p += 16;
+    }
+
+    return end;
+}
+
+# else
+
+static bool isSpace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static const char *skipSpace(const char *p, unsigned &line)
+{
+    for (; isSpace(*p); p ++)
+	line += *p == '\n';
+
+    return p;
+}
+
+static const char *skipWord(const char *p, bool digits)
+{
+    while (isdigit(*p) || (!digits && (isalpha(*p) || *p == '_')))
+	p ++;
+
+    return p;
+}
+
+static const char *findStar(const char *p, const char *end, unsigned &line)
+{
+    for (; p < end && *p != '*' && *p != '\0'; p ++)
+	line += *p == '\n';
+
+    return p;
+}
+
+# endif
+
+
+/*
+ * Function:	skipComment (private)
+ *
+ * Description:	Return the character after the end of a comment whose
+ *		body begins at the given character.  As with the flex
+ *		scanner, a null character ends a comment, which is then an
+ *		error unless the null character follows an asterisk, as
+ *		does the end of the source.
+ */
+
+static const char *skipComment(const char *p, const char *end, unsigned &line)
+{
+    while ((p = findStar(p, end, line)) < end && *p == '*') {
+	if (++ p == end)
+	    return p;
+
+	if (*p == '/' || *p == '\0')
+	    return p + 1;
+    }
+
+    complain(line, "unterminated comment");
+    return p < end ? p + 1 : end;
+}
+
+
+/*
+ * Function:	skipLiteral (private)
+ *
+ * Description:	Return the character after the end of the string or
+ *		character literal beginning at the given character, or
+ *		null if there is none.  A literal may not span lines.  A
+ *		character literal may not be empty, but of course a string
+ *		literal may.
+ */
+
+static const char *skipLiteral(const char *p, const char *end)
+{
+    char quote = *p ++;
+    const char *start = p;
+
+
+    while (p < end && *p != quote && *p != '\n')
+	if (*p == '\\') {
+	    if (p + 1 >= end || p[1] == '\n')
+		return nullptr;
+
+	    p += 2;
+	} else
+	    p ++;
+
+    if (p >= end || *p != quote || (quote == '\'' && p == start))
+	return nullptr;
+
+    return p + 1;
+}
+
+
+/*
+ * Function:	follow (private)
+ *
+ * Description:	Return the given token for two characters if the next
+ *		character is the given second character, which is then
+ *		skipped, and the given token for one character otherwise.
+ */
+
+static int follow(const char *&q, char second, int token, int single)
+{
+    if (*q != second)
+	return single;
+
+    q ++;
+    return token;
+}
+
+
+/*
+ * Function:	checkInt (private)
+ *
+ * Description:	Check if an integer constant is valid.  A constant with
+ *		fewer than nineteen digits always fits in a long, even in
+ *		octal, so only longer constants need to be converted.
+ */
+
+static void checkInt(string_view text, unsigned line)
+{
+    string s;
+
+
+    if (text.size() < 19)
+	return;
+
+    s = text;
+    errno = 0;
+    strtol(s.c_str(), NULL, 0);
+
+    if (errno != 0)
+	complain(line, "integer constant too large");
+}
+
+
+/*
+ * Function:	checkLiteral (private)
+ *
+ * Description:	Check if a string or character literal is valid.
+ */
+
+static void checkLiteral(string_view text, unsigned line)
+{
+    const char *kind = text[0] == '"' ? "string" : "character";
+    bool invalid, overflow;
+    string s;
+
+
+    s = parseString(text.substr(1, text.size() - 2), invalid, overflow);
+
+    if (invalid)
+	complain(line, string("unknown escape sequence in ") + kind + " constant");
+    else if (overflow)
+	complain(line, string("escape sequence out of range in ") + kind + " constant");
+    else if (text[0] == '\'' && s.size() > 1)
+	complain(line, "multi-character character constant");
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Read all the tokens of the current translation unit from
+ *		the given source.  The text of each token is a span of the
+ *		source rather than a copy.
+ */
+
+void tokenize(Source &source)
+{
+    CompilerContext *context = CompilerContext::current();
+    const char *p = source.text(), *end = p + source.size(), *q;
+    unsigned line = 1;
+    int token;
+
+
+    while (true) {
+	p = skipSpace(p, line);
+
+	if (p >= end)
+	    break;
+
+	q = p + 1;
+
+	switch (*p) {
+	case 'a': case 'b': case 'c': case 'd': case 'e': case 'f': case 'g':
+	case 'h': case 'i': case 'j': case 'k': case 'l': case 'm': case 'n':
+	case 'o': case 'p': case 'q': case 'r': case 's': case 't': case 'u':
+	case 'v': case 'w': case 'x': case 'y': case 'z':
+	case 'A': case 'B': case 'C': case 'D': case 'E': case 'F': case 'G':
+	case 'H': case 'I': case 'J': case 'K': case 'L': case 'M': case 'N':
+	case 'O': case 'P': case 'Q': case 'R': case 'S': case 'T': case 'U':
+	case 'V': case 'W': case 'X': case 'Y': case 'Z': case '_':
+	    q = skipWord(q, false);
+
+	    if ((token = keyword(p, q - p)) != 0)
+		context->tokens.push_back({token, line, nullptr, {p, (size_t) (q - p)}});
+	    else
+		context->tokens.push_back({ID, line, intern(p, q - p), {}});
+
+	    p = q;
+	    continue;
+
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+	    q = skipWord(q, true);
+
+	    if (*q == 'l' || *q == 'L')
+		q ++;
+
+	    context->tokens.push_back({NUM, line, nullptr, {p, (size_t) (q - p)}});
+	    checkInt(context->tokens.back().text, line);
+	    p = q;
+	    continue;
+
+	case '"': case '\'':
+	    if ((q = skipLiteral(p, end)) == nullptr) {
+		p ++;
+		continue;
+	    }
+
+	    token = *p == '"' ? STRING : CHARACTER;
+	    context->tokens.push_back({token, line, nullptr, {p, (size_t) (q - p)}});
+	    checkLiteral(context->tokens.back().text, line);
+	    p = q;
+	    continue;
+
+	case '/':
+	    if (*q == '*') {
+		p = skipComment(q + 1, end, line);
+		continue;
+	    }
+
+	    token = '/';
+	    break;
+
+	case '|':
+	    token = follow(q, '|', OR, '|');
+	    break;
+
+	case '&':
+	    token = follow(q, '&', AND, '&');
+	    break;
+
+	case '=':
+	    token = follow(q, '=', EQL, '=');
+	    break;
+
+	case '!':
+	    token = follow(q, '=', NEQ, '!');
+	    break;
+
+	case '<':
+	    token = follow(q, '=', LEQ, '<');
+	    break;
+
+	case '>':
+	    token = follow(q, '=', GEQ, '>');
+	    break;
+
+	case '+':
+	    token = follow(q, '+', INC, '+');
+	    break;
+
+	case '-':
+	    if (*q == '>')
+		token = follow(q, '>', ARROW, '-');
+	    else
+		token = follow(q, '-', DEC, '-');
+
+	    break;
+
+	case '.':
+	    if (q[0] == '.' && q[1] == '.') {
+		token = ELLIPSIS;
+		q += 2;
+	    } else
+		token = '.';
+
+	    break;
+
+	case '*': case '%': case '(': case ')': case '[': case ']':
+	case '{': case '}': case ';': case ':': case ',':
+	    token = *p;
+	    break;
+
+	default:
+	    p ++;
+	    continue;
+	}
+
+	context->tokens.push_back({token, line, nullptr, {p, (size_t) (q - p)}});
+	p = q;
+    }
+
+    context->tokens.push_back({DONE, line, nullptr, {}});
+}
@@ -0,0 +1,239 @@
+/*
+ * File:	select.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		selecting the addressing modes of the machine.  The actual
+ *		classes are declared elsewhere, mainly in IR.h.
+ *
+ *		The machine can add a base, an index scaled by one, two,
+ *		four, or eight, and a constant offset as part of any memory
+ *		operand, or compute such an address by itself without
+ *		disturbing its operands.  So each addition of pointers is
+ *		turned into an address quad, absorbing the multiplication
+ *		of its index by a scale, and each address used only by a
+ *		load or store is then absorbed into the load or store.
+ *		Indexing an array thus becomes a single instruction.
+ *
+ *		The trees are matched greedily within each block, largest
+ *		first, like a maximal munch.  A quad is only absorbed if the
+ *		value of its result is used nowhere else and its operands
+ *		are not assigned again before that use, so that its value
+ *		is the same wherever it is computed.
+ */
+
+# include <unordered_map>
+# include "machine.h"
+# include "IR.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Procedure::selectAddresses
+ *
+ * Description:	Select the addressing modes of the loads, stores, and
+ *		additions of pointers in this procedure.
+ */
+
+void Procedure::selectAddresses()
+{
+    vector<unsigned> defs(temps.size(), 0), uses(temps.size(), 0);
+    unordered_map<unsigned, size_t> position;
+    vector<Operand *> operands;
+    vector<bool> dead;
+    size_t i, n;
+
+
+    /* Count the assignments and uses of each temporary. */
+
+    for (auto block : blocks)
+	for (auto &quad : block->quads) {
+	    if (quad.result.isTemp())
+		defs[quad.result.temp] ++;
+
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp())
+		    uses[operand->temp] ++;
+	}
+
+    for (auto block : blocks) {
+	vector<Quad> &quads = block->quads;
+
+	position.clear();
+	dead.assign(quads.size(), false);
+
+
+	/* Return the position of the quad in this block last computing
+	   the given operand, if the value computed is used only by the
+	   quad at the given position, and otherwise the end of the
+	   block.  The value of an unnamed temporary used only once is
+	   used nowhere else, and neither is the value of any temporary
+	   used once more only by a quad assigning it a new value. */
+
+	auto single = [&](const Operand &operand, size_t i) {
+	    auto it = operand.isTemp() ? position.find(operand.temp) : position.end();
+	    unsigned count = 0;
+
+
+	    if (it == position.end())
+		return quads.size();
+
+	    if (!named[operand.temp] && defs[operand.temp] == 1)
+		return uses[operand.temp] == 1 ? it->second : quads.size();
+
+	    if (quads[i].result != operand)
+		return quads.size();
+
+	    for (size_t n = it->second + 1; n <= i; n ++) {
+		quads[n].uses(operands);
+
+		for (auto use : operands)
+		    count += *use == operand;
+	    }
+
+	    return count == 1 ? it->second : quads.size();
+	};
+
+
+	/* Return whether the given operand is unchanged between the
+	   quads at the given positions. */
+
+	auto unchanged = [&](const Operand &operand, size_t from, size_t to) {
+	    if (!operand.isTemp() || (defs[operand.temp] == 1 && !named[operand.temp]))
+		return true;
+
+	    while (++ from < to)
+		if (quads[from].result == operand)
+		    return false;
+
+	    return true;
+	};
+
+
+	/* Return the position of the multiplication by a scale computing
+	   the given operand for the quad at the given position, along
+	   with the value multiplied and the scale, or the end of the
+	   block if there is none. */
+
+	auto scaled = [&](const Operand &operand, size_t i, Operand &value, unsigned &scale) {
+	    size_t n = single(operand, i);
+
+
+	    if (n == quads.size() || quads[n].opcode != MUL)
+		return quads.size();
+
+	    for (unsigned side = 0; side < 2; side ++) {
+		const Operand &factor = side == 0 ? quads[n].right : quads[n].left;
+		const Operand &other = side == 0 ? quads[n].left : quads[n].right;
+
+		if (!factor.isConst() || !other.isTemp())
+		    continue;
+
+		if (factor.value != 2 && factor.value != 4 && factor.value != 8)
+		    continue;
+
+		if (!unchanged(other, n, i))
+		    continue;
+
+		value = other;
+		scale = factor.value;
+		return n;
+	    }
+
+	    return quads.size();
+	};
+
+
+	/* Turn the addition of a pointer at the given position into an
+	   address, absorbing the scaling of its index if possible. */
+
+	auto address = [&](size_t i) {
+	    Quad &quad = quads[i];
+	    Operand base = quad.left, index = quad.right, value;
+	    unsigned scale = 1;
+	    long offset = 0;
+	    size_t n;
+
+
+	    if (index.isAddress() || base.isConst())
+		swap(base, index);
+
+	    if (!base.isAddress() && !base.isTemp())
+		return;
+
+	    if (index.isConst()) {
+		if (index.value != (int) index.value)
+		    return;
+
+		offset = index.value;
+		index = Operand();
+
+	    } else if (!index.isTemp())
+		return;
+
+	    else if ((n = scaled(index, i, value, scale)) < quads.size()) {
+		dead[n] = true;
+		index = value;
+
+	    } else if ((n = scaled(base, i, value, scale)) < quads.size()) {
+		dead[n] = true;
+		base = index;
+		index = value;
+	    }
+
+	    if (scale == 1 && (named[quad.result.temp] || uses[quad.result.temp] != 1))
+		return;
+
+	    quad.opcode = ADDRESS;
+	    quad.left = base;
+	    quad.right = Operand();
+	    quad.index = index;
+	    quad.scale = scale;
+	    quad.offset = offset;
+	};
+
+
+	/* Absorb the address of the load or store at the given position
+	   if it is used nowhere else. */
+
+	auto memory = [&](size_t i) {
+	    Quad &quad = quads[i];
+	    size_t n = single(quad.left, i);
+
+
+	    if (n == quads.size() || quads[n].opcode != ADDRESS)
+		return;
+
+	    Quad &address = quads[n];
+
+	    if (!unchanged(address.left, n, i) || !unchanged(address.index, n, i))
+		return;
+
+	    dead[n] = true;
+	    quad.left = address.left;
+	    quad.index = address.index;
+	    quad.scale = address.scale;
+	    quad.offset = address.offset;
+	};
+
+	for (i = 0; i < quads.size(); i ++) {
+	    Quad &quad = quads[i];
+
+	    if (quad.opcode == ADD && quad.result.size == SIZEOF_PTR)
+		address(i);
+	    else if (quad.opcode == LOAD || quad.opcode == STORE)
+		memory(i);
+
+	    if (quad.result.isTemp())
+		position[quad.result.temp] = i;
+	}
+
+	for (i = n = 0; i < quads.size(); i ++)
+	    if (!dead[i])
+		quads[n ++] = quads[i];
+
+	quads.erase(quads.begin() + n, quads.end());
+    }
+}
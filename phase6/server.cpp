@@ -0,0 +1,284 @@
+/*
+ * File:	server.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for running the compiler as a server.  The
+ *		server listens on a Unix socket and forks a child for each
+ *		request, which runs the command just as a new compiler
+ *		would, but without paying to execute, link, and initialize
+ *		one.  Each child starts from the warm state of the server,
+ *		and any failure in one request cannot affect another.
+ *		Children are never waited for, so the server can take the
+ *		next request at once, and requests are served concurrently.
+ *
+ *		A client sends its standard input, output, and error along
+ *		with the request, so the child reads and writes exactly
+ *		what the compiler run by the client would have.  The
+ *		request is the length of the rest, then the working
+ *		directory of the client and its arguments, each terminated
+ *		by a null character.  The child answers with the exit
+ *		status of the command.  A client whose request could not
+ *		be sent may just run the command itself.
+ */
+
+# include <cerrno>
+# include <climits>
+# include <csignal>
+# include <cstdint>
+# include <cstdlib>
+# include <cstring>
+# include <vector>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# include "server.h"
+
+using namespace std;
+
+# define NUM_STREAMS 3
+
+
+/*
+ * Function:	address (private)
+ *
+ * Description:	Fill in the address of the socket with the given path,
+ *		returning false if the path is too long.
+ */
+
+static bool address(const string &path, struct sockaddr_un &addr)
+{
+    if (path.size() >= sizeof(addr.sun_path))
+	return false;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    return true;
+}
+
+
+/*
+ * Function:	transfer (private)
+ *
+ * Description:	Read or write exactly the given number of bytes, retrying
+ *		after a short transfer or an interrupted system call, and
+ *		return whether every byte was transferred.
+ */
+
+static bool transfer(int fd, void *data, size_t size, bool writing)
+{
+    char *p = (char *) data;
+    ssize_t n;
+
+
+    while (size > 0) {
+	n = writing ? write(fd, p, size) : read(fd, p, size);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n <= 0)
+	    return false;
+
+	p += n;
+	size -= n;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	respond (private)
+ *
+ * Description:	Receive the request on the given connection, take over
+ *		the streams of the client and its working directory, run
+ *		the command, and send back its exit status, which is also
+ *		returned.
+ */
+
+static int respond(int fd, Command command)
+{
+    char control[CMSG_SPACE(sizeof(int) * NUM_STREAMS)];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    vector<char *> args;
+    vector<char> request;
+    uint32_t length;
+    int status, fds[NUM_STREAMS];
+    size_t i;
+
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = &length;
+    iov.iov_len = sizeof(length);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(fd, &msg, MSG_WAITALL) != sizeof(length))
+	return EXIT_FAILURE;
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+
+    if (cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+	return EXIT_FAILURE;
+
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    request.resize(length);
+
+    if (length == 0 || !transfer(fd, request.data(), length, false))
+	return EXIT_FAILURE;
+
+    if (request.back() != '\0')
+	return EXIT_FAILURE;
+
+    for (i = 0; i < length; i += strlen(&request[i]) + 1)
+	args.push_back(&request[i]);
+
+    for (i = 0; i < NUM_STREAMS; i ++) {
+	dup2(fds[i], i);
+	close(fds[i]);
+    }
+
+    if (args.size() < 2 || chdir(args[0]) != 0)
+	return EXIT_FAILURE;
+
+    args.push_back(nullptr);
+    status = command(args.size() - 2, args.data() + 1);
+    transfer(fd, &status, sizeof(status), true);
+    return status;
+}
+
+
+/*
+ * Function:	serve
+ *
+ * Description:	Listen on the socket with the given path, replacing any
+ *		socket already there, and run the given command for each
+ *		request in a child of its own.  Return false if the socket
+ *		cannot be created, and otherwise never return.  Anything
+ *		else already at the path is left alone, and the socket is
+ *		not created, with errno set to EEXIST.
+ */
+
+bool serve(const string &path, Command command)
+{
+    struct sockaddr_un addr;
+    struct stat info;
+    int fd, connection;
+
+
+    if (!address(path, addr))
+	return false;
+
+    if (lstat(path.c_str(), &info) == 0) {
+	if (!S_ISSOCK(info.st_mode)) {
+	    errno = EEXIST;
+	    return false;
+	}
+
+	unlink(path.c_str());
+    }
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	return false;
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+	    listen(fd, SOMAXCONN) != 0)
+	return false;
+
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+	if ((connection = accept(fd, nullptr, nullptr)) < 0) {
+	    if (errno == EINTR || errno == ECONNABORTED)
+		continue;
+
+	    return false;
+	}
+
+	if (fork() == 0) {
+	    close(fd);
+	    signal(SIGCHLD, SIG_DFL);
+	    signal(SIGPIPE, SIG_DFL);
+	    exit(respond(connection, command));
+	}
+
+	close(connection);
+    }
+}
+
+
+/*
+ * Function:	forward
+ *
+ * Description:	Send the command with the given arguments, along with our
+ *		standard streams, to the server listening on the socket with
+ *		the given path, and wait for its exit status.  Return false
+ *		if the request could not be sent, in which case nothing has
+ *		been read from or written to the streams.  If the server
+ *		fails to answer, the command is taken to have failed.
+ */
+
+bool forward(const string &path, int argc, char *argv[], int &status)
+{
+    char control[CMSG_SPACE(sizeof(int) * NUM_STREAMS)], cwd[PATH_MAX];
+    int fds[NUM_STREAMS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    struct sockaddr_un addr;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov;
+    string request;
+    uint32_t length;
+    int fd;
+
+
+    if (!address(path, addr) || getcwd(cwd, sizeof(cwd)) == nullptr)
+	return false;
+
+    request.append(cwd, strlen(cwd) + 1);
+
+    for (int i = 0; i < argc; i ++)
+	request.append(argv[i], strlen(argv[i]) + 1);
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+	return false;
+
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+	close(fd);
+	return false;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    length = request.size();
+    iov.iov_base = &length;
+    iov.iov_len = sizeof(length);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    if (sendmsg(fd, &msg, 0) != sizeof(length)) {
+	close(fd);
+	return false;
+    }
+
+    if (!transfer(fd, &request[0], request.size(), true) ||
+	    !transfer(fd, &status, sizeof(status), false))
+	status = EXIT_FAILURE;
+
+    close(fd);
+    return true;
+}
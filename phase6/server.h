@@ -0,0 +1,18 @@
+/*
+ * File:	server.h
+ *
+ * Description:	This file contains the function declarations for running
+ *		the compiler as a server and for forwarding a command to
+ *		it.
+ */
+
+# ifndef SERVER_H
+# define SERVER_H
+# include <string>
+
+typedef int (*Command)(int argc, char *argv[]);
+
+bool serve(const std::string &path, Command command);
+bool forward(const std::string &path, int argc, char *argv[], int &status);
+
+# endif /* SERVER_H */
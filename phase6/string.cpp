@@ -11,6 +11,19 @@
 using namespace std;
 
 
+/*
+ * Function:	at (private)
+ *
+ * Description:	Return the character at the given index of a string, or a
+ *		null character past its end, as with a C++ string.
+ */
+
+static char at(string_view s, size_t i)
+{
+    return i < s.size() ? s[i] : '\0';
+}
+
+
 /*
  * Function:	parseString
  *
@@ -19,7 +32,7 @@ using namespace std;
  *		an octal or hexadecimal escape sequence.
  */
 
-string parseString(const string &s, bool &invalid, bool &overflow)
+string parseString(string_view s, bool &invalid, bool &overflow)
 {
     unsigned start, val;
     string result;
@@ -32,7 +45,7 @@ string parseString(const string &s, bool &invalid, bool &overflow)
 	if (s[i] == '\\') {
 	    i ++;
 
-	    switch(s[i]) {
+	    switch(at(s, i)) {
 	    case 'a':
 		result += '\a';
 		break;
@@ -73,11 +86,11 @@ string parseString(const string &s, bool &invalid, bool &overflow)
 		start = i;
 
 		while (1) {
-		    if (s[i + 1] >= '0' && s[i + 1] <= '9')
+		    if (at(s, i + 1) >= '0' && at(s, i + 1) <= '9')
 			val = val * 16 + (s[++ i] - '0');
-		    else if (s[i + 1] >= 'a' && s[i + 1] <= 'f')
+		    else if (at(s, i + 1) >= 'a' && at(s, i + 1) <= 'f')
 			val = val * 16 + (s[++ i] - 'a' + 10);
-		    else if (s[i + 1] >= 'A' && s[i + 1] <= 'F')
+		    else if (at(s, i + 1) >= 'A' && at(s, i + 1) <= 'F')
 			val = val * 16 + (s[++ i] - 'A' + 10);
 		    else
 			break;
@@ -96,10 +109,10 @@ string parseString(const string &s, bool &invalid, bool &overflow)
 	    case '4': case '5': case '6': case '7':
 		val = s[i] - '0';
 
-		if (s[i + 1] >= '0' && s[i + 1] <= '7')
+		if (at(s, i + 1) >= '0' && at(s, i + 1) <= '7')
 		    val = val * 8 + (s[++ i] - '0');
 
-		if (s[i + 1] >= '0' && s[i + 1] <= '7')
+		if (at(s, i + 1) >= '0' && at(s, i + 1) <= '7')
 		    val = val * 8 + (s[++ i] - '0');
 
 		if (val > UCHAR_MAX)
@@ -129,7 +142,7 @@ string parseString(const string &s, bool &invalid, bool &overflow)
  *		invalid escape sequence is silently ignored.
  */
 
-string parseString(const string &s)
+string parseString(string_view s)
 {
     bool invalid, overflow;
     return parseString(s, invalid, overflow);
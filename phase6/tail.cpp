@@ -0,0 +1,154 @@
+/*
+ * File:	tail.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		optimizing tail calls.  The actual classes are declared
+ *		elsewhere, mainly in IR.h.
+ *
+ *		A call whose result is immediately returned is in tail
+ *		position.  A tail call of the procedure itself becomes an
+ *		assignment of the arguments to the parameters and a jump
+ *		back to the entry, so the recursion becomes a loop, which
+ *		the loop optimizer can then improve.  Any other tail call
+ *		with its arguments in registers becomes a return whose
+ *		callee is set, for which the code generator tears down our
+ *		frame and jumps to the callee, which then returns to our
+ *		caller.
+ *
+ *		Neither is valid if the address of a stack slot may have
+ *		been passed to the callee, since the slot is reused by the
+ *		next iteration or freed before the jump, so we give up on
+ *		any procedure with a stack slot.
+ */
+
+# include "machine.h"
+# include "IR.h"
+
+using namespace std;
+
+
+/*
+ * Function:	tailCall (private)
+ *
+ * Description:	Return the call in tail position in the given block, or
+ *		null if there is none.  The result of the call may be
+ *		copied before it is returned, and may be returned by the
+ *		block that follows, as it is when the call was part of a
+ *		function expanded inline.
+ */
+
+static Quad *tailCall(BasicBlock *block)
+{
+    vector<Quad> &quads = block->quads;
+    size_t n = quads.size();
+    Quad *ret = nullptr;
+    Operand value;
+
+
+    if (quads[n - 1].opcode == RET)
+	ret = &quads[-- n];
+    else if (quads[n - 1].opcode == JUMP && block->next[0]->quads.size() == 1) {
+	ret = &block->next[0]->quads[0];
+	n --;
+    }
+
+    if (ret == nullptr || ret->opcode != RET || ret->callee != nullptr)
+	return nullptr;
+
+    value = ret->left;
+
+    if (n > 0 && quads[n - 1].opcode == COPY && quads[n - 1].result == value)
+	value = quads[-- n].left;
+
+    if (n == 0 || quads[n - 1].opcode != CALL)
+	return nullptr;
+
+    if (!quads[n - 1].result.isTemp() || quads[n - 1].result != value)
+	return nullptr;
+
+    return &quads[n - 1];
+}
+
+
+/*
+ * Function:	Procedure::optimizeTailCalls
+ *
+ * Description:	Turn each tail call of this procedure into a jump to its
+ *		entry, and each other tail call passing its arguments in
+ *		registers into a return that jumps to the callee.
+ */
+
+void Procedure::optimizeTailCalls()
+{
+    BasicBlock *entry = nullptr;
+    unsigned i, j, numBlocks = blocks.size();
+    vector<Operand> args;
+    Quad *call;
+
+
+    if (!slots.empty())
+	return;
+
+    for (unsigned k = 0; k < numBlocks; k ++) {
+	BasicBlock *block = blocks[k];
+
+	if ((call = tailCall(block)) == nullptr)
+	    continue;
+
+	if (call->args.size() > NUM_PARAM_REGS)
+	    continue;
+
+	if (call->callee != function || call->args.size() != params.size()
+		|| function->type().parameters()->variadic) {
+	    Quad ret(RET);
+
+	    ret.callee = call->callee;
+	    ret.args = call->args;
+	    block->quads.erase(block->quads.begin() + (call - &block->quads[0]),
+		block->quads.end());
+	    block->quads.push_back(ret);
+	    continue;
+	}
+
+
+	/* Copy any argument that is a parameter assigned before it is
+	   read, and then assign the arguments to the parameters. */
+
+	args = call->args;
+	block->quads.erase(block->quads.begin() + (call - &block->quads[0]),
+	    block->quads.end());
+
+	for (i = 0; i < args.size(); i ++)
+	    for (j = 0; j < i; j ++)
+		if (args[i] == params[j]) {
+		    Operand copy = temp(args[i].size);
+		    block->quads.push_back(Quad(COPY, copy, args[i]));
+		    args[i] = copy;
+		    break;
+		}
+
+	for (i = 0; i < args.size(); i ++)
+	    if (args[i] != params[i])
+		block->quads.push_back(Quad(COPY, params[i], args[i]));
+
+	if (entry == nullptr) {
+	    entry = this->block();
+	    entry->count = blocks[0]->count;
+	    entry->quads.push_back(Quad(JUMP));
+	    entry->next[0] = blocks[0];
+	}
+
+
+	block->quads.push_back(Quad(JUMP));
+	block->next[0] = blocks[0];
+    }
+
+    if (entry != nullptr) {
+	blocks.insert(blocks.begin(), entry);
+
+	for (i = 0; i < blocks.size(); i ++)
+	    blocks[i]->number = i;
+
+	link();
+    }
+}
@@ -0,0 +1,296 @@
+/*
+ * File:	values.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		value numbering.  The actual classes are declared
+ *		elsewhere, mainly in IR.h.
+ *
+ *		The blocks are visited in a preorder walk of the dominator
+ *		tree, keeping a table of the expressions computed by the
+ *		dominating blocks.  A quad computing an expression already
+ *		in the table is deleted, and its result is replaced by the
+ *		temporary already holding the value.
+ *
+ *		The value of an unnamed temporary assigned only once, or of
+ *		a named temporary never assigned, such as a parameter, is
+ *		the same wherever it is used.  Any other temporary may be
+ *		reassigned on some path between two blocks, so its value is
+ *		only known to be the same within a block between two of its
+ *		assignments.  Likewise, loads are only reused within a block
+ *		between two stores or calls, unless the procedure has none.
+ *		Expressions involving these values are thus only reused
+ *		within a block.
+ */
+
+# include <algorithm>
+# include <array>
+# include <unordered_map>
+# include "IR.h"
+
+using namespace std;
+
+typedef array<long, 10> Key;
+
+struct KeyHash {
+    size_t operator ()(const Key &key) const {
+	size_t hash = 0;
+
+	for (auto value : key)
+	    hash = (hash ^ value) * 1099511628211UL;
+
+	return hash;
+    }
+};
+
+
+/*
+ * Function:	dominators (private)
+ *
+ * Description:	Compute the immediate dominator of each block reachable
+ *		from the entry, using the iterative algorithm of Cooper,
+ *		Harvey, and Kennedy over a reverse postorder.  The entry is
+ *		its own immediate dominator.
+ */
+
+static void dominators(const Procedure &proc, vector<BasicBlock *> &idom)
+{
+    unsigned n = proc.blocks.size();
+    vector<unsigned> order(n, 0);
+    vector<BasicBlock *> postorder;
+    vector<pair<BasicBlock *, unsigned>> stack;
+    vector<bool> seen(n, false);
+    bool changed;
+
+
+    stack.emplace_back(proc.blocks[0], 0);
+    seen[0] = true;
+
+    while (!stack.empty()) {
+	BasicBlock *block = stack.back().first;
+
+	if (stack.back().second == block->successors()) {
+	    order[block->number] = postorder.size();
+	    postorder.push_back(block);
+	    stack.pop_back();
+	    continue;
+	}
+
+	BasicBlock *next = block->next[stack.back().second ++];
+
+	if (!seen[next->number]) {
+	    seen[next->number] = true;
+	    stack.emplace_back(next, 0);
+	}
+    }
+
+    idom.assign(n, nullptr);
+    idom[0] = proc.blocks[0];
+
+    do {
+	changed = false;
+
+	for (unsigned i = postorder.size() - 1; i -- > 0; ) {
+	    BasicBlock *block = postorder[i], *dom = nullptr;
+
+	    for (auto pred : block->preds) {
+		BasicBlock *other = pred;
+
+		if (idom[other->number] == nullptr)
+		    continue;
+
+		if (dom == nullptr) {
+		    dom = other;
+		    continue;
+		}
+
+		while (dom != other) {
+		    while (order[dom->number] < order[other->number])
+			dom = idom[dom->number];
+
+		    while (order[other->number] < order[dom->number])
+			other = idom[other->number];
+		}
+	    }
+
+	    if (idom[block->number] != dom) {
+		idom[block->number] = dom;
+		changed = true;
+	    }
+	}
+    } while (changed);
+}
+
+
+/*
+ * Function:	isExpression (private)
+ *
+ * Description:	Return whether a quad only computes its result from its
+ *		operands, and so may be reused.
+ */
+
+static bool isExpression(const Quad &quad)
+{
+    switch (quad.opcode) {
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIVIDE:
+    case REMAINDER:
+    case NEG:
+    case EXTEND:
+    case SET:
+    case LOAD:
+	return true;
+
+    default:
+	return false;
+    }
+}
+
+
+/*
+ * Function:	Procedure::numberValues
+ *
+ * Description:	Delete the quads of this procedure that compute a value
+ *		already computed by a quad that dominates them.
+ */
+
+void Procedure::numberValues()
+{
+    unsigned n = blocks.size(), serial = 0, i;
+    vector<unsigned> defs(temps.size(), 0), block(temps.size(), 0);
+    vector<long> version(temps.size(), 0);
+    vector<Operand> replacement(temps.size());
+    vector<vector<BasicBlock *>> children(n);
+    vector<BasicBlock *> idom, stack;
+    vector<Key> log;
+    vector<size_t> marks;
+    vector<Operand *> operands;
+    vector<bool> dead;
+    unordered_map<Key, Operand, KeyHash> table;
+    bool stores = false;
+    long counter = 0, entry = 0, memory = 0;
+
+
+    /* Count the assignments to each temporary, and find any stores
+       or calls. */
+
+    for (auto b : blocks)
+	for (auto &quad : b->quads) {
+	    if (quad.result.isTemp())
+		defs[quad.result.temp] ++;
+
+	    if (quad.opcode == STORE || quad.opcode == CALL)
+		stores = true;
+	}
+
+    dominators(*this, idom);
+
+    for (i = 1; i < n; i ++)
+	if (idom[i] != nullptr)
+	    children[idom[i]->number].push_back(blocks[i]);
+
+
+    /* The version of an operand whose value may change is its current
+       version within the block. */
+
+    auto current = [&](const Operand &operand) {
+	if (!operand.isTemp())
+	    return 0L;
+
+	if (defs[operand.temp] == 0 || (defs[operand.temp] == 1 && !named[operand.temp]))
+	    return 0L;
+
+	return block[operand.temp] == serial ? version[operand.temp] : entry;
+    };
+
+
+    /* Walk the dominator tree, with a null marking the end of the
+       children of a block, at which point its expressions are
+       removed from the table. */
+
+    stack.push_back(blocks[0]);
+
+    while (!stack.empty()) {
+	BasicBlock *b = stack.back();
+	stack.pop_back();
+
+	if (b == nullptr) {
+	    for (; log.size() > marks.back(); log.pop_back())
+		table.erase(log.back());
+
+	    marks.pop_back();
+	    continue;
+	}
+
+	marks.push_back(log.size());
+	stack.push_back(nullptr);
+	stack.insert(stack.end(), children[b->number].rbegin(), children[b->number].rend());
+
+	serial ++;
+	entry = ++ counter;
+	memory = stores ? ++ counter : 0;
+	dead.assign(b->quads.size(), false);
+
+	for (i = 0; i < b->quads.size(); i ++) {
+	    Quad &quad = b->quads[i];
+
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp() && replacement[operand->temp].kind != Operand::NONE)
+		    *operand = replacement[operand->temp];
+
+	    if (isExpression(quad) && quad.result.isTemp() &&
+		    defs[quad.result.temp] == 1 && !named[quad.result.temp]) {
+		Operand left = quad.left, right = quad.right;
+
+		if (quad.opcode == ADD || quad.opcode == MUL)
+		    if (make_pair(left.kind, left.value) > make_pair(right.kind, right.value))
+			swap(left, right);
+
+		Key k = {quad.opcode, quad.opcode == SET ? quad.condition : 0,
+		    quad.result.size, left.kind << 8 | left.size, left.value,
+		    current(left), right.kind << 8 | right.size, right.value,
+		    current(right), quad.opcode == LOAD ? memory : 0};
+
+		auto it = table.find(k);
+
+		if (it != table.end()) {
+		    replacement[quad.result.temp] = it->second;
+		    dead[i] = true;
+		    continue;
+		}
+
+		table.emplace(k, quad.result);
+		log.push_back(k);
+	    }
+
+	    if (quad.opcode == STORE || quad.opcode == CALL)
+		memory = ++ counter;
+
+	    if (quad.result.isTemp()) {
+		block[quad.result.temp] = serial;
+		version[quad.result.temp] = ++ counter;
+	    }
+	}
+
+	auto first = b->quads.data();
+
+	b->quads.erase(remove_if(b->quads.begin(), b->quads.end(),
+	    [&](const Quad &quad) {return dead[&quad - first];}), b->quads.end());
+    }
+
+
+    /* Replace the results of the deleted quads wherever else they are
+       used. */
+
+    for (auto b : blocks)
+	for (auto &quad : b->quads) {
+	    quad.uses(operands);
+
+	    for (auto operand : operands)
+		if (operand->isTemp() && replacement[operand->temp].kind != Operand::NONE)
+		    *operand = replacement[operand->temp];
+	}
+}
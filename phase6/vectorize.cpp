@@ -0,0 +1,533 @@
+/*
+ * File:	vectorize.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		vectorizing the loops of a procedure.  The actual classes
+ *		are declared elsewhere, mainly in IR.h.
+ *
+ *		A loop is vectorized if it is a single block counting a
+ *		variable up by one to an invariant limit, as lowered from a
+ *		for or while statement whose body has no control flow, and
+ *		each load and store is of an element of an array indexed by
+ *		that variable.  The elements must all be of the same size,
+ *		and the loop may store into only one array, and may neither
+ *		call anything nor assign any other variable.
+ *
+ *		The elements are then handled as many at a time as fit in a
+ *		vector register.  Only the low bytes of a value matter once
+ *		it is stored, and the low bytes of a sum or difference
+ *		depend only on those of its operands, so the extensions and
+ *		truncations of the usual arithmetic conversions are simply
+ *		ignored.  A comparison needs its operands exactly, and so
+ *		only compares elements as loaded and invariants that fit in
+ *		a lane.  SSE2 can neither compare 64-bit elements nor
+ *		multiply elements, so neither is vectorized.
+ *
+ *		The vector loop is only entered if at least one vector of
+ *		iterations remains, and if storing an array cannot change
+ *		an element of another array before it is loaded.  The
+ *		original loop follows it to finish the last iterations, and
+ *		runs all of them otherwise.  An invariant used by the vector
+ *		loop is copied to every lane of a register beforehand.
+ *		There are only a few vector values, so each simply gets its
+ *		own register, except for the last register, which the code
+ *		generator uses as a scratch register.
+ */
+
+# include <climits>
+# include <unordered_map>
+# include "machine.h"
+# include "IR.h"
+
+using namespace std;
+
+enum Role {
+    INDEX, SCALED, POINTER, ELEMENT, INVARIANT,
+};
+
+struct Lane {
+    Role role;
+    Operand value;
+    bool exact;
+};
+
+
+/*
+ * Function:	vectorize (private)
+ *
+ * Description:	Vectorize the given loop of a procedure, returning whether
+ *		it was vectorized.  The new blocks are placed before the
+ *		loop, but the graph is left to be linked again.  The counts
+ *		of the new blocks are estimated from that of the loop.
+ */
+
+static bool vectorize(Procedure &proc, BasicBlock *loop)
+{
+    vector<Quad> &quads = loop->quads, prologue, body;
+    vector<pair<Operand, Operand>> broadcasts;
+    vector<unsigned> defs(proc.temps.size(), 0);
+    unordered_map<unsigned, Lane> lanes;
+    unordered_map<unsigned, Operand> renamed;
+    vector<Operand> bases;
+    vector<Operand *> operands;
+    vector<BasicBlock *> added;
+    Operand counter, limit, last, stored, distance;
+    BasicBlock *exit, *block, *check, *body_block, *rest;
+    unsigned size = 0, registers = 0, stores = 0, i, n = quads.size();
+    unsigned long entered = 0;
+    long factor, lowest;
+    Condition cond;
+
+
+    /* Return whether the given operand is not computed in the loop, or
+       is computed there only from others not computed there. */
+
+    auto invariant = [&](const Operand &operand) {
+	if (!operand.isTemp() || defs[operand.temp] == 0)
+	    return true;
+
+	auto it = lanes.find(operand.temp);
+	return it != lanes.end() && it->second.role == INVARIANT;
+    };
+
+
+    /* Return the role of the given operand in the loop, if any. */
+
+    auto role = [&](const Operand &operand, Role role) {
+	if (!operand.isTemp())
+	    return false;
+
+	auto it = lanes.find(operand.temp);
+	return it != lanes.end() && it->second.role == role;
+    };
+
+
+    /* Return whether the given operand is the counter as a long. */
+
+    auto index = [&](const Operand &operand) {
+	if (operand.size != SIZEOF_PTR)
+	    return false;
+
+	return operand == counter || role(operand, INDEX);
+    };
+
+
+    /* Return the register holding the given element or invariant,
+       creating a register for an invariant if necessary. */
+
+    auto element = [&](const Operand &operand) {
+	Operand reg;
+
+
+	if (operand.isTemp() && lanes.count(operand.temp) > 0)
+	    if (lanes[operand.temp].role == ELEMENT)
+		return lanes[operand.temp].value;
+
+	for (auto &broadcast : broadcasts)
+	    if (broadcast.first == operand)
+		return broadcast.second;
+
+	reg = Operand(Operand::VECTOR, size, registers ++);
+	broadcasts.emplace_back(operand, reg);
+	return reg;
+    };
+
+
+    /* Return whether the given operand may be an operand of an
+       arithmetic quad on elements, or of a comparison if exact. */
+
+    auto usable = [&](const Operand &operand, bool exact) {
+	if (role(operand, ELEMENT))
+	    return !exact || lanes[operand.temp].exact;
+
+	if (!invariant(operand) || operand.size < size)
+	    return false;
+
+	if (!exact || operand.size == size)
+	    return true;
+
+	if (!operand.isConst())
+	    return false;
+
+	return size == 1 ? operand.value == (signed char) operand.value
+	    : operand.value == (int) operand.value;
+    };
+
+
+    /* Replace the given operand by its copy in the vector loop. */
+
+    auto rename = [&](Operand &operand) {
+	if (operand.isTemp() && renamed.count(operand.temp) > 0)
+	    operand = renamed[operand.temp];
+    };
+
+
+    /* The loop must branch back to itself while the counter is less
+       than its limit, after incrementing the counter by one. */
+
+    if (n < 3 || quads.back().opcode != BRANCH)
+	return false;
+
+    const Quad &branch = quads.back(), &step = quads[n - 2];
+
+    cond = loop->next[0] == loop ? branch.condition : inverse(branch.condition);
+    exit = loop->next[0] == loop ? loop->next[1] : loop->next[0];
+
+    if (cond == LT) {
+	counter = branch.left;
+	limit = branch.right;
+    } else if (cond == GT) {
+	counter = branch.right;
+	limit = branch.left;
+    } else
+	return false;
+
+    if (!counter.isTemp() || !proc.named[counter.temp] || step.opcode != ADD)
+	return false;
+
+    if (step.result != counter || counter.size < SIZEOF_INT)
+	return false;
+
+    if (!(step.left == counter && step.right.isConst() && step.right.value == 1))
+	if (!(step.right == counter && step.left.isConst() && step.left.value == 1))
+	    return false;
+
+
+    /* No other variable may be assigned, nor any value computed in the
+       loop be used elsewhere. */
+
+    for (auto &quad : quads)
+	if (quad.result.isTemp())
+	    defs[quad.result.temp] ++;
+
+    for (i = 0; i < defs.size(); i ++)
+	if (defs[i] > 1 || (defs[i] == 1 && proc.named[i] && i != counter.temp))
+	    return false;
+
+    for (auto other : proc.blocks)
+	if (other != loop)
+	    for (auto &quad : other->quads) {
+		quad.uses(operands);
+
+		for (auto operand : operands)
+		    if (operand->isTemp() && operand->temp != counter.temp && defs[operand->temp] > 0)
+			return false;
+	    }
+
+    for (i = 0; i < n - 2; i ++)
+	if (quads[i].opcode == STORE) {
+	    size = quads[i].right.size;
+	    stores ++;
+	}
+
+    if (stores != 1 || (size != SIZEOF_CHAR && size != SIZEOF_INT && size != SIZEOF_LONG))
+	return false;
+
+
+    /* Translate each quad into the vector loop, computing the addresses
+       of the first elements just as before. */
+
+    for (i = 0; i < n - 2; i ++) {
+	Quad quad = quads[i];
+	const Operand result = quad.result;
+	bool scalar = quad.opcode != LOAD && quad.opcode != STORE && result.isTemp();
+	Lane lane = {ELEMENT, Operand(), true};
+
+	quad.uses(operands);
+
+	for (auto operand : operands)
+	    scalar = scalar && invariant(*operand);
+
+	switch (quad.opcode) {
+	case COPY:
+	case ADD:
+	case SUB:
+	case MUL:
+	case NEG:
+	case EXTEND:
+	case SET:
+	    break;
+
+	case LOAD:
+	case STORE:
+	    scalar = false;
+	    break;
+
+	default:
+	    return false;
+	}
+
+	if (scalar) {
+	    lanes[result.temp] = {INVARIANT, Operand(), false};
+	    renamed[result.temp] = proc.temp(result.size);
+
+	    for (auto operand : operands)
+		rename(*operand);
+
+	    rename(quad.result);
+	    prologue.push_back(quad);
+	    continue;
+	}
+
+	if (quad.opcode == EXTEND && quad.left == counter && result.size == SIZEOF_PTR)
+	    lane.role = INDEX;
+
+	else if (quad.opcode == MUL && result.size == SIZEOF_PTR &&
+		((index(quad.left) && quad.right.isConst() && quad.right.value == size) ||
+		 (index(quad.right) && quad.left.isConst() && quad.left.value == size)))
+	    lane.role = SCALED;
+
+	else if (quad.opcode == ADD && result.size == SIZEOF_PTR &&
+		(role(quad.left, SCALED) || (size == 1 && index(quad.left))) &&
+		invariant(quad.right)) {
+	    lane.role = POINTER;
+	    lane.value = quad.right;
+
+	} else if (quad.opcode == ADD && result.size == SIZEOF_PTR &&
+		(role(quad.right, SCALED) || (size == 1 && index(quad.right))) &&
+		invariant(quad.left)) {
+	    lane.role = POINTER;
+	    lane.value = quad.left;
+
+	} else if (quad.opcode == LOAD) {
+	    if (!role(quad.left, POINTER) || result.size != size || stored.kind != Operand::NONE)
+		return false;
+
+	    bases.push_back(lanes[quad.left.temp].value);
+	    lane.value = Operand(Operand::VECTOR, size, registers ++);
+	    rename(quad.left);
+	    quad.result = lane.value;
+	    body.push_back(quad);
+	    lanes[result.temp] = lane;
+	    continue;
+
+	} else if (quad.opcode == STORE) {
+	    if (!role(quad.left, POINTER) || !usable(quad.right, false))
+		return false;
+
+	    stored = lanes[quad.left.temp].value;
+	    rename(quad.left);
+	    quad.right = element(quad.right);
+	    body.push_back(quad);
+	    continue;
+
+	} else if ((quad.opcode == EXTEND || quad.opcode == COPY) && role(quad.left, ELEMENT)) {
+	    if (result.size < size)
+		return false;
+
+	    lane = lanes[quad.left.temp];
+	    lane.exact = result.size == size || (quad.opcode == EXTEND && lane.exact);
+	    lanes[result.temp] = lane;
+	    continue;
+
+	} else if (quad.opcode == ADD || quad.opcode == SUB || quad.opcode == NEG) {
+	    if (result.size < size || !usable(quad.left, false))
+		return false;
+
+	    if (quad.opcode != NEG && !usable(quad.right, false))
+		return false;
+
+	    quad.left = element(quad.left);
+
+	    if (quad.opcode != NEG)
+		quad.right = element(quad.right);
+
+	    lane.value = Operand(Operand::VECTOR, size, registers ++);
+	    lane.exact = result.size == size;
+	    quad.result = lane.value;
+	    body.push_back(quad);
+	    lanes[result.temp] = lane;
+	    continue;
+
+	} else if (quad.opcode == SET) {
+	    if (size == SIZEOF_LONG || result.size < size)
+		return false;
+
+	    if (!usable(quad.left, true) || !usable(quad.right, true))
+		return false;
+
+	    quad.left = element(quad.left);
+	    quad.right = element(quad.right);
+	    lane.value = Operand(Operand::VECTOR, size, registers ++);
+	    quad.result = lane.value;
+	    body.push_back(quad);
+	    lanes[result.temp] = lane;
+	    continue;
+
+	} else
+	    return false;
+
+	lanes[result.temp] = lane;
+	renamed[result.temp] = proc.temp(result.size);
+
+	for (auto operand : operands)
+	    rename(*operand);
+
+	rename(quad.result);
+	body.push_back(quad);
+    }
+
+    if (registers >= NUM_VECTOR_REGS)
+	return false;
+
+
+    /* The vector loop runs while a whole vector of iterations remains,
+       so it stops at the limit less the number of lanes, which must
+       not overflow. */
+
+    factor = VECTOR_SIZE / size;
+    lowest = counter.size == SIZEOF_INT ? INT_MIN : LONG_MIN;
+    rename(limit);
+
+    if (limit.isConst()) {
+	if (limit.value < lowest + factor)
+	    return false;
+
+	last = proc.constant(limit.value - factor, counter.size);
+    } else
+	last = proc.temp(counter.size);
+
+    for (auto pred : loop->preds)
+	if (pred != loop)
+	    entered += pred->count;
+
+    entered = min(entered, loop->count);
+
+
+    /* Return a new block placed before the loop. */
+
+    auto create = [&]() {
+	BasicBlock *block = proc.block();
+
+	block->count = entered;
+	added.push_back(block);
+	return block;
+    };
+
+
+    /* End the given block with a branch to the given block if the
+       condition holds, and to the original loop otherwise. */
+
+    auto test = [&](BasicBlock *block, Condition cond, const Operand &left,
+	    const Operand &right, BasicBlock *next) {
+	Quad quad(BRANCH, Operand(), left, right);
+
+	quad.condition = cond;
+	block->quads.push_back(quad);
+	block->next[0] = next;
+	block->next[1] = loop;
+    };
+
+
+    /* Compute the invariants and broadcast them, and then test that
+       enough iterations remain. */
+
+    block = create();
+    block->quads = prologue;
+
+    for (auto &broadcast : broadcasts) {
+	Operand value = broadcast.first;
+
+	rename(value);
+	block->quads.push_back(Quad(COPY, broadcast.second, value));
+    }
+
+    if (!limit.isConst()) {
+	check = create();
+	test(block, GE, limit, proc.constant(lowest + factor, counter.size), check);
+	block = check;
+	block->quads.push_back(Quad(SUB, last, limit, proc.constant(factor, counter.size)));
+    }
+
+    check = create();
+    test(block, LE, counter, last, check);
+    block = check;
+
+
+    /* Test that the array stored precedes or is far enough past each
+       other array loaded. */
+
+    for (auto &base : bases) {
+	if (base == stored || (base.isAddress() && stored.isAddress()))
+	    continue;
+
+	Operand first = stored, second = base;
+
+	rename(first);
+	rename(second);
+	distance = proc.temp(SIZEOF_PTR);
+	block->quads.push_back(Quad(SUB, distance, first, second));
+
+	check = create();
+	rest = create();
+	test(block, GT, distance, proc.constant(0, SIZEOF_PTR), check);
+	block->next[1] = rest;
+	test(check, GE, distance, proc.constant(VECTOR_SIZE, SIZEOF_PTR), rest);
+	block = rest;
+    }
+
+
+    /* The vector loop and then the test for any remaining iterations. */
+
+    body_block = create();
+    rest = create();
+    block->quads.push_back(Quad(JUMP));
+    block->next[0] = body_block;
+
+    body_block->quads = body;
+    body_block->quads.push_back(Quad(ADD, counter, counter, proc.constant(factor, counter.size)));
+    test(body_block, LE, counter, last, body_block);
+    body_block->next[1] = rest;
+    body_block->count = loop->count / factor;
+
+    test(rest, LT, counter, limit, loop);
+    rest->next[1] = exit;
+
+    loop->count -= min(loop->count, body_block->count * factor);
+
+
+    /* Enter the new blocks instead of the loop. */
+
+    for (auto pred : loop->preds)
+	if (pred != loop)
+	    for (i = 0; i < pred->successors(); i ++)
+		if (pred->next[i] == loop)
+		    pred->next[i] = added[0];
+
+    for (i = 0; proc.blocks[i] != loop; i ++)
+	continue;
+
+    proc.blocks.insert(proc.blocks.begin() + i, added.begin(), added.end());
+    return true;
+}
+
+
+/*
+ * Function:	Procedure::vectorizeLoops
+ *
+ * Description:	Vectorize each loop of this procedure that can be, linking
+ *		the graph again if any were.
+ */
+
+void Procedure::vectorizeLoops()
+{
+    vector<BasicBlock *> loops;
+    bool changed = false;
+    unsigned i;
+
+
+    for (auto block : blocks)
+	if (block->next[0] == block || block->next[1] == block)
+	    loops.push_back(block);
+
+    for (auto loop : loops)
+	changed = vectorize(*this, loop) || changed;
+
+    if (!changed)
+	return;
+
+    for (i = 0; i < blocks.size(); i ++)
+	blocks[i]->number = i;
+
+    link();
+}